@@ -11,10 +11,14 @@
   of Measure objects (also in some form of container).
 */
 
+#include <atomic>
 #include <stdexcept>
 #include <regex>
+#include <limits>
 
 #include "area.h"
+#include "memory.h"
+#include "search.h"
 
 #define REGEX_ISO_639_3 "^[a-z]{3}$"
 
@@ -32,18 +36,35 @@ using json = nlohmann::json;
   @example
     Area("W06000023");
 */
-Area::Area(std::string &local_authority_code) noexcept : area_code(local_authority_code) {
-	names.clear();
-	measures.clear();
-}
+Area::Area(std::string &local_authority_code)
+	: area_code(local_authority_code),
+	  contents(std::allocate_shared<Contents>(ArenaAllocator<Contents>())) {}
 
 /**
- * Destructor for the Area object.
+ * Destructor for the Area object. The names and Measures are left to any
+ * copies of the Area still sharing them.
  */
 Area::~Area() {
 	this->area_code = "";
-	names.clear();
-	measures.clear();
+}
+
+/**
+  Retrieve the names and Measures of this Area to change them, first taking a
+  copy of them if they are shared with another copy of the Area.
+
+  @return
+    The names and Measures of this Area, shared with no other Area
+*/
+Area::Contents& Area::own() {
+	if (contents.use_count() > 1) {
+		//from the same Arena as the names and Measures, as their copies are.
+		ArenaAllocator<Contents> allocator(contents->measures.get_allocator());
+		contents = std::allocate_shared<Contents>(allocator, *contents);
+	} else {
+		//the other copies may have been released on other threads; see what they did first.
+		std::atomic_thread_fence(std::memory_order_acquire);
+	}
+	return *contents;
 }
 
 /**
@@ -59,13 +80,13 @@ Area& Area::operator=(const Area &other) {
 	this->area_code = other.getLocalAuthorityCode();
 
 	//update all name values from the rhs object. Conflicting items will be overwritten.
-	for(const auto &it : other.names) {
+	for(const auto &it : other.contents->names) {
 		tmp = it.first;
 		this->setName(tmp, it.second);
 	}
 
 	//update all measures from the rhs object. Conflicting items will be overwritten.
-	for(const auto &it : other.measures) {
+	for(const auto &it : other.contents->measures) {
 		this->setMeasure(it.first, it.second);
 	}
 
@@ -112,7 +133,7 @@ std::string Area::getLocalAuthorityCode() const noexcept{
 */
 std::string Area::getName(const std::string &lang) const {
 	try {
-		return names.at(lang);
+		return contents->names.at(lang);
 	} catch (std::out_of_range &e) {
 		throw std::out_of_range("No Name found for key " + lang);
 	}
@@ -151,10 +172,11 @@ void Area::setName(std::string lang, const std::string &name) {
 		throw std::invalid_argument("Area::setName: Language code must be three alphabetical letters only");
 	}
 
+	AreaNames &names = own().names;
 	auto did_insert = names.insert(std::pair<std::string, std::string>(lang, name));
 	//check to see if there is an existing value that needs to be overwritten.
 	if(!did_insert.second) {
-		this->names[lang] = name;
+		names[lang] = name;
 	}
 }
 
@@ -166,7 +188,8 @@ void Area::setName(std::string lang, const std::string &name) {
     The codename for the measure you want to retrieve
 
   @return
-    A Measure object
+    A Measure object, which may be shared with copies of this Area, so use
+    editMeasure() to change it
 
   @throws
     std::out_of_range if there is no measure with the given code, throwing
@@ -186,12 +209,44 @@ Measure& Area::getMeasure(const std::string &key) const {
 	std::transform(lower_key.begin(), lower_key.end(), lower_key.begin(), ::tolower);
 
 	try {
-		return (Measure &) (measures.at(lower_key));
+		return (Measure &) (contents->measures.at(lower_key));
 	} catch (std::out_of_range &e){
 		throw std::out_of_range("No measure found matching " + lower_key);
 	}
 }
 
+/**
+  Retrieve a Measure object to change it, given its codename. Unlike
+  getMeasure(), the Measure is first copied if it is shared with a copy of
+  this Area, so the change is only seen through this Area.
+
+  @param key
+    The codename for the measure you want to change
+
+  @return
+    A Measure object belonging to this Area alone
+
+  @throws
+    std::out_of_range if there is no measure with the given code, as with
+    getMeasure()
+
+  @example
+    Area area("W06000023");
+    area.setMeasure("Pop", Measure("Pop", "Population"));
+    Area snapshot(area);
+    area.editMeasure("pop").setValue(2010, 1.0); // snapshot is unchanged
+*/
+Measure& Area::editMeasure(const std::string &key) {
+	std::string lower_key = key;
+	std::transform(lower_key.begin(), lower_key.end(), lower_key.begin(), ::tolower);
+
+	//look the measure up before taking a copy, so a missing one copies nothing.
+	if (contents->measures.count(lower_key) == 0) {
+		throw std::out_of_range("No measure found matching " + lower_key);
+	}
+	return own().measures.at(lower_key);
+}
+
 /**
   Add a particular Measure to this Area object. Note that the Measure's
   codename should be converted to lowercase.
@@ -229,13 +284,13 @@ void Area::setMeasure(const std::string &key, const Measure &measure) {
 
 	try {
 		//try to get any measure that already exists at the key location.
-		Measure &old = (this->getMeasure(tmp));
+		Measure &old = (this->editMeasure(tmp));
 
 		//if we got this far then we need to update the existing measure with data from the new measure.
 		old = measure;
 
 	} catch (std::out_of_range &e) {
-		measures.insert(std::pair<std::string, Measure>(tmp, measure));
+		own().measures.insert(std::pair<std::string, Measure>(tmp, measure));
 	}
 }
 
@@ -261,7 +316,120 @@ void Area::setMeasure(const std::string &key, const Measure &measure) {
     auto size = area.size();
 */
 int Area::size() const noexcept{
-	return measures.size();
+	return contents->measures.size();
+}
+
+/**
+  Retrieve every name for this Area, keyed by language code.
+
+  @return
+    A read-only reference to the map of language codes to names
+
+  @example
+    Area area("W06000023");
+    area.setName("eng", "Powys");
+    auto name = area.getNames().at("eng");
+*/
+const AreaNames& Area::getNames() const noexcept {
+	return contents->names;
+}
+
+/**
+  Retrieve every Measure in this Area, keyed by lowercase codename.
+
+  @return
+    A read-only reference to the map of codenames to Measures
+
+  @example
+    Area area("W06000023");
+    ...
+    for (const auto &it : area.getMeasures()) {
+      std::cout << it.second;
+    }
+*/
+const AreaMeasures& Area::getMeasures() const noexcept {
+	return contents->measures;
+}
+
+/**
+  Remove the Measure with the given codename from this Area. The search is
+  case insensitive, as with getMeasure().
+
+  @param key
+    The codename of the Measure to remove
+
+  @return
+    true if a Measure was removed, false if there was no such Measure
+
+  @example
+    Area area("W06000023");
+    area.setMeasure("pop", Measure("pop", "Population"));
+    area.removeMeasure("Pop"); // returns true
+*/
+bool Area::removeMeasure(const std::string &key) {
+
+	std::string lower_key = key;
+	std::transform(lower_key.begin(), lower_key.end(), lower_key.begin(), ::tolower);
+
+	if (contents->measures.count(lower_key) == 0) {
+		return false;
+	}
+	return own().measures.erase(lower_key) > 0;
+}
+
+/**
+  Estimate the number of bytes this Area occupies, including the object itself,
+  its names and every Measure it contains. Names and Measures shared with
+  copies of the Area are counted in full by each of them.
+
+  @return
+    The estimated footprint of the Area in bytes
+
+  @example
+    Area area("W06000023");
+    area.setName("eng", "Powys");
+    auto bytes = area.memoryUsage();
+*/
+size_t Area::memoryUsage() const noexcept {
+	using namespace BethYw::Memory;
+
+	size_t bytes = sizeof(Area) + stringHeapUsage(area_code);
+	bytes += allocationSize(SHARED_BLOCK_HEADER + sizeof(Contents));
+
+	for(const auto &it : contents->names) {
+		bytes += allocationSize(mapNodeSize<std::string, std::string>());
+		bytes += stringHeapUsage(it.first) + stringHeapUsage(it.second);
+	}
+
+	//the Measure object itself lives inside the map node, so only count its heap usage.
+	for(const auto &it : contents->measures) {
+		bytes += allocationSize(mapNodeSize<std::string, Measure>());
+		bytes += stringHeapUsage(it.first);
+		bytes += it.second.memoryUsage() - sizeof(Measure);
+	}
+
+	return bytes;
+}
+
+/**
+  Add the bytes used by each of this Area's Measures (including the map node
+  holding it) to a running total keyed by Measure codename.
+
+  @param usage
+    Map of Measure codename to bytes that will be added to
+
+  @example
+    std::map<std::string, size_t> usage;
+    area.addMemoryUsageByMeasure(usage);
+*/
+void Area::addMemoryUsageByMeasure(std::map<std::string, size_t> &usage) const {
+	using namespace BethYw::Memory;
+
+	for(const auto &it : contents->measures) {
+		usage[it.first] += allocationSize(mapNodeSize<std::string, Measure>())
+						   + stringHeapUsage(it.first)
+						   + it.second.memoryUsage() - sizeof(Measure);
+	}
 }
 
 /**
@@ -294,6 +462,37 @@ int Area::size() const noexcept{
     std::cout << area << std::endl;
 */
 std::ostream& operator<<(std::ostream &os, const Area &obj) {
+	return obj.print(os, 0, std::numeric_limits<unsigned int>::max());
+}
+
+/**
+  Output the names of this Area and its values from one year to another,
+  inclusive, as operator<< does for every year. A measure with values but none
+  in the range is left out, as it would be had the range been given as a years
+  filter when importing.
+
+  @param os
+    The output stream to write to
+
+  @param first_year
+    The first year to output
+
+  @param last_year
+    The last year to output
+
+  @param measure_codes
+    The codes of the measures to output, or nullptr for every measure
+
+  @return
+    Reference to the output stream
+
+  @example
+    Area area("W06000023");
+    ...
+    area.print(std::cout, 2010, 2015);
+*/
+std::ostream& Area::print(std::ostream &os, unsigned int first_year, unsigned int last_year,
+						 const std::unordered_set<std::string> *measure_codes) const {
 
 	std::string eng_name;
 	bool has_eng = true;
@@ -302,7 +501,7 @@ std::ostream& operator<<(std::ostream &os, const Area &obj) {
 
 	//get the name of the area in english.
 	try {
-		eng_name = obj.names.at("eng");
+		eng_name = contents->names.at("eng");
 	} catch (std::out_of_range &e) {
 		eng_name = "";
 		has_eng = false;
@@ -310,7 +509,7 @@ std::ostream& operator<<(std::ostream &os, const Area &obj) {
 
 	//get the name of the area in welsh.
 	try {
-		cym_name = obj.names.at("cym");
+		cym_name = contents->names.at("cym");
 	} catch (std::out_of_range &e) {
 		cym_name = "";
 		has_welsh = false;
@@ -328,15 +527,23 @@ std::ostream& operator<<(std::ostream &os, const Area &obj) {
 		os << "Unnamed";
 	}
 
-	os << " (" << obj.getLocalAuthorityCode() << ")" << std::endl;
+	os << " (" << getLocalAuthorityCode() << ")" << std::endl;
 
 	//output all measures to the stream. If there are no measures then we output <no measures>.
-	if (obj.size() == 0) {
-		os << "<no measures>" << std::endl;
-	} else {
-		for(auto &it : obj.measures) {
-			os << it.second << std::endl;
+	bool printed = false;
+	for(auto &it : contents->measures) {
+		if (measure_codes != nullptr && measure_codes->count(it.first) == 0) {
+			continue;
 		}
+		const MeasureRange range = it.second.getValues(first_year, last_year);
+		if (range.empty() && it.second.size() != 0) {
+			continue;
+		}
+		os << range << std::endl;
+		printed = true;
+	}
+	if (!printed) {
+		os << "<no measures>" << std::endl;
 	}
 
 	return os;
@@ -369,11 +576,11 @@ bool Area::operator==(const Area &rhs) const{
 	unsigned int num_matches = 0;
 
 	//if the sizes do not match then they cannot have the same names.
-	if(this->names.size() == rhs.names.size()) {
+	if(this->contents->names.size() == rhs.contents->names.size()) {
 		try {
 			//try and match all values from one object, if a key does not exist in the other object
 			//then we need to catch the exception.
-			for(const auto &it : this->names) {
+			for(const auto &it : this->contents->names) {
 				if(it.second == rhs.getName(it.first)) {
 					num_matches++;
 				}
@@ -385,7 +592,7 @@ bool Area::operator==(const Area &rhs) const{
 		}
 
 		//check if all of the values matched.
-		if(num_matches == this->names.size()) {
+		if(num_matches == this->contents->names.size()) {
 			match_names = true;
 		}
 	}
@@ -398,7 +605,7 @@ bool Area::operator==(const Area &rhs) const{
 		try {
 			//try and match all values from one object, if a key does not exist in the other object
 			//then we need to catch the exception.
-			for(const auto &it : this->measures) {
+			for(const auto &it : this->contents->measures) {
 				if(rhs.getMeasure(it.first) == it.second) {
 					num_matches++;
 				}
@@ -407,7 +614,7 @@ bool Area::operator==(const Area &rhs) const{
 			num_matches = -1;
 		}
 
-		if(num_matches == this->measures.size()) {
+		if(num_matches == this->contents->measures.size()) {
 			match_data = true;
 		}
 	}
@@ -424,13 +631,29 @@ bool Area::operator==(const Area &rhs) const{
  * @param a Area object to be converted.
  */
 void to_json(json& j, const Area& a) {
+	to_json(j, a, 0, std::numeric_limits<unsigned int>::max(), nullptr);
+}
+
+/**
+ * Converts the object into a JSON string with only the values from one year
+ * to another, inclusive, and adds it to a JSON object. A measure with values
+ * but none in the range is left out.
+ *
+ * @param j JSON object that the data will be attached to.
+ * @param a Area object to be converted.
+ * @param first_year The first year to convert.
+ * @param last_year The last year to convert.
+ * @param measure_codes The codes of the measures to convert, or nullptr for every measure.
+ */
+void to_json(json& j, const Area& a, unsigned int first_year, unsigned int last_year,
+			 const std::unordered_set<std::string> *measure_codes) {
 	json area_as_json;
 
 	json names;
 	json measures;
 
 	//dump the names map into the json object. the json lib handles the conversion for us.
-	for(auto &it : a.names) {
+	for(auto &it : a.contents->names) {
 		names.emplace(it.first, it.second);
 	}
 	area_as_json.emplace("names", names);
@@ -439,10 +662,17 @@ void to_json(json& j, const Area& a) {
 	//NOTE: couldn't write the to_json method the same way for the measure
 	//		as i was getting an issue where another empty object was being
 	//		created to encapsulate the measures.
-	if(!a.measures.empty()) {
-		for(auto &it : a.measures) {
-			measures.emplace(it.first, it.second.getValuesAsJSON());
+	for(auto &it : a.contents->measures) {
+		if (measure_codes != nullptr && measure_codes->count(it.first) == 0) {
+			continue;
 		}
+		const MeasureRange range = it.second.getValues(first_year, last_year);
+		if (range.empty() && it.second.size() != 0) {
+			continue;
+		}
+		measures.emplace(it.first, range.getValuesAsJSON());
+	}
+	if(!measures.empty()) {
 		area_as_json.emplace("measures", measures);
 	}
 
@@ -451,7 +681,10 @@ void to_json(json& j, const Area& a) {
 }
 
 /**
- * Checks to see if a given area exists within an area filter.
+ * Checks to see if a given area exists within an area filter. A term of the
+ * filter matches if it is part of the area's code or one of its names, ignoring
+ * case and accents (see search.h), or if it is a regular expression that
+ * matches one of them.
  *
  * @param area_filter Pointer to an unordered set of strings that contains the strings to match to the area.
  * @param area Area that will be checked.
@@ -459,36 +692,44 @@ void to_json(json& j, const Area& a) {
  */
 bool checkIfAreaMatchesFilter(const Area &area, const std::unordered_set<std::string> *filter) {
 
-	bool match = false;
-	std::string area_regex_pattern;
-	std::regex regex;
-	std::string area_auth_code;
-	std::string curr_name;
-
-	//if the filter is a null pointer or empty then match is set to true.
+	//if the filter is a null pointer or empty then every area matches.
 	if(filter == nullptr || filter->empty()) {
-		match = true;
-	} else {
-		for(const auto &code : *filter) {
+		return true;
+	}
+
+	//the code and names are only folded once, and only if a term needs them.
+	std::vector<std::string> folded;
 
+	for(const auto &code : *filter) {
+		if(isAreaPattern(code)) {
 			//case insensitive regex pattern
-			area_regex_pattern = "^.*" + code +".*$";
-			regex.assign(area_regex_pattern, std::regex_constants::icase);
+			const std::regex regex("^.*" + code + ".*$", std::regex_constants::icase);
 
-			//check if the area code matches the regex pattern.
+			//check if the area code or any of the names match the regex pattern.
 			if(std::regex_match(area.area_code, regex)) {
-				match = true;
-			} else {
-				//check if any of the names match the regex pattern.
-				for(const auto &name : area.names) {
-					curr_name = name.second;
-					if(std::regex_match(curr_name, regex)) {
-						match = true;
-					}
+				return true;
+			}
+			for(const auto &name : area.contents->names) {
+				if(std::regex_match(name.second, regex)) {
+					return true;
 				}
 			}
+			continue;
+		}
+
+		if(folded.empty()) {
+			folded.push_back(foldAreaText(area.area_code));
+			for(const auto &name : area.contents->names) {
+				folded.push_back(foldAreaText(name.second));
+			}
+		}
+		const std::string term = foldAreaText(code);
+		for(const auto &text : folded) {
+			if(text.find(term) != std::string::npos) {
+				return true;
+			}
 		}
 	}
 
-	return match;
+	return false;
 }
\ No newline at end of file
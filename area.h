@@ -15,35 +15,67 @@
 
 #include <string>
 #include <map>
+#include <memory>
 #include <unordered_set>
 
 #include "lib_json.hpp"
 #include "measure.h"
+#include "arena.h"
+
+/*
+  The names of an Area keyed by language, and its Measures keyed by codename.
+  Nodes come from the current Arena (see arena.h) if there is one.
+*/
+using AreaNames = std::map<std::string, std::string, std::less<std::string>,
+						   ArenaAllocator<std::pair<const std::string, std::string>>>;
+using AreaMeasures = std::map<std::string, Measure, std::less<std::string>,
+							  ArenaAllocator<std::pair<const std::string, Measure>>>;
 
 /*
   An Area object consists of a unique authority code, a container for names
   for the area in any number of different languages, and a container for the
   Measures objects.
+
+  The names and Measures are shared by copies of an Area until one of them is
+  changed, when that copy takes a copy of its own, so copying an Area (e.g.
+  into a new snapshot of the data, see snapshot.h) does not copy its values.
 */
 class Area {
  private:
+	struct Contents {
+		AreaNames names;
+		AreaMeasures measures;
+	};
+
 	std::string area_code;
-	std::map<std::string, std::string> names;
-	std::map<std::string, Measure> measures;
+	std::shared_ptr<Contents> contents;
+
+	Contents& own();
 
  public:
-	explicit Area(std::string &local_authority_code) noexcept;
+	explicit Area(std::string &local_authority_code);
+	Area(const Area &other) = default;
 	~Area();
 	Area& operator=(const Area &other);
 	std::string getLocalAuthorityCode() const noexcept;
 	std::string getName(const std::string &lang) const;
 	void setName(std::string lang, const std::string &name);
 	Measure& getMeasure(const std::string &key) const;
+	Measure& editMeasure(const std::string &key);
 	void setMeasure(const std::string &key, const Measure &measure);
 	int size() const noexcept;
+	const AreaNames& getNames() const noexcept;
+	const AreaMeasures& getMeasures() const noexcept;
+	bool removeMeasure(const std::string &key);
+	size_t memoryUsage() const noexcept;
+	void addMemoryUsageByMeasure(std::map<std::string, size_t> &usage) const;
+	std::ostream& print(std::ostream &os, unsigned int first_year, unsigned int last_year,
+						const std::unordered_set<std::string> *measure_codes = nullptr) const;
 	friend std::ostream& operator<<(std::ostream &os, const Area &obj);
 	bool operator==(const Area &rhs) const;
 	friend void to_json(nlohmann::json& j, const Area& a);
+	friend void to_json(nlohmann::json& j, const Area& a, unsigned int first_year, unsigned int last_year,
+						const std::unordered_set<std::string> *measure_codes);
 	friend bool checkIfAreaMatchesFilter(const Area &area, const std::unordered_set<std::string> *filter);
 };
 
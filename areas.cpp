@@ -12,8 +12,14 @@
   various populate() functions) and creating the Area and Measure objects.
 */
 
+#include <algorithm>
 #include <stdexcept>
+#include <exception>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <set>
 #include <string>
 #include <tuple>
 #include <regex>
@@ -21,24 +27,52 @@
 #include "lib_json.hpp"
 #include "datasets.h"
 #include "areas.h"
+#include "memory.h"
+#include "projection.h"
+#include "writer.h"
+#include "columnar.h"
+#include "scheduler.h"
+#include "pipeline.h"
+#include "search.h"
 
 /*
   An alias for the imported JSON parsing library.
 */
 using json = nlohmann::json;
 
+/*
+  The number of areas in each task rebuilding the stale quantile sketches.
+*/
+static const size_t QUANTILE_AREAS_PER_TASK = 4096;
+
+/*
+  The number of areas in each task rendering NDJSON.
+*/
+static const size_t NDJSON_AREAS_PER_TASK = 64;
+
+/*
+  Whether a measure is output in a view of its years: one with values but none
+  in the view is left out (see Areas::setYearView()).
+*/
+static bool isInView(const MeasureRange &range) noexcept {
+	return !range.empty() || range.getMeasure().size() == 0;
+}
+
 /**
-  Constructor for an Areas object.
+  Constructor for an Areas object. Its containers allocate from the current
+  Arena, if there is one, and it keeps that Arena alive for as long as it
+  exists.
 
   @example
     Areas data = Areas();
 */
-Areas::Areas() {
+Areas::Areas() : arena(Arena::currentShared()) {
 	areas_container.clear();
 }
 
 /**
-  Destructor for the Areas object.
+  Destructor for the Areas object. The containers are emptied before the
+  Arena they allocate from can be released.
  */
 Areas::~Areas() {
 	areas_container.clear();
@@ -74,10 +108,16 @@ void Areas::setArea(const std::string &auth_code, const Area &area) {
 		Area &old = (this->getArea(auth_code));
 
 		//if we got this far then we need to update the existing area with data from the new area.
+		//the roll-ups its values are in are updated by taking them out and putting them back.
+		hierarchy.areaRemoved(old);
+		addToQuantiles(area, &old);
 		old = area;
+		hierarchy.areaAdded(old);
 
 	} catch (std::out_of_range &e) {
-		areas_container.insert(std::pair<std::string, Area>(auth_code, area));
+		auto it = areas_container.insert(std::pair<std::string, Area>(auth_code, area)).first;
+		hierarchy.areaAdded(it->second);
+		addToQuantiles(it->second, nullptr);
 	}
 }
 
@@ -126,8 +166,697 @@ Area &Areas::getArea(const std::string &auth_code) const {
     
     auto size = areas.size(); // returns 1
 */
-int Areas::size() const {
-	return areas_container.size();
+int Areas::size() const {
+	return areas_container.size();
+}
+
+/**
+  Iterators over the Areas in the container, in order of local authority code,
+  so that an Areas instance can be used in a range-based for loop.
+
+  @return
+    A read-only iterator to the first Area, or past the last Area
+
+  @example
+    Areas data = Areas();
+    ...
+    for (const auto &it : data) {
+      std::cout << it.first << std::endl;
+    }
+*/
+AreasContainer::const_iterator Areas::begin() const noexcept {
+	return areas_container.cbegin();
+}
+
+AreasContainer::const_iterator Areas::end() const noexcept {
+	return areas_container.cend();
+}
+
+/**
+  Retrieve the local authority codes of every Area within the container.
+
+  @return
+    An unordered set of local authority codes
+
+  @example
+    Areas data = Areas();
+    ...
+    auto codes = data.getAreaCodes();
+*/
+StringFilterSet Areas::getAreaCodes() const {
+	StringFilterSet codes;
+
+	for (const auto &it : areas_container) {
+		codes.insert(it.first);
+	}
+
+	return codes;
+}
+
+/**
+  Remove the Area with the given local authority code, if there is one.
+
+  @param auth_code
+    The local authority code of the Area to remove
+
+  @return
+    The number of Areas removed (0 or 1)
+
+  @example
+    Areas data = Areas();
+    ...
+    data.removeArea("W06000023");
+*/
+size_t Areas::removeArea(const std::string &auth_code) {
+	auto it = areas_container.find(auth_code);
+	if (it == areas_container.end()) {
+		return 0;
+	}
+
+	hierarchy.areaRemoved(it->second);
+	removeFromQuantiles(it->second);
+	areas_container.erase(it);
+	return 1;
+}
+
+/**
+  Estimate the number of bytes held by this Areas instance, including every
+  Area and Measure inside it.
+
+  @return
+    The estimated footprint of the Areas instance in bytes
+
+  @example
+    Areas data = Areas();
+    ...
+    std::cerr << data.memoryUsage() << " bytes" << std::endl;
+*/
+size_t Areas::memoryUsage() const noexcept {
+	using namespace BethYw::Memory;
+
+	size_t bytes = sizeof(Areas);
+	for (const auto &it : areas_container) {
+		bytes += allocationSize(mapNodeSize<std::string, Area>());
+		bytes += stringHeapUsage(it.first);
+		bytes += it.second.memoryUsage() - sizeof(Area);
+	}
+
+	return bytes;
+}
+
+/**
+  Break the memory held by Measures down by Measure codename, summed across
+  every Area. Area names and the Area objects themselves are not included.
+
+  @return
+    A map of Measure codename to the estimated bytes used by that Measure
+
+  @example
+    Areas data = Areas();
+    ...
+    for (auto &it : data.memoryUsageByMeasure()) {
+      std::cerr << it.first << ": " << it.second << std::endl;
+    }
+*/
+std::map<std::string, size_t> Areas::memoryUsageByMeasure() const {
+	std::map<std::string, size_t> usage;
+
+	for (const auto &it : areas_container) {
+		it.second.addMemoryUsageByMeasure(usage);
+	}
+
+	return usage;
+}
+
+/**
+  Remove a Measure from every Area in this Areas instance.
+
+  @param code
+    The (case insensitive) codename of the Measure to remove
+
+  @return
+    The estimated number of bytes released
+
+  @example
+    Areas data = Areas();
+    ...
+    data.removeMeasure("pop");
+*/
+size_t Areas::removeMeasure(const std::string &code) {
+	size_t before = memoryUsage();
+
+	std::string lower = code;
+	std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+	quantiles.invalidateMeasure(lower);
+
+	for (auto &it : areas_container) {
+		if (hierarchy.empty()) {
+			it.second.removeMeasure(code);
+		} else {
+			hierarchy.areaRemoved(it.second);
+			it.second.removeMeasure(code);
+			hierarchy.areaAdded(it.second);
+		}
+	}
+
+	return before - memoryUsage();
+}
+
+/**
+  Replace a Measure of an Area with another, or remove it. Unlike
+  Area::setMeasure(), which merges the values of the two, the Area is left
+  with only the values of the new Measure, and the roll-ups of the Area's
+  parents (see hierarchy.h) are kept up to date.
+
+  @param auth_code
+    The local authority code of the Area
+
+  @param key
+    The codename of the Measure
+
+  @param measure
+    The new Measure, or nullptr to remove it
+
+  @throws
+    std::out_of_range if there is no Area with the local authority code
+
+  @example
+    Measure measure("pop:yoy", "Population, % change on the year before");
+    ...
+    data.replaceMeasure("W06000011", "pop:yoy", &measure);
+*/
+void Areas::replaceMeasure(const std::string &auth_code, const std::string &key, const Measure *measure) {
+	Area &area = getArea(auth_code);
+
+	if (hierarchy.empty() && !quantiles.isEnabled()) {
+		area.removeMeasure(key);
+		if (measure != nullptr) {
+			area.setMeasure(key, *measure);
+		}
+		return;
+	}
+
+	std::string code = key;
+	std::transform(code.begin(), code.end(), code.begin(), ::tolower);
+
+	std::map<unsigned int, double> old_values;
+	auto existing = area.getMeasures().find(code);
+	if (existing != area.getMeasures().end()) {
+		old_values.insert(existing->second.getValues().begin(), existing->second.getValues().end());
+	}
+
+	area.removeMeasure(code);
+	if (measure != nullptr) {
+		area.setMeasure(code, *measure);
+	}
+
+	//every year that was or is in the Measure is a change to the roll-ups.
+	std::map<unsigned int, double> new_values;
+	auto replaced = area.getMeasures().find(code);
+	if (replaced != area.getMeasures().end()) {
+		new_values.insert(replaced->second.getValues().begin(), replaced->second.getValues().end());
+	}
+	for (const auto &it : old_values) {
+		auto now = new_values.find(it.first);
+		quantiles.invalidate(code, it.first);
+		if (!hierarchy.empty()) {
+			hierarchy.valueChanged(area, code, it.first, true, it.second,
+								   now != new_values.end(), now != new_values.end() ? now->second : 0.0);
+		}
+	}
+	for (const auto &it : new_values) {
+		if (old_values.count(it.first) == 0) {
+			quantiles.add(code, it.first, it.second);
+			if (!hierarchy.empty()) {
+				hierarchy.valueChanged(area, code, it.first, false, 0.0, true, it.second);
+			}
+		}
+	}
+}
+
+/**
+  The hierarchy of the Areas (see hierarchy.h), which is captured from the
+  datasets that have one and keeps roll-ups of the measures of each parent's
+  areas.
+
+  @return
+    The Hierarchy
+
+  @example
+    Areas data = Areas();
+    data.getHierarchy().setWeightMeasure("pop");
+    ...
+    auto rollups = data.getHierarchy().getRollUps("W92000004");
+*/
+const Hierarchy& Areas::getHierarchy() const noexcept {
+	return hierarchy;
+}
+
+Hierarchy& Areas::getHierarchy() noexcept {
+	return hierarchy;
+}
+
+/**
+  Add the links of another Areas instance's hierarchy to this one, e.g. one
+  a dataset was imported into on its own. The roll-ups are made from the
+  values in this instance.
+
+  @param other
+    The other Areas instance
+
+  @example
+    data.mergeHierarchy(staged);
+*/
+void Areas::mergeHierarchy(const Areas &other) {
+	for (const auto &it : other.hierarchy.getParents()) {
+		hierarchy.setParent(it.first, it.second, lookup());
+	}
+}
+
+/**
+  @return
+    A function that finds an Area in this instance by its local authority
+    code, for the Hierarchy
+*/
+AreaLookup Areas::lookup() const {
+	return [this](const std::string &code) -> const Area * {
+		auto it = areas_container.find(code);
+		return it != areas_container.end() ? &it->second : nullptr;
+	};
+}
+
+/**
+  Set one value of a Measure in an Area, adding the Measure if the Area does
+  not have it, and apply the change to the roll-ups of the Area's parents.
+
+  @param area
+    The Area
+
+  @param codename
+    The codename of the Measure, in any case
+
+  @param label
+    The label of the Measure, if it is added
+
+  @param year
+    The year of the value
+
+  @param value
+    The value
+*/
+void Areas::setAreaValue(Area &area, const std::string &codename, const std::string &label,
+						 unsigned int year, double value) {
+	//measures are keyed by their lowercase codename, e.g. the "Pop" of complete-popu1009-pop.csv is "pop".
+	std::string code = codename;
+	std::transform(code.begin(), code.end(), code.begin(), ::tolower);
+	if (importSkips(code)) {
+		return;
+	}
+
+	using namespace BethYw::Memory;
+	bool had_old = false;
+	double old_value = 0.0;
+	size_t added = 0;
+
+	try {
+		Measure &m = area.editMeasure(code);
+		auto it = m.getValues().find(year);
+		if (it != m.getValues().end()) {
+			had_old = true;
+			old_value = it->second;
+		} else {
+			added = allocationSize(mapNodeSize<unsigned int, double>());
+		}
+		m.setValue(year, value);
+	} catch (std::out_of_range &e) {
+		Measure new_measure = Measure(code, label);
+		new_measure.setValue(year, value);
+		area.setMeasure(new_measure.getCodename(), new_measure);
+		added = allocationSize(mapNodeSize<std::string, Measure>()) + stringHeapUsage(code)
+				+ new_measure.memoryUsage() - sizeof(Measure);
+	}
+
+	if (!hierarchy.empty()) {
+		hierarchy.valueChanged(area, code, year, had_old, old_value, true, value);
+	}
+	if (had_old) {
+		quantiles.invalidate(code, year);
+	} else {
+		quantiles.add(code, year, value);
+	}
+
+	chargeImport(added);
+}
+
+/**
+  Set the limit on the memory the dataset being imported may add, or
+  nullptr for none. The caller keeps ownership of the budget, which records
+  what was added and dropped, and must reset it once the import is done.
+
+  @param budget
+    The budget of the next import, or nullptr
+
+  @example
+    ImportBudget import;
+    import.headroom = limit - data.memoryUsage();
+    data.setImportBudget(&import);
+    data.populate(...);
+    data.setImportBudget(nullptr);
+*/
+void Areas::setImportBudget(ImportBudget *budget) noexcept {
+	import_budget = budget;
+}
+
+/**
+  Set the function called with every row of the datasets imported next (see
+  ImportObserver in areas.h), or an empty function for none.
+
+  @param observer
+    The function to call with each row
+
+  @example
+    CatalogEntry contents;
+    data.setImportObserver([&contents](const IngestRow &row) { contents.add(row); });
+    data.populate(...);
+    data.setImportObserver(ImportObserver());
+*/
+void Areas::setImportObserver(const ImportObserver &observer) {
+	import_observer = observer;
+}
+
+//whether the values of a measure (by lowercase codename) are being skipped because it was dropped.
+bool Areas::importSkips(const std::string &code) const {
+	return import_budget != nullptr && !import_budget->dropped.empty()
+		   && std::find(import_budget->dropped.begin(), import_budget->dropped.end(), code) != import_budget->dropped.end();
+}
+
+//add the bytes a value added to the import's total, dropping measures or stopping if it is over budget.
+void Areas::chargeImport(size_t bytes) {
+	if (import_budget == nullptr) {
+		return;
+	}
+	ImportBudget &budget = *import_budget;
+	budget.added += bytes;
+
+	while (budget.added > budget.headroom) {
+		std::string largest;
+		size_t largest_bytes = 0;
+		if (budget.degrade) {
+			for (const auto &it : memoryUsageByMeasure()) {
+				if (budget.existingMeasures.count(it.first) == 0 && it.second > largest_bytes) {
+					largest = it.first;
+					largest_bytes = it.second;
+				}
+			}
+		}
+		if (largest.empty()) {
+			budget.exceeded = true;
+			throw std::runtime_error("Memory budget exceeded");
+		}
+
+		const size_t released = removeMeasure(largest);
+		budget.added -= std::min(budget.added, released);
+		budget.dropped.push_back(largest);
+	}
+}
+
+/**
+  Start matching areas against the terms of an --areas filter. The matches
+  worked out for the same terms before are kept, so the areas of areas.csv
+  that populateFromAuthorityCodeCSV() resolved are not matched again when
+  the datasets are imported.
+
+  @param filter
+    The terms of the --areas argument
+*/
+void Areas::resolveAreasFilter(const StringFilterSet &filter) {
+	if (filter != areas_filter_terms) {
+		areas_filter_terms = filter;
+		areas_filter_matches.clear();
+	}
+}
+
+/**
+  Check whether an area matches the --areas filter last given to
+  resolveAreasFilter(). An area is looked up by its code, so it is only
+  matched against the terms (see checkIfAreaMatchesFilter()) the first time
+  its code is seen.
+
+  @param area
+    The area to check
+
+  @param filter
+    The terms of the --areas argument, as given to resolveAreasFilter()
+
+  @return
+    True if the area matches the filter
+*/
+bool Areas::isAreaInFilter(const Area &area, const StringFilterSet &filter) {
+	auto found = areas_filter_matches.find(area.getLocalAuthorityCode());
+	if (found == areas_filter_matches.end()) {
+		found = areas_filter_matches.emplace(area.getLocalAuthorityCode(),
+											 checkIfAreaMatchesFilter(area, &filter)).first;
+	}
+	return found->second;
+}
+
+/**
+  Add the values of an Area to the quantile sketches (see quantile.h). A
+  value that replaces one in an existing Area makes its sketch stale instead,
+  since a sketch cannot take the old value out.
+
+  @param area
+    The Area whose values are being added
+
+  @param existing
+    The Area its values are about to be merged into, or nullptr if it is new
+*/
+void Areas::addToQuantiles(const Area &area, const Area *existing) {
+	if (!quantiles.isEnabled()) {
+		return;
+	}
+
+	for (const auto &measure : area.getMeasures()) {
+		const MeasureValues *old = nullptr;
+		if (existing != nullptr) {
+			auto it = existing->getMeasures().find(measure.first);
+			if (it != existing->getMeasures().end()) {
+				old = &it->second.getValues();
+			}
+		}
+
+		for (const auto &value : measure.second.getValues()) {
+			if (old != nullptr && old->count(value.first) != 0) {
+				quantiles.invalidate(measure.first, value.first);
+			} else {
+				quantiles.add(measure.first, value.first, value.second);
+			}
+		}
+	}
+}
+
+/**
+  Mark the quantile sketches of every value of an Area that is about to be
+  removed as stale.
+
+  @param area
+    The Area
+*/
+void Areas::removeFromQuantiles(const Area &area) {
+	if (!quantiles.isEnabled()) {
+		return;
+	}
+
+	for (const auto &measure : area.getMeasures()) {
+		for (const auto &value : measure.second.getValues()) {
+			quantiles.invalidate(measure.first, value.first);
+		}
+	}
+}
+
+/**
+  Start keeping a quantile sketch (see quantile.h) of each measure in each
+  year, across the areas. This must be done before the data is imported.
+
+  @param k
+    The k of each sketch, or 0 for exact quantiles
+
+  @example
+    Areas data = Areas();
+    data.enableQuantiles();
+    ...
+    double median = data.getQuantiles().find("dens", 2010)->quantile(0.5);
+*/
+void Areas::enableQuantiles(size_t k) noexcept {
+	quantiles.enable(k);
+}
+
+/**
+  Retrieve the quantile sketches, first building again any that are stale.
+  The Areas are shared out between tasks on the shared TaskScheduler (see
+  scheduler.h), each of which builds sketches of its share of the stale
+  measures and years, and these are then merged in order, so the sketches do
+  not depend on the number of threads. Every sketch is then ranked (see
+  QuantileSketch::rank()), so once this has been called, calling it again
+  and asking the sketches for quantiles only reads them, until the data
+  changes, and can be done on any number of threads at once.
+
+  @return
+    The quantile sketches
+
+  @example
+    for (const auto &it : data.getQuantiles().getSketches()) {
+      std::cout << it.first.first << " " << it.first.second << ": "
+                << it.second.quantile(0.5) << std::endl;
+    }
+*/
+const QuantileIndex& Areas::getQuantiles() const {
+	if (quantiles.getStale().empty()) {
+		quantiles.rank();
+		return quantiles;
+	}
+
+	using Key = std::pair<std::string, unsigned int>;
+	const std::set<Key> stale = quantiles.getStale();
+	std::set<std::string> stale_measures;
+	for (const auto &key : stale) {
+		stale_measures.insert(key.first);
+	}
+
+	std::vector<const Area *> sources;
+	for (const auto &it : areas_container) {
+		sources.push_back(&it.second);
+	}
+
+	const size_t tasks = std::max<size_t>(1, (sources.size() + QUANTILE_AREAS_PER_TASK - 1) / QUANTILE_AREAS_PER_TASK);
+	std::vector<std::map<Key, QuantileSketch>> partials(tasks);
+
+	parallelFor(TaskScheduler::shared(), sources.size(), QUANTILE_AREAS_PER_TASK, [&](size_t first, size_t last) {
+		auto &partial = partials[first / QUANTILE_AREAS_PER_TASK];
+		for (size_t i = first; i < last; i++) {
+			for (const auto &measure : sources[i]->getMeasures()) {
+				if (stale_measures.count(measure.first) == 0) {
+					continue;
+				}
+				for (const auto &value : measure.second.getValues()) {
+					Key key(measure.first, value.first);
+					if (stale.count(key) != 0) {
+						partial.emplace(key, QuantileSketch(quantiles.getK())).first->second.add(value.second);
+					}
+				}
+			}
+		}
+	});
+
+	for (size_t t = 1; t < tasks; t++) {
+		for (const auto &it : partials[t]) {
+			auto merged = partials[0].emplace(it.first, QuantileSketch(quantiles.getK())).first;
+			merged->second.merge(it.second);
+		}
+	}
+	for (const auto &key : stale) {
+		auto it = partials[0].find(key);
+		quantiles.replace(key.first, key.second, it != partials[0].end() ? it->second : QuantileSketch(0));
+	}
+	quantiles.rank();
+
+	return quantiles;
+}
+
+/**
+  Set the years that are output, by toJSON(), toNDJSON(), toCSV(),
+  toColumnar() and operator<<, and ranked by (see ranking.h), without changing
+  the imported data, so different ranges of years can be output from one
+  import. Each measure's range is found by binary search as it is output, and
+  none of its values are copied, so output costs only the number of values in
+  the range. A measure with values but none in the range is left out, as it
+  would be had the range been given as a years filter when importing.
+
+  @param years
+    The first and last year, inclusive, or <0,0> for every year
+
+  @example
+    Areas data = Areas();
+    ...
+    data.setYearView(YearFilterTuple(2010, 2015));
+    std::cout << data.toJSON();
+*/
+void Areas::setYearView(const YearFilterTuple &years) noexcept {
+	year_view = years;
+}
+
+/**
+  @return
+    The years that are output, or <0,0> for every year
+*/
+const YearFilterTuple& Areas::getYearView() const noexcept {
+	return year_view;
+}
+
+/**
+  Set the measures that are output, by toJSON(), toNDJSON(), toCSV(),
+  toColumnar() and operator<<, and by the other ways of outputting Areas
+  (e.g. printCorrelation()), without changing the imported data. Measures
+  imported only because others are calculated from them (e.g. the measures
+  of a derived measure, see derived.h) can then be left out of the output,
+  while still being there to calculate from.
+
+  @param measures
+    The codes of the measures to output, in lowercase, or an empty set for
+    every measure
+
+  @example
+    Areas data = Areas();
+    ...
+    data.setMeasureView({"dpp"});
+    std::cout << data;
+*/
+void Areas::setMeasureView(const StringFilterSet &measures) {
+	measure_view = measures;
+}
+
+/**
+  @return
+    The codes of the measures that are output, or an empty set for every
+    measure
+*/
+const StringFilterSet& Areas::getMeasureView() const noexcept {
+	return measure_view;
+}
+
+/**
+  Whether a measure is output (see setMeasureView()).
+
+  @param code
+    The code of the measure, in lowercase
+
+  @return
+    true if the measure is output
+*/
+bool Areas::isMeasureInView(const std::string &code) const noexcept {
+	return measure_view.empty() || measure_view.count(code) > 0;
+}
+
+/**
+  Retrieve a view of the values of a measure in the years that are output
+  (see setYearView()).
+
+  @param measure
+    A Measure of one of these Areas
+
+  @return
+    A view of the measure's values in the years that are output
+
+  @example
+    for (const auto &value : data.getValues(area.getMeasure("pop"))) {
+      std::cout << value.first << ": " << value.second << std::endl;
+    }
+*/
+MeasureRange Areas::getValues(const Measure &measure) const {
+	if (std::get<1>(year_view) == 0) {
+		return MeasureRange(measure, measure.getValues().begin(), measure.getValues().end());
+	}
+	return measure.getValues(std::get<0>(year_view), std::get<1>(year_view));
 }
 
 /**
@@ -231,6 +960,10 @@ void Areas::populateFromAuthorityCodeCSV(
 	//if the filter is null or empty then we load everything.
 	bool load_all = (areasFilter == nullptr || areasFilter->empty());
 
+	//with a filter, every area is indexed and the filter's terms are found in the index once they all are.
+	std::vector<Area> rows;
+	AreaIndex index;
+
 	while (std::getline(is, line_buff)) {
 
 		//clear the stream after every iteration.
@@ -254,12 +987,23 @@ void Areas::populateFromAuthorityCodeCSV(
 		tmp = "cym";
 		a.setName(tmp, value);
 
-		//check to see if the current area needs to be inserted into the map.
-		if (!load_all) {
-			if (checkIfAreaMatchesFilter(a, areasFilter)) {
-				this->setArea(a.getLocalAuthorityCode(), a);
-			}
+		if (load_all) {
+			this->setArea(a.getLocalAuthorityCode(), a);
 		} else {
+			index.add(a.getLocalAuthorityCode(), {a.getName("eng"), a.getName("cym")});
+			rows.push_back(a);
+		}
+	}
+
+	//the areas that match are remembered, by code, so the datasets' rows for them are not matched again.
+	if (!load_all) {
+		resolveAreasFilter(*areasFilter);
+		for (const auto &a : rows) {
+			areas_filter_matches[a.getLocalAuthorityCode()] = false;
+		}
+		for (const uint32_t found : index.find(*areasFilter)) {
+			const Area &a = rows[found];
+			areas_filter_matches[a.getLocalAuthorityCode()] = true;
 			this->setArea(a.getLocalAuthorityCode(), a);
 		}
 	}
@@ -377,156 +1121,309 @@ void Areas::populateFromWelshStatsJSON(
 	const YearFilterTuple *const yearsFilter)
 noexcept(false) {
 
-	//convert the stream into a JSON object.
-	json j;
-	is >> j;
+	importWelshStatsJSON(is, nullptr, cols, areasFilter, measuresFilter, yearsFilter);
+}
+
+namespace {
 
-	unsigned int year_range_start,
-		year_range_end,
-		current_year;
+/*
+  Decodes the rows of a StatsWales JSON page into IngestRows (see pipeline.h),
+  and checks them against the measures and years filters. Nothing here needs
+  the Areas instance, so rows are decoded by the parser stage of an import as
+  they are parsed, and only the rows that pass are merged.
+*/
+class WelshStatsJSONRows {
+ private:
+	const BethYw::SourceColumnMapping &cols;
+	BethYw::SourceColumnMapping::const_iterator hierarchy_col;
 
-	std::string current_local_auth_code,
-		current_area_name_eng,
-		current_measure_code,
-		current_measure_label,
-		measure_code_tag,
-		measure_label_tag,
-		tmp;
+	//the measures filter in lowercase, which is empty if every measure is loaded.
+	StringFilterSet measures;
 
-	double current_value;
+	bool load_all_years;
+	unsigned int year_range_start;
+	unsigned int year_range_end;
 
-	//if the filters are null or empty then we load everything.
-	bool load_all_areas = (areasFilter == nullptr || areasFilter->empty());
-	bool load_all_measures = (measuresFilter == nullptr || measuresFilter->empty());
+	std::string tmp;
 
-	bool load_all_years = false;
-	bool should_load;
-	bool match;
+ public:
+	WelshStatsJSONRows(const BethYw::SourceColumnMapping &cols,
+					   const StringFilterSet *const measuresFilter,
+					   const YearFilterTuple *const yearsFilter)
+		: cols(cols), hierarchy_col(cols.find(BethYw::SourceColumn::AUTH_HIERARCHY)),
+		  load_all_years(true), year_range_start(0), year_range_end(0) {
+		if (measuresFilter != nullptr) {
+			for (auto &it : *measuresFilter) {
+				//convert the key to lowercase to make matching easier.
+				tmp = it;
+				std::transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
+				measures.insert(tmp);
+			}
+		}
 
-	//check to see if all years need to be loaded.
-	if (yearsFilter != nullptr) {
-		year_range_start = std::get<0>(*yearsFilter);
-		year_range_end = std::get<1>(*yearsFilter);
-		if (year_range_end == 0) {
-			load_all_years = true;
+		//check to see if all years need to be loaded.
+		if (yearsFilter != nullptr && std::get<1>(*yearsFilter) != 0) {
+			load_all_years = false;
+			year_range_start = std::get<0>(*yearsFilter);
+			year_range_end = std::get<1>(*yearsFilter);
 		}
-	} else {
-		load_all_years = true;
 	}
 
-	//iterate through every element in the JSON object.
-	for (auto &el : j["value"].items()) {
-		auto &data = el.value();
-
-		should_load = true;
+	/*
+	  Decode a row into `row`, returning whether it passes the filters. Throws
+	  std::out_of_range if there are not enough columns in cols.
+	*/
+	bool decode(json &data, IngestRow &row) {
 		try {
-			current_local_auth_code = data[cols.at(BethYw::SourceColumn::AUTH_CODE)];
-			current_area_name_eng = data[cols.at(BethYw::SourceColumn::AUTH_NAME_ENG)];
+			row.code = data[cols.at(BethYw::SourceColumn::AUTH_CODE)].get<std::string>();
+			row.name = data[cols.at(BethYw::SourceColumn::AUTH_NAME_ENG)].get<std::string>();
 
 			//year value is stored as a string so we need to convert to a u_int.
 			tmp = data[cols.at(BethYw::SourceColumn::YEAR)];
-			current_year = std::stoi(tmp);
+			row.year = std::stoi(tmp);
 
 			//check if the value is stored as a string or a double in the file.
 			//for some reason aqi values are stored as strings and not doubles???
 			if (data[cols.at(BethYw::SourceColumn::VALUE)].is_string()) {
 				tmp = data[cols.at(BethYw::SourceColumn::VALUE)];
-				current_value = std::stod(tmp);
+				row.value = std::stod(tmp);
 			} else {
-				current_value = data[cols.at(BethYw::SourceColumn::VALUE)];
+				row.value = data[cols.at(BethYw::SourceColumn::VALUE)];
 			}
 
 			//measure code could be held in either MEASURE_CODE or SINGLE_MEASURE_CODE, so we try both.
 			try {
-				measure_code_tag = cols.at(BethYw::SourceColumn::MEASURE_CODE);
-				measure_label_tag = cols.at(BethYw::SourceColumn::MEASURE_NAME);
+				const std::string &measure_code_tag = cols.at(BethYw::SourceColumn::MEASURE_CODE);
+				const std::string &measure_label_tag = cols.at(BethYw::SourceColumn::MEASURE_NAME);
 
-				current_measure_code = data[measure_code_tag];
-				current_measure_label = data[measure_label_tag];
+				row.measure = data[measure_code_tag].get<std::string>();
+				row.label = data[measure_label_tag].get<std::string>();
 			} catch (std::out_of_range &e1) {
-				current_measure_code = cols.at(BethYw::SourceColumn::SINGLE_MEASURE_CODE);
-				current_measure_label = cols.at(BethYw::SourceColumn::SINGLE_MEASURE_NAME);
+				row.measure = cols.at(BethYw::SourceColumn::SINGLE_MEASURE_CODE);
+				row.label = cols.at(BethYw::SourceColumn::SINGLE_MEASURE_NAME);
 			}
 
 			//set the measure code to lowercase for ease of use.
-			std::transform(current_measure_code.begin(),
-						   current_measure_code.end(),
-						   current_measure_code.begin(),
-						   ::tolower);
+			std::transform(row.measure.begin(), row.measure.end(), row.measure.begin(), ::tolower);
 
 		} catch (std::out_of_range &e2) {
 			throw std::out_of_range("Not enough columns in cols!");
 		}
 
 		//check to see if we should load the data from this entry.
-		if (!(load_all_years || ((year_range_start <= current_year) && (current_year <= year_range_end)))) {
-			should_load = false;
+		if (!(load_all_years || ((year_range_start <= row.year) && (row.year <= year_range_end)))) {
+			return false;
+		}
+		if (!measures.empty() && measures.count(row.measure) == 0) {
+			return false;
 		}
 
-		//check if the current value exists in the measure filter
-		if (!load_all_measures) {
-			match = false;
-			for (auto &it : *measuresFilter) {
+		//the area's parent, if the dataset has a column for it (see hierarchy.h).
+		row.hasParent = false;
+		if (hierarchy_col != cols.end()) {
+			auto parent = data.find(hierarchy_col->second);
+			if (parent != data.end() && parent->is_string()) {
+				row.parent = parent->get<std::string>();
+				row.hasParent = true;
+			}
+		}
+		return true;
+	}
+};
 
-				//convert the key to lowercase to make matching easier.
-				tmp = it;
-				std::transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
-				if (tmp == current_measure_code) {
-					match = true;
-				}
+} // namespace
+
+/**
+  Merge a row of a StatsWales JSON dataset, that has already been decoded and
+  checked against the measures and years filters, into the container. See
+  populateFromWelshStatsJSON() for details of the format and the filters.
+
+  @param row
+    The decoded row
+
+  @param areasFilter
+    An umodifiable pointer to set of umodifiable strings of areas to import,
+    or an empty set if all areas should be imported
+
+  @param findArea
+    Finds an Area in the container, for the hierarchy (see lookup())
+*/
+void Areas::mergeWelshStatsJSONRow(
+	const IngestRow &row,
+	const StringFilterSet *const areasFilter,
+	const AreaLookup &findArea) {
+
+	//if the filter is null or empty then we load everything.
+	bool load_all_areas = (areasFilter == nullptr || areasFilter->empty());
+
+	try {
+		//try and get the area, if it does not exist then catch the error and make a new one.
+		Area &a = this->getArea(row.code);
+
+		//check to see if the current area exists in the filter
+		if (load_all_areas || isAreaInFilter(a, *areasFilter)) {
+			//check to see if the measure exists in the area. if not then we create one.
+			setAreaValue(a, row.measure, row.label, row.year, row.value);
+			if (row.hasParent) {
+				hierarchy.setParent(row.code, row.parent, findArea);
 			}
-			should_load &= match;
 		}
+	} catch (std::out_of_range &e) {
+		//create a new area from the data parsed from the JSON file.
+		std::string code = row.code;
+		Area new_area = Area(code);
+		new_area.setName("eng", row.name);
+
+		//check to see if this new area exists in the area filter.
+		if (load_all_areas || isAreaInFilter(new_area, *areasFilter)) {
+			//no need to check if the measure exists because the area has only just been created.
+			Measure new_measure = Measure(row.measure, row.label);
+			if (importSkips(new_measure.getCodename())) {
+				return;
+			}
+			new_measure.setValue(row.year, row.value);
+			new_area.setMeasure(new_measure.getCodename(), new_measure);
 
-		if (should_load) {
-			try {
-				//try and get the area, if it does not exist then catch the error and make a new one.
-				Area &a = this->getArea(current_local_auth_code);
-
-				//check to see if the current area exists in the filter
-				if (load_all_areas || checkIfAreaMatchesFilter(a, areasFilter)) {
-					//check to see if the measure exists in the area. if not then we create one.
-					try {
-						a.getMeasure(current_measure_code).setValue(current_year, current_value);
-					} catch (std::out_of_range &e) {
-						Measure new_measure = Measure(current_measure_code, current_measure_label);
-						new_measure.setValue(current_year, current_value);
-						a.setMeasure(new_measure.getCodename(), new_measure);
-					}
-				}
-			} catch (std::out_of_range &e) {
-				//create a new area from the data parsed from the JSON file.
-				Area new_area = Area(current_local_auth_code);
-				tmp = "eng";
-				new_area.setName(tmp, current_area_name_eng);
-
-				//check to see if this new area exists in the area filter.
-				if (load_all_areas || checkIfAreaMatchesFilter(new_area, areasFilter)) {
-					//no need to check if the measure exists because the area has only just been created.
-					Measure new_measure = Measure(current_measure_code, current_measure_label);
-					new_measure.setValue(current_year, current_value);
-					new_area.setMeasure(new_measure.getCodename(), new_measure);
-
-					//add this new area to the areas map
-					this->setArea(current_local_auth_code, new_area);
-				}
+			//add this new area to the areas map
+			this->setArea(code, new_area);
+			if (row.hasParent) {
+				hierarchy.setParent(code, row.parent, findArea);
 			}
+
+			using namespace BethYw::Memory;
+			chargeImport(allocationSize(mapNodeSize<std::string, Area>()) + stringHeapUsage(code)
+						 + new_area.memoryUsage() - sizeof(Area));
 		}
 	}
+}
+
+/**
+  Import a StatsWales JSON dataset, of one page or several, through the
+  import pipeline (see pipeline.h): the rows are parsed, keeping only the keys
+  we read (see projection.h), and decoded on one thread while the input is
+  read on another, and merged on this one. See populateFromWelshStatsJSON()
+  and populateFromWelshStatsJSONPages() for details.
+
+  @param is
+    The input stream of the dataset (or its first page)
+
+  @param resolver
+    The PageResolver used to find the following pages, or nullptr for a
+    dataset of one page
+
+  @param cols
+    A map of the enum BethyYw::SourceColumnMapping (see datasets.h) to strings
+    that give the column header in the JSON file
+
+  @param areasFilter
+    An umodifiable pointer to set of umodifiable strings of areas to import,
+    or an empty set if all areas should be imported
+
+  @param measuresFilter
+    An umodifiable pointer to set of umodifiable strings of measures to import,
+    or an empty set if all measures should be imported
+
+  @param yearsFilter
+    An umodifiable pointer to an umodifiable tuple of two unsigned integers,
+    where if both values are 0, then all years should be imported
+
+  @throws
+    std::runtime_error if a parsing error occurs (e.g. due to a malformed file)
+    std::out_of_range if there are not enough columns in cols
+*/
+void Areas::importWelshStatsJSON(
+	std::istream &is,
+	const PageResolver *resolver,
+	const BethYw::SourceColumnMapping &cols,
+	const StringFilterSet *const areasFilter,
+	const StringFilterSet *const measuresFilter,
+	const YearFilterTuple *const yearsFilter) {
+
+	const JSONProjection projection(cols);
+	WelshStatsJSONRows rows(cols, measuresFilter, yearsFilter);
+	const AreaLookup find_area = lookup();
+	if (areasFilter != nullptr && !areasFilter->empty()) {
+		resolveAreasFilter(*areasFilter);
+	}
+
+	auto parse = [&](std::istream &page, const std::function<void(IngestRow &)> &emit) {
+		IngestRow row;
+		return parseProjectedWelshStatsJSON(page, projection, [&](json &data) {
+			const bool passes = rows.decode(data, row);
+			if (import_observer) {
+				import_observer(row);
+			}
+			if (passes) {
+				emit(row);
+			}
+		});
+	};
 
-	//clean up variables. Not exactly necessary but better safe than sorry.
-	current_local_auth_code = "";
-	current_area_name_eng = "";
-	current_measure_code = "";
-	current_measure_label = "";
-	measure_code_tag = "";
-	measure_label_tag = "";
-	tmp = "";
-
-	year_range_start = 0;
-	year_range_end = 0;
-	current_year = 0;
-	current_year = 0;
+	runIngestPipeline(is, resolver, parse, [&](const IngestRow &row) {
+		mergeWelshStatsJSONRow(row, areasFilter, find_area);
+	});
+}
+
+/**
+  Import a StatsWales JSON dataset that is split across several pages. The
+  first page is read from `is`, and the odata.nextLink at the end of each page
+  is handed to `resolver` to find the next one, until there is no link or the
+  resolver has no such page.
+
+  Pages go through the import pipeline (see pipeline.h) one after another,
+  so the next page is opened as soon as the link to it has been parsed, while
+  the rows of the page before are still being merged. Pages are merged in
+  order, so the result is the same as importing one file containing every
+  page.
+
+  @param is
+    The input stream of the first page
+
+  @param resolver
+    The PageResolver used to find the following pages
+
+  @param cols
+    A map of the enum BethyYw::SourceColumnMapping (see datasets.h) to strings
+    that give the column header in the JSON file
+
+  @param areasFilter
+    An umodifiable pointer to set of umodifiable strings of areas to import,
+    or an empty set if all areas should be imported
+
+  @param measuresFilter
+    An umodifiable pointer to set of umodifiable strings of measures to import,
+    or an empty set if all measures should be imported
+
+  @param yearsFilter
+    An umodifiable pointer to an umodifiable tuple of two unsigned integers,
+    where if both values are 0, then all years should be imported
+
+  @return
+    void
+
+  @throws
+    std::runtime_error if a parsing error occurs (e.g. due to a malformed file)
+    std::out_of_range if there are not enough columns in cols
+
+  @example
+    InputFile input("data/econ0080.json");
+    LocalPageResolver resolver("data/");
+
+    Areas data = Areas();
+    data.populateFromWelshStatsJSONPages(
+      input.open(),
+      resolver,
+      InputFiles::BIZ.COLS);
+*/
+void Areas::populateFromWelshStatsJSONPages(
+	std::istream &is,
+	const PageResolver &resolver,
+	const BethYw::SourceColumnMapping &cols,
+	const StringFilterSet *const areasFilter,
+	const StringFilterSet *const measuresFilter,
+	const YearFilterTuple *const yearsFilter)
+noexcept(false) {
+	importWelshStatsJSON(is, &resolver, cols, areasFilter, measuresFilter, yearsFilter);
 }
 
 /**
@@ -625,31 +1522,17 @@ noexcept(false) {
 		}
 	}
 
-	//load data from file into areas.
+	//load data from file into areas, through the import pipeline (see pipeline.h).
 	if (should_load) {
-
-		char delimiter = ',';
-		std::stringstream line_stream;
-		std::map<int, unsigned int> allowed_years;
-		double current_measure_value;
-		std::vector<double> values;
-
-		std::string line_buffer,
-			current_value,
-			current_area_code,
-			measure_code,
-			measure_label;
-
-		unsigned int current_year,
-			year_range_start,
-			year_range_end;
-
+		const std::string measure_code = cols.at(BethYw::SourceColumn::SINGLE_MEASURE_CODE);
+		const std::string measure_label = cols.at(BethYw::SourceColumn::SINGLE_MEASURE_NAME);
+		const std::string &code_header = cols.at(BethYw::SourceColumn::AUTH_CODE);
+		std::string observed_measure = measure_code;
+		std::transform(observed_measure.begin(), observed_measure.end(), observed_measure.begin(), ::tolower);
+
+		unsigned int year_range_start = 0,
+			year_range_end = 0;
 		bool load_all_years = false;
-		//if the filter is null or empty then we load everything.
-		bool load_all_areas = (areasFilter == nullptr || areasFilter->empty());
-
-		measure_code = cols.at(BethYw::SourceColumn::SINGLE_MEASURE_CODE);
-		measure_label = cols.at(BethYw::SourceColumn::SINGLE_MEASURE_NAME);
 
 		//check to see if all years need to be loaded.
 		if (yearsFilter != nullptr) {
@@ -662,85 +1545,102 @@ noexcept(false) {
 			load_all_years = true;
 		}
 
-		//place column headers into the line stream for validation.
-		std::getline(is, line_buffer);
-		line_stream << line_buffer;
+		//split each line into a row for each allowed year, on the parser's thread.
+		auto parse = [&](std::istream &page, const std::function<void(IngestRow &)> &emit) {
+			char delimiter = ',';
+			std::stringstream line_stream;
+			std::map<int, unsigned int> allowed_years;
+			std::vector<double> values;
+			std::string line_buffer,
+				current_value;
+			IngestRow row;
+
+			//place column headers into the line stream for validation.
+			std::getline(page, line_buffer);
+			line_stream << line_buffer;
 
-		line_buffer = "";
-		//check to see if the file header matches the column header.
-		std::getline(line_stream, line_buffer, delimiter);
-		if (line_buffer != cols.at(BethYw::SourceColumn::AUTH_CODE)) {
-			throw std::runtime_error("Malformed file!");
-		}
+			line_buffer = "";
+			//check to see if the file header matches the column header.
+			std::getline(line_stream, line_buffer, delimiter);
+			if (line_buffer != code_header) {
+				throw std::runtime_error("Malformed file!");
+			}
 
-		//read all year headers and add allowed years to the map.
-		int i = 0;
-		while (std::getline(line_stream, current_value, delimiter)) {
-			current_year = std::stoi(current_value);
+			//read all year headers and add allowed years to the map.
+			std::vector<unsigned int> years;
+			int i = 0;
+			while (std::getline(line_stream, current_value, delimiter)) {
+				unsigned int current_year = std::stoi(current_value);
+				years.push_back(current_year);
 
-			//if the current year is in range then we store it and its index into the map for later use.
-			if (load_all_years || ((current_year <= year_range_end) && (current_year >= year_range_start))) {
-				allowed_years.insert(std::pair<int, unsigned int>(i, current_year));
+				//if the current year is in range then we store it and its index into the map for later use.
+				if (load_all_years || ((current_year <= year_range_end) && (current_year >= year_range_start))) {
+					allowed_years.insert(std::pair<int, unsigned int>(i, current_year));
+				}
+				i++;
 			}
-			i++;
-		}
 
-		while (std::getline(is, line_buffer)) {
-			//clear values vector before re-use.
-			values.clear();
+			while (std::getline(page, line_buffer)) {
+				//clear values vector before re-use.
+				values.clear();
 
-			//clear and set the stream for the current line
-			line_stream.str("");
-			line_stream.clear();
-			line_stream << line_buffer;
+				//clear and set the stream for the current line
+				line_stream.str("");
+				line_stream.clear();
+				line_stream << line_buffer;
 
-			std::getline(line_stream, current_area_code, delimiter);
+				std::string current_area_code;
+				std::getline(line_stream, current_area_code, delimiter);
 
-			//load all yearly readings into the values array.
-			while (std::getline(line_stream, current_value, delimiter)) {
-				current_measure_value = std::stod(current_value);
-				values.push_back(current_measure_value);
-			}
+				//load all yearly readings into the values array.
+				while (std::getline(line_stream, current_value, delimiter)) {
+					values.push_back(std::stod(current_value));
+				}
 
-			//the map of allowed years gives us the indices of the values,
-			//so we loop through every year allowed to us and add the values to the measures.
-			for (const auto &it : allowed_years) {
-				try {
-					Area &a = this->getArea(current_area_code);
-
-					//check if the current area should be loaded
-					if (load_all_areas || checkIfAreaMatchesFilter(a, areasFilter)) {
-						try {
-							Measure &m = a.getMeasure(measure_code);
-							m.setValue(it.second, values[it.first]);
-						} catch (std::out_of_range &e) {
-							auto tmp_measure = Measure(measure_code, measure_label);
-							tmp_measure.setValue(it.second, values[it.first]);
-							a.setMeasure(tmp_measure.getCodename(), tmp_measure);
-						}
+				//an observer sees every year of the row, with its measure in lowercase as from a JSON dataset.
+				if (import_observer) {
+					row.code = current_area_code;
+					row.measure = observed_measure;
+					row.label = measure_label;
+					for (size_t y = 0; y < years.size(); y++) {
+						row.year = years[y];
+						row.value = y < values.size() ? values[y] : 0.0;
+						import_observer(row);
 					}
-					//if there is no area then we must just skip the entry
-				} catch (std::out_of_range &e) {}
+				}
+
+				//the map of allowed years gives us the indices of the values,
+				//so we hand on a row for every year allowed to us.
+				for (const auto &it : allowed_years) {
+					row.code = current_area_code;
+					row.measure = measure_code;
+					row.label = measure_label;
+					row.year = it.second;
+					row.value = values[it.first];
+					emit(row);
+				}
 			}
-		}
 
-		//clean up variables
-		line_buffer = "";
-		current_value = "";
-		current_area_code = "";
-		measure_code = "";
-		measure_label = "";
+			return std::string();
+		};
 
-		current_year = 0;
-		year_range_start = 0;
-		year_range_end = 0;
-		current_measure_value = 0;
+		//if the filter is null or empty then we load everything.
+		bool load_all_areas = (areasFilter == nullptr || areasFilter->empty());
+		if (!load_all_areas) {
+			resolveAreasFilter(*areasFilter);
+		}
 
-		line_stream.str("");
-		line_stream.clear();
+		runIngestPipeline(is, nullptr, parse, [&](const IngestRow &row) {
+			try {
+				Area &a = this->getArea(row.code);
 
-		allowed_years.clear();
-		values.clear();
+				//check if the current area should be loaded
+				if (load_all_areas || isAreaInFilter(a, *areasFilter)) {
+					setAreaValue(a, row.measure, row.label, row.year, row.value);
+				}
+				//if there is no area then we must just skip the entry
+			} catch (std::out_of_range &e) {}
+		});
 	}
 }
 
@@ -852,6 +1752,10 @@ void Areas::populate(std::istream &is,
     where if both values are 0, then all years should be imported, otherwise
     they should be treated as a the range of years to be imported
 
+  @param resolver
+    An optional PageResolver. If given, StatsWales JSON datasets are followed
+    across pages, see populateFromWelshStatsJSONPages()
+
   @return
     void
 
@@ -896,7 +1800,8 @@ void Areas::populate(
 	const BethYw::SourceColumnMapping &cols,
 	const StringFilterSet *const areasFilter,
 	const StringFilterSet *const measuresFilter,
-	const YearFilterTuple *const yearsFilter) {
+	const YearFilterTuple *const yearsFilter,
+	const PageResolver *const resolver) {
 
 	try {
 		switch (type) {
@@ -905,7 +1810,12 @@ void Areas::populate(
 			case BethYw::AuthorityByYearCSV:
 				populateFromAuthorityByYearCSV(is, cols, areasFilter, measuresFilter, yearsFilter);
 				break;
-			case BethYw::WelshStatsJSON: populateFromWelshStatsJSON(is, cols, areasFilter, measuresFilter, yearsFilter);
+			case BethYw::WelshStatsJSON:
+				if (resolver != nullptr) {
+					populateFromWelshStatsJSONPages(is, *resolver, cols, areasFilter, measuresFilter, yearsFilter);
+				} else {
+					populateFromWelshStatsJSON(is, cols, areasFilter, measuresFilter, yearsFilter);
+				}
 				break;
 			default: throw std::runtime_error("Areas::populate: Unexpected data type");
 		}
@@ -991,8 +1901,11 @@ std::string Areas::toJSON() const {
 	json j = {};
 
 	//convert each area into a json object and add to the parent json object.
+	const unsigned int first_year = std::get<0>(year_view);
+	const unsigned int last_year = std::get<1>(year_view) == 0 ? std::numeric_limits<unsigned int>::max() : std::get<1>(year_view);
+	const StringFilterSet *measures = measure_view.empty() ? nullptr : &measure_view;
 	for (const auto &it : areas_container) {
-		to_json(j, it.second);
+		to_json(j, it.second, first_year, last_year, measures);
 	}
 
 	//check if the json is empty.
@@ -1003,6 +1916,271 @@ std::string Areas::toJSON() const {
 	return j.dump();
 }
 
+/**
+  Write this Areas object as newline-delimited JSON: one self-contained JSON
+  object per line, for each area or for each measure of each area, in order of
+  their codes. Chunks of areas are rendered by tasks on the shared
+  TaskScheduler (see scheduler.h), a few per thread at a time, and written to
+  `os` in order through a BufferedWriter, in large blocks that are each
+  flushed, so a reader can start on the first areas while the rest are still
+  being rendered, and only the chunks being rendered are held in memory.
+
+  An area record is {"code": ..., "names": {...}, "measures": {...}}, with the
+  measures as in toJSON(), and a measure record is {"code": ..., "names":
+  {...}, "measure": ..., "label": ..., "values": {...}}. With measure records,
+  areas without measures are left out.
+
+  @param os
+    The output stream to write to
+
+  @param record
+    NDJSONByArea for a record per area, or NDJSONByMeasure for a record per
+    measure of each area
+
+  @example
+    Areas data = Areas();
+    ...
+    data.toNDJSON(std::cout, NDJSONByArea);
+*/
+void Areas::toNDJSON(std::ostream &os, NDJSONRecord record) const {
+	auto render = [this, record](std::string &out, const std::string &code, const Area &area) {
+		auto write = [&out](const json &j) {
+			out += j.dump();
+			out += '\n';
+		};
+
+		json names = json::object();
+		for (const auto &name : area.getNames()) {
+			names.emplace(name.first, name.second);
+		}
+
+		if (record == NDJSONByArea) {
+			json j = {{"code", code}, {"names", names}};
+			json measures = json::object();
+			for (const auto &measure : area.getMeasures()) {
+				const MeasureRange values = getValues(measure.second);
+				if (isMeasureInView(measure.first) && isInView(values)) {
+					measures.emplace(measure.first, values.getValuesAsJSON());
+				}
+			}
+			if (!measures.empty()) {
+				j.emplace("measures", measures);
+			}
+			write(j);
+			return;
+		}
+
+		for (const auto &measure : area.getMeasures()) {
+			const MeasureRange values = getValues(measure.second);
+			if (!isMeasureInView(measure.first) || !isInView(values)) {
+				continue;
+			}
+			write({{"code", code},
+				   {"names", names},
+				   {"measure", measure.first},
+				   {"label", measure.second.getLabel()},
+				   {"values", values.getValuesAsJSON()}});
+		}
+	};
+
+	std::vector<AreasContainer::const_iterator> entries;
+	for (auto it = areas_container.begin(); it != areas_container.end(); ++it) {
+		entries.push_back(it);
+	}
+
+	//a round of chunks is rendered at once, enough to keep every thread busy, and then written in order.
+	TaskScheduler &scheduler = TaskScheduler::shared();
+	const size_t round = NDJSON_AREAS_PER_TASK * scheduler.size() * 2;
+	std::vector<std::string> chunks;
+	BufferedWriter writer(os);
+
+	for (size_t start = 0; start < entries.size(); start += round) {
+		const size_t count = std::min(round, entries.size() - start);
+		chunks.assign((count + NDJSON_AREAS_PER_TASK - 1) / NDJSON_AREAS_PER_TASK, std::string());
+
+		parallelFor(scheduler, count, NDJSON_AREAS_PER_TASK, [&](size_t first, size_t last) {
+			std::string &out = chunks[first / NDJSON_AREAS_PER_TASK];
+			for (size_t i = start + first; i < start + last; i++) {
+				render(out, entries[i]->first, entries[i]->second);
+			}
+		});
+
+		for (const auto &chunk : chunks) {
+			writer.write(chunk);
+			writer.endRecord();
+		}
+	}
+
+	writer.flush();
+}
+
+/**
+  Write this Areas object as CSV, straight from the containers through a
+  BufferedWriter, so a large export is written in blocks as it goes.
+
+  In the wide layout there is a row for each measure of each area, with a
+  column for each year that any of them has (as in
+  complete-popu1009-pop.csv), and an empty cell where a measure has no value
+  for a year:
+
+    AuthorityCode,Measure,1991,2001,...
+    W06000011,pop,230100,223301,...
+
+  In the long layout there is a row for each value:
+
+    AuthorityCode,Measure,Year,Value
+    W06000011,pop,1991,230100
+
+  Values are written in their shortest exact decimal form, as in the JSON
+  output, and areas and measures are in order of their codes.
+
+  @param os
+    The output stream to write to
+
+  @param layout
+    CSVWide or CSVLong
+
+  @example
+    Areas data = Areas();
+    ...
+    data.toCSV(std::cout, CSVLong);
+*/
+void Areas::toCSV(std::ostream &os, CSVLayout layout) const {
+	BufferedWriter writer(os);
+
+	if (layout == CSVLong) {
+		writer.write("AuthorityCode,Measure,Year,Value\n");
+		for (const auto &area : areas_container) {
+			for (const auto &measure : area.second.getMeasures()) {
+				if (!isMeasureInView(measure.first)) {
+					continue;
+				}
+				for (const auto &value : getValues(measure.second)) {
+					writer.writeCSVField(area.first);
+					writer.write(',');
+					writer.writeCSVField(measure.first);
+					writer.write(',');
+					writer.writeUnsigned(value.first);
+					writer.write(',');
+					writer.writeDouble(value.second);
+					writer.write('\n');
+					writer.endRecord();
+				}
+			}
+		}
+		writer.flush();
+		return;
+	}
+
+	//the columns are every year of every measure.
+	std::set<unsigned int> years;
+	for (const auto &area : areas_container) {
+		for (const auto &measure : area.second.getMeasures()) {
+			if (!isMeasureInView(measure.first)) {
+				continue;
+			}
+			for (const auto &value : getValues(measure.second)) {
+				years.insert(value.first);
+			}
+		}
+	}
+
+	writer.write("AuthorityCode,Measure");
+	for (unsigned int year : years) {
+		writer.write(',');
+		writer.writeUnsigned(year);
+	}
+	writer.write('\n');
+
+	for (const auto &area : areas_container) {
+		for (const auto &measure : area.second.getMeasures()) {
+			const MeasureRange values = getValues(measure.second);
+			if (!isMeasureInView(measure.first) || !isInView(values)) {
+				continue;
+			}
+			writer.writeCSVField(area.first);
+			writer.write(',');
+			writer.writeCSVField(measure.first);
+
+			//walk the years and the measure's values (which are in year order) together.
+			auto value = values.begin();
+			for (unsigned int year : years) {
+				writer.write(',');
+				if (value != values.end() && value->first == year) {
+					writer.writeDouble(value->second);
+					value++;
+				}
+			}
+			writer.write('\n');
+			writer.endRecord();
+		}
+	}
+
+	writer.flush();
+}
+
+/**
+  Write all of the imported data in the BYWC binary columnar format (see
+  columnar.h for its layout), with a row for each value as in the long CSV
+  layout. The area and measure codes are dictionary-encoded, and each column
+  of a row group is written in one go from an array, so another program can
+  memory-map the file and use the columns without parsing them.
+
+  @param os
+    The output stream to write to, which should be opened in binary mode
+
+  @param rowGroupRows
+    The most rows in a row group
+
+  @throws
+    std::runtime_error if the output could not be written
+
+  @example
+    Areas data = Areas();
+    ...
+    std::ofstream file("popden.bywc", std::ios::binary);
+    data.toColumnar(file);
+*/
+void Areas::toColumnar(std::ostream &os, uint32_t rowGroupRows) const {
+	std::vector<std::string> areaCodes;
+	std::set<std::string> measureSet;
+	uint64_t rowCount = 0;
+	areaCodes.reserve(areas_container.size());
+	for (const auto &area : areas_container) {
+		areaCodes.push_back(area.first);
+		for (const auto &measure : area.second.getMeasures()) {
+			const MeasureRange values = getValues(measure.second);
+			if (isMeasureInView(measure.first) && isInView(values)) {
+				measureSet.insert(measure.first);
+				rowCount += values.size();
+			}
+		}
+	}
+
+	const std::vector<std::string> measureCodes(measureSet.begin(), measureSet.end());
+	std::map<std::string, uint32_t> measureIndexes;
+	for (uint32_t i = 0; i < measureCodes.size(); i++) {
+		measureIndexes[measureCodes[i]] = i;
+	}
+
+	ColumnarWriter writer(os, areaCodes, measureCodes, rowCount, rowGroupRows);
+	uint32_t areaIndex = 0;
+	for (const auto &area : areas_container) {
+		for (const auto &measure : area.second.getMeasures()) {
+			const MeasureRange values = getValues(measure.second);
+			if (values.empty() || !isMeasureInView(measure.first)) {
+				continue;
+			}
+			const uint32_t measureIndex = measureIndexes.at(measure.first);
+			for (const auto &value : values) {
+				writer.append(areaIndex, measureIndex, value.first, value.second);
+			}
+		}
+		areaIndex++;
+	}
+	writer.finish();
+}
+
 /**
   Overload the << operator to print all of the imported data.
 
@@ -1108,8 +2286,11 @@ std::string Areas::toJSON() const {
     std::cout << areas << std::end;
 */
 std::ostream &operator<<(std::ostream &os, const Areas &obj) {
+	const unsigned int first_year = std::get<0>(obj.year_view);
+	const unsigned int last_year = std::get<1>(obj.year_view) == 0 ? std::numeric_limits<unsigned int>::max() : std::get<1>(obj.year_view);
+	const StringFilterSet *measures = obj.measure_view.empty() ? nullptr : &obj.measure_view;
 	for (const auto &it : obj.areas_container) {
-		os << it.second << std::endl;
+		it.second.print(os, first_year, last_year, measures) << std::endl;
 	}
 
 	return os;
@@ -23,13 +23,22 @@
         +-> Areas A class that contains all Area objects.
  */
 
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <tuple>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "datasets.h"
 #include "area.h"
+#include "hierarchy.h"
+#include "quantile.h"
+#include "input.h"
+#include "columnar.h"
+#include "pipeline.h"
 
 /*
   An alias for filters based on strings such as categorisations e.g. area,
@@ -43,9 +52,62 @@ using StringFilterSet = std::unordered_set<std::string>;
 using YearFilterTuple = std::tuple<unsigned int, unsigned int>;
 
 /*
-  An alias for the data within an Areas object stores Area objects.
+  What each record of NDJSON output (see Areas::toNDJSON()) holds: an area
+  with all of its measures, or one measure of an area.
 */
-using AreasContainer = std::map<std::string, Area>;
+enum NDJSONRecord {
+	NDJSONNone,
+	NDJSONByArea,
+	NDJSONByMeasure
+};
+
+/*
+  The layout of CSV output (see Areas::toCSV()): a row for each measure of
+  each area with a column for each year, or a row for each value.
+*/
+enum CSVLayout {
+	CSVNone,
+	CSVWide,
+	CSVLong
+};
+
+/*
+  An alias for the data within an Areas object stores Area objects. Nodes come
+  from the current Arena (see arena.h) if there is one, which the Areas object
+  then shares ownership of.
+*/
+using AreasContainer = std::map<std::string, Area, std::less<std::string>,
+								ArenaAllocator<std::pair<const std::string, Area>>>;
+
+/*
+  A limit on the memory one dataset may add while it is being imported (see
+  loadDatasets() in bethyw.cpp). Areas estimates the bytes each value adds as
+  it is merged, so the limit is enforced as the dataset is imported rather
+  than once it has all been loaded. If the dataset goes over its headroom,
+  the largest measure it has introduced so far is dropped and the rest of
+  its values are skipped (degrade), or the import stops (abort, or when
+  there is nothing left to drop) with exceeded set.
+*/
+struct ImportBudget {
+	size_t headroom = 0;
+	bool degrade = true;
+	StringFilterSet existingMeasures;
+
+	size_t added = 0;
+	std::vector<std::string> dropped;
+	bool exceeded = false;
+};
+
+/*
+  Called with every row of a dataset as it is parsed, before the measures and
+  years filters are applied, on the parser's thread (see pipeline.h). For
+  example, loadDatasets() in bethyw.cpp records what a dataset contains for
+  its catalog (see catalog.h) while it is imported, rather than reading it
+  again afterwards. A dataset with a column for each year gives a row for
+  every year, whether or not it has a value, and none at all if its measure
+  is filtered out.
+*/
+using ImportObserver = std::function<void(const IngestRow &row)>;
 
 /*
   Areas is a class that stores all the data categorised by area. The 
@@ -60,13 +122,72 @@ using AreasContainer = std::map<std::string, Area>;
 class Areas {
  private:
 	AreasContainer areas_container;
+	Hierarchy hierarchy;
+	mutable QuantileIndex quantiles;
+	YearFilterTuple year_view;
+	StringFilterSet measure_view;
+	ImportBudget *import_budget = nullptr;
+	ImportObserver import_observer;
+
+	//whether each area matches the --areas filter, by code, for the terms they were worked out for.
+	StringFilterSet areas_filter_terms;
+	std::unordered_map<std::string, bool> areas_filter_matches;
+
+	//the Arena the containers allocate from, if any, which is only released once ~Areas() has emptied them.
+	std::shared_ptr<Arena> arena;
+
+	AreaLookup lookup() const;
+	bool importSkips(const std::string &code) const;
+	void chargeImport(size_t bytes);
+	void resolveAreasFilter(const StringFilterSet &filter);
+	bool isAreaInFilter(const Area &area, const StringFilterSet &filter);
+	void addToQuantiles(const Area &area, const Area *existing);
+	void removeFromQuantiles(const Area &area);
+	void setAreaValue(Area &area, const std::string &codename, const std::string &label,
+					  unsigned int year, double value);
+
+	void mergeWelshStatsJSONRow(
+		const IngestRow &row,
+		const StringFilterSet *const areas_filter,
+		const AreaLookup &find_area);
+
+	void importWelshStatsJSON(
+		std::istream &is,
+		const PageResolver *resolver,
+		const BethYw::SourceColumnMapping &cols,
+		const StringFilterSet *const areas_filter,
+		const StringFilterSet *const measures_filter,
+		const YearFilterTuple *const years_filter);
 
  public:
 	Areas();
+	Areas(const Areas &other) = default;
+	Areas &operator=(const Areas &other) = delete;
 	~Areas();
 	void setArea(const std::string &auth_code, const Area &area);
 	Area& getArea(const std::string &auth_code) const;
 	int size() const;
+	AreasContainer::const_iterator begin() const noexcept;
+	AreasContainer::const_iterator end() const noexcept;
+	StringFilterSet getAreaCodes() const;
+	size_t removeArea(const std::string &auth_code);
+	size_t memoryUsage() const noexcept;
+	std::map<std::string, size_t> memoryUsageByMeasure() const;
+	size_t removeMeasure(const std::string &code);
+	void setImportBudget(ImportBudget *budget) noexcept;
+	void setImportObserver(const ImportObserver &observer);
+	void replaceMeasure(const std::string &auth_code, const std::string &key, const Measure *measure);
+	const Hierarchy& getHierarchy() const noexcept;
+	Hierarchy& getHierarchy() noexcept;
+	void mergeHierarchy(const Areas &other);
+	void enableQuantiles(size_t k = QUANTILE_SKETCH_K) noexcept;
+	const QuantileIndex& getQuantiles() const;
+	void setYearView(const YearFilterTuple &years) noexcept;
+	const YearFilterTuple& getYearView() const noexcept;
+	void setMeasureView(const StringFilterSet &measures);
+	const StringFilterSet& getMeasureView() const noexcept;
+	bool isMeasureInView(const std::string &code) const noexcept;
+	MeasureRange getValues(const Measure &measure) const;
 
 	void populateFromAuthorityCodeCSV(
 		std::istream &is,
@@ -82,6 +203,15 @@ class Areas {
 		const YearFilterTuple *const years_filter = nullptr)
 	noexcept(false);
 
+	void populateFromWelshStatsJSONPages(
+		std::istream &is,
+		const PageResolver &resolver,
+		const BethYw::SourceColumnMapping &cols,
+		const StringFilterSet *const areas_filter = nullptr,
+		const StringFilterSet *const measures_filter = nullptr,
+		const YearFilterTuple *const years_filter = nullptr)
+	noexcept(false);
+
 	void populateFromAuthorityByYearCSV(
 		std::istream &is,
 		const BethYw::SourceColumnMapping &cols,
@@ -102,10 +232,14 @@ class Areas {
 		const BethYw::SourceColumnMapping &cols,
 		const StringFilterSet *const areas_filter = nullptr,
 		const StringFilterSet *const measures_filter = nullptr,
-		const YearFilterTuple *const years_filter = nullptr)
+		const YearFilterTuple *const years_filter = nullptr,
+		const PageResolver *const resolver = nullptr)
 	noexcept(false);
 
 	std::string toJSON() const;
+	void toNDJSON(std::ostream &os, NDJSONRecord record) const;
+	void toCSV(std::ostream &os, CSVLayout layout) const;
+	void toColumnar(std::ostream &os, uint32_t rowGroupRows = COLUMNAR_ROW_GROUP_ROWS) const;
 	friend std::ostream &operator<<(std::ostream &os, const Areas &obj);
 };
 
@@ -0,0 +1,165 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the implementation of Arena and ArenaScope. See the
+  header file for additional comments.
+ */
+
+#include <cstdint>
+#include <utility>
+
+#include "arena.h"
+
+//the Arena installed on each thread by ArenaScope, if any.
+static thread_local std::shared_ptr<Arena> current_arena;
+
+/**
+  Constructor for an empty Arena. No memory is reserved until the first
+  allocation.
+
+  @param blockSize
+    The size of the blocks memory is reserved in. Allocations bigger than a
+    quarter of this get a block of their own.
+
+  @example
+    auto arena = std::make_shared<Arena>();
+    ArenaScope scope(arena);
+*/
+Arena::Arena(size_t blockSize)
+	: block_size(blockSize > 0 ? blockSize : 1024 * 1024), next(nullptr), end(nullptr),
+	  allocations(0), bytes_used(0), bytes_reserved(0) {}
+
+/**
+  Reserve a new block of memory.
+
+  @param size
+    The size of the block
+
+  @return
+    The start of the block
+*/
+char *Arena::addBlock(size_t size) {
+	blocks.emplace_back(new char[size]);
+	bytes_reserved += size;
+	return blocks.back().get();
+}
+
+/**
+  Allocate memory from the Arena. This function is safe to call from several
+  threads at once.
+
+  @param bytes
+    The number of bytes to allocate
+
+  @param alignment
+    The alignment the memory must have, which must be a power of two
+
+  @return
+    A pointer to the memory, which stays valid until the Arena is destroyed
+
+  @throws
+    std::bad_alloc if a new block cannot be reserved
+
+  @example
+    Arena arena;
+    auto *values = static_cast<double *>(arena.allocate(10 * sizeof(double), alignof(double)));
+*/
+void *Arena::allocate(size_t bytes, size_t alignment) {
+	std::lock_guard<std::mutex> lock(mutex);
+	allocations++;
+	bytes_used += bytes;
+
+	//large allocations would waste most of a shared block, so they get their own, aligned within it.
+	if (bytes > block_size / 4) {
+		const uintptr_t block = (uintptr_t) addBlock(bytes + alignment);
+		return (void *) ((block + alignment - 1) & ~(uintptr_t) (alignment - 1));
+	}
+
+	uintptr_t aligned = ((uintptr_t) next + alignment - 1) & ~(uintptr_t) (alignment - 1);
+	if (next == nullptr || aligned + bytes > (uintptr_t) end) {
+		next = addBlock(block_size);
+		end = next + block_size;
+		aligned = ((uintptr_t) next + alignment - 1) & ~(uintptr_t) (alignment - 1);
+	}
+
+	next = (char *) (aligned + bytes);
+	return (void *) aligned;
+}
+
+/**
+  @return
+    The number of allocations made from the Arena
+*/
+size_t Arena::allocationCount() const noexcept {
+	return allocations;
+}
+
+/**
+  @return
+    The number of blocks of memory the Arena has reserved
+*/
+size_t Arena::blockCount() const noexcept {
+	return blocks.size();
+}
+
+/**
+  @return
+    The number of bytes allocated from the Arena
+*/
+size_t Arena::bytesUsed() const noexcept {
+	return bytes_used;
+}
+
+/**
+  @return
+    The number of bytes the Arena has reserved in blocks
+*/
+size_t Arena::bytesReserved() const noexcept {
+	return bytes_reserved;
+}
+
+/**
+  @return
+    The Arena installed on this thread by an ArenaScope, or nullptr if there
+    is none
+*/
+Arena *Arena::current() noexcept {
+	return current_arena.get();
+}
+
+/**
+  @return
+    A share in the ownership of the Arena installed on this thread by an
+    ArenaScope, or nullptr if there is none
+*/
+std::shared_ptr<Arena> Arena::currentShared() noexcept {
+	return current_arena;
+}
+
+/**
+  Constructor for a scope in which containers allocate from `arena`.
+
+  @param arena
+    The Arena to allocate from, or nullptr to allocate from the heap
+
+  @example
+    {
+      ArenaScope scope(std::make_shared<Arena>());
+      Areas data = Areas(); // data allocates from the arena
+    }
+*/
+ArenaScope::ArenaScope(std::shared_ptr<Arena> arena) : previous(std::move(current_arena)) {
+	current_arena = std::move(arena);
+}
+
+/**
+  Destructor for the scope, which reinstates the Arena that was current
+  before it.
+*/
+ArenaScope::~ArenaScope() {
+	current_arena = std::move(previous);
+}
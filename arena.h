@@ -0,0 +1,137 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains an arena allocator for the containers in Areas, Area and
+  Measure.
+
+  Importing the datasets creates a very large number of small map nodes (for
+  areas, names, measures and years), each of which is normally a separate
+  call to new and, at exit, to delete. An Arena instead hands out memory from
+  a few large blocks, and frees them all at once when it is destroyed.
+
+  Containers pick up the arena to allocate from when they are constructed:
+  whichever Arena was installed on the current thread by an ArenaScope, or
+  the normal heap if there is none. The allocator only holds a pointer to
+  the Arena, so creating, copying and destroying a container costs no more
+  than it does on the heap. The Arena is kept alive by the Areas instance
+  constructed in the same scope, which shares ownership of it, so an Area or
+  Measure made in an ArenaScope must not outlive the Areas it belongs to.
+
+  Memory given back to an Arena is not reused until the whole Arena is freed,
+  so arenas suit data that is built up and then kept, like a load of datasets.
+ */
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+/*
+  A region of memory that is allocated from by bumping a pointer through large
+  blocks, and freed all at once when it is destroyed.
+*/
+class Arena {
+ private:
+	const size_t block_size;
+	std::vector<std::unique_ptr<char[]>> blocks;
+	char *next;
+	char *end;
+	size_t allocations;
+	size_t bytes_used;
+	size_t bytes_reserved;
+	std::mutex mutex;
+
+	char *addBlock(size_t size);
+
+ public:
+	explicit Arena(size_t blockSize = 1024 * 1024);
+	Arena(const Arena &) = delete;
+	Arena &operator=(const Arena &) = delete;
+
+	void *allocate(size_t bytes, size_t alignment);
+	size_t allocationCount() const noexcept;
+	size_t blockCount() const noexcept;
+	size_t bytesUsed() const noexcept;
+	size_t bytesReserved() const noexcept;
+
+	static Arena *current() noexcept;
+	static std::shared_ptr<Arena> currentShared() noexcept;
+	friend class ArenaScope;
+};
+
+/*
+  Installs an Arena as the current Arena of this thread for the lifetime of
+  the scope, restoring the previous one (if any) at the end.
+*/
+class ArenaScope {
+ private:
+	std::shared_ptr<Arena> previous;
+ public:
+	explicit ArenaScope(std::shared_ptr<Arena> arena);
+	~ArenaScope();
+	ArenaScope(const ArenaScope &) = delete;
+	ArenaScope &operator=(const ArenaScope &) = delete;
+};
+
+/*
+  A standard allocator that allocates from the Arena that was current on this
+  thread when it was constructed, or with new if there was none. Copies of a
+  container keep allocating from the same Arena as the original. It does not
+  own the Arena (see Areas).
+*/
+template <typename T>
+class ArenaAllocator {
+ private:
+	Arena *arena;
+
+	template <typename U>
+	friend class ArenaAllocator;
+
+ public:
+	using value_type = T;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	ArenaAllocator() noexcept : arena(Arena::current()) {}
+
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U> &other) noexcept : arena(other.arena) {}
+
+	T *allocate(size_t n) {
+		if (arena != nullptr) {
+			return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+		}
+		return static_cast<T *>(::operator new(n * sizeof(T)));
+	}
+
+	void deallocate(T *p, size_t) noexcept {
+		//memory in an arena is released when the whole arena is.
+		if (arena == nullptr) {
+			::operator delete(p);
+		}
+	}
+
+	Arena *getArena() const noexcept {
+		return arena;
+	}
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U> &rhs) const noexcept {
+		return arena == rhs.arena;
+	}
+
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U> &rhs) const noexcept {
+		return arena != rhs.arena;
+	}
+};
+
+#endif // ARENA_H_
@@ -0,0 +1,663 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the implementation of BatchFileReader. See the header
+  file for how the files are read.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+#include "batchread.h"
+#include "compression.h"
+
+namespace {
+
+int openForReading(const std::string &path) {
+#ifdef _WIN32
+	return _open(path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+	return ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+}
+
+bool fileSize(int fd, uint64_t &size) {
+#ifdef _WIN32
+	struct _stati64 info;
+	if (_fstati64(fd, &info) != 0) {
+		return false;
+	}
+#else
+	struct stat info;
+	if (::fstat(fd, &info) != 0) {
+		return false;
+	}
+#endif
+	size = (uint64_t) info.st_size;
+	return true;
+}
+
+//read up to length bytes at offset, returning the number read or -errno.
+long readAt(int fd, char *data, size_t length, uint64_t offset) {
+#ifdef _WIN32
+	//only the reader's thread reads the file, so seeking first is safe.
+	if (_lseeki64(fd, (__int64) offset, SEEK_SET) < 0) {
+		return -errno;
+	}
+	const int result = _read(fd, data, (unsigned int) length);
+#else
+	const ssize_t result = ::pread(fd, data, length, (off_t) offset);
+#endif
+	return result < 0 ? -errno : (long) result;
+}
+
+void closeFile(int fd) {
+#ifdef _WIN32
+	_close(fd);
+#else
+	::close(fd);
+#endif
+}
+
+//allocate a chunk with room for length bytes at BATCH_READ_ALIGNMENT.
+BatchFileReader::Chunk allocateChunk(size_t length) {
+	BatchFileReader::Chunk chunk;
+	chunk.memory.reset(new char[length + BATCH_READ_ALIGNMENT]);
+	const uintptr_t start = (uintptr_t) chunk.memory.get();
+	chunk.data = (char *) ((start + BATCH_READ_ALIGNMENT - 1) & ~((uintptr_t) BATCH_READ_ALIGNMENT - 1));
+	return chunk;
+}
+
+} // namespace
+
+#ifdef __linux__
+
+/*
+  An io_uring submission and completion queue, set up through the system
+  calls directly, and the reads in flight on it.
+*/
+struct BatchFileReader::Ring {
+	struct Request {
+		size_t file = 0;
+		int fd = -1;
+		uint64_t offset = 0;
+		size_t expected = 0;
+		size_t filled = 0;
+		Chunk chunk;
+		struct iovec iov;
+		bool busy = false;
+	};
+
+	int fd = -1;
+	void *sq_map = MAP_FAILED;
+	void *cq_map = MAP_FAILED;
+	void *sqe_map = MAP_FAILED;
+	size_t sq_size = 0;
+	size_t cq_size = 0;
+	size_t sqe_size = 0;
+
+	unsigned *sq_tail = nullptr;
+	unsigned *sq_mask = nullptr;
+	unsigned *sq_array = nullptr;
+	struct io_uring_sqe *sqes = nullptr;
+	unsigned *cq_head = nullptr;
+	unsigned *cq_tail = nullptr;
+	unsigned *cq_mask = nullptr;
+	struct io_uring_cqe *cqes = nullptr;
+
+	std::vector<Request> requests;
+
+	//set up a ring with room for `entries` reads, returning false if io_uring is not available.
+	bool setUp(unsigned entries) {
+		struct io_uring_params params;
+		std::memset(&params, 0, sizeof(params));
+		fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+		if (fd < 0) {
+			return false;
+		}
+
+		sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+		const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (single) {
+			sq_size = cq_size = std::max(sq_size, cq_size);
+		}
+
+		sq_map = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+		if (sq_map == MAP_FAILED) {
+			return false;
+		}
+		if (!single) {
+			cq_map = mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+			if (cq_map == MAP_FAILED) {
+				return false;
+			}
+		}
+		sqe_size = params.sq_entries * sizeof(struct io_uring_sqe);
+		sqe_map = mmap(nullptr, sqe_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+		if (sqe_map == MAP_FAILED) {
+			return false;
+		}
+
+		char *sq = (char *) sq_map;
+		char *cq = (char *) (single ? sq_map : cq_map);
+		sq_tail = (unsigned *) (sq + params.sq_off.tail);
+		sq_mask = (unsigned *) (sq + params.sq_off.ring_mask);
+		sq_array = (unsigned *) (sq + params.sq_off.array);
+		sqes = (struct io_uring_sqe *) sqe_map;
+		cq_head = (unsigned *) (cq + params.cq_off.head);
+		cq_tail = (unsigned *) (cq + params.cq_off.tail);
+		cq_mask = (unsigned *) (cq + params.cq_off.ring_mask);
+		cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+
+		requests.resize(std::min<size_t>(entries, params.sq_entries));
+		return true;
+	}
+
+	~Ring() {
+		if (sqe_map != MAP_FAILED) {
+			munmap(sqe_map, sqe_size);
+		}
+		if (cq_map != MAP_FAILED) {
+			munmap(cq_map, cq_size);
+		}
+		if (sq_map != MAP_FAILED) {
+			munmap(sq_map, sq_size);
+		}
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+
+	//queue the rest of a request's read, to be submitted by the next enter().
+	void push(size_t slot) {
+		Request &request = requests[slot];
+		request.iov.iov_base = request.chunk.data + request.filled;
+		request.iov.iov_len = request.expected - request.filled;
+
+		//only this thread writes the tail, but the kernel must see the entry before the new tail.
+		const unsigned tail = *sq_tail;
+		const unsigned index = tail & *sq_mask;
+		struct io_uring_sqe &sqe = sqes[index];
+		std::memset(&sqe, 0, sizeof(sqe));
+		sqe.opcode = IORING_OP_READV;
+		sqe.fd = request.fd;
+		sqe.addr = (uint64_t) (uintptr_t) &request.iov;
+		sqe.len = 1;
+		sqe.off = request.offset + request.filled;
+		sqe.user_data = slot;
+		sq_array[index] = index;
+		__atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+	}
+
+	//submit the queued reads and wait for at least one to complete, returning the number submitted or -errno.
+	long enter(unsigned submit) {
+		const long result = syscall(__NR_io_uring_enter, fd, submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+		return result < 0 ? -errno : result;
+	}
+};
+
+#else
+
+struct BatchFileReader::Ring {};
+
+#endif
+
+/**
+  Constructor for BatchFileReader, which opens every file and starts reading
+  them all straight away. A file that cannot be opened is only reported when
+  its InputSource is opened, as it would be for an InputFile.
+
+  @param paths
+    The paths of the files to read
+
+  @param allowIOUring
+    Whether to read through io_uring if it is available, or always read
+    with pread
+
+  @example
+    BatchFileReader reader({"datasets/popu1009.json", "datasets/econ0080.json"});
+    auto source = reader.open(0);
+    std::istream &is = source->open();
+*/
+BatchFileReader::BatchFileReader(const std::vector<std::string> &paths, bool allowIOUring)
+	: files(paths.size()), cursor(0), stopping(false) {
+	bool any = false;
+	for (size_t i = 0; i < paths.size(); i++) {
+		File &file = files[i];
+		file.path = paths[i];
+		file.fd = openForReading(file.path);
+		if (file.fd >= 0 && !fileSize(file.fd, file.size)) {
+			closeFile(file.fd);
+			file.fd = -1;
+		}
+		any |= file.fd >= 0;
+	}
+	if (!any) {
+		return;
+	}
+
+#ifdef __linux__
+	if (allowIOUring) {
+		ring.reset(new Ring());
+		if (!ring->setUp((unsigned) BATCH_READ_QUEUE_DEPTH)) {
+			ring.reset();
+		}
+	}
+#else
+	(void) allowIOUring;
+#endif
+
+	worker = std::thread(ring ? &BatchFileReader::readWithRing : &BatchFileReader::readWithPread, this);
+}
+
+/**
+  Destructor for BatchFileReader, which waits for any reads in flight and
+  closes the files.
+*/
+BatchFileReader::~BatchFileReader() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		for (auto &file : files) {
+			file.discarded = true;
+			file.ready.clear();
+		}
+	}
+	changed.notify_all();
+
+	if (worker.joinable()) {
+		worker.join();
+	}
+	for (auto &file : files) {
+		if (file.fd >= 0) {
+			closeFile(file.fd);
+		}
+	}
+}
+
+/**
+  @return
+    The number of files being read
+*/
+size_t BatchFileReader::size() const noexcept {
+	return files.size();
+}
+
+/**
+  @param file
+    The index of the file
+
+  @return
+    Whether the file could be opened
+*/
+bool BatchFileReader::isOpen(size_t file) const noexcept {
+	return files.at(file).fd >= 0;
+}
+
+/**
+  @return
+    Whether the files are being read through io_uring, rather than with pread
+*/
+bool BatchFileReader::usesIOUring() const noexcept {
+	return ring != nullptr;
+}
+
+/**
+  Create an InputSource for one of the files, which detects and decompresses
+  compressed data as it is read, like openInputFile().
+
+  @param file
+    The index of the file
+
+  @return
+    An InputSource reading the file from this reader
+
+  @throws
+    std::out_of_range if there is no such file
+*/
+std::unique_ptr<InputSource> BatchFileReader::open(size_t file) {
+	const std::string path = files.at(file).path;
+	return std::unique_ptr<InputSource>(
+		new InputDecompressor(std::unique_ptr<InputSource>(new InputBatchedFile(*this, file, path))));
+}
+
+/**
+  Take the next chunk of a file, waiting for it to be read if necessary.
+
+  @param file
+    The index of the file
+
+  @param chunk
+    Set to the next chunk of the file
+
+  @return
+    False if the whole file has been taken (or discarded)
+
+  @throws
+    std::runtime_error if the file could not be read
+*/
+bool BatchFileReader::next(size_t file, Chunk &chunk) {
+	std::unique_lock<std::mutex> lock(mutex);
+	File &f = files.at(file);
+	changed.wait(lock, [&f]() {
+		return f.discarded || !f.error.empty() || f.delivered >= f.size || f.ready.count(f.delivered) != 0;
+	});
+
+	if (!f.error.empty()) {
+		throw std::runtime_error(f.error);
+	}
+	if (f.discarded || f.delivered >= f.size) {
+		return false;
+	}
+
+	auto it = f.ready.find(f.delivered);
+	chunk = std::move(it->second);
+	f.ready.erase(it);
+	f.delivered += BATCH_READ_CHUNK_BYTES;
+
+	//there is room to read another chunk of the file.
+	lock.unlock();
+	changed.notify_all();
+	return true;
+}
+
+/**
+  Stop reading a file, and free the chunks read but not yet taken (e.g.
+  because the dataset is not going to be imported after all).
+
+  @param file
+    The index of the file
+*/
+void BatchFileReader::discard(size_t file) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		File &f = files.at(file);
+		f.discarded = true;
+		f.ready.clear();
+	}
+	changed.notify_all();
+}
+
+//pick the next chunk to read, taking the files in turn so each starts before any is finished.
+bool BatchFileReader::nextRead(size_t &file, uint64_t &offset, size_t &length) {
+	for (size_t i = 0; i < files.size(); i++) {
+		const size_t index = (cursor + i) % files.size();
+		File &f = files[index];
+		if (f.fd < 0 || f.discarded || !f.error.empty() || f.next >= f.size
+			|| f.reading + f.ready.size() >= BATCH_READ_CHUNKS_PER_FILE) {
+			continue;
+		}
+
+		file = index;
+		offset = f.next;
+		length = (size_t) std::min<uint64_t>(BATCH_READ_CHUNK_BYTES, f.size - f.next);
+		f.next += BATCH_READ_CHUNK_BYTES;
+		f.reading++;
+		cursor = (index + 1) % files.size();
+		return true;
+	}
+	return false;
+}
+
+//hand over a chunk that has been read, given the number of bytes read or -errno.
+void BatchFileReader::finishRead(size_t file, uint64_t offset, Chunk chunk, long result) {
+	File &f = files[file];
+	f.reading--;
+	if (f.discarded) {
+		return;
+	}
+	if (result < 0) {
+		f.error = "BatchFileReader: Failed to read file " + f.path + ": " + std::strerror((int) -result);
+		f.ready.clear();
+		return;
+	}
+
+	//the file has been cut short since it was opened, so this chunk is now its last.
+	if (offset + (uint64_t) result < std::min<uint64_t>(offset + BATCH_READ_CHUNK_BYTES, f.size)) {
+		f.size = offset + (uint64_t) result;
+		for (auto it = f.ready.lower_bound(f.size); it != f.ready.end();) {
+			it = f.ready.erase(it);
+		}
+	}
+	if (result > 0 && offset < f.size) {
+		chunk.size = (size_t) result;
+		f.ready[offset] = std::move(chunk);
+	}
+}
+
+//the body of the reader's thread with io_uring: keep every read that there is room for in flight at once.
+void BatchFileReader::readWithRing() {
+#ifdef __linux__
+	std::unique_lock<std::mutex> lock(mutex);
+	size_t in_flight = 0;
+	unsigned queued = 0;
+
+	for (;;) {
+		for (size_t slot = 0; slot < ring->requests.size() && !stopping; slot++) {
+			Ring::Request &request = ring->requests[slot];
+			size_t length;
+			if (request.busy || !nextRead(request.file, request.offset, length)) {
+				continue;
+			}
+
+			//reads cover whole multiples of the alignment, even at the end of a file.
+			request.fd = files[request.file].fd;
+			request.expected = (length + BATCH_READ_ALIGNMENT - 1) & ~(BATCH_READ_ALIGNMENT - 1);
+			request.filled = 0;
+			request.chunk = allocateChunk(request.expected);
+			request.busy = true;
+			ring->push(slot);
+			queued++;
+			in_flight++;
+		}
+
+		if (in_flight == 0) {
+			bool done = true;
+			for (const auto &f : files) {
+				done &= f.fd < 0 || f.discarded || !f.error.empty() || f.next >= f.size;
+			}
+			if (stopping || done) {
+				return;
+			}
+			changed.wait(lock);
+			continue;
+		}
+
+		lock.unlock();
+		const long submitted = ring->enter(queued);
+		lock.lock();
+		if (submitted >= 0) {
+			queued -= (unsigned) submitted;
+		} else if (submitted != -EINTR && submitted != -EAGAIN && submitted != -EBUSY) {
+			//the ring has stopped working, so the files cannot be read.
+			for (auto &f : files) {
+				if (f.fd >= 0 && !f.discarded && f.error.empty() && (f.next < f.size || f.reading > 0)) {
+					f.error = "BatchFileReader: Failed to read file " + f.path + ": " + std::strerror((int) -submitted);
+				}
+			}
+			changed.notify_all();
+			return;
+		}
+
+		unsigned head = *ring->cq_head;
+		const unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+		for (; head != tail; head++) {
+			const struct io_uring_cqe &cqe = ring->cqes[head & *ring->cq_mask];
+			Ring::Request &request = ring->requests[(size_t) cqe.user_data];
+			const File &f = files[request.file];
+			if (cqe.res > 0) {
+				request.filled += (size_t) cqe.res;
+			}
+
+			//a read can stop short of what was asked for without reaching the end of the file.
+			if (cqe.res > 0 && request.filled < request.expected && request.offset + request.filled < f.size
+				&& !f.discarded) {
+				ring->push((size_t) cqe.user_data);
+				queued++;
+				continue;
+			}
+
+			finishRead(request.file, request.offset, std::move(request.chunk), cqe.res < 0 ? (long) cqe.res : (long) request.filled);
+			request.busy = false;
+			in_flight--;
+		}
+		__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+		changed.notify_all();
+	}
+#endif
+}
+
+//the body of the reader's thread without io_uring: read one chunk at a time with pread, in the same order.
+void BatchFileReader::readWithPread() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	for (;;) {
+		size_t file;
+		uint64_t offset;
+		size_t length;
+		if (stopping) {
+			return;
+		}
+		if (!nextRead(file, offset, length)) {
+			bool done = true;
+			for (const auto &f : files) {
+				done &= f.fd < 0 || f.discarded || !f.error.empty() || f.next >= f.size;
+			}
+			if (done) {
+				return;
+			}
+			changed.wait(lock);
+			continue;
+		}
+
+		const int fd = files[file].fd;
+		lock.unlock();
+		Chunk chunk = allocateChunk(length);
+		long filled = 0;
+		while ((size_t) filled < length) {
+			const long result = readAt(fd, chunk.data + filled, length - (size_t) filled, offset + (uint64_t) filled);
+			if (result == -EINTR) {
+				continue;
+			}
+			if (result <= 0) {
+				filled = result < 0 ? result : filled;
+				break;
+			}
+			filled += result;
+		}
+		lock.lock();
+
+		finishRead(file, offset, std::move(chunk), filled);
+		changed.notify_all();
+	}
+}
+
+/**
+  Constructor for a stream buffer over one file of a BatchFileReader.
+
+  @param reader
+    The reader of the file, which must outlive the stream buffer
+
+  @param file
+    The index of the file
+*/
+BatchStreamBuf::BatchStreamBuf(BatchFileReader &_reader, size_t _file) : reader(_reader), file(_file) {}
+
+/**
+  Move on to the next chunk of the file, waiting for it to be read if
+  necessary.
+
+  @return
+    The next character, or EOF at the end of the file
+
+  @throws
+    std::runtime_error if the file could not be read
+*/
+BatchStreamBuf::int_type BatchStreamBuf::underflow() {
+	if (gptr() < egptr()) {
+		return traits_type::to_int_type(*gptr());
+	}
+
+	while (reader.next(file, current)) {
+		if (current.size > 0) {
+			setg(current.data, current.data, current.data + current.size);
+			return traits_type::to_int_type(*gptr());
+		}
+	}
+	return traits_type::eof();
+}
+
+/**
+  Constructor for a source reading one file of a BatchFileReader.
+
+  @param reader
+    The reader of the file, which must outlive the source
+
+  @param file
+    The index of the file
+
+  @param path
+    The path of the file
+
+  @example
+    InputBatchedFile input(reader, 0, "datasets/popu1009.json");
+*/
+InputBatchedFile::InputBatchedFile(BatchFileReader &_reader, size_t _file, const std::string &path)
+	: InputSource(path), reader(_reader), file(_file) {}
+
+/**
+  Destructor for the source, which stops the reader reading the rest of the
+  file.
+*/
+InputBatchedFile::~InputBatchedFile() {
+	reader.discard(file);
+}
+
+/**
+  Open the file as a stream of the chunks the reader has read.
+
+  @return
+    A reference to the stream
+
+  @throws
+    std::runtime_error if the file could not be opened, with the same
+    message as InputFile::open()
+
+  @example
+    InputBatchedFile input(reader, 0, "datasets/popu1009.json");
+    std::istream &stream = input.open();
+*/
+std::istream& InputBatchedFile::open() {
+	if (!reader.isOpen(file)) {
+		throw std::runtime_error("InputFile::open: Failed to open file " + getSource());
+	}
+	if (!stream) {
+		buffer.reset(new BatchStreamBuf(reader, file));
+		stream.reset(new std::istream(buffer.get()));
+	}
+	return *stream;
+}
@@ -0,0 +1,151 @@
+#ifndef BATCHREAD_H_
+#define BATCHREAD_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the declaration of BatchFileReader, which reads a batch
+  of files (e.g. every dataset loadDatasets() is about to import) at once, so
+  that on slow storage the time spent waiting for them is close to that of
+  the slowest file rather than the sum of them all.
+
+  As soon as it is created, the reader starts reading every file in chunks
+  of BATCH_READ_CHUNK_BYTES, aligned to BATCH_READ_ALIGNMENT in memory and
+  in the file, taking the first chunk of each file before the second of any.
+  On Linux the reads are submitted together through io_uring, so the kernel
+  has them all in hand at once; elsewhere, or if io_uring is not available
+  (e.g. it is blocked in a container), the files are read one chunk at a
+  time with pread on a thread of the reader's own.
+
+  Each file is read through an InputSource from open(), whose stream hands
+  over the chunks of the file in order as they arrive, waiting only for one
+  that has not. At most BATCH_READ_CHUNKS_PER_FILE chunks of each file are
+  read ahead of the stream, so a large file does not have to fit in memory
+  all at once.
+ */
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "input.h"
+
+/*
+  The size of each read, and the alignment of each read in memory and in
+  the file.
+*/
+const size_t BATCH_READ_CHUNK_BYTES = 1024 * 1024;
+const size_t BATCH_READ_ALIGNMENT = 4096;
+
+/*
+  The most chunks of one file that are being read or have been read but not
+  yet handed over, and the most reads in flight at once across every file.
+*/
+const size_t BATCH_READ_CHUNKS_PER_FILE = 8;
+const size_t BATCH_READ_QUEUE_DEPTH = 64;
+
+class BatchFileReader {
+ public:
+	/*
+	  A chunk of a file that has been read, at BATCH_READ_ALIGNMENT within
+	  memory.
+	*/
+	struct Chunk {
+		std::unique_ptr<char[]> memory;
+		char *data = nullptr;
+		size_t size = 0;
+	};
+
+ private:
+	struct File {
+		std::string path;
+		int fd = -1;
+		uint64_t size = 0;
+		std::string error;
+
+		//the offset of the next chunk to read, and of the next to hand over.
+		uint64_t next = 0;
+		uint64_t delivered = 0;
+
+		std::map<uint64_t, Chunk> ready;
+		size_t reading = 0;
+		bool discarded = false;
+	};
+
+	struct Ring;
+
+	std::vector<File> files;
+	std::unique_ptr<Ring> ring;
+	size_t cursor;
+	bool stopping;
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::thread worker;
+
+	bool nextRead(size_t &file, uint64_t &offset, size_t &length);
+	void finishRead(size_t file, uint64_t offset, Chunk chunk, long result);
+	void readWithRing();
+	void readWithPread();
+
+ public:
+	explicit BatchFileReader(const std::vector<std::string> &paths, bool allowIOUring = true);
+	~BatchFileReader();
+
+	BatchFileReader(const BatchFileReader &other) = delete;
+	BatchFileReader &operator=(const BatchFileReader &other) = delete;
+
+	size_t size() const noexcept;
+	bool isOpen(size_t file) const noexcept;
+	bool usesIOUring() const noexcept;
+
+	std::unique_ptr<InputSource> open(size_t file);
+	bool next(size_t file, Chunk &chunk);
+	void discard(size_t file);
+};
+
+/*
+  A read-only stream buffer over the chunks of one file of a BatchFileReader.
+*/
+class BatchStreamBuf : public std::streambuf {
+ private:
+	BatchFileReader &reader;
+	const size_t file;
+	BatchFileReader::Chunk current;
+
+ protected:
+	int_type underflow() override;
+
+ public:
+	BatchStreamBuf(BatchFileReader &reader, size_t file);
+	BatchStreamBuf(const BatchStreamBuf &) = delete;
+	BatchStreamBuf &operator=(const BatchStreamBuf &) = delete;
+};
+
+/*
+  Source data that is one file of a BatchFileReader. The reader must outlive
+  it, and stops reading the file once it is destroyed.
+*/
+class InputBatchedFile : public InputSource {
+ private:
+	BatchFileReader &reader;
+	const size_t file;
+	std::unique_ptr<BatchStreamBuf> buffer;
+	std::unique_ptr<std::istream> stream;
+ public:
+	InputBatchedFile(BatchFileReader &reader, size_t file, const std::string &path);
+	~InputBatchedFile();
+	std::istream& open() override;
+};
+
+#endif // BATCHREAD_H_
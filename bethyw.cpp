@@ -12,7 +12,15 @@
   calling a series of helper functions.
 */
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
 #include <string>
 #include <tuple>
 #include <unordered_set>
@@ -21,10 +29,18 @@
 
 #include "lib_cxxopts.hpp"
 #include "areas.h"
+#include "batchread.h"
 #include "bethyw.h"
+#include "catalog.h"
+#include "pipeline.h"
+#include "registry.h"
+#include "scheduler.h"
+#include "snapshot.h"
+#include "store.h"
 
 #define REGEX_SINGLE_YEAR "^([0-9]{4})$"
 #define REGEX_YEAR_RANGE "^([0-9]{4})-([0-9]{4})$"
+#define REGEX_MEMORY_SIZE "^([0-9]+)([kmg]?)i?b?$"
 
 /**
   Run Beth Yw?, parsing the command line arguments, importing the data,
@@ -64,31 +80,252 @@ int BethYw::run(int argc, char *argv[]) {
 			auto areasFilter      = BethYw::parseAreasArg(args);
 			auto measuresFilter   = BethYw::parseMeasuresArg(args);
 			auto yearsFilter      = BethYw::parseYearsArg(args);
+			auto memoryBudget     = BethYw::parseMemoryBudgetArgs(args);
+			auto connections      = BethYw::parseConnectionsArg(args);
+			auto threads          = BethYw::parseThreadsArg(args);
+			auto ranking          = BethYw::parseRankingArgs(args);
+			auto derived          = BethYw::parseDeriveArg(args);
+			auto windows          = BethYw::parseWindowArg(args);
+			auto correlate        = BethYw::parseCorrelateArg(args);
+			auto rollup           = BethYw::parseRollUpArg(args);
+			auto quantiles        = BethYw::parseQuantilesArg(args);
+			auto ndjson           = BethYw::parseNDJSONArg(args);
+			auto csv              = BethYw::parseCSVArg(args);
+			auto columnar         = BethYw::parseColumnarArg(args);
+			auto store            = BethYw::parseStoreArgs(args);
+			if (ranking.k > 0 && !correlate.empty()) {
+				throw std::invalid_argument("Invalid input for correlate argument: cannot be combined with --top");
+			}
+			if (rollup.statistic != RollUpNone && (ranking.k > 0 || !correlate.empty())) {
+				throw std::invalid_argument("Invalid input for rollup argument: cannot be combined with --top or --correlate");
+			}
+			if (!quantiles.empty() && (ranking.k > 0 || !correlate.empty() || rollup.statistic != RollUpNone)) {
+				throw std::invalid_argument("Invalid input for quantiles argument: cannot be combined with --top, --correlate or --rollup");
+			}
+			if (ndjson != NDJSONNone && (args.count("json") || ranking.k > 0 || !correlate.empty() || !quantiles.empty())) {
+				throw std::invalid_argument("Invalid input for ndjson argument: cannot be combined with --json, --top, --correlate or --quantiles");
+			}
+			if (csv != CSVNone && (args.count("json") || ndjson != NDJSONNone || ranking.k > 0 || !correlate.empty()
+								   || !quantiles.empty())) {
+				throw std::invalid_argument("Invalid input for csv argument: cannot be combined with --json, --ndjson, --top, "
+											"--correlate or --quantiles");
+			}
+			if (!columnar.empty() && (args.count("json") || ndjson != NDJSONNone || csv != CSVNone || ranking.k > 0
+									  || !correlate.empty() || !quantiles.empty())) {
+				throw std::invalid_argument("Invalid input for columnar argument: cannot be combined with --json, --ndjson, "
+											"--csv, --top, --correlate or --quantiles");
+			}
+			if (!store.write.empty() && (args.count("json") || ndjson != NDJSONNone || csv != CSVNone
+										 || !columnar.empty() || ranking.k > 0 || !correlate.empty()
+										 || !quantiles.empty() || rollup.statistic != RollUpNone)) {
+				throw std::invalid_argument("Invalid input for store argument: cannot be combined with --json, --ndjson, "
+											"--csv, --columnar, --top, --correlate, --quantiles or --rollup");
+			}
 			datasetsToImport.size();
+			TaskScheduler::setSharedThreads(threads);
+
+			//a ranking only looks at one measure (and maybe one year), so there is no need to import the rest.
+			if (ranking.k > 0) {
+				if (measuresFilter.empty()) {
+					measuresFilter.insert(ranking.measure);
+				}
+				//a window function needs the years before the one ranked by.
+				if (ranking.statistic == RankByValue && yearsFilter == YearFilterTuple(0, 0) && windows.empty()) {
+					yearsFilter = YearFilterTuple(ranking.year, ranking.year);
+				}
+			}
+
+			//only the measures asked for are output, though others may be imported to calculate them from.
+			const StringFilterSet outputMeasures = measuresFilter;
+
+			//the series created by window functions come from the measure they are applied to.
+			for (const auto &code : StringFilterSet(measuresFilter)) {
+				std::string base = windowBaseMeasure(code, windows);
+				if (!base.empty()) {
+					measuresFilter.insert(base);
+				}
+			}
+
+			//derived measures are only evaluated if they pass the measures filter, but the measures they
+			//use need importing even if they do not, and are then left out of the output.
+			const StringFilterSet derivedFilter = measuresFilter;
+			for (const auto &code : derived.dependencies(derivedFilter)) {
+				measuresFilter.insert(code);
+			}
+
+			//a weighted mean needs the weights, even if they are not asked for, though they are then left out of
+			//the output.
+			if (!rollup.weight.empty() && !measuresFilter.empty()) {
+				measuresFilter.insert(rollup.weight);
+			}
+
+			//with --arena, every container in data allocates from one arena that is freed in one go.
+			std::shared_ptr<Arena> arena;
+			if (args.count("arena")) {
+				arena = std::make_shared<Arena>();
+			}
+			ArenaScope arenaScope(arena);
 			Areas data = Areas();
+			data.getHierarchy().setWeightMeasure(rollup.weight);
+			data.setMeasureView(outputMeasures);
+			if (!quantiles.empty()) {
+				data.enableQuantiles(args.count("exact-quantiles") ? 0 : QUANTILE_SKETCH_K);
+			}
+
+			//watching keeps replacing data as files change, which we cannot do within a budget, or in an
+			//arena that only frees memory at exit.
+			bool watch = args.count("watch") > 0;
+			if (watch && memoryBudget.limit > 0) {
+				throw std::invalid_argument("Invalid input for watch argument: cannot be combined with a memory budget");
+			}
+			if (watch && args.count("arena")) {
+				throw std::invalid_argument("Invalid input for watch argument: cannot be combined with --arena");
+			}
+			if (watch && isHTTPURL(dir)) {
+				throw std::invalid_argument("Invalid input for watch argument: --dir must be a local directory");
+			}
+			if (watch && !store.read.empty()) {
+				throw std::invalid_argument("Invalid input for watch argument: cannot be combined with --from-store");
+			}
+
+			auto resolver = BethYw::makePageResolver(dir, connections);
+			std::unique_ptr<IncrementalLoader> loader;
+			StringFilterSet listedAreas;
 
 			//attempt to load area.csv and datasets
 			try {
-				BethYw::loadAreas(data, dir, areasFilter);
-
-				BethYw::loadDatasets(data,
-							dir,
-							datasetsToImport,
-							areasFilter,
-							measuresFilter,
-							yearsFilter);
+				if (!store.read.empty()) {
+					//the store is queried in place, so only what passes the filters is read from it.
+					ColumnarStore source(store.read);
+					source.populate(data, &areasFilter, &measuresFilter, &yearsFilter);
+				} else if (watch) {
+					loader.reset(new IncrementalLoader(data,
+								dir,
+								datasetsToImport,
+								areasFilter,
+								measuresFilter,
+								yearsFilter,
+								resolver.get()));
+					loader->load();
+				} else {
+					BethYw::loadAreas(data, dir, areasFilter);
+					listedAreas = data.getAreaCodes();
+
+					BethYw::loadDatasets(data,
+								dir,
+								datasetsToImport,
+								areasFilter,
+								measuresFilter,
+								yearsFilter,
+								&memoryBudget,
+								resolver.get());
+				}
 			} catch (std::out_of_range &e1) {
 				std::cerr << "Error importing dataset:" << std::endl << e1.what() << std::endl;
 			} catch (std::runtime_error &e2) {
 				std::cerr << "Error importing dataset:" << std::endl << e2.what() << std::endl;
 			}
 
-			if (args.count("json")) {
-				// The output as JSON
-				std::cout << data.toJSON();
-			} else {
-				// The output as tables
-				std::cout << data;
+			if (args.count("ingest-report")) {
+				BethYw::printIngestReport(std::cerr, ingestTotals());
+			}
+
+			if (args.count("memory-report")) {
+				BethYw::printMemoryReport(std::cerr, data, memoryBudget);
+				if (arena) {
+					std::cerr << "Arena: " << arena->allocationCount() << " allocations in "
+							  << arena->blockCount() << " blocks (" << arena->bytesUsed() << " of "
+							  << arena->bytesReserved() << " bytes used)" << std::endl;
+				}
+			}
+
+			//if we could not stay within the memory budget then we abort rather than print partial data.
+			if (memoryBudget.exceeded) {
+				std::cerr << "Memory budget of " << memoryBudget.limit << " bytes exceeded" << std::endl;
+				return -1;
+			}
+
+			//derived measures and window functions are added to the data before it is printed, to the Areas
+			//with the given codes or, if there are none, to every Area.
+			auto prepare = [&derived, &derivedFilter, &windows](Areas &data, const std::set<std::string> *areaCodes) {
+				derived.apply(data, derivedFilter, areaCodes);
+				applyWindowFunctions(data, windows, nullptr, areaCodes);
+			};
+
+			auto print = [&args, &ranking, &correlate, &rollup, &quantiles, &ndjson, &csv, &columnar, &store,
+						  &listedAreas, &loader](const Areas &data) {
+				if (!correlate.empty()) {
+					MeasureCorrelation correlation(data);
+					if (args.count("json")) {
+						printCorrelationJSON(std::cout, correlation);
+					} else {
+						printCorrelation(std::cout, correlation, correlate == "cov");
+					}
+				} else if (!quantiles.empty()) {
+					if (args.count("json")) {
+						std::cout << quantilesToJSON(data, quantiles);
+					} else {
+						printQuantiles(std::cout, data, quantiles);
+					}
+				} else if (rollup.statistic != RollUpNone) {
+					Areas parents = BethYw::rollUpAreas(data, rollup);
+					if (!columnar.empty()) {
+						BethYw::writeColumnarFile(parents, columnar);
+					} else if (ndjson != NDJSONNone) {
+						parents.toNDJSON(std::cout, ndjson);
+					} else if (csv != CSVNone) {
+						parents.toCSV(std::cout, csv);
+					} else if (args.count("json")) {
+						std::cout << parents.toJSON();
+					} else {
+						std::cout << parents;
+					}
+				} else if (ranking.k > 0) {
+					auto top = rankAreas(data, ranking);
+					if (args.count("json")) {
+						std::cout << rankingToJSON(top, ranking);
+					} else {
+						printRanking(std::cout, top, ranking);
+					}
+				} else if (!store.write.empty()) {
+					// The data as a store to query later, rather than printed
+					BethYw::writeStoreFile(data, store.write, loader ? nullptr : &listedAreas);
+				} else if (!columnar.empty()) {
+					// The output as a binary columnar file, rather than printed
+					BethYw::writeColumnarFile(data, columnar);
+				} else if (ndjson != NDJSONNone) {
+					// The output as a JSON record per line, written as it goes
+					data.toNDJSON(std::cout, ndjson);
+				} else if (csv != CSVNone) {
+					// The output as CSV, written as it goes
+					data.toCSV(std::cout, csv);
+				} else if (args.count("json")) {
+					// The output as JSON
+					std::cout << data.toJSON();
+				} else {
+					// The output as tables
+					std::cout << data;
+				}
+				std::cout.flush();
+			};
+			prepare(data, nullptr);
+			print(data);
+
+			if (watch) {
+				//each reload is applied to data, then published as a new snapshot for the printer thread, so a
+				//reload never waits for a print to finish, and a print never sees a reload half done. A
+				//snapshot shares every Area that has not changed since the last with it, so only those that
+				//have are prepared again.
+				AreasSnapshots snapshots(std::make_shared<const Areas>(data));
+				SnapshotFollower printer(snapshots, print);
+
+				BethYw::watchDatasets(*loader, dir, [&](const std::set<std::string> &areasChanged) {
+					for (const auto &code : areasChanged) {
+						derived.invalidate(code);
+					}
+					prepare(data, &areasChanged);
+					snapshots.publish(std::make_shared<const Areas>(data));
+				});
 			}
 
 		} catch (std::invalid_argument &e1) {
@@ -124,14 +361,29 @@ cxxopts::Options BethYw::cxxoptsSetup() {
 
 	cxxopts.add_options()
 		("dir",
-			"Directory for input data passed in as files",
+			"Directory for input data passed in as files, or the http:// URL "
+			"of an OData server to download them from",
 			cxxopts::value<std::string>()->default_value("datasets"))
 
+		("connections",
+			"The number of pages to download at once when --dir is a URL",
+			cxxopts::value<std::string>()->default_value("4"))
+
+		("threads",
+			"The number of threads to import, analyse and output the data with "
+			"(omit or set to 0 for one per processor)",
+			cxxopts::value<std::string>()->default_value("0"))
+
 		("d,datasets",
 			"The dataset(s) to import and analyse as a comma-separated list of codes "
-			"(omit or set to 'all' to import and analyse all datasets)",
+			"or .json/.csv file names (omit or set to 'all' to import and analyse all datasets)",
 			cxxopts::value<std::vector<std::string>>())
 
+		("manifest",
+			"A JSON file listing more datasets to import by code (by default, "
+			"bethyw-manifest.json in the directory if there is one)",
+			cxxopts::value<std::string>())
+
 		("a,areas",
 			"The areas(s) to import and analyse as a comma-separated list of "
 			"authority codes (omit or set to 'all' to import and analyse all areas)",
@@ -150,6 +402,112 @@ cxxopts::Options BethYw::cxxoptsSetup() {
 		("j,json",
 			"Print the output as JSON instead of tables.")
 
+		("ndjson",
+			"Print the output as newline-delimited JSON, streamed as it is written: "
+			"a record per 'area' (the default) or per 'measure' of each area",
+			cxxopts::value<std::string>()->implicit_value("area"))
+
+		("csv",
+			"Print the output as CSV, streamed as it is written: 'wide' (the default) "
+			"for a row per measure of each area with a column per year, or 'long' for "
+			"a row per value",
+			cxxopts::value<std::string>()->implicit_value("wide"))
+
+		("columnar",
+			"Write the output to the given file in the BYWC binary columnar format, "
+			"which can be memory-mapped without parsing, instead of printing it",
+			cxxopts::value<std::string>())
+
+		("store",
+			"Write the imported data to the given file as a store, which can be "
+			"memory-mapped and queried in place with --from-store, instead of printing it",
+			cxxopts::value<std::string>())
+
+		("from-store",
+			"Query the given store (written with --store) instead of importing the "
+			"datasets, reading only the areas, measures and years that are filtered for",
+			cxxopts::value<std::string>())
+
+		("memory-budget",
+			"Maximum memory the loaded datasets may use, in bytes "
+			"(suffix with K, M or G; omit or set to 0 for no limit)",
+			cxxopts::value<std::string>()->default_value("0"))
+
+		("memory-policy",
+			"What to do when a dataset goes over the memory budget: 'degrade' to drop "
+			"the measures it introduced, or 'abort' to stop importing",
+			cxxopts::value<std::string>()->default_value("degrade"))
+
+		("memory-report",
+			"Print the memory used by each dataset and measure to the standard error.")
+
+		("ingest-report",
+			"Print how busy each stage of importing the datasets (reading, parsing and "
+			"merging) was to the standard error.")
+
+		("arena",
+			"Allocate the imported data from a few large blocks of memory instead of "
+			"one allocation per item, which are all freed at once at exit")
+
+		("top",
+			"Print only the N areas with the highest (or lowest) value of the "
+			"measure given by --by, instead of all the data",
+			cxxopts::value<std::string>())
+
+		("by",
+			"The measure code to rank the areas by with --top",
+			cxxopts::value<std::string>())
+
+		("year",
+			"The year to rank the areas by with --top and --stat value",
+			cxxopts::value<std::string>())
+
+		("stat",
+			"What to rank the areas by with --top: 'value' in --year, or 'diff', "
+			"'pct' or 'avg' over the imported years",
+			cxxopts::value<std::string>()->default_value("value"))
+
+		("order",
+			"The order to rank the areas in with --top: 'desc' for the highest "
+			"first, or 'asc' for the lowest first",
+			cxxopts::value<std::string>()->default_value("desc"))
+
+		("derive",
+			"Add a measure calculated from other measures, as <code>=<expression>, "
+			"e.g. railpp=rail/pop (repeat to add more)",
+			cxxopts::value<std::vector<std::string>>())
+
+		("window",
+			"Add series calculated from each measure's values in year order, as a "
+			"comma-separated list of: rolling-mean:<years>, yoy, cagr, cumsum",
+			cxxopts::value<std::vector<std::string>>())
+
+		("correlate",
+			"Print the correlation of every measure with every other over the "
+			"years of every area, instead of all the data (--correlate=cov for the "
+			"covariance)",
+			cxxopts::value<std::string>()->implicit_value("corr"))
+
+		("rollup",
+			"Print the measures of each parent area (e.g. Wales, or a region) "
+			"rolled up from the local authorities beneath it, instead of all the "
+			"data: 'sum', 'mean', or 'wmean:<measure>' for the mean weighted by "
+			"another measure, e.g. wmean:pop",
+			cxxopts::value<std::string>())
+
+		("quantiles",
+			"Print the given percentiles of each measure in each year across the "
+			"areas, instead of all the data, as a comma-separated list e.g. 50,90",
+			cxxopts::value<std::string>())
+
+		("exact-quantiles",
+			"Calculate --quantiles exactly from every value, instead of from a "
+			"sketch of at most a few thousand values per measure and year")
+
+		("watch",
+			"Keep running, and when a dataset file changes, import just that file "
+			"again and print the output again")
+
 		("h,help",
 		"Print usage.");
 
@@ -165,11 +523,17 @@ cxxopts::Options BethYw::cxxoptsSetup() {
   (case-insensitive), all datasets should be imported.
 
   This function validates the passed in dataset names against the codes in
-  DATASETS array in the InputFiles namespace in datasets.h. If an invalid code
-  is entered, throw a std::invalid_argument with the message:
+  the DatasetRegistry (see loadDatasetRegistry()), which holds the DATASETS
+  array in the InputFiles namespace in datasets.h and those in any manifest. A
+  name that is not a code but the name of a .json or .csv file in the
+  directory is imported as a dataset of its own, with its columns sniffed. If
+  an invalid code is entered, throw a std::invalid_argument with the message:
   No dataset matches key: <input code>
   where <input name> is the name supplied by the user through the argument.
 
+  A dataset whose columns cannot be sniffed is reported to the standard error
+  and is not imported, as if it had failed to import.
+
   @param args
     Parsed program arguments
 
@@ -187,69 +551,182 @@ cxxopts::Options BethYw::cxxoptsSetup() {
     auto datasetsToImport = BethYw::parseDatasetsArg(args);
  */
 std::vector<BethYw::InputFileSource> BethYw::parseDatasetsArg(cxxopts::ParseResult &args) {
+	std::string dir = args["dir"].as<std::string>() + DIR_SEP;
+	return parseDatasetsArg(args, loadDatasetRegistry(args), dir);
+}
 
-	// Retrieve all valid datasets, see datasets.h
-	size_t numDatasets = InputFiles::NUM_DATASETS;
-	auto &allDatasets = InputFiles::DATASETS;
+/**
+  Parse the datasets argument against a DatasetRegistry, see
+  parseDatasetsArg() above.
 
-	// Create the container for the return type
-	std::vector<InputFileSource> datasetsToImport;
+  @param args
+    Parsed program arguments
 
-	//if an OptionParseException is thrown then no dataset has been specified,
-	//therefore we just load every dataset
-	try {
-		if(args.count("datasets")) {
-			// You can get the std::vector of arguments from cxxopts like this.
-			// Note that this function will throw an exception if datasets is not set as
-			// an argument. Check the documentation! Read it and understand it.
-			auto inputDatasets = args["datasets"].as<std::vector<std::string>>();
+  @param registry
+    The datasets that can be imported
 
-			//first check if the all flag is present in the list of arguments.
-			bool allFlag = false;
-			for(auto &it : inputDatasets) {
-				if(it == "all") {
-					allFlag = true;
-				}
+  @param dir
+    The directory the datasets are in, ending in a separator
+
+  @return
+    A std::vector of BethYw::InputFileSource instances to import
+
+  @throws
+    std::invalid_argument if the argument contains an invalid dataset with
+    message: No dataset matches key <input code>
+
+  @example
+    auto datasetsToImport = BethYw::parseDatasetsArg(args, DatasetRegistry(), "datasets/");
+ */
+std::vector<BethYw::InputFileSource> BethYw::parseDatasetsArg(cxxopts::ParseResult &args,
+															   const DatasetRegistry &registry,
+															   const std::string &dir) {
+	// Create the container for the return type
+	std::vector<RegisteredDataset> selected;
+
+	//if no dataset has been specified, or the all flag is present, we load every dataset.
+	bool allFlag = args.count("datasets") == 0;
+	std::vector<std::string> inputDatasets;
+	if (!allFlag) {
+		inputDatasets = args["datasets"].as<std::vector<std::string>>();
+		for (auto &it : inputDatasets) {
+			if (it == "all") {
+				allFlag = true;
 			}
+		}
+	}
 
-			//iterate through every dataset passed in as an argument and compares them to the
-			//list of all datasets in InputFiles::DATASETS. If the allFlag is set to true, we
-			//can skip this and load all datasets.
-			if(!allFlag) {
-				unsigned int i;
-				bool isValid;
-				for(auto &it : inputDatasets) {
-					isValid = false;
-					//check if the current param matches any known dataset.
-					for(i = 0; i < numDatasets; i++) {
-						if(it == (allDatasets[i].CODE)) {
-							isValid = true;
-							datasetsToImport.push_back(allDatasets[i]);
-						}
-					}
+	if (allFlag) {
+		selected = registry.getDatasets();
+	} else {
+		//iterate through every dataset passed in as an argument and find it in the registry,
+		//or else in the directory.
+		for (auto &it : inputDatasets) {
+			const RegisteredDataset *dataset = registry.find(it);
+			if (dataset != nullptr) {
+				selected.push_back(*dataset);
+				continue;
+			}
 
-					//if no match was made then the argument is invalid.
-					if(!isValid) {
-						throw std::invalid_argument("No dataset matches key: " + it + "");
-					}
-				}
-			} else {
-				for (unsigned int i = 0; i < numDatasets; i++)
-					datasetsToImport.push_back(allDatasets[i]);
+			static const std::regex datasetFile(".+\\.(json|csv)(\\.gz)?", std::regex_constants::icase);
+			FileFingerprint fingerprint;
+			if (!std::regex_match(it, datasetFile) || (!isHTTPURL(dir) && !datasetFingerprint(dir, it, fingerprint))) {
+				throw std::invalid_argument("No dataset matches key: " + it + "");
 			}
-		} else {
-			throw cxxopts::OptionParseException("No Argument(s) for 'datasets'");
+
+			//the single measure of a file, if it has one, is named after the file, e.g. tran0152.
+			RegisteredDataset file;
+			file.code = file.name = file.file = it;
+			if (file.file.size() > 3 && file.file.compare(file.file.size() - 3, 3, ".gz") == 0) {
+				file.file.erase(file.file.size() - 3);
+			}
+			file.measure = file.file.substr(0, file.file.rfind('.'));
+			selected.push_back(file);
+		}
+	}
+
+	//only the datasets that will be imported have their columns sniffed, if they need it.
+	std::unique_ptr<SchemaCache> cache;
+	if (!isHTTPURL(dir)) {
+		cache.reset(new SchemaCache(dir));
+	}
+
+	std::vector<InputFileSource> datasetsToImport;
+	for (const auto &dataset : selected) {
+		try {
+			datasetsToImport.push_back(resolveDataset(dataset, dir, cache.get()));
+		} catch (std::runtime_error &e) {
+			std::cerr << "Error importing dataset:" << std::endl << e.what() << std::endl;
 		}
+	}
 
-	}catch (const cxxopts::OptionException& e) {
-		//if there are no arguments then this exception is caught and all datasets are loaded.
-		for (unsigned int i = 0; i < numDatasets; i++)
-			datasetsToImport.push_back(allDatasets[i]);
+	if (cache && cache->isChanged()) {
+		cache->save();
 	}
 
 	return datasetsToImport;
 }
 
+/**
+  Create the DatasetRegistry of the datasets that can be imported: those in
+  datasets.h, and those in the manifest given by the manifest argument, or
+  else in bethyw-manifest.json in the directory if there is one.
+
+  @param args
+    Parsed program arguments
+
+  @return
+    The DatasetRegistry
+
+  @throws
+    std::runtime_error if the manifest cannot be read
+
+  @example
+    DatasetRegistry registry = BethYw::loadDatasetRegistry(args);
+ */
+DatasetRegistry BethYw::loadDatasetRegistry(cxxopts::ParseResult &args) {
+	DatasetRegistry registry;
+
+	if (args.count("manifest")) {
+		registry.loadManifestFile(args["manifest"].as<std::string>());
+		return registry;
+	}
+
+	const std::string dir = args["dir"].as<std::string>() + DIR_SEP;
+	FileFingerprint fingerprint;
+	if (!isHTTPURL(dir) && fileFingerprint(dir, MANIFEST_FILE, fingerprint)) {
+		registry.loadManifestFile(dir + MANIFEST_FILE);
+	}
+
+	return registry;
+}
+
+/**
+  Create the InputFileSource of a registered dataset, sniffing the columns of
+  its file if they are not known. The sniffed columns are kept in the
+  SchemaCache, if there is one.
+
+  @param dataset
+    The registered dataset
+
+  @param dir
+    The directory (or http:// URL) the dataset is in
+
+  @param cache
+    The SchemaCache of the directory, or nullptr
+
+  @return
+    The InputFileSource to import the dataset with
+
+  @throws
+    std::runtime_error if the file cannot be read or its columns inferred
+
+  @example
+    SchemaCache cache("datasets/");
+    auto source = BethYw::resolveDataset(*registry.find("hous"), "datasets/", &cache);
+ */
+BethYw::InputFileSource BethYw::resolveDataset(const RegisteredDataset &dataset,
+											   const std::string &dir,
+											   SchemaCache *cache) {
+	SniffedSchema schema;
+	if (dataset.hasSchema() || (cache != nullptr && cache->find(dataset.file, schema))) {
+		return applySchema(dataset, schema);
+	}
+
+	//a JSON file is fetched from its OData endpoint when the directory is a URL.
+	static const std::regex jsonFile(".+\\.json", std::regex_constants::icase);
+	const InputFileSource guess {dataset.code, dataset.name, dataset.file,
+								 std::regex_match(dataset.file, jsonFile) ? WelshStatsJSON : AuthorityByYearCSV,
+								 SourceColumnMapping()};
+	auto input = openDatasetSource(dir, guess);
+	schema = sniffSchema(input->open(), dataset.file);
+
+	if (cache != nullptr) {
+		cache->store(dataset.file, schema);
+	}
+	return applySchema(dataset, schema);
+}
+
 /**
   Parses the areas command line argument, which is optional. If it doesn't 
   exist or exists and contains "all" as value (any case), all areas should be
@@ -423,109 +900,1175 @@ std::tuple<unsigned int, unsigned int> BethYw::parseYearsArg(cxxopts::ParseResul
 }
 
 /**
-  Load the areas.csv file from the directory `dir`. Parse the file and
-  create the appropriate Area objects inside the Areas object passed to
-  the function in the `areas` argument.
+  Parse the memory budget command line arguments. The budget is a number of
+  bytes, optionally followed by a K, M or G suffix (case insensitive, with an
+  optional trailing "iB" or "B"), and defaults to 0, i.e. no budget. The policy
+  is either "degrade" (the default) or "abort".
 
-  areas.csv is guaranteed to be formatted as:
-    Local authority code,Name (eng),Name (cym)
+  @param args
+    Parsed program arguments
 
-  Hint: To implement this function. First you will need create an InputFile 
-  object with the filename of the areas file, open it, and then pass reference 
-  to the stream to the Areas::populate() function.
+  @return
+    A MemoryBudget with the limit and policy set
 
-  Hint 2: you can retrieve the specific filename for a dataset, e.g. for the 
-  areas.csv file, from the InputFileSource's FILE member variable
+  @throws
+    std::invalid_argument if either argument has an invalid value with the
+    message: Invalid input for memory budget argument
+    or: Invalid input for memory policy argument
 
-  @param areas
-    An Areas instance that should be modified (i.e. the populate() function
-    in the instance should be called)
+  @example
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args = cxxopts.parse(argc, argv);
 
-  @param dir
-    Directory where the areas.csv file is
+    auto memoryBudget = BethYw::parseMemoryBudgetArgs(args);
+*/
+BethYw::MemoryBudget BethYw::parseMemoryBudgetArgs(cxxopts::ParseResult &args) {
 
-  @param areasFilter
-    An unordered set of areas to filter, or empty to import all areas
+	MemoryBudget budget;
 
-  @return
-    void
+	std::string temp = args["memory-budget"].as<std::string>();
+	std::transform(temp.begin(), temp.end(), temp.begin(), ::tolower);
 
-  @example
-    Areas areas();
+	std::regex memory_size (REGEX_MEMORY_SIZE);
+	std::smatch s;
 
-    BethYw::loadAreas(areas, "data", BethYw::parseAreasArg(args));
-*/
-void BethYw::loadAreas(Areas &areas, std::string dir, const std::unordered_set<std::string> &areas_filter) {
+	if (!std::regex_search(temp, s, memory_size)) {
+		throw std::invalid_argument("Invalid input for memory budget argument");
+	}
+
+	unsigned long long value = 0;
+	try {
+		value = std::stoull(s.str(1));
+	} catch (std::out_of_range &e) {
+		throw std::invalid_argument("Invalid input for memory budget argument");
+	}
+
+	//scale the value by the unit suffix, if there is one, as long as the result fits.
+	const std::string unit = s.str(2);
+	unsigned int shift = 0;
+	if (unit == "k") {
+		shift = 10;
+	} else if (unit == "m") {
+		shift = 20;
+	} else if (unit == "g") {
+		shift = 30;
+	}
+	if (value > (std::numeric_limits<size_t>::max() >> shift)) {
+		throw std::invalid_argument("Invalid input for memory budget argument");
+	}
+	budget.limit = (size_t) value << shift;
+
+	temp = args["memory-policy"].as<std::string>();
+	std::transform(temp.begin(), temp.end(), temp.begin(), ::tolower);
+
+	if (temp == "degrade") {
+		budget.degrade = true;
+	} else if (temp == "abort") {
+		budget.degrade = false;
+	} else {
+		throw std::invalid_argument("Invalid input for memory policy argument");
+	}
 
-	//add the correct filename to the directory path and populate the areas object.
-	dir += InputFiles::AREAS.FILE;
-	InputFile input_file = InputFile(dir);
-	areas.populate(input_file.open(), BethYw::AuthorityCodeCSV, InputFiles::AREAS.COLS, &areas_filter);
+	return budget;
 }
 
 /**
-  Import datasets from `datasetsToImport` as files in `dir` into areas, and
-  filtering them with the `areasFilter`, `measuresFilter`, and `yearsFilter`.
-
-  The actual filtering will be done by the Areas::populate() function, thus 
-  you need to merely pass pointers on to these filters.
+  Print a breakdown of the memory used by the loaded data: the total, the
+  amount each dataset added while it was imported, and the amount held by
+  each measure across all areas.
 
-  This function should promise not to throw an exception. If there is an
-  error/exception thrown in any function called by thus function, catch it and
-  output 'Error importing dataset:', followed by a new line and then the output
-  of the what() function on the exception.
+  @param os
+    The output stream to write to
 
   @param areas
-    An Areas instance that should be modified (i.e. datasets loaded into it)
+    The Areas instance datasets were loaded into
 
-  @param dir
-    The directory where the datasets are
+  @param budget
+    The MemoryBudget that was passed to loadDatasets()
 
-  @param datasetsToImport
-    A vector of InputFileSource objects
+  @example
+    BethYw::printMemoryReport(std::cerr, data, memoryBudget);
+*/
+void BethYw::printMemoryReport(std::ostream &os, const Areas &areas, const MemoryBudget &budget) {
 
-  @param areasFilter
-    An unordered set of areas (as authority codes encoded in std::strings)
-    to filter, or empty to import all areas
+	os << "Memory used: " << areas.memoryUsage() << " bytes";
+	if (budget.limit > 0) {
+		os << " (budget " << budget.limit << " bytes)";
+	}
+	os << std::endl;
 
-  @param measuresFilter
-    An unordered set of measures (as measure codes encoded in std::strings)
-    to filter, or empty to import all measures
+	os << "By dataset:" << std::endl;
+	for (const auto &it : budget.usageByDataset) {
+		os << "  " << it.first << ": " << it.second << " bytes" << std::endl;
+	}
 
-  @param yearsFilter
-    An two-pair tuple of unsigned ints corresponding to the range of years 
-    to import, which should both be 0 to import all years.
+	os << "By measure:" << std::endl;
+	for (const auto &it : areas.memoryUsageByMeasure()) {
+		os << "  " << it.first << ": " << it.second << " bytes" << std::endl;
+	}
 
-  @return
-    void
+	for (const auto &it : budget.droppedMeasures) {
+		os << "Dropped measure to stay within budget: " << it << std::endl;
+	}
+}
+
+/**
+  Print what each stage of the import pipeline (see pipeline.h) did: the
+  items it handled, the time it spent working and waiting for the stage
+  before or after it, and so the share of its time it was busy.
+
+  @param os
+    The output stream to write to
+
+  @param stats
+    What each stage did, e.g. over every import (see ingestTotals())
 
   @example
-    Areas areas();
+    BethYw::printIngestReport(std::cerr, ingestTotals());
+*/
+void BethYw::printIngestReport(std::ostream &os, const IngestStats &stats) {
+
+	os << "Imported " << stats.imports << " dataset(s) through the pipeline:" << std::endl;
+
+	auto stage = [&os](const std::string &name, const IngestStageStats &counts, const std::string &items) {
+		os << "  " << name << ": " << counts.items << " " << items << ", "
+		   << counts.busyNanos / 1000000 << " ms busy, " << counts.waitNanos / 1000000 << " ms waiting ("
+		   << (unsigned int) (counts.utilisation() * 100 + 0.5) << "% utilised)" << std::endl;
+	};
+	stage("reader", stats.reader, "bytes");
+	stage("parser", stats.parser, "rows");
+	stage("merger", stats.merger, "rows");
+}
 
-    BethYw::loadDatasets(
-      areas,
-      "data",
-      BethYw::parseDatasetsArgument(args),
-      BethYw::parseAreasArg(args),
-      BethYw::parseMeasuresArg(args),
-      BethYw::parseYearsArg(args));
+/**
+  Parse the connections command line argument, the number of pages of a
+  dataset that may be downloaded at once.
+
+  @param args
+    Parsed program arguments
+
+  @return
+    The number of connections, at least 1
+
+  @throws
+    std::invalid_argument if the argument is not a positive integer with the
+    message: Invalid input for connections argument
 */
-void BethYw::loadDatasets(Areas &areas,
-						  std::string &dir,
-						  const std::vector<BethYw::InputFileSource> &datasetsToImport,
-						  const std::unordered_set<std::string> &areasFilter,
-						  const std::unordered_set<std::string> &measuresFilter,
-						  const std::tuple<unsigned int, unsigned int> &yearsFilter) noexcept{
+size_t BethYw::parseConnectionsArg(cxxopts::ParseResult &args) {
 
-	//load each dataset listed in the filter and add the relevant content to all of the areas.
-	for(const auto &it : datasetsToImport) {
-		try {
-			InputFile f = InputFile(dir + it.FILE);
-			areas.populate(f.open(), it.PARSER, it.COLS, &areasFilter, &measuresFilter, &yearsFilter);
-		} catch (std::out_of_range &e1) {
-			std::cerr << "Error importing dataset:" << std::endl << e1.what() << std::endl;
-		} catch (std::runtime_error &e2) {
-			std::cerr << "Error importing dataset:" << std::endl << e2.what() << std::endl;
+	std::string temp = args["connections"].as<std::string>();
+	if (temp.empty() || temp.size() > 4 || temp.find_first_not_of("0123456789") != std::string::npos
+		|| std::stoul(temp) == 0) {
+		throw std::invalid_argument("Invalid input for connections argument");
+	}
+
+	return std::stoul(temp);
+}
+
+/**
+  Parse the threads command line argument, the number of threads of the
+  shared TaskScheduler (see scheduler.h) that importing, analysing and
+  outputting the data share.
+
+  @param args
+    Parsed program arguments
+
+  @return
+    The number of threads, or 0 for one per processor
+
+  @throws
+    std::invalid_argument if the argument is not a non-negative integer of
+    at most 4 digits with the message: Invalid input for threads argument
+*/
+unsigned int BethYw::parseThreadsArg(cxxopts::ParseResult &args) {
+
+	std::string temp = args["threads"].as<std::string>();
+	if (temp.empty() || temp.size() > 4 || temp.find_first_not_of("0123456789") != std::string::npos) {
+		throw std::invalid_argument("Invalid input for threads argument");
+	}
+
+	return (unsigned int) std::stoul(temp);
+}
+
+/**
+  Parse the ranking command line arguments: --top, the number of areas to
+  rank, --by, the measure to rank them by, --stat, what to rank by, --year,
+  the year to rank by when that is a value, and --order.
+
+  @param args
+    Parsed program arguments
+
+  @return
+    A RankingQuery, with k set to 0 if --top was not given
+
+  @throws
+    std::invalid_argument if an argument is missing or not valid, with the
+    message: Invalid input for <name> argument
+
+  @example
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args = cxxopts.parse(argc, argv);
+
+    auto ranking = BethYw::parseRankingArgs(args);
+    if (ranking.k > 0) {
+      printRanking(std::cout, rankAreas(data, ranking), ranking);
+    }
+*/
+RankingQuery BethYw::parseRankingArgs(cxxopts::ParseResult &args) {
+	RankingQuery query;
+
+	if (!args.count("top")) {
+		if (args.count("by") || args.count("year")) {
+			throw std::invalid_argument("Invalid input for top argument: --by and --year need --top");
+		}
+		return query;
+	}
+
+	std::string temp = args["top"].as<std::string>();
+	if (temp.empty() || temp.size() > 9 || temp.find_first_not_of("0123456789") != std::string::npos
+		|| std::stoul(temp) == 0) {
+		throw std::invalid_argument("Invalid input for top argument");
+	}
+	query.k = std::stoul(temp);
+
+	if (!args.count("by") || args["by"].as<std::string>().empty()) {
+		throw std::invalid_argument("Invalid input for by argument: a measure code is needed with --top");
+	}
+	query.measure = args["by"].as<std::string>();
+	std::transform(query.measure.begin(), query.measure.end(), query.measure.begin(), ::tolower);
+
+	temp = args["stat"].as<std::string>();
+	std::transform(temp.begin(), temp.end(), temp.begin(), ::tolower);
+	if (temp == "value") {
+		query.statistic = RankByValue;
+	} else if (temp == "diff") {
+		query.statistic = RankByDifference;
+	} else if (temp == "pct") {
+		query.statistic = RankByPercentage;
+	} else if (temp == "avg") {
+		query.statistic = RankByAverage;
+	} else {
+		throw std::invalid_argument("Invalid input for stat argument");
+	}
+
+	//the other statistics are taken over all the imported years, which -y limits.
+	if (query.statistic == RankByValue) {
+		std::regex single_year (REGEX_SINGLE_YEAR);
+		if (!args.count("year") || !std::regex_match(args["year"].as<std::string>(), single_year)) {
+			throw std::invalid_argument("Invalid input for year argument");
+		}
+		query.year = std::stoul(args["year"].as<std::string>());
+	} else if (args.count("year")) {
+		throw std::invalid_argument("Invalid input for year argument: use -y to choose the years for --stat "
+									+ temp);
+	}
+
+	temp = args["order"].as<std::string>();
+	std::transform(temp.begin(), temp.end(), temp.begin(), ::tolower);
+	if (temp == "desc") {
+		query.descending = true;
+	} else if (temp == "asc") {
+		query.descending = false;
+	} else {
+		throw std::invalid_argument("Invalid input for order argument");
+	}
+
+	return query;
+}
+
+/**
+  Parse the derive command line arguments, each of which defines a derived
+  measure as <code>=<expression> (see derived.h).
+
+  @param args
+    Parsed program arguments
+
+  @return
+    The derived measures, in the order they were given
+
+  @throws
+    std::invalid_argument if a definition is not valid
+
+  @example
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args = cxxopts.parse(argc, argv);
+
+    auto derived = BethYw::parseDeriveArg(args);
+*/
+DerivedMeasures BethYw::parseDeriveArg(cxxopts::ParseResult &args) {
+	DerivedMeasures derived;
+
+	if (args.count("derive")) {
+		for (const auto &definition : args["derive"].as<std::vector<std::string>>()) {
+			derived.add(definition);
+		}
+	}
+
+	return derived;
+}
+
+/**
+  Parse the window command line argument, a comma-separated list of window
+  functions to apply to every measure (see window.h).
+
+  @param args
+    Parsed program arguments
+
+  @return
+    The window functions, or an empty std::vector if there are none
+
+  @throws
+    std::invalid_argument if a window function is not valid, with the message:
+    Invalid input for window argument: <function>
+
+  @example
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args = cxxopts.parse(argc, argv);
+
+    auto windows = BethYw::parseWindowArg(args);
+*/
+std::vector<WindowFunction> BethYw::parseWindowArg(cxxopts::ParseResult &args) {
+	if (!args.count("window")) {
+		return std::vector<WindowFunction>();
+	}
+	return parseWindowFunctions(args["window"].as<std::vector<std::string>>());
+}
+
+/**
+  Parse the correlate command line argument, which prints the correlation
+  (corr, the default) or covariance (cov) matrix of the measures instead of
+  the data.
+
+  @param args
+    Parsed program arguments
+
+  @return
+    "corr" or "cov", or an empty string if the argument was not given
+
+  @throws
+    std::invalid_argument if the argument is not corr or cov, with the
+    message: Invalid input for correlate argument
+
+  @example
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args = cxxopts.parse(argc, argv);
+
+    auto correlate = BethYw::parseCorrelateArg(args);
+*/
+std::string BethYw::parseCorrelateArg(cxxopts::ParseResult &args) {
+	if (!args.count("correlate")) {
+		return "";
+	}
+
+	std::string temp = args["correlate"].as<std::string>();
+	std::transform(temp.begin(), temp.end(), temp.begin(), ::tolower);
+	if (temp != "corr" && temp != "cov") {
+		throw std::invalid_argument("Invalid input for correlate argument");
+	}
+
+	return temp;
+}
+
+/**
+  Parse the rollup command line argument, which prints the roll-ups of each
+  parent area (see hierarchy.h) instead of the data: sum, mean, or
+  wmean:<measure> for the mean weighted by another measure.
+
+  @param args
+    Parsed program arguments
+
+  @return
+    The roll-up, with statistic RollUpNone if the argument was not given
+
+  @throws
+    std::invalid_argument if the argument is not valid, with the message:
+    Invalid input for rollup argument
+
+  @example
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args = cxxopts.parse(argc, argv);
+
+    auto rollup = BethYw::parseRollUpArg(args);
+*/
+RollUpQuery BethYw::parseRollUpArg(cxxopts::ParseResult &args) {
+	RollUpQuery query;
+	if (!args.count("rollup")) {
+		return query;
+	}
+
+	std::string temp = args["rollup"].as<std::string>();
+	std::transform(temp.begin(), temp.end(), temp.begin(), ::tolower);
+	const std::string weighted = "wmean:";
+
+	if (temp == "sum") {
+		query.statistic = RollUpSum;
+	} else if (temp == "mean") {
+		query.statistic = RollUpMean;
+	} else if (temp.compare(0, weighted.size(), weighted) == 0 && temp.size() > weighted.size()) {
+		query.statistic = RollUpWeightedMean;
+		query.weight = temp.substr(weighted.size());
+	} else {
+		throw std::invalid_argument("Invalid input for rollup argument");
+	}
+
+	return query;
+}
+
+/**
+  Parse the quantiles command line argument, a comma-separated list of
+  percentiles of each measure in each year to print instead of the data.
+
+  @param args
+    Parsed program arguments
+
+  @return
+    The quantiles as proportions from 0 to 1, or an empty std::vector if the
+    argument was not given
+
+  @throws
+    std::invalid_argument if a percentile is not a number from 0 to 100, with
+    the message: Invalid input for quantiles argument: <percentile>
+
+  @example
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args = cxxopts.parse(argc, argv);
+
+    auto quantiles = BethYw::parseQuantilesArg(args);
+*/
+std::vector<double> BethYw::parseQuantilesArg(cxxopts::ParseResult &args) {
+	if (!args.count("quantiles")) {
+		return std::vector<double>();
+	}
+	return parseQuantiles(args["quantiles"].as<std::string>());
+}
+
+/**
+  Parse the ndjson command line argument, which prints the output as
+  newline-delimited JSON with a record per area (the default) or per measure
+  of each area.
+
+  @param args
+    Parsed program arguments
+
+  @return
+    NDJSONByArea or NDJSONByMeasure, or NDJSONNone if the argument was not
+    given
+
+  @throws
+    std::invalid_argument if the argument is not 'area' or 'measure', with the
+    message: Invalid input for ndjson argument
+
+  @example
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args = cxxopts.parse(argc, argv);
+
+    auto ndjson = BethYw::parseNDJSONArg(args);
+*/
+NDJSONRecord BethYw::parseNDJSONArg(cxxopts::ParseResult &args) {
+	if (!args.count("ndjson")) {
+		return NDJSONNone;
+	}
+
+	std::string temp = args["ndjson"].as<std::string>();
+	std::transform(temp.begin(), temp.end(), temp.begin(), ::tolower);
+	if (temp == "area") {
+		return NDJSONByArea;
+	} else if (temp == "measure") {
+		return NDJSONByMeasure;
+	}
+	throw std::invalid_argument("Invalid input for ndjson argument");
+}
+
+/**
+  Parse the csv command line argument, which prints the output as CSV in the
+  wide layout (the default) or the long layout, see Areas::toCSV().
+
+  @param args
+    Parsed program arguments
+
+  @return
+    CSVWide or CSVLong, or CSVNone if the argument was not given
+
+  @throws
+    std::invalid_argument if the argument is not 'wide' or 'long', with the
+    message: Invalid input for csv argument
+
+  @example
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args = cxxopts.parse(argc, argv);
+
+    auto csv = BethYw::parseCSVArg(args);
+*/
+CSVLayout BethYw::parseCSVArg(cxxopts::ParseResult &args) {
+	if (!args.count("csv")) {
+		return CSVNone;
+	}
+
+	std::string temp = args["csv"].as<std::string>();
+	std::transform(temp.begin(), temp.end(), temp.begin(), ::tolower);
+	if (temp == "wide") {
+		return CSVWide;
+	} else if (temp == "long") {
+		return CSVLong;
+	}
+	throw std::invalid_argument("Invalid input for csv argument");
+}
+
+/**
+  Parse the columnar command line argument, which is the path of a file to
+  write the output to in the BYWC binary columnar format (see columnar.h).
+
+  @param args
+    Parsed program arguments
+
+  @return
+    The path of the file, or an empty string if the argument was not given
+
+  @throws
+    std::invalid_argument if the path is empty, with the message: Invalid
+    input for columnar argument
+
+  @example
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args = cxxopts.parse(argc, argv);
+
+    auto columnar = BethYw::parseColumnarArg(args);
+*/
+std::string BethYw::parseColumnarArg(cxxopts::ParseResult &args) {
+	if (!args.count("columnar")) {
+		return "";
+	}
+
+	const std::string path = args["columnar"].as<std::string>();
+	if (path.empty()) {
+		throw std::invalid_argument("Invalid input for columnar argument");
+	}
+	return path;
+}
+
+/**
+  Write a binary file. The file is written alongside and then renamed, so a
+  program that memory-maps it never sees half of it, even when it is
+  rewritten by --watch.
+
+  @param path
+    The path of the file
+
+  @param write
+    Writes the contents of the file to the stream it is given
+
+  @throws
+    std::runtime_error if the file could not be written
+
+  @example
+    BethYw::writeBinaryFile("popden.bywc", [&data](std::ostream &os) {
+      data.toColumnar(os);
+    });
+*/
+void BethYw::writeBinaryFile(const std::string &path, const std::function<void(std::ostream &)> &write) {
+	const std::string temp = path + ".tmp";
+	{
+		std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			throw std::runtime_error("Failed to open file " + temp);
+		}
+		try {
+			write(file);
+		} catch (std::runtime_error &e) {
+			file.close();
+			std::remove(temp.c_str());
+			throw;
+		}
+	}
+	if (std::rename(temp.c_str(), path.c_str()) != 0) {
+		std::remove(temp.c_str());
+		throw std::runtime_error("Failed to write file " + path);
+	}
+}
+
+/**
+  Write data to a file in the BYWC binary columnar format (see
+  Areas::toColumnar()).
+
+  @param data
+    The data to write
+
+  @param path
+    The path of the file
+
+  @throws
+    std::runtime_error if the file could not be written
+
+  @example
+    BethYw::writeColumnarFile(data, "popden.bywc");
+*/
+void BethYw::writeColumnarFile(const Areas &data, const std::string &path) {
+	writeBinaryFile(path, [&data](std::ostream &os) {
+		data.toColumnar(os);
+	});
+}
+
+/**
+  Parse the store and from-store command line arguments: the path of a file
+  to write the imported data to as a store (see store.h), and the path of a
+  store to query instead of importing the datasets.
+
+  @param args
+    Parsed program arguments
+
+  @return
+    The paths, each empty if its argument was not given
+
+  @throws
+    std::invalid_argument if a path is empty, with the message: Invalid input
+    for store argument or Invalid input for from-store argument
+
+  @example
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args = cxxopts.parse(argc, argv);
+
+    auto store = BethYw::parseStoreArgs(args);
+*/
+BethYw::StoreArgs BethYw::parseStoreArgs(cxxopts::ParseResult &args) {
+	StoreArgs store;
+	if (args.count("store")) {
+		store.write = args["store"].as<std::string>();
+		if (store.write.empty()) {
+			throw std::invalid_argument("Invalid input for store argument");
+		}
+	}
+	if (args.count("from-store")) {
+		store.read = args["from-store"].as<std::string>();
+		if (store.read.empty()) {
+			throw std::invalid_argument("Invalid input for from-store argument");
+		}
+	}
+	return store;
+}
+
+/**
+  Write data to a file as a store (see store.h), which can then be queried
+  with --from-store.
+
+  @param data
+    The data to write
+
+  @param path
+    The path of the file
+
+  @param listedAreas
+    The codes of the areas listed in areas.csv, or nullptr, see
+    writeColumnarStore()
+
+  @throws
+    std::runtime_error if the file could not be written
+
+  @example
+    BethYw::writeStoreFile(data, "wales.byws");
+*/
+void BethYw::writeStoreFile(const Areas &data, const std::string &path, const StringFilterSet *const listedAreas) {
+	writeBinaryFile(path, [&data, listedAreas](std::ostream &os) {
+		writeColumnarStore(os, data, listedAreas);
+	});
+}
+
+/**
+  Build an Areas instance of the parent areas in the hierarchy of `data`,
+  each with a Measure for every measure rolled up from the areas beneath it
+  that is output (see Areas::setMeasureView()), so the weights of a weighted
+  mean are only output if they were asked for.
+  A parent's names are taken from `data` if it has the parent as an Area, and
+  each Measure's label is the label of the measure in `data` followed by the
+  statistic, e.g. "Population, sum".
+
+  @param data
+    The imported data
+
+  @param query
+    The roll-up to output
+
+  @return
+    The parent areas
+
+  @example
+    RollUpQuery query;
+    query.statistic = RollUpSum;
+    std::cout << BethYw::rollUpAreas(data, query);
+*/
+Areas BethYw::rollUpAreas(const Areas &data, const RollUpQuery &query) {
+	const Hierarchy &hierarchy = data.getHierarchy();
+	const std::string statistic = rollUpStatisticName(query);
+
+	std::map<std::string, std::string> labels;
+	for (const auto &area : data) {
+		for (const auto &measure : area.second.getMeasures()) {
+			labels.emplace(measure.first, measure.second.getLabel());
+		}
+	}
+
+	Areas parents = Areas();
+	for (const auto &code : hierarchy.getRollUpCodes()) {
+		std::string tmp = code;
+		Area area(tmp);
+		try {
+			for (const auto &name : data.getArea(code).getNames()) {
+				area.setName(name.first, name.second);
+			}
+		} catch (std::out_of_range &e) {}
+
+		for (const auto &measure : *hierarchy.getRollUps(code)) {
+			if (!data.isMeasureInView(measure.first)) {
+				continue;
+			}
+			Measure rolled(measure.first, labels[measure.first] + ", " + statistic);
+			for (const auto &year : measure.second) {
+				const double value = year.second.get(query.statistic);
+				if (std::isfinite(value)) {
+					rolled.setValue(year.first, value);
+				}
+			}
+			if (rolled.size() > 0) {
+				area.setMeasure(measure.first, rolled);
+			}
+		}
+
+		parents.setArea(code, area);
+	}
+
+	return parents;
+}
+
+/**
+  Create the InputSource for a dataset in `dir`. If `dir` is a http:// URL
+  then StatsWales JSON datasets are requested from the OData endpoint
+  <dir>dataset/<name> (where <name> is the dataset's file name without the
+  .json extension) and any other file from <dir><file>. Otherwise the dataset
+  is read from the file <dir><file>, or <dir><file>.gz if only a gzipped copy
+  exists.
+
+  Either way, compressed data is detected and decompressed as it is read (see
+  compression.h).
+
+  @param dir
+    The directory or URL the datasets are in, including the trailing separator
+
+  @param dataset
+    The dataset to open
+
+  @return
+    An InputSource for the dataset
+
+  @example
+    auto source = BethYw::openDatasetSource("datasets/", InputFiles::BIZ);
+    std::istream &is = source->open();
+*/
+std::unique_ptr<InputSource> BethYw::openDatasetSource(const std::string &dir, const InputFileSource &dataset) {
+
+	if (!isHTTPURL(dir)) {
+		return openInputFile(dir + dataset.FILE);
+	}
+
+	//URLs always use a forward slash, whatever separator was added to dir.
+	std::string base = dir;
+	if (base.back() == '\\') {
+		base.back() = '/';
+	}
+
+	std::string file = dataset.FILE;
+	const std::string extension = ".json";
+	if (dataset.PARSER == WelshStatsJSON && file.size() > extension.size()
+		&& file.compare(file.size() - extension.size(), extension.size(), extension) == 0) {
+		return std::unique_ptr<InputSource>(new InputDecompressor(std::unique_ptr<InputSource>(
+			new InputHTTP(base + "dataset/" + file.substr(0, file.size() - extension.size())))));
+	}
+
+	return std::unique_ptr<InputSource>(new InputDecompressor(std::unique_ptr<InputSource>(
+		new InputHTTP(base + file))));
+}
+
+/**
+  Create the PageResolver used to follow the pages of StatsWales JSON
+  datasets in `dir`: over HTTP with up to `connections` requests in flight if
+  `dir` is a http:// URL, or from sibling files otherwise.
+
+  @param dir
+    The directory or URL the datasets are in, including the trailing separator
+
+  @param connections
+    The maximum number of page requests in flight when downloading
+
+  @return
+    A PageResolver for the datasets in `dir`
+
+  @example
+    auto resolver = BethYw::makePageResolver("datasets/", 4);
+*/
+std::unique_ptr<PageResolver> BethYw::makePageResolver(const std::string &dir, size_t connections) {
+
+	if (isHTTPURL(dir)) {
+		return std::unique_ptr<PageResolver>(new HTTPPageResolver(connections));
+	}
+
+	return std::unique_ptr<PageResolver>(new LocalPageResolver(dir));
+}
+
+/**
+  Load the areas.csv file from the directory `dir`. Parse the file and
+  create the appropriate Area objects inside the Areas object passed to
+  the function in the `areas` argument.
+
+  areas.csv is guaranteed to be formatted as:
+    Local authority code,Name (eng),Name (cym)
+
+  Hint: To implement this function. First you will need create an InputFile 
+  object with the filename of the areas file, open it, and then pass reference 
+  to the stream to the Areas::populate() function.
+
+  Hint 2: you can retrieve the specific filename for a dataset, e.g. for the 
+  areas.csv file, from the InputFileSource's FILE member variable
+
+  @param areas
+    An Areas instance that should be modified (i.e. the populate() function
+    in the instance should be called)
+
+  @param dir
+    Directory where the areas.csv file is
+
+  @param areasFilter
+    An unordered set of areas to filter, or empty to import all areas
+
+  @return
+    void
+
+  @example
+    Areas areas();
+
+    BethYw::loadAreas(areas, "data", BethYw::parseAreasArg(args));
+*/
+void BethYw::loadAreas(Areas &areas, std::string dir, const std::unordered_set<std::string> &areas_filter) {
+
+	//open the areas file in the directory (or at the URL) and populate the areas object.
+	auto input_file = openDatasetSource(dir, InputFiles::AREAS);
+	areas.populate(input_file->open(), BethYw::AuthorityCodeCSV, InputFiles::AREAS.COLS, &areas_filter);
+}
+
+/**
+  Import datasets from `datasetsToImport` as files in `dir` into areas, and
+  filtering them with the `areasFilter`, `measuresFilter`, and `yearsFilter`.
+
+  The actual filtering will be done by the Areas::populate() function, thus 
+  you need to merely pass pointers on to these filters.
+
+  StatsWales JSON datasets are split into pages. The pages after the first are
+  found by `resolver`, or if it is not given, read from sibling files in `dir`
+  (see LocalPageResolver in input.h). `dir` may also be the http:// URL of an
+  OData server, see openDatasetSource().
+
+  With a filter, a local dataset whose entry in the DatasetCatalog of `dir`
+  shows it has nothing the filter would import is skipped without being
+  read (see catalog.h). A dataset with no entry yet is imported, and its
+  entry is made from the rows its import parsed (see ImportObserver in
+  areas.h). If the import did not parse it, e.g. a CSV dataset whose measure
+  is filtered out, it is scanned for the catalog once the others have been
+  imported.
+
+  The files of the other local datasets are all read at once by a
+  BatchFileReader (see batchread.h) while they are imported in turn.
+
+  This function should promise not to throw an exception. If there is an
+  error/exception thrown in any function called by thus function, catch it and
+  output 'Error importing dataset:', followed by a new line and then the output
+  of the what() function on the exception.
+
+  @param areas
+    An Areas instance that should be modified (i.e. datasets loaded into it)
+
+  @param dir
+    The directory where the datasets are
+
+  @param datasetsToImport
+    A vector of InputFileSource objects
+
+  @param areasFilter
+    An unordered set of areas (as authority codes encoded in std::strings)
+    to filter, or empty to import all areas
+
+  @param measuresFilter
+    An unordered set of measures (as measure codes encoded in std::strings)
+    to filter, or empty to import all measures
+
+  @param yearsFilter
+    An two-pair tuple of unsigned ints corresponding to the range of years 
+    to import, which should both be 0 to import all years.
+
+  @param budget
+    An optional MemoryBudget. The memory each dataset adds is recorded in it,
+    and if a dataset takes the total over its limit then the measures that
+    dataset introduced are dropped (largest first) until the data fits again,
+    or, with the abort policy or if that is not enough, no further datasets
+    are imported and the budget is marked as exceeded.
+
+  @param resolver
+    An optional PageResolver for following the pages of JSON datasets
+
+  @return
+    void
+
+  @example
+    Areas areas();
+
+    BethYw::loadDatasets(
+      areas,
+      "data",
+      BethYw::parseDatasetsArgument(args),
+      BethYw::parseAreasArg(args),
+      BethYw::parseMeasuresArg(args),
+      BethYw::parseYearsArg(args));
+*/
+void BethYw::loadDatasets(Areas &areas,
+						  std::string &dir,
+						  const std::vector<BethYw::InputFileSource> &datasetsToImport,
+						  const std::unordered_set<std::string> &areasFilter,
+						  const std::unordered_set<std::string> &measuresFilter,
+						  const std::tuple<unsigned int, unsigned int> &yearsFilter,
+						  MemoryBudget *budget,
+						  const PageResolver *resolver) noexcept{
+
+	//paged JSON datasets continue in sibling files in the same directory, unless we are told otherwise.
+	std::unique_ptr<PageResolver> default_resolver;
+	if (resolver == nullptr) {
+		default_resolver = makePageResolver(dir, 1);
+		resolver = default_resolver.get();
+	}
+
+	//with a filter, a local dataset that the catalog says cannot contribute is not read at all.
+	std::unique_ptr<DatasetCatalog> catalog;
+	if (!isHTTPURL(dir) && (!areasFilter.empty() || !measuresFilter.empty() || std::get<1>(yearsFilter) != 0)) {
+		catalog.reset(new DatasetCatalog(dir));
+	}
+
+	//what the catalog already knows of each dataset, found without reading any of them. A dataset whose
+	//measures and years rule it out is not read at all; its areas are checked once the datasets before it
+	//have been imported, as they may give names to its areas.
+	std::vector<const CatalogEntry*> entries(datasetsToImport.size(), nullptr);
+	std::vector<bool> ruledOut(datasetsToImport.size(), false);
+	if (catalog) {
+		for (size_t i = 0; i < datasetsToImport.size(); i++) {
+			const auto &it = datasetsToImport[i];
+			if (it.PARSER != WelshStatsJSON && it.PARSER != AuthorityByYearCSV) {
+				continue;
+			}
+			entries[i] = catalog->find(it);
+			ruledOut[i] = entries[i] != nullptr && !entries[i]->mayMatchMeasuresAndYears(measuresFilter, yearsFilter);
+		}
+	}
+
+	//local datasets are all read at once, so waiting for the storage overlaps rather than adding up.
+	std::unique_ptr<BatchFileReader> batch;
+	if (!isHTTPURL(dir)) {
+		std::vector<std::string> paths;
+		for (size_t i = 0; i < datasetsToImport.size(); i++) {
+			paths.push_back(ruledOut[i] ? "" : resolveInputFile(dir + datasetsToImport[i].FILE));
+		}
+		batch.reset(new BatchFileReader(paths));
+	}
+
+	//datasets the catalog did not know are recorded from what their import parses. any whose import did not
+	//parse them (e.g. a CSV dataset whose measure is filtered out) are scanned once every dataset is imported.
+	std::vector<size_t> unscanned;
+
+	//load each dataset listed in the filter and add the relevant content to all of the areas.
+	for (size_t i = 0; i < datasetsToImport.size(); i++) {
+		const auto &it = datasetsToImport[i];
+		if (ruledOut[i] || (entries[i] != nullptr && !entries[i]->mayMatchAreas(areas, areasFilter))) {
+			if (batch && !ruledOut[i]) {
+				batch->discard(i);
+			}
+			if (budget != nullptr) {
+				budget->usageByDataset[it.CODE] += 0;
+			}
+			continue;
+		}
+		const bool uncatalogued = catalog && entries[i] == nullptr
+								  && (it.PARSER == WelshStatsJSON || it.PARSER == AuthorityByYearCSV);
+		CatalogEntry contents;
+		RecordingPageResolver pages(*resolver, dir);
+		if (uncatalogued) {
+			areas.setImportObserver([&contents](const IngestRow &row) { contents.add(row); });
+		}
+
+		//we only need to track memory if the caller has asked for it.
+		size_t before = 0;
+		StringFilterSet areas_before;
+		ImportBudget import;
+		if (budget != nullptr) {
+			before = areas.memoryUsage();
+			if (budget->limit > 0) {
+				for (const auto &m : areas.memoryUsageByMeasure()) {
+					import.existingMeasures.insert(m.first);
+				}
+				areas_before = areas.getAreaCodes();
+
+				//the budget is checked as each value is merged, so a large dataset cannot go far past it.
+				import.headroom = budget->limit > before ? budget->limit - before : 0;
+				import.degrade = budget->degrade;
+				areas.setImportBudget(&import);
+			}
+		}
+
+		bool imported = false;
+		try {
+			auto f = batch ? batch->open(i) : openDatasetSource(dir, it);
+			areas.populate(f->open(), it.PARSER, it.COLS, &areasFilter, &measuresFilter, &yearsFilter,
+						   uncatalogued ? &pages : resolver);
+			imported = true;
+		} catch (std::out_of_range &e1) {
+			std::cerr << "Error importing dataset:" << std::endl << e1.what() << std::endl;
+		} catch (std::runtime_error &e2) {
+			if (!import.exceeded) {
+				std::cerr << "Error importing dataset:" << std::endl << e2.what() << std::endl;
+			}
+		}
+		areas.setImportBudget(nullptr);
+
+		if (uncatalogued) {
+			areas.setImportObserver(ImportObserver());
+			if (imported && !contents.measures.empty()) {
+				try {
+					catalog->record(it, contents, pages.getPages());
+				} catch (std::runtime_error &e) {
+					//the file has gone since it was imported, so there is nothing to record.
+				}
+			} else {
+				unscanned.push_back(i);
+			}
+		}
+
+		if (budget == nullptr) {
+			continue;
+		}
+
+		for (const auto &m : import.dropped) {
+			budget->droppedMeasures.push_back(it.CODE + "/" + m);
+		}
+
+		size_t after = areas.memoryUsage();
+		budget->usageByDataset[it.CODE] += (after > before) ? after - before : 0;
+
+		if (import.exceeded) {
+			budget->exceeded = true;
+			break;
+		}
+		if (budget->limit == 0 || (after <= budget->limit && import.dropped.empty())) {
+			continue;
+		}
+
+		//the estimate made while importing may be a little under, so degrade by dropping the measures this
+		//dataset introduced, largest first, along with any areas it introduced that are left without measures.
+		if (budget->degrade) {
+			std::vector<std::pair<size_t, std::string>> introduced;
+			for (const auto &m : areas.memoryUsageByMeasure()) {
+				if (import.existingMeasures.count(m.first) == 0) {
+					introduced.emplace_back(m.second, m.first);
+				}
+			}
+			std::sort(introduced.rbegin(), introduced.rend());
+
+			for (const auto &m : introduced) {
+				if (after <= budget->limit) {
+					break;
+				}
+				after -= std::min(after, areas.removeMeasure(m.second));
+				budget->droppedMeasures.push_back(it.CODE + "/" + m.second);
+			}
+
+			for (const auto &code : areas.getAreaCodes()) {
+				if (areas_before.count(code) == 0 && areas.getArea(code).size() == 0) {
+					areas.removeArea(code);
+				}
+			}
+			after = areas.memoryUsage();
+		}
+
+		//if we are still over the budget then we must stop importing.
+		if (after > budget->limit) {
+			budget->exceeded = true;
+			break;
+		}
+	}
+
+	if (catalog) {
+		for (const auto i : unscanned) {
+			try {
+				catalog->scan(datasetsToImport[i]);
+			} catch (std::exception &e) {
+				//the import above has already reported why the dataset cannot be read.
+			}
+		}
+		if (catalog->isChanged()) {
+			catalog->save();
+		}
+	}
+}
+
+/**
+  Watch `dir` forever, applying each change to a file that `loader` imports
+  as it happens (see IncrementalLoader::reload()) and then calling
+  `onChange`. What was imported again, and how long it took, is written to the
+  standard error. If a file fails to import, e.g. because it is still being
+  written, the error is reported and the data is left as it was.
+
+  @param loader
+    The IncrementalLoader that imported the data
+
+  @param dir
+    The directory the files are in
+
+  @param onChange
+    Called after the data has been updated, e.g. to print it again, with the
+    codes of the areas whose data changed
+
+  @throws
+    std::runtime_error if the directory cannot be watched
+
+  @example
+    BethYw::watchDatasets(loader, "datasets/", [&](const std::set<std::string> &) { std::cout << data; });
+*/
+void BethYw::watchDatasets(IncrementalLoader &loader,
+						   const std::string &dir,
+						   const std::function<void(const std::set<std::string> &)> &onChange) {
+	DirectoryWatcher watcher(dir);
+
+	for (;;) {
+		bool changed = false;
+		std::set<std::string> areasChanged;
+
+		for (const auto &file : watcher.wait()) {
+			if (!loader.watches(file)) {
+				continue;
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			try {
+				auto result = loader.reload(file);
+				auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+					std::chrono::steady_clock::now() - start);
+
+				std::cerr << "Reloaded " << file << " (";
+				for (size_t i = 0; i < result.sources.size(); i++) {
+					std::cerr << (i > 0 ? ", " : "") << result.sources[i];
+				}
+				std::cerr << "): " << result.valuesChanged << " values changed in "
+						  << elapsed.count() << "ms" << std::endl;
+				changed |= result.valuesChanged > 0 || result.areasRebuilt > 0 || result.measuresRebuilt > 0;
+				areasChanged.insert(result.areasChanged.begin(), result.areasChanged.end());
+			} catch (std::exception &e) {
+				std::cerr << "Error reloading dataset:" << std::endl << e.what() << std::endl;
+			}
+		}
+
+		if (changed) {
+			onChange(areasChanged);
 		}
 	}
 }
@@ -12,6 +12,10 @@
   running Beth Yw?
  */
 
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
 #include <string>
 #include <unordered_set>
 #include <vector>
@@ -22,6 +26,17 @@
 #include "areas.h"
 #include "measure.h"
 #include "input.h"
+#include "http.h"
+#include "compression.h"
+#include "watcher.h"
+#include "arena.h"
+#include "ranking.h"
+#include "derived.h"
+#include "window.h"
+#include "correlation.h"
+#include "hierarchy.h"
+#include "quantile.h"
+#include "registry.h"
 
 
 const char DIR_SEP =
@@ -35,6 +50,34 @@ namespace BethYw {
 
 const std::string STUDENT_NUMBER = "979663";
 
+/*
+  A limit on the memory the loaded datasets may occupy, and a record of how
+  much each dataset actually used. A limit of 0 means there is no budget.
+
+  The limit is checked as each value of a dataset is merged (see
+  ImportBudget in areas.h). When a dataset takes the total over the limit,
+  loadDatasets() either stops loading (abort) or first tries to get back
+  under the limit by dropping the measures that dataset introduced, largest
+  first, and skipping the rest of their values (degrade).
+*/
+struct MemoryBudget {
+	size_t limit = 0;
+	bool degrade = true;
+	bool exceeded = false;
+	std::map<std::string, size_t> usageByDataset;
+	std::vector<std::string> droppedMeasures;
+};
+
+/*
+  The paths given to --store, to write the imported data to as a store (see
+  store.h), and to --from-store, to query a store instead of importing the
+  datasets. A path is empty if it was not given.
+*/
+struct StoreArgs {
+	std::string write;
+	std::string read;
+};
+
 /*
   Run Beth Yw?, parsing the command line arguments and acting upon them.
 */
@@ -51,6 +94,14 @@ cxxopts::Options cxxoptsSetup();
 */
 std::vector<BethYw::InputFileSource> parseDatasetsArg(cxxopts::ParseResult& args);
 
+std::vector<BethYw::InputFileSource> parseDatasetsArg(cxxopts::ParseResult& args,
+													  const DatasetRegistry &registry,
+													  const std::string &dir);
+
+DatasetRegistry loadDatasetRegistry(cxxopts::ParseResult& args);
+
+InputFileSource resolveDataset(const RegisteredDataset &dataset, const std::string &dir, SchemaCache *cache);
+
 /*
   Parse the areas argument and return a std::unordered_set of all the
   areas to import, or an empty set if all areas should be imported.
@@ -61,6 +112,48 @@ std::unordered_set<std::string> parseMeasuresArg(cxxopts::ParseResult& args);
 
 std::tuple<unsigned int, unsigned int> parseYearsArg(cxxopts::ParseResult& args);
 
+MemoryBudget parseMemoryBudgetArgs(cxxopts::ParseResult& args);
+
+void printMemoryReport(std::ostream &os, const Areas &areas, const MemoryBudget &budget);
+
+void printIngestReport(std::ostream &os, const IngestStats &stats);
+
+size_t parseConnectionsArg(cxxopts::ParseResult& args);
+
+unsigned int parseThreadsArg(cxxopts::ParseResult& args);
+
+RankingQuery parseRankingArgs(cxxopts::ParseResult& args);
+
+DerivedMeasures parseDeriveArg(cxxopts::ParseResult& args);
+
+std::vector<WindowFunction> parseWindowArg(cxxopts::ParseResult& args);
+
+std::string parseCorrelateArg(cxxopts::ParseResult& args);
+
+RollUpQuery parseRollUpArg(cxxopts::ParseResult& args);
+
+std::vector<double> parseQuantilesArg(cxxopts::ParseResult& args);
+
+NDJSONRecord parseNDJSONArg(cxxopts::ParseResult& args);
+
+CSVLayout parseCSVArg(cxxopts::ParseResult& args);
+
+std::string parseColumnarArg(cxxopts::ParseResult& args);
+
+void writeBinaryFile(const std::string &path, const std::function<void(std::ostream &)> &write);
+
+void writeColumnarFile(const Areas &data, const std::string &path);
+
+StoreArgs parseStoreArgs(cxxopts::ParseResult& args);
+
+void writeStoreFile(const Areas &data, const std::string &path, const StringFilterSet *const listedAreas = nullptr);
+
+Areas rollUpAreas(const Areas &data, const RollUpQuery &query);
+
+std::unique_ptr<InputSource> openDatasetSource(const std::string &dir, const InputFileSource &dataset);
+
+std::unique_ptr<PageResolver> makePageResolver(const std::string &dir, size_t connections);
+
 void loadAreas(Areas &areas, std::string dir, const std::unordered_set<std::string> &areasFilter);
 
 void loadDatasets(Areas &areas,
@@ -68,7 +161,13 @@ void loadDatasets(Areas &areas,
 				  const std::vector<BethYw::InputFileSource> &datasetsToImport,
 				  const std::unordered_set<std::string> &areasFilter,
 				  const std::unordered_set<std::string> &measuresFilter,
-				  const std::tuple<unsigned int, unsigned int> &yearsFilter) noexcept;
+				  const std::tuple<unsigned int, unsigned int> &yearsFilter,
+				  MemoryBudget *budget = nullptr,
+				  const PageResolver *resolver = nullptr) noexcept;
+
+void watchDatasets(IncrementalLoader &loader,
+				   const std::string &dir,
+				   const std::function<void(const std::set<std::string> &)> &onChange);
 
 } // namespace BethYw
 
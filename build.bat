@@ -2,8 +2,9 @@
 
 SET bin_dir=bin
 SET tests_dir=tests
-SET source_files=bethyw.cpp input.cpp areas.cpp area.cpp measure.cpp
+SET source_files=bethyw.cpp input.cpp areas.cpp area.cpp measure.cpp http.cpp compression.cpp watcher.cpp arena.cpp ranking.cpp derived.cpp window.cpp correlation.cpp hierarchy.cpp quantile.cpp catalog.cpp registry.cpp projection.cpp writer.cpp columnar.cpp store.cpp search.cpp snapshot.cpp scheduler.cpp pipeline.cpp batchread.cpp
 SET main_file=main.cpp
+SET libs=-pthread -lz
 SET executable=%bin_dir%\bethyw.exe
 
 COPY bin\bethyw2.exe bin\bethyw.exe
@@ -13,7 +14,7 @@ IF "%1"=="" GOTO compile
 SET testStr=%1%
 SET testStr=%testStr:~0,4%
 IF %testStr%==test (
-  SET source_files=%source_files% %tests_dir%\%1%.cpp
+  SET source_files=%source_files% odataserver.cpp %tests_dir%\%1%.cpp
   SET main_file=%bin_dir%\catch.o
   SET executable=%bin_dir%\bethyw-test.exe
 
@@ -25,6 +26,6 @@ IF %testStr%==test (
 :compile
 IF NOT EXIST %bin_dir% MKDIR %bin_dir%
 IF EXIST %executable% DEL %executable%
-g++ --std=c++14 -Wall %source_files% %main_file% -o %executable%
+g++ --std=c++14 -Wall %source_files% %main_file% -o %executable% %libs%
 
 :end
@@ -2,8 +2,9 @@
 
 BIN_DIR="bin"
 TESTS_DIR="tests"
-SOURCE_FILES="bethyw.cpp input.cpp areas.cpp area.cpp measure.cpp"
+SOURCE_FILES="bethyw.cpp input.cpp areas.cpp area.cpp measure.cpp http.cpp compression.cpp watcher.cpp arena.cpp ranking.cpp derived.cpp window.cpp correlation.cpp hierarchy.cpp quantile.cpp catalog.cpp registry.cpp projection.cpp writer.cpp columnar.cpp store.cpp search.cpp snapshot.cpp scheduler.cpp pipeline.cpp batchread.cpp"
 MAIN_FILE="main.cpp"
+LIBS="-pthread -lz"
 EXECUTABLE="./${BIN_DIR}/bethyw"
 
 set -x
@@ -14,7 +15,7 @@ if [ $# -gt 1 ]; then
   exit
 elif [ $# -eq 1 ]; then
   if [[ $1 == test* ]]; then
-    SOURCE_FILES="${SOURCE_FILES} ./${TESTS_DIR}/$1.cpp"
+    SOURCE_FILES="${SOURCE_FILES} odataserver.cpp ./${TESTS_DIR}/$1.cpp"
     MAIN_FILE="./${BIN_DIR}/catch.o"
     EXECUTABLE="./${BIN_DIR}/bethyw-test"
 
@@ -27,4 +28,4 @@ fi
 
 mkdir -p ${BIN_DIR}
 rm ${EXECUTABLE} 2> /dev/null
-g++ --std=c++14 -pedantic -Wall ${SOURCE_FILES} ${MAIN_FILE} -o ${EXECUTABLE}
\ No newline at end of file
+g++ --std=c++14 -pedantic -Wall ${SOURCE_FILES} ${MAIN_FILE} -o ${EXECUTABLE} ${LIBS}
\ No newline at end of file
@@ -0,0 +1,639 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the implementation of the dataset catalog. See the
+  header file for additional comments.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#include "lib_json.hpp"
+#include "input.h"
+#include "compression.h"
+#include "catalog.h"
+
+//the version of the catalog file, which is ignored if it was written by another version.
+static const int CATALOG_VERSION = 1;
+
+/**
+  @return
+    true if both fingerprints are of the same file, unchanged
+*/
+bool FileFingerprint::operator==(const FileFingerprint &other) const noexcept {
+	return name == other.name && size == other.size && modified == other.modified;
+}
+
+/**
+  Find the fingerprint of a file in a directory.
+
+  @param dir
+    The directory, ending in a separator
+
+  @param name
+    The name of the file
+
+  @param fingerprint
+    Set to the fingerprint of the file
+
+  @return
+    false if there is no such file
+*/
+bool fileFingerprint(const std::string &dir, const std::string &name, FileFingerprint &fingerprint) {
+	struct stat info;
+	if (stat((dir + name).c_str(), &info) != 0) {
+		return false;
+	}
+
+	fingerprint.name = name;
+	fingerprint.size = (unsigned long long) info.st_size;
+#ifdef __linux__
+	fingerprint.modified = (long long) info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+#else
+	fingerprint.modified = (long long) info.st_mtime;
+#endif
+	return true;
+}
+
+/**
+  Find the fingerprint of the file a dataset is read from: the file itself, or
+  its gzipped copy if only that exists (see openInputFile()).
+
+  @param dir
+    The directory, ending in a separator
+
+  @param file
+    The name of the dataset's file
+
+  @param fingerprint
+    Set to the fingerprint of the file
+
+  @return
+    false if there is no such file
+*/
+bool datasetFingerprint(const std::string &dir, const std::string &file, FileFingerprint &fingerprint) {
+	return fileFingerprint(dir, file, fingerprint) || fileFingerprint(dir, file + ".gz", fingerprint);
+}
+
+namespace {
+
+/*
+  Create a directory if it does not already exist.
+*/
+bool makeDirectory(const std::string &path) {
+#ifdef _WIN32
+	return _mkdir(path.c_str()) == 0 || errno == EEXIST;
+#else
+	return mkdir(path.c_str(), 0700) == 0 || errno == EEXIST;
+#endif
+}
+
+} // namespace
+
+/**
+  Find the directory that the caches of a datasets directory (its
+  DatasetCatalog and SchemaCache) are kept in. It is named after the datasets
+  directory and a hash of its full path, within bethyw/ in $XDG_CACHE_HOME,
+  or else ~/.cache (%LOCALAPPDATA% on Windows). It is only created once a
+  cache is saved (see makeCacheDirectory()), and nothing is ever written to
+  the datasets directory itself.
+
+  @param dir
+    The datasets directory, ending in a separator
+
+  @return
+    The cache directory, ending in a separator, or an empty string if there
+    is nowhere to keep caches, in which case nothing is cached
+
+  @example
+    std::ifstream file(cacheDirectory("datasets/") + CATALOG_FILE);
+*/
+std::string cacheDirectory(const std::string &dir) {
+	std::string base;
+#ifdef _WIN32
+	const char *local = std::getenv("LOCALAPPDATA");
+	if (local != nullptr && *local != '\0') {
+		base = local;
+	}
+#else
+	//a relative $XDG_CACHE_HOME is to be ignored, as with other XDG variables.
+	const char *xdg = std::getenv("XDG_CACHE_HOME");
+	const char *home = std::getenv("HOME");
+	if (xdg != nullptr && *xdg == '/') {
+		base = xdg;
+	} else if (home != nullptr && *home != '\0') {
+		base = std::string(home) + "/.cache";
+	}
+#endif
+	if (base.empty()) {
+		return "";
+	}
+
+	std::string full;
+#ifdef _WIN32
+	char buffer[_MAX_PATH];
+	if (_fullpath(buffer, dir.c_str(), _MAX_PATH) != nullptr) {
+		full = buffer;
+	}
+#else
+	char *resolved = realpath(dir.c_str(), nullptr);
+	if (resolved != nullptr) {
+		full = resolved;
+		std::free(resolved);
+	}
+#endif
+	while (full.size() > 1 && (full.back() == '/' || full.back() == '\\')) {
+		full.pop_back();
+	}
+	if (full.empty()) {
+		return "";
+	}
+
+	//FNV-1a, so the name of a directory's cache is the same from one build to the next.
+	uint64_t hash = 14695981039346656037ULL;
+	for (const unsigned char c : full) {
+		hash = (hash ^ c) * 1099511628211ULL;
+	}
+	char hex[17];
+	std::snprintf(hex, sizeof(hex), "%016llx", (unsigned long long) hash);
+
+	const std::string name = full.substr(full.find_last_of("/\\") + 1);
+	return base + "/bethyw/" + (name.empty() ? "root" : name) + "-" + hex + "/";
+}
+
+/**
+  Create a cache directory found by cacheDirectory(), and the bethyw/
+  directory it is in, if they do not already exist.
+
+  @param cache
+    The cache directory, ending in a separator
+
+  @return
+    false if the directory cannot be created, in which case nothing is cached
+
+  @example
+    const std::string cache = cacheDirectory("datasets/");
+    if (makeCacheDirectory(cache)) {
+      std::ofstream file(cache + CATALOG_FILE);
+    }
+*/
+bool makeCacheDirectory(const std::string &cache) {
+	const std::string path = cache.substr(0, cache.size() - 1);
+	const std::string bethyw = path.substr(0, path.find_last_of('/'));
+	const std::string base = bethyw.substr(0, bethyw.find_last_of('/'));
+	return makeDirectory(base) && makeDirectory(bethyw) && makeDirectory(path);
+}
+
+namespace {
+
+/*
+  Scan a CSV file with a column for each year and a row for each area, whose
+  single measure is given by cols.
+*/
+void scanAuthorityByYearCSV(std::istream &is, const BethYw::SourceColumnMapping &cols, CatalogEntry &entry) {
+	std::string line;
+	std::string field;
+
+	std::string measure = cols.at(BethYw::SourceColumn::SINGLE_MEASURE_CODE);
+	std::transform(measure.begin(), measure.end(), measure.begin(), ::tolower);
+	entry.measures.insert(measure);
+
+	if (!std::getline(is, line)) {
+		throw std::runtime_error("DatasetCatalog::scan: the CSV file has no header");
+	}
+	std::stringstream header(line);
+	std::getline(header, field, ',');
+	bool first = true;
+	while (std::getline(header, field, ',')) {
+		const unsigned int year = (unsigned int) std::stoul(field);
+		entry.first_year = first ? year : std::min(entry.first_year, year);
+		entry.last_year = first ? year : std::max(entry.last_year, year);
+		first = false;
+	}
+
+	while (std::getline(is, line)) {
+		std::stringstream row(line);
+		if (std::getline(row, field, ',') && !field.empty()) {
+			entry.areas.emplace(field, "");
+		}
+	}
+}
+
+} // namespace
+
+/**
+  Check whether a dataset may import anything for a query, in the same way as
+  the import would filter it. Areas are matched on their codes and on the
+  names the dataset gives them, as well as the names of the Areas already
+  imported (e.g. the Welsh names from areas.csv).
+
+  @param known
+    The Areas imported so far
+
+  @param areasFilter
+    The areas filter of the query, or an empty set for every area
+
+  @param measuresFilter
+    The measures filter of the query, or an empty set for every measure
+
+  @param yearsFilter
+    The years filter of the query, or (0, 0) for every year
+
+  @return
+    false if the dataset cannot import anything for the query
+
+  @example
+    if (!entry.mayContribute(data, areasFilter, measuresFilter, yearsFilter)) {
+      // skip the dataset
+    }
+*/
+bool CatalogEntry::mayContribute(const Areas &known,
+								 const StringFilterSet &areasFilter,
+								 const StringFilterSet &measuresFilter,
+								 const YearFilterTuple &yearsFilter) const {
+	return mayMatchMeasuresAndYears(measuresFilter, yearsFilter) && mayMatchAreas(known, areasFilter);
+}
+
+/**
+  Check whether any of the measures and years of a dataset pass the filters
+  of a query. Unlike its areas, this does not depend on what has already been
+  imported, so it can be checked before any dataset is.
+
+  @param measuresFilter
+    The measures filter of the query, or an empty set for every measure
+
+  @param yearsFilter
+    The years filter of the query, or (0, 0) for every year
+
+  @return
+    false if the dataset has no measure or year the query would import
+*/
+bool CatalogEntry::mayMatchMeasuresAndYears(const StringFilterSet &measuresFilter,
+											const YearFilterTuple &yearsFilter) const {
+	if (!measuresFilter.empty()) {
+		bool match = false;
+		for (auto code : measuresFilter) {
+			std::transform(code.begin(), code.end(), code.begin(), ::tolower);
+			match |= measures.count(code) != 0;
+		}
+		if (!match) {
+			return false;
+		}
+	}
+
+	if (std::get<1>(yearsFilter) != 0) {
+		if (measures.empty() || std::get<1>(yearsFilter) < first_year || std::get<0>(yearsFilter) > last_year) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+  Check whether any of the areas of a dataset pass the areas filter of a
+  query, matched on their codes, the names the dataset gives them, and the
+  names of the Areas already imported.
+
+  @param known
+    The Areas imported so far
+
+  @param areasFilter
+    The areas filter of the query, or an empty set for every area
+
+  @return
+    false if the dataset has no area the query would import
+*/
+bool CatalogEntry::mayMatchAreas(const Areas &known, const StringFilterSet &areasFilter) const {
+	if (areasFilter.empty()) {
+		return true;
+	}
+	for (const auto &it : areas) {
+		std::string code = it.first;
+		Area area(code);
+		try {
+			for (const auto &name : known.getArea(code).getNames()) {
+				area.setName(name.first, name.second);
+			}
+		} catch (std::out_of_range &e) {}
+		if (checkIfAreaMatchesFilter(area, &areasFilter)) {
+			return true;
+		}
+
+		//the dataset may give the area a different name to the one already known.
+		if (!it.second.empty()) {
+			area.setName("eng", it.second);
+			if (checkIfAreaMatchesFilter(area, &areasFilter)) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/**
+  Add a row of the dataset, as parsed, to what the entry records: its area
+  (with the name the row gives it), its measure and its year.
+
+  @param row
+    A row of the dataset, with its measure in lowercase
+
+  @example
+    CatalogEntry contents;
+    data.setImportObserver([&contents](const IngestRow &row) { contents.add(row); });
+*/
+void CatalogEntry::add(const IngestRow &row) {
+	if (measures.empty()) {
+		first_year = row.year;
+		last_year = row.year;
+	}
+	first_year = std::min(first_year, row.year);
+	last_year = std::max(last_year, row.year);
+	if (measures.count(row.measure) == 0) {
+		measures.insert(row.measure);
+	}
+	if (areas.count(row.code) == 0) {
+		areas.emplace(row.code, row.name);
+	}
+}
+
+/**
+  Constructor for a RecordingPageResolver.
+
+  @param resolver
+    The PageResolver that finds the pages
+
+  @param dir
+    The local directory the pages are in, ending in a separator
+
+  @example
+    LocalPageResolver local("datasets/");
+    RecordingPageResolver resolver(local, "datasets/");
+*/
+RecordingPageResolver::RecordingPageResolver(const PageResolver &resolver, const std::string &dir)
+	: resolver(resolver), local(dir), dir(dir) {}
+
+/**
+  Find the page a nextLink points to with the other resolver, recording its
+  name if there is one.
+
+  @param nextLink
+    The odata.nextLink of the page before
+
+  @return
+    The page, or nullptr if there is none
+*/
+std::unique_ptr<InputSource> RecordingPageResolver::resolve(const std::string &nextLink) const {
+	auto page = resolver.resolve(nextLink);
+	if (page) {
+		std::string path = local.pagePath(nextLink);
+		pages.push_back(path.compare(0, dir.size(), dir) == 0 ? path.substr(dir.size()) : path);
+	}
+	return page;
+}
+
+/**
+  @return
+    The names of the pages found so far, in the directory, in order
+*/
+const std::vector<std::string>& RecordingPageResolver::getPages() const noexcept {
+	return pages;
+}
+
+/**
+  Constructor for the catalog of a directory, read from the catalog file in
+  its cache directory if there is one. A catalog file that cannot be read is
+  ignored, and replaced when the catalog is saved.
+
+  @param dir
+    The directory, ending in a separator
+
+  @example
+    DatasetCatalog catalog("datasets/");
+*/
+DatasetCatalog::DatasetCatalog(const std::string &dir) : dir(dir), cache(cacheDirectory(dir)), changed(false) {
+	if (cache.empty()) {
+		return;
+	}
+	std::ifstream file(cache + CATALOG_FILE);
+	if (!file.is_open()) {
+		return;
+	}
+
+	try {
+		nlohmann::json j;
+		file >> j;
+		if (j.at("version").get<int>() != CATALOG_VERSION) {
+			return;
+		}
+
+		for (const auto &dataset : j.at("datasets").items()) {
+			const auto &value = dataset.value();
+			CatalogEntry entry;
+			for (const auto &file : value.at("files")) {
+				entry.files.push_back(FileFingerprint {file.at("name").get<std::string>(),
+													   file.at("size").get<unsigned long long>(),
+													   file.at("modified").get<long long>()});
+			}
+			entry.measures = value.at("measures").get<std::set<std::string>>();
+			entry.first_year = value.at("years").at(0).get<unsigned int>();
+			entry.last_year = value.at("years").at(1).get<unsigned int>();
+			entry.areas = value.at("areas").get<std::map<std::string, std::string>>();
+			entries[dataset.key()] = entry;
+		}
+	} catch (std::exception &e) {
+		entries.clear();
+	}
+}
+
+/**
+  Find what a dataset contains, if it has been scanned and none of its files
+  have changed since.
+
+  @param dataset
+    The dataset
+
+  @return
+    The catalog entry of the dataset, or nullptr if it needs scanning
+*/
+const CatalogEntry* DatasetCatalog::find(const BethYw::InputFileSource &dataset) const {
+	auto it = entries.find(dataset.FILE);
+	if (it == entries.end() || it->second.files.empty()) {
+		return nullptr;
+	}
+
+	FileFingerprint current;
+	if (!datasetFingerprint(dir, dataset.FILE, current) || !(current == it->second.files[0])) {
+		return nullptr;
+	}
+	for (size_t i = 1; i < it->second.files.size(); i++) {
+		if (!fileFingerprint(dir, it->second.files[i].name, current) || !(current == it->second.files[i])) {
+			return nullptr;
+		}
+	}
+
+	return &it->second;
+}
+
+/**
+  Read a dataset (and any pages after the first) to find what it contains,
+  and add it to the catalog.
+
+  @param dataset
+    The dataset
+
+  @return
+    The catalog entry of the dataset
+
+  @throws
+    std::runtime_error or std::out_of_range if the dataset cannot be read
+
+  @example
+    const CatalogEntry *entry = catalog.find(dataset);
+    if (entry == nullptr) {
+      entry = &catalog.scan(dataset);
+    }
+*/
+const CatalogEntry& DatasetCatalog::scan(const BethYw::InputFileSource &dataset) {
+	FileFingerprint fingerprint;
+	if (!datasetFingerprint(dir, dataset.FILE, fingerprint)) {
+		throw std::runtime_error("DatasetCatalog::scan: Failed to find file " + dir + dataset.FILE);
+	}
+
+	CatalogEntry contents;
+	std::vector<std::string> pages;
+	auto input = openInputFile(dir + dataset.FILE);
+	if (dataset.PARSER == BethYw::WelshStatsJSON) {
+		LocalPageResolver local(dir);
+		RecordingPageResolver resolver(local, dir);
+		Areas scratch = Areas();
+		scratch.setImportObserver([&contents](const IngestRow &row) { contents.add(row); });
+		scratch.populate(input->open(), dataset.PARSER, dataset.COLS, nullptr, nullptr, nullptr, &resolver);
+		pages = resolver.getPages();
+	} else if (dataset.PARSER == BethYw::AuthorityByYearCSV) {
+		scanAuthorityByYearCSV(input->open(), dataset.COLS, contents);
+	}
+
+	return record(dataset, contents, pages);
+}
+
+/**
+  Add what a dataset contains, found while it was read for some other
+  reason (e.g. imported with an ImportObserver, see areas.h), to the catalog,
+  so that it does not have to be scanned.
+
+  @param dataset
+    The dataset
+
+  @param contents
+    What the dataset contains: its measures, years and areas
+
+  @param pages
+    The names of the pages after the first that the dataset was read from,
+    in the directory
+
+  @return
+    The catalog entry of the dataset
+
+  @throws
+    std::runtime_error if the dataset's file cannot be found
+
+  @example
+    RecordingPageResolver pages(resolver, dir);
+    CatalogEntry contents;
+    data.setImportObserver([&contents](const IngestRow &row) { contents.add(row); });
+    data.populate(input->open(), dataset.PARSER, dataset.COLS, &areasFilter, nullptr, nullptr, &pages);
+    catalog.record(dataset, contents, pages.getPages());
+*/
+const CatalogEntry& DatasetCatalog::record(const BethYw::InputFileSource &dataset, const CatalogEntry &contents,
+										   const std::vector<std::string> &pages) {
+	CatalogEntry entry = contents;
+	entry.files.clear();
+
+	FileFingerprint fingerprint;
+	if (!datasetFingerprint(dir, dataset.FILE, fingerprint)) {
+		throw std::runtime_error("DatasetCatalog::record: Failed to find file " + dir + dataset.FILE);
+	}
+	entry.files.push_back(fingerprint);
+	for (const auto &page : pages) {
+		if (fileFingerprint(dir, page, fingerprint)) {
+			entry.files.push_back(fingerprint);
+		}
+	}
+
+	changed = true;
+	return entries[dataset.FILE] = entry;
+}
+
+/**
+  @return
+    true if a dataset has been scanned since the catalog was read
+*/
+bool DatasetCatalog::isChanged() const noexcept {
+	return changed;
+}
+
+/**
+  Write the catalog to the catalog file in its cache directory, if anything
+  has been scanned, creating the cache directory if need be. The file is
+  written alongside and then renamed, so a reader never sees half of it.
+  Failing to write it (e.g. if the cache directory cannot be created) only
+  means the datasets are scanned again next time.
+*/
+void DatasetCatalog::save() {
+	if (!changed) {
+		return;
+	}
+
+	nlohmann::json j;
+	j["version"] = CATALOG_VERSION;
+	j["datasets"] = nlohmann::json::object();
+	for (const auto &it : entries) {
+		nlohmann::json entry;
+		entry["files"] = nlohmann::json::array();
+		for (const auto &file : it.second.files) {
+			entry["files"].push_back({{"name", file.name}, {"size", file.size}, {"modified", file.modified}});
+		}
+		entry["measures"] = it.second.measures;
+		entry["years"] = {it.second.first_year, it.second.last_year};
+		entry["areas"] = it.second.areas;
+		j["datasets"][it.first] = entry;
+	}
+
+	if (cache.empty() || !makeCacheDirectory(cache)) {
+		return;
+	}
+	const std::string path = cache + CATALOG_FILE;
+	const std::string temp = path + ".tmp";
+	{
+		std::ofstream file(temp);
+		if (!file.is_open()) {
+			return;
+		}
+		file << j.dump();
+		if (!file.good()) {
+			return;
+		}
+	}
+	if (std::rename(temp.c_str(), path.c_str()) != 0) {
+		std::remove(temp.c_str());
+		return;
+	}
+	changed = false;
+}
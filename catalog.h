@@ -0,0 +1,117 @@
+#ifndef CATALOG_H_
+#define CATALOG_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains declarations for the dataset catalog, which records
+  which measures, years and areas each dataset in a directory contains, so
+  that a dataset that cannot contribute anything to a query (e.g. econ0080.json
+  for -m pop) can be skipped without being read.
+
+  A dataset is scanned the first time a query with a filter imports it, and
+  what was found is stored in the cache directory of the datasets directory
+  (see cacheDirectory()), along with the size and modification time of each
+  file the dataset was read from (including the pages of a paged JSON
+  dataset). An entry whose files have changed since is ignored and the
+  dataset is scanned again. Only local directories have a catalog.
+ */
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "datasets.h"
+#include "areas.h"
+#include "input.h"
+#include "pipeline.h"
+
+/*
+  The name of the catalog file in the cache directory of a datasets
+  directory.
+*/
+const std::string CATALOG_FILE = "catalog.json";
+
+/*
+  The size and modification time of a file, which change whenever the file
+  does.
+*/
+struct FileFingerprint {
+	std::string name;
+	unsigned long long size;
+	long long modified;
+
+	bool operator==(const FileFingerprint &other) const noexcept;
+};
+
+bool fileFingerprint(const std::string &dir, const std::string &name, FileFingerprint &fingerprint);
+
+bool datasetFingerprint(const std::string &dir, const std::string &file, FileFingerprint &fingerprint);
+
+std::string cacheDirectory(const std::string &dir);
+
+bool makeCacheDirectory(const std::string &cache);
+
+/*
+  What a dataset contains: the codes of its measures (in lower case), its
+  first and last year, and the codes of its areas with any name it gives
+  them.
+*/
+struct CatalogEntry {
+	std::vector<FileFingerprint> files;
+	std::set<std::string> measures;
+	unsigned int first_year = 0;
+	unsigned int last_year = 0;
+	std::map<std::string, std::string> areas;
+
+	bool mayContribute(const Areas &known,
+					   const StringFilterSet &areasFilter,
+					   const StringFilterSet &measuresFilter,
+					   const YearFilterTuple &yearsFilter) const;
+	bool mayMatchMeasuresAndYears(const StringFilterSet &measuresFilter,
+								  const YearFilterTuple &yearsFilter) const;
+	bool mayMatchAreas(const Areas &known, const StringFilterSet &areasFilter) const;
+	void add(const IngestRow &row);
+};
+
+/*
+  A PageResolver that finds pages with another, and records the name of each
+  page it finds in a local directory, so the pages a dataset was read from
+  can be added to its catalog entry.
+*/
+class RecordingPageResolver : public PageResolver {
+ private:
+	const PageResolver &resolver;
+	const LocalPageResolver local;
+	const std::string dir;
+	mutable std::vector<std::string> pages;
+
+ public:
+	RecordingPageResolver(const PageResolver &resolver, const std::string &dir);
+	std::unique_ptr<InputSource> resolve(const std::string &nextLink) const override;
+	const std::vector<std::string>& getPages() const noexcept;
+};
+
+class DatasetCatalog {
+ private:
+	std::string dir;
+	std::string cache;
+	std::map<std::string, CatalogEntry> entries;
+	bool changed;
+
+ public:
+	explicit DatasetCatalog(const std::string &dir);
+	const CatalogEntry* find(const BethYw::InputFileSource &dataset) const;
+	const CatalogEntry& scan(const BethYw::InputFileSource &dataset);
+	const CatalogEntry& record(const BethYw::InputFileSource &dataset, const CatalogEntry &contents,
+							   const std::vector<std::string> &pages);
+	bool isChanged() const noexcept;
+	void save();
+};
+
+#endif // CATALOG_H_
@@ -0,0 +1,253 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the implementation of ColumnarWriter. See the header
+  file for the layout of the format.
+ */
+
+#include <cmath>
+#include <stdexcept>
+
+#include "columnar.h"
+
+namespace {
+
+//the size of the file header, in bytes.
+const size_t HEADER_BYTES = 40;
+
+//round a size up to a multiple of 8 bytes.
+size_t padded(size_t size) noexcept {
+	return (size + 7) & ~((size_t) 7);
+}
+
+bool isLittleEndian() noexcept {
+	const uint32_t one = 1;
+	return *reinterpret_cast<const uint8_t *>(&one) == 1;
+}
+
+} // namespace
+
+/**
+  Constructor for a ColumnarWriter, which writes the header, the
+  dictionaries and the row group table straight away. The rows must then be
+  given, in order, to append(), followed by a call to finish().
+
+  @param os
+    The output stream to write to, which should be opened in binary mode
+
+  @param areaCodes
+    The area dictionary, in sorted order
+
+  @param measureCodes
+    The measure dictionary, in sorted order
+
+  @param rowCount
+    The number of rows that will be appended
+
+  @param rowGroupRows
+    The most rows in a row group
+
+  @throws
+    std::invalid_argument if rowGroupRows is 0
+    std::runtime_error if this is not a little-endian machine
+
+  @example
+    ColumnarWriter writer(file, {"W06000011"}, {"pop"}, 1);
+    writer.append(0, 0, 2019, 246993);
+    writer.finish();
+*/
+ColumnarWriter::ColumnarWriter(
+	std::ostream &os,
+	const std::vector<std::string> &areaCodes,
+	const std::vector<std::string> &measureCodes,
+	uint64_t rowCount,
+	uint32_t rowGroupRows)
+	: os(os), rowCount(rowCount), rowGroupRows(rowGroupRows), rowsWritten(0), invalidCount(0) {
+	if (rowGroupRows == 0) {
+		throw std::invalid_argument("ColumnarWriter: a row group must hold at least one row");
+	}
+	if (!isLittleEndian()) {
+		throw std::runtime_error("ColumnarWriter: the columnar format can only be written on a little-endian machine");
+	}
+
+	const uint32_t groupCount = (uint32_t) ((rowCount + rowGroupRows - 1) / rowGroupRows);
+	const uint64_t tableOffset = HEADER_BYTES + dictionaryBytes(areaCodes) + dictionaryBytes(measureCodes);
+
+	const uint32_t areaCount = (uint32_t) areaCodes.size();
+	const uint32_t measureCount = (uint32_t) measureCodes.size();
+	writeBytes("BYWC", 4);
+	writeBytes(&COLUMNAR_VERSION, sizeof(COLUMNAR_VERSION));
+	writeBytes(&areaCount, sizeof(areaCount));
+	writeBytes(&measureCount, sizeof(measureCount));
+	writeBytes(&rowCount, sizeof(rowCount));
+	writeBytes(&rowGroupRows, sizeof(rowGroupRows));
+	writeBytes(&groupCount, sizeof(groupCount));
+	writeBytes(&tableOffset, sizeof(tableOffset));
+
+	writeDictionary(areaCodes);
+	writeDictionary(measureCodes);
+
+	//every row group but the last is full, so where each starts is known before any is written.
+	std::vector<uint64_t> groupOffsets(groupCount);
+	uint64_t offset = tableOffset + padded(groupCount * sizeof(uint64_t));
+	for (uint32_t i = 0; i < groupCount; i++) {
+		groupOffsets[i] = offset;
+		const uint64_t remaining = rowCount - (uint64_t) i * rowGroupRows;
+		offset += rowGroupBytes(remaining < rowGroupRows ? (uint32_t) remaining : rowGroupRows);
+	}
+	writeBytes(groupOffsets.data(), groupOffsets.size() * sizeof(uint64_t));
+	writePadding(groupOffsets.size() * sizeof(uint64_t));
+
+	const size_t reserve = rowCount < rowGroupRows ? (size_t) rowCount : rowGroupRows;
+	values.reserve(reserve);
+	areaIndexes.reserve(reserve);
+	measureIndexes.reserve(reserve);
+	years.reserve(reserve);
+	validity.reserve((reserve + 7) / 8);
+}
+
+/**
+  Add a row, writing the row group once it is full.
+
+  @param area
+    The index of the row's area in the area dictionary
+
+  @param measure
+    The index of the row's measure in the measure dictionary
+
+  @param year
+    The year of the value
+
+  @param value
+    The value, which is not valid if it is not finite
+
+  @throws
+    std::out_of_range if more rows are appended than the writer was
+    constructed for
+*/
+void ColumnarWriter::append(uint32_t area, uint32_t measure, uint32_t year, double value) {
+	if (rowsWritten + values.size() >= rowCount) {
+		throw std::out_of_range("ColumnarWriter: more rows appended than were declared");
+	}
+
+	const size_t row = values.size();
+	if (row % 8 == 0) {
+		validity.push_back(0);
+	}
+	if (std::isfinite(value)) {
+		validity.back() |= (uint8_t) (1u << (row % 8));
+		values.push_back(value);
+	} else {
+		invalidCount++;
+		values.push_back(0.0);
+	}
+	areaIndexes.push_back(area);
+	measureIndexes.push_back(measure);
+	years.push_back(year);
+
+	if (values.size() == rowGroupRows) {
+		writeRowGroup();
+	}
+}
+
+/**
+  Write the last row group and flush the output stream.
+
+  @throws
+    std::out_of_range if fewer rows were appended than the writer was
+    constructed for
+    std::runtime_error if the output could not be written
+*/
+void ColumnarWriter::finish() {
+	if (!values.empty()) {
+		writeRowGroup();
+	}
+	if (rowsWritten != rowCount) {
+		throw std::out_of_range("ColumnarWriter: fewer rows appended than were declared");
+	}
+
+	os.flush();
+	if (!os.good()) {
+		throw std::runtime_error("ColumnarWriter: failed to write the output");
+	}
+}
+
+/**
+  @param codes
+    A dictionary
+
+  @return
+    The number of bytes the dictionary takes in the file, with its padding
+*/
+size_t ColumnarWriter::dictionaryBytes(const std::vector<std::string> &codes) noexcept {
+	size_t size = (codes.size() + 1) * sizeof(uint32_t);
+	for (const auto &code : codes) {
+		size += code.size();
+	}
+	return padded(size);
+}
+
+/**
+  @param rows
+    The number of rows in a row group
+
+  @return
+    The number of bytes the row group takes in the file, with its padding
+*/
+size_t ColumnarWriter::rowGroupBytes(uint32_t rows) noexcept {
+	return 2 * sizeof(uint32_t)
+		   + rows * sizeof(double)
+		   + 3 * padded(rows * sizeof(uint32_t))
+		   + padded((rows + 7) / 8);
+}
+
+void ColumnarWriter::writeBytes(const void *data, size_t size) {
+	os.write(static_cast<const char *>(data), (std::streamsize) size);
+}
+
+//pad a section of the given size up to the next multiple of 8 bytes.
+void ColumnarWriter::writePadding(size_t size) {
+	static const char zeros[8] = {0};
+	writeBytes(zeros, padded(size) - size);
+}
+
+void ColumnarWriter::writeDictionary(const std::vector<std::string> &codes) {
+	std::vector<uint32_t> offsets;
+	offsets.reserve(codes.size() + 1);
+	offsets.push_back(0);
+	for (const auto &code : codes) {
+		offsets.push_back(offsets.back() + (uint32_t) code.size());
+	}
+	writeBytes(offsets.data(), offsets.size() * sizeof(uint32_t));
+
+	for (const auto &code : codes) {
+		writeBytes(code.data(), code.size());
+	}
+	writePadding(offsets.size() * sizeof(uint32_t) + offsets.back());
+}
+
+//each column is written from its vector in one write.
+void ColumnarWriter::writeRowGroup() {
+	const uint32_t rows = (uint32_t) values.size();
+	writeBytes(&rows, sizeof(rows));
+	writeBytes(&invalidCount, sizeof(invalidCount));
+	writeBytes(values.data(), rows * sizeof(double));
+	for (const auto *column : {&areaIndexes, &measureIndexes, &years}) {
+		writeBytes(column->data(), rows * sizeof(uint32_t));
+		writePadding(rows * sizeof(uint32_t));
+	}
+	writeBytes(validity.data(), validity.size());
+	writePadding(validity.size());
+
+	rowsWritten += rows;
+	values.clear();
+	areaIndexes.clear();
+	measureIndexes.clear();
+	years.clear();
+	validity.clear();
+	invalidCount = 0;
+}
@@ -0,0 +1,106 @@
+#ifndef COLUMNAR_H_
+#define COLUMNAR_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the declaration of ColumnarWriter, which writes the
+  values of an Areas instance in the BYWC binary columnar format (see
+  Areas::toColumnar()). The format is meant to be memory-mapped by another
+  program and read without parsing: every column is a flat little-endian
+  array that starts on an 8-byte boundary, so a pointer into the mapping can
+  be used as a uint32_t or double array directly.
+
+  A file is laid out as follows, where every offset is in bytes from the
+  start of the file and "pad" is zero bytes up to the next multiple of 8:
+
+    header (40 bytes)
+      char[4]  magic, "BYWC"
+      uint32   version, 1
+      uint32   number of areas in the area dictionary
+      uint32   number of measures in the measure dictionary
+      uint64   number of rows
+      uint32   the most rows in a row group
+      uint32   number of row groups
+      uint64   offset of the row group table
+
+    area dictionary, then measure dictionary
+      uint32[n + 1]  offsets of each code into the bytes that follow, so
+                     code i is the bytes [offsets[i], offsets[i + 1])
+      char[]         the codes in UTF-8, in sorted order, without
+                     terminators, then pad
+
+    row group table
+      uint64[number of row groups]  offset of each row group
+
+    row group, for each (of r rows)
+      uint32     r
+      uint32     number of rows whose value is not valid
+      double[r]  value (0 where not valid)
+      uint32[r]  area, as an index into the area dictionary, then pad
+      uint32[r]  measure, as an index into the measure dictionary, then pad
+      uint32[r]  year, then pad
+      uint8[]    validity bitmap of (r + 7) / 8 bytes, where bit i % 8 of
+                 byte i / 8 is set if value i is valid, then pad
+
+  Rows are ordered by area, then measure, then year, as in the long CSV
+  layout. A value is not valid if it is not finite (e.g. a derived measure
+  divided by zero).
+ */
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
+  The version of the BYWC format written, in the header.
+*/
+const uint32_t COLUMNAR_VERSION = 1;
+
+/*
+  The most rows a row group holds by default: 64K rows, so a row group is
+  around 1.3MB.
+*/
+const uint32_t COLUMNAR_ROW_GROUP_ROWS = 64 * 1024;
+
+class ColumnarWriter {
+ private:
+	std::ostream &os;
+	uint64_t rowCount;
+	uint32_t rowGroupRows;
+	uint64_t rowsWritten;
+
+	//the columns of the row group being filled.
+	std::vector<double> values;
+	std::vector<uint32_t> areaIndexes;
+	std::vector<uint32_t> measureIndexes;
+	std::vector<uint32_t> years;
+	std::vector<uint8_t> validity;
+	uint32_t invalidCount;
+
+	void writeBytes(const void *data, size_t size);
+	void writePadding(size_t size);
+	void writeDictionary(const std::vector<std::string> &codes);
+	void writeRowGroup();
+
+ public:
+	ColumnarWriter(
+		std::ostream &os,
+		const std::vector<std::string> &areaCodes,
+		const std::vector<std::string> &measureCodes,
+		uint64_t rowCount,
+		uint32_t rowGroupRows = COLUMNAR_ROW_GROUP_ROWS);
+
+	void append(uint32_t area, uint32_t measure, uint32_t year, double value);
+	void finish();
+
+	static size_t dictionaryBytes(const std::vector<std::string> &codes) noexcept;
+	static size_t rowGroupBytes(uint32_t rows) noexcept;
+};
+
+#endif // COLUMNAR_H_
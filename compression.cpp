@@ -0,0 +1,360 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the implementation of InputDecompressor and the gzip
+  stream buffer behind it. See the header file for additional comments.
+ */
+
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include <zlib.h>
+
+#include "compression.h"
+
+//the size of the reads from the compressed stream, and of the decompressed chunks.
+static const size_t INPUT_CHUNK_SIZE = 64 * 1024;
+static const size_t OUTPUT_CHUNK_SIZE = 256 * 1024;
+
+//how many decompressed chunks the worker thread may get ahead of the reader.
+static const size_t CHUNKS_AHEAD = 4;
+
+/**
+  Work out the compression format of a stream from its first bytes, without
+  consuming them.
+
+  @param is
+    The stream to check, which must not have been read from yet
+
+  @return
+    The compression format, or NoCompression if the magic bytes of none of the
+    formats we know are present
+
+  @throws
+    std::runtime_error if the bytes read cannot be put back into the stream
+
+  @example
+    std::ifstream file("datasets/popu1009.json.gz");
+    detectCompression(file); // returns Gzip
+*/
+Compression detectCompression(std::istream &is) {
+	std::streambuf *buffer = is.rdbuf();
+	if (buffer == nullptr) {
+		return NoCompression;
+	}
+
+	//read up to 6 bytes, which covers the longest magic number (xz).
+	unsigned char magic[6] = {0};
+	size_t read = 0;
+	while (read < sizeof(magic)) {
+		auto c = buffer->sbumpc();
+		if (c == std::streambuf::traits_type::eof()) {
+			break;
+		}
+		magic[read++] = (unsigned char) c;
+	}
+
+	for (size_t i = 0; i < read; i++) {
+		if (buffer->sungetc() == std::streambuf::traits_type::eof()) {
+			throw std::runtime_error("detectCompression: Failed to rewind stream");
+		}
+	}
+
+	if (read >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+		return Gzip;
+	} else if (read >= 3 && magic[0] == 'B' && magic[1] == 'Z' && magic[2] == 'h') {
+		return Bzip2;
+	} else if (read >= 6 && magic[0] == 0xfd && magic[1] == '7' && magic[2] == 'z'
+			   && magic[3] == 'X' && magic[4] == 'Z' && magic[5] == 0x00) {
+		return Xz;
+	} else if (read >= 4 && magic[0] == 0x28 && magic[1] == 0xb5
+			   && magic[2] == 0x2f && magic[3] == 0xfd) {
+		return Zstd;
+	}
+
+	return NoCompression;
+}
+
+/**
+  @param format
+    A compression format
+
+  @return
+    The usual name of the format, e.g. "gzip"
+*/
+std::string compressionName(Compression format) noexcept {
+	switch (format) {
+	case Gzip:
+		return "gzip";
+	case Bzip2:
+		return "bzip2";
+	case Xz:
+		return "xz";
+	case Zstd:
+		return "zstd";
+	default:
+		return "none";
+	}
+}
+
+/**
+  Constructor for a stream buffer over the decompressed contents of a gzip
+  stream. Decompression starts straight away on another thread.
+
+  @param compressed
+    The gzip data, which must outlive the stream buffer
+
+  @param source
+    The name of the source of the data, for error messages
+
+  @example
+    std::ifstream file("datasets/popu1009.json.gz");
+    GzipStreamBuf buffer(file, "datasets/popu1009.json.gz");
+    std::istream is(&buffer);
+*/
+GzipStreamBuf::GzipStreamBuf(std::istream &_compressed, const std::string &_source)
+	: compressed(_compressed), source(_source), chunks(CHUNKS_AHEAD) {
+	worker = std::thread(&GzipStreamBuf::decompress, this);
+}
+
+/**
+  Destructor for the stream buffer, which stops the decompression thread if
+  the stream has not been read to the end.
+*/
+GzipStreamBuf::~GzipStreamBuf() {
+	chunks.close();
+	worker.join();
+}
+
+/**
+  The body of the decompression thread. Reads the compressed stream, inflates
+  it and pushes the output onto the queue until the end of the data, an
+  error, or the queue being closed by the destructor.
+
+  Files made by concatenating gzip files (which gzip itself accepts) are
+  decompressed as one stream.
+*/
+void GzipStreamBuf::decompress() {
+	z_stream zs;
+	zs.zalloc = Z_NULL;
+	zs.zfree = Z_NULL;
+	zs.opaque = Z_NULL;
+	zs.next_in = Z_NULL;
+	zs.avail_in = 0;
+
+	//15 + 16 tells zlib to expect a gzip header and trailer.
+	if (inflateInit2(&zs, 15 + 16) != Z_OK) {
+		Chunk chunk;
+		chunk.error = std::make_exception_ptr(
+			std::runtime_error("GzipStreamBuf: Failed to initialise zlib for " + source));
+		chunks.push(std::move(chunk));
+		chunks.close();
+		return;
+	}
+
+	std::vector<char> input(INPUT_CHUNK_SIZE);
+	Chunk chunk;
+	chunk.data.resize(OUTPUT_CHUNK_SIZE);
+	size_t filled = 0;
+	bool in_member = true;
+
+	try {
+		for (;;) {
+			if (zs.avail_in == 0) {
+				compressed.read(input.data(), input.size());
+				zs.next_in = (Bytef *) input.data();
+				zs.avail_in = (uInt) compressed.gcount();
+				if (zs.avail_in == 0) {
+					if (compressed.bad()) {
+						throw std::runtime_error("GzipStreamBuf: Failed to read " + source);
+					}
+					if (in_member) {
+						throw std::runtime_error("GzipStreamBuf: Unexpected end of gzip data in " + source);
+					}
+					break;
+				}
+			}
+
+			//a new member has started after the end of the previous one.
+			if (!in_member) {
+				inflateReset(&zs);
+				in_member = true;
+			}
+
+			zs.next_out = (Bytef *) &chunk.data[filled];
+			zs.avail_out = (uInt) (chunk.data.size() - filled);
+
+			int result = inflate(&zs, Z_NO_FLUSH);
+			filled = chunk.data.size() - zs.avail_out;
+
+			if (result == Z_STREAM_END) {
+				in_member = false;
+			} else if (result != Z_OK && result != Z_BUF_ERROR) {
+				throw std::runtime_error("GzipStreamBuf: Corrupt gzip data in " + source);
+			}
+
+			if (filled == chunk.data.size()) {
+				if (!chunks.push(std::move(chunk))) {
+					inflateEnd(&zs);
+					return;
+				}
+				chunk = Chunk();
+				chunk.data.resize(OUTPUT_CHUNK_SIZE);
+				filled = 0;
+			}
+		}
+
+		if (filled > 0) {
+			chunk.data.resize(filled);
+			chunks.push(std::move(chunk));
+		}
+	} catch (std::exception &e) {
+		//hand over what was decompressed before the error, then the error itself.
+		if (filled > 0) {
+			chunk.data.resize(filled);
+			chunks.push(std::move(chunk));
+		}
+		Chunk error;
+		error.error = std::current_exception();
+		chunks.push(std::move(error));
+	}
+
+	inflateEnd(&zs);
+	chunks.close();
+}
+
+/**
+  Make the next decompressed chunk available to the stream, waiting for the
+  decompression thread if necessary.
+
+  @return
+    The next character, or EOF at the end of the data
+
+  @throws
+    std::runtime_error if the gzip data could not be decompressed
+*/
+GzipStreamBuf::int_type GzipStreamBuf::underflow() {
+	if (gptr() < egptr()) {
+		return traits_type::to_int_type(*gptr());
+	}
+
+	Chunk chunk;
+	do {
+		if (!chunks.pop(chunk)) {
+			return traits_type::eof();
+		}
+		if (chunk.error) {
+			std::rethrow_exception(chunk.error);
+		}
+	} while (chunk.data.empty());
+
+	current = std::move(chunk.data);
+	setg(&current[0], &current[0], &current[0] + current.size());
+	return traits_type::to_int_type(*gptr());
+}
+
+/**
+  Constructor for a source that may be compressed.
+
+  @param inner
+    The source of the (possibly) compressed data
+
+  @example
+    InputDecompressor input(std::unique_ptr<InputSource>(
+      new InputFile("datasets/popu1009.json.gz")));
+*/
+InputDecompressor::InputDecompressor(std::unique_ptr<InputSource> _inner)
+	: InputSource(_inner->getSource()), inner(std::move(_inner)), format(NoCompression) {}
+
+/**
+  Open the wrapped source and return a reference to a stream of its
+  decompressed contents. If it is not compressed, the wrapped source's own
+  stream is returned.
+
+  Errors while decompressing are raised as exceptions from the stream's read
+  functions, so they can't be mistaken for the end of the data.
+
+  @return
+    A standard input stream reference
+
+  @throws
+    std::runtime_error if the wrapped source fails to open, or the data is
+    compressed in a format we cannot decompress, with the message:
+    InputDecompressor::open: Unsupported compression format <format> in <source>
+
+  @example
+    InputDecompressor input(std::unique_ptr<InputSource>(
+      new InputFile("datasets/popu1009.json.gz")));
+    input.open();
+*/
+std::istream& InputDecompressor::open() {
+	std::istream &is = inner->open();
+
+	format = detectCompression(is);
+	switch (format) {
+	case NoCompression:
+		return is;
+
+	case Gzip:
+		buffer.reset(new GzipStreamBuf(is, getSource()));
+		stream.reset(new std::istream(buffer.get()));
+		stream->exceptions(std::ios::badbit);
+		return *stream;
+
+	default:
+		throw std::runtime_error("InputDecompressor::open: Unsupported compression format "
+								 + compressionName(format) + " in " + getSource());
+	}
+}
+
+/**
+  @return
+    The compression format detected when the source was opened
+*/
+Compression InputDecompressor::compression() const noexcept {
+	return format;
+}
+
+/**
+  Find the file on disk to read for a file that may have been compressed:
+  if the file does not exist but <path>.gz does, that is read instead.
+
+  @param path
+    The path of the uncompressed file
+
+  @return
+    path, or path + ".gz"
+
+  @example
+    resolveInputFile("datasets/popu1009.json"); // "datasets/popu1009.json.gz" if only that exists
+*/
+std::string resolveInputFile(const std::string &path) {
+	if (!std::ifstream(path).is_open() && std::ifstream(path + ".gz").is_open()) {
+		return path + ".gz";
+	}
+	return path;
+}
+
+/**
+  Create a source for a file on disk that may be compressed. If the file does
+  not exist but <path>.gz does, that is used instead (see resolveInputFile()).
+
+  @param path
+    The path of the uncompressed file
+
+  @return
+    An InputDecompressor reading the file or its gzipped copy
+
+  @example
+    auto input = openInputFile("datasets/popu1009.json");
+    std::istream &is = input->open(); // reads popu1009.json.gz if necessary
+*/
+std::unique_ptr<InputSource> openInputFile(const std::string &path) {
+	return std::unique_ptr<InputSource>(
+		new InputDecompressor(std::unique_ptr<InputSource>(new InputFile(resolveInputFile(path)))));
+}
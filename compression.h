@@ -0,0 +1,103 @@
+#ifndef COMPRESSION_H_
+#define COMPRESSION_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains declarations for reading compressed datasets without
+  decompressing them to disk first.
+
+  InputDecompressor wraps another InputSource. When it is opened it looks at
+  the first bytes of the wrapped stream to work out whether the data is
+  compressed, and if it is gzip, returns a stream of the decompressed data.
+  The decompression runs on its own thread, a few chunks ahead of whatever
+  is reading the stream, so the parsers and zlib work at the same time.
+  Uncompressed data is passed through untouched.
+
+  openInputFile() is how datasets on disk are opened: if a file does not
+  exist but a gzipped copy of it (<file>.gz) does, the copy is read instead.
+ */
+
+#include <exception>
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+#include "input.h"
+#include "queue.h"
+
+/*
+  The formats we recognise by their magic bytes. Only Gzip can currently be
+  decompressed, the others are recognised so that we can give a useful error
+  rather than trying to parse compressed data as text.
+*/
+enum Compression {
+	NoCompression,
+	Gzip,
+	Bzip2,
+	Xz,
+	Zstd
+};
+
+Compression detectCompression(std::istream &is);
+
+std::string compressionName(Compression format) noexcept;
+
+/*
+  A read-only stream buffer over the output of a thread decompressing gzip
+  data from another stream. The thread hands over the decompressed data in
+  chunks through a bounded queue; any error it hits is rethrown by the
+  reading thread when it reaches that point in the stream.
+*/
+class GzipStreamBuf : public std::streambuf {
+ private:
+	struct Chunk {
+		std::string data;
+		std::exception_ptr error;
+	};
+
+	std::istream &compressed;
+	const std::string source;
+	BlockingQueue<Chunk> chunks;
+	std::string current;
+	std::thread worker;
+
+	void decompress();
+
+ protected:
+	int_type underflow() override;
+
+ public:
+	GzipStreamBuf(std::istream &compressed, const std::string &source);
+	~GzipStreamBuf();
+	GzipStreamBuf(const GzipStreamBuf &) = delete;
+	GzipStreamBuf &operator=(const GzipStreamBuf &) = delete;
+};
+
+/*
+  Source data that may be compressed, read through another InputSource (e.g.
+  an InputFile of a .json.gz file).
+*/
+class InputDecompressor : public InputSource {
+ private:
+	std::unique_ptr<InputSource> inner;
+	std::unique_ptr<GzipStreamBuf> buffer;
+	std::unique_ptr<std::istream> stream;
+	Compression format;
+ public:
+	explicit InputDecompressor(std::unique_ptr<InputSource> inner);
+	std::istream& open() override;
+	Compression compression() const noexcept;
+};
+
+std::string resolveInputFile(const std::string &path);
+
+std::unique_ptr<InputSource> openInputFile(const std::string &path);
+
+#endif // COMPRESSION_H_
@@ -0,0 +1,382 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the implementation of MeasureCorrelation. See the header
+  file for additional comments.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include "lib_json.hpp"
+#include "correlation.h"
+
+namespace {
+
+/*
+  Turn the sums over the observations of a pair into its statistics.
+*/
+PairStatistics pairStatistics(double n, double sx, double sy, double sxx, double syy, double sxy) {
+	const double nan = std::numeric_limits<double>::quiet_NaN();
+	PairStatistics statistics {(size_t) n, nan, nan};
+	if (n < 2) {
+		return statistics;
+	}
+
+	const double cxy = sxy - sx * sy / n;
+	const double cxx = sxx - sx * sx / n;
+	const double cyy = syy - sy * sy / n;
+	statistics.covariance = cxy / (n - 1);
+
+	//a measure that does not vary only differs from its mean by rounding errors.
+	if (cxx > sxx * 1e-12 && cyy > syy * 1e-12) {
+		statistics.correlation = std::max(-1.0, std::min(1.0, cxy / std::sqrt(cxx * cyy)));
+	}
+
+	return statistics;
+}
+
+} // namespace
+
+/**
+  Constructor for the aligned measures of an Areas instance. Every measure in
+  any Area that is output (see Areas::setMeasureView()) is included, and
+  there is an observation for every year any measure has a value for in each
+  Area.
+
+  @param areas
+    The Areas instance
+
+  @example
+    MeasureCorrelation correlation(data);
+    printCorrelation(std::cout, correlation, false);
+*/
+MeasureCorrelation::MeasureCorrelation(const Areas &areas) : rows(0) {
+	std::set<std::string> codes;
+	std::vector<std::vector<unsigned int>> years;
+
+	//first the measures, and the years (and so the observations) of each area.
+	for (const auto &area : areas) {
+		std::set<unsigned int> area_years;
+		for (const auto &measure : area.second.getMeasures()) {
+			if (!areas.isMeasureInView(measure.first)) {
+				continue;
+			}
+			codes.insert(measure.first);
+			for (const auto &value : measure.second.getValues()) {
+				area_years.insert(value.first);
+			}
+		}
+		years.emplace_back(area_years.begin(), area_years.end());
+		rows += area_years.size();
+	}
+
+	measures.assign(codes.begin(), codes.end());
+	std::map<std::string, size_t> columns;
+	for (size_t i = 0; i < measures.size(); i++) {
+		columns[measures[i]] = i;
+	}
+
+	//the entries of each measure, in order of observation, since the areas and their years are in order.
+	std::vector<std::vector<std::pair<size_t, double>>> entries(measures.size());
+	size_t first_row = 0;
+	size_t area_index = 0;
+	for (const auto &area : areas) {
+		const auto &area_years = years[area_index++];
+		for (const auto &measure : area.second.getMeasures()) {
+			if (!areas.isMeasureInView(measure.first)) {
+				continue;
+			}
+			auto &column = entries[columns[measure.first]];
+			for (const auto &value : measure.second.getValues()) {
+				if (!std::isfinite(value.second)) {
+					continue;
+				}
+				size_t row = first_row + (std::lower_bound(area_years.begin(), area_years.end(), value.first)
+										  - area_years.begin());
+				column.emplace_back(row, value.second);
+			}
+		}
+		first_row += area_years.size();
+	}
+
+	//centre each measure on its mean, so that large values do not swamp the sums of squares.
+	starts.assign(1, 0);
+	for (const auto &column : entries) {
+		double sum = 0.0;
+		for (const auto &entry : column) {
+			sum += entry.second;
+		}
+		const double mean = column.empty() ? 0.0 : sum / column.size();
+		for (const auto &entry : column) {
+			observations.push_back(entry.first);
+			values.push_back(entry.second - mean);
+		}
+		starts.push_back(observations.size());
+	}
+}
+
+/**
+  @return
+    The codes of the measures, in the order of the rows and columns of the
+    matrix
+*/
+const std::vector<std::string>& MeasureCorrelation::getMeasures() const noexcept {
+	return measures;
+}
+
+/**
+  @return
+    The number of observations: the number of years in each area, summed
+*/
+size_t MeasureCorrelation::observationCount() const noexcept {
+	return rows;
+}
+
+/**
+  Compare two measures over the observations both have a value for.
+
+  @param i
+    The index of the first measure in getMeasures()
+
+  @param j
+    The index of the second measure in getMeasures()
+
+  @return
+    The statistics of the pair
+
+  @throws
+    std::out_of_range if i or j is not the index of a measure
+
+  @example
+    auto statistics = correlation.pair(0, 1);
+*/
+PairStatistics MeasureCorrelation::pair(size_t i, size_t j) const {
+	if (i >= measures.size() || j >= measures.size()) {
+		throw std::out_of_range("MeasureCorrelation::pair: no measure at index " + std::to_string(std::max(i, j)));
+	}
+
+	size_t a = starts[i];
+	size_t b = starts[j];
+	const size_t a_end = starts[i + 1];
+	const size_t b_end = starts[j + 1];
+
+	//only the observations in both measures are summed.
+	double n = 0, sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+	while (a < a_end && b < b_end) {
+		if (observations[a] < observations[b]) {
+			a++;
+		} else if (observations[b] < observations[a]) {
+			b++;
+		} else {
+			const double x = values[a++];
+			const double y = values[b++];
+			n += 1;
+			sx += x;
+			sy += y;
+			sxx += x * x;
+			syy += y * y;
+			sxy += x * y;
+		}
+	}
+
+	return pairStatistics(n, sx, sy, sxx, syy, sxy);
+}
+
+/**
+  Compute the pairs of a block of the matrix on or above the diagonal.
+
+  @param first_row, last_row
+    The measures of the rows of the block (last_row is excluded)
+
+  @param first_col, last_col
+    The measures of the columns of the block (last_col is excluded)
+
+  @param out
+    The rows of the matrix from first_row on, each starting at the diagonal
+*/
+void MeasureCorrelation::computeBlock(size_t first_row, size_t last_row, size_t first_col, size_t last_col,
+									  std::vector<std::vector<PairStatistics>> &out) const {
+	for (size_t i = first_row; i < last_row; i++) {
+		for (size_t j = std::max(i, first_col); j < last_col; j++) {
+			out[i - first_row][j - i] = pair(i, j);
+		}
+	}
+}
+
+/**
+  Compute the upper triangle of the matrix, one row of blocks at a time. The
+  blocks in a row are shared out between tasks on a TaskScheduler (see
+  scheduler.h), and once they are all done, each row of the matrix in them is
+  passed to `onRow`, in order.
+
+  @param onRow
+    Called with the index of each measure and its statistics with itself and
+    every measure after it
+
+  @param scheduler
+    The scheduler to run the tasks on, or nullptr for the shared one
+
+  @param blockSize
+    The number of measures in each side of a block
+
+  @example
+    correlation.compute([](size_t i, const std::vector<PairStatistics> &row) {
+      // row[0] is measure i with itself, row[1] with measure i + 1, ...
+    });
+*/
+void MeasureCorrelation::compute(const std::function<void(size_t, const std::vector<PairStatistics> &)> &onRow,
+								 TaskScheduler *scheduler,
+								 size_t blockSize) const {
+	const size_t n = measures.size();
+	if (blockSize == 0) {
+		blockSize = 64;
+	}
+	if (scheduler == nullptr) {
+		scheduler = &TaskScheduler::shared();
+	}
+	const size_t blocks = (n + blockSize - 1) / blockSize;
+
+	for (size_t block_row = 0; block_row < blocks; block_row++) {
+		const size_t first_row = block_row * blockSize;
+		const size_t last_row = std::min(n, first_row + blockSize);
+
+		std::vector<std::vector<PairStatistics>> out(last_row - first_row);
+		for (size_t i = first_row; i < last_row; i++) {
+			out[i - first_row].resize(n - i);
+		}
+
+		//a task for each block in the row.
+		parallelFor(*scheduler, blocks - block_row, 1, [&](size_t first, size_t last) {
+			for (size_t block = block_row + first; block < block_row + last; block++) {
+				computeBlock(first_row, last_row, block * blockSize, std::min(n, (block + 1) * blockSize), out);
+			}
+		});
+
+		for (size_t i = first_row; i < last_row; i++) {
+			onRow(i, out[i - first_row]);
+		}
+	}
+}
+
+/**
+  Print the upper triangle of the correlation (or covariance) matrix as a
+  table. Pairs that cannot be calculated are printed as -.
+
+  @param os
+    The output stream to print to
+
+  @param correlation
+    The aligned measures
+
+  @param covariance
+    True to print the covariances instead of the correlations
+
+  @param scheduler
+    The scheduler to compute the matrix on, or nullptr for the shared one
+
+  @example
+    printCorrelation(std::cout, MeasureCorrelation(data), false);
+*/
+void printCorrelation(std::ostream &os, const MeasureCorrelation &correlation, bool covariance, TaskScheduler *scheduler) {
+	const auto &measures = correlation.getMeasures();
+
+	os << (covariance ? "Covariance" : "Correlation") << " of " << measures.size() << " measures over "
+	   << correlation.observationCount() << " area-years" << std::endl;
+	if (measures.empty()) {
+		return;
+	}
+
+	//covariances can be any size, so are printed in scientific notation.
+	size_t label_width = 0;
+	size_t width = covariance ? 13 : 9;
+	for (const auto &code : measures) {
+		label_width = std::max(label_width, code.length());
+		width = std::max(width, code.length());
+	}
+
+	os << std::setw((int) label_width) << "";
+	for (const auto &code : measures) {
+		os << " " << std::setw((int) width) << code;
+	}
+	os << std::endl;
+
+	correlation.compute([&](size_t i, const std::vector<PairStatistics> &row) {
+		os << std::left << std::setw((int) label_width) << measures[i] << std::right;
+		for (size_t j = 0; j < i; j++) {
+			os << " " << std::setw((int) width) << "";
+		}
+
+		std::ostringstream cell;
+		for (const auto &statistics : row) {
+			const double value = covariance ? statistics.covariance : statistics.correlation;
+			cell.str("");
+			if (std::isnan(value)) {
+				cell << "-";
+			} else if (covariance) {
+				cell << std::scientific << std::setprecision(6) << value;
+			} else {
+				cell << std::fixed << std::setprecision(6) << value;
+			}
+			os << " " << std::setw((int) width) << cell.str();
+		}
+		os << std::endl;
+	}, scheduler);
+
+	os << std::endl;
+}
+
+/**
+  Print the upper triangle of the matrix as JSON, as each row is computed,
+  e.g.
+
+    {"measures":["dens","pop"],"observations":660,"pairs":[
+      {"correlation":1.0,"covariance":...,"observations":660,"x":"dens","y":"dens"},
+      {"correlation":0.3,"covariance":...,"observations":660,"x":"dens","y":"pop"},...]}
+
+  Pairs that cannot be calculated have a null covariance or correlation.
+
+  @param os
+    The output stream to print to
+
+  @param correlation
+    The aligned measures
+
+  @param scheduler
+    The scheduler to compute the matrix on, or nullptr for the shared one
+
+  @example
+    printCorrelationJSON(std::cout, MeasureCorrelation(data));
+*/
+void printCorrelationJSON(std::ostream &os, const MeasureCorrelation &correlation, TaskScheduler *scheduler) {
+	const auto &measures = correlation.getMeasures();
+
+	os << "{\"measures\":" << nlohmann::json(measures).dump()
+	   << ",\"observations\":" << correlation.observationCount() << ",\"pairs\":[";
+
+	bool first = true;
+	correlation.compute([&](size_t i, const std::vector<PairStatistics> &row) {
+		for (size_t offset = 0; offset < row.size(); offset++) {
+			nlohmann::json pair;
+			pair["x"] = measures[i];
+			pair["y"] = measures[i + offset];
+			pair["observations"] = row[offset].observations;
+			pair["covariance"] = row[offset].covariance;
+			pair["correlation"] = row[offset].correlation;
+
+			os << (first ? "" : ",") << pair.dump();
+			first = false;
+		}
+	}, scheduler);
+
+	os << "]}";
+}
@@ -0,0 +1,81 @@
+#ifndef CORRELATION_H_
+#define CORRELATION_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains declarations for correlating every measure in an Areas
+  instance with every other.
+
+  Each measure is a column of observations, one for each year of each area
+  (so measures are aligned by area and year). A pair of measures is compared
+  over the observations both have a value for, so a year missing from one
+  measure only leaves that observation out of the pairs with that measure.
+
+  Each column is stored once, centred on its mean, as only the observations
+  it has a value for, in order, so a measure that covers few areas or years
+  takes little memory however many observations there are. Comparing a pair
+  is a merge of the two columns, over the observations in both of them.
+  The matrix is computed in square blocks of measures shared out between
+  tasks on a TaskScheduler, one row of blocks at a time, and each row is
+  handed on (e.g. to be printed) before the next is computed. Only the upper
+  triangle is computed, since the matrix is symmetric, and only one row of
+  blocks is held in memory at a time rather than the whole matrix.
+ */
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "areas.h"
+#include "scheduler.h"
+
+/*
+  The statistics of a pair of measures, over the observations both have.
+  The covariance needs 2 observations and the correlation needs both measures
+  to vary; otherwise they are NaN.
+*/
+struct PairStatistics {
+	size_t observations;
+	double covariance;
+	double correlation;
+};
+
+/*
+  The measures of an Areas instance, aligned by area and year, ready to be
+  correlated.
+*/
+class MeasureCorrelation {
+ private:
+	std::vector<std::string> measures;
+	size_t rows;
+
+	//the observations each measure has a value for, in order, and those values: the entries of measure i
+	//are from starts[i] up to starts[i + 1].
+	std::vector<size_t> starts;
+	std::vector<size_t> observations;
+	std::vector<double> values;
+
+	void computeBlock(size_t first_row, size_t last_row, size_t first_col, size_t last_col,
+					  std::vector<std::vector<PairStatistics>> &out) const;
+
+ public:
+	explicit MeasureCorrelation(const Areas &areas);
+	const std::vector<std::string>& getMeasures() const noexcept;
+	size_t observationCount() const noexcept;
+	PairStatistics pair(size_t i, size_t j) const;
+	void compute(const std::function<void(size_t, const std::vector<PairStatistics> &)> &onRow,
+				 TaskScheduler *scheduler = nullptr,
+				 size_t blockSize = 64) const;
+};
+
+void printCorrelation(std::ostream &os, const MeasureCorrelation &correlation, bool covariance, TaskScheduler *scheduler = nullptr);
+
+void printCorrelationJSON(std::ostream &os, const MeasureCorrelation &correlation, TaskScheduler *scheduler = nullptr);
+
+#endif // CORRELATION_H_
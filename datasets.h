@@ -72,7 +72,8 @@ enum SourceColumn {
   SINGLE_MEASURE_CODE,
   SINGLE_MEASURE_NAME,
   YEAR,
-  VALUE
+  VALUE,
+  AUTH_HIERARCHY
 };
 
 /*
@@ -136,7 +137,8 @@ const InputFileSource POPDEN = {
     {MEASURE_CODE,  "Measure_Code"},
     {MEASURE_NAME,  "Measure_ItemName_ENG"},
     {YEAR,          "Year_Code"},
-    {VALUE,         "Data"}
+    {VALUE,         "Data"},
+    {AUTH_HIERARCHY, "Localauthority_Hierarchy"}
   }
 }; // const InputFileSource POPDEN
 
@@ -151,7 +153,8 @@ const InputFileSource BIZ = {
     {MEASURE_CODE,  "Variable_Code"},
     {MEASURE_NAME,  "Variable_ItemNotes_ENG"},
     {YEAR,          "Year_Code"},
-    {VALUE,         "Data"}
+    {VALUE,         "Data"},
+    {AUTH_HIERARCHY, "Area_Hierarchy"}
   }
 }; // const InputFileSource BIZ
 
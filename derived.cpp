@@ -0,0 +1,552 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the implementation of derived measures. See the header
+  file for additional comments.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "derived.h"
+
+/*
+  A recursive descent parser for the expression of a derived measure, which
+  compiles it into the measure's postfix program:
+
+    expression := term (('+' | '-') term)*
+    term       := factor (('*' | '/') factor)*
+    factor     := '-' factor | number | code | '{' code '}' | '(' expression ')'
+*/
+class ExpressionParser {
+ private:
+	const std::string &text;
+	size_t pos;
+	DerivedMeasure &measure;
+
+	void fail(const std::string &reason) const {
+		throw std::invalid_argument("Invalid expression for derived measure " + measure.code + ": "
+									+ reason + " at position " + std::to_string(pos + 1));
+	}
+
+	char peek() {
+		while (pos < text.size() && std::isspace((unsigned char) text[pos])) {
+			pos++;
+		}
+		return pos < text.size() ? text[pos] : '\0';
+	}
+
+	void emit(DerivedMeasure::OpCode code, double constant = 0.0, size_t input = 0) {
+		measure.program.push_back({code, constant, input});
+	}
+
+	void input(std::string code) {
+		std::transform(code.begin(), code.end(), code.begin(), ::tolower);
+		if (code == measure.code) {
+			fail("a derived measure cannot use itself");
+		}
+
+		auto it = std::find(measure.inputs.begin(), measure.inputs.end(), code);
+		if (it == measure.inputs.end()) {
+			measure.inputs.push_back(code);
+			it = measure.inputs.end() - 1;
+		}
+		emit(DerivedMeasure::Input, 0.0, it - measure.inputs.begin());
+	}
+
+	void expression() {
+		term();
+		for (char c = peek(); c == '+' || c == '-'; c = peek()) {
+			pos++;
+			term();
+			emit(c == '+' ? DerivedMeasure::Add : DerivedMeasure::Subtract);
+		}
+	}
+
+	void term() {
+		factor();
+		for (char c = peek(); c == '*' || c == '/'; c = peek()) {
+			pos++;
+			factor();
+			emit(c == '*' ? DerivedMeasure::Multiply : DerivedMeasure::Divide);
+		}
+	}
+
+	void factor() {
+		char c = peek();
+
+		if (c == '-') {
+			pos++;
+			factor();
+			emit(DerivedMeasure::Negate);
+		} else if (c == '(') {
+			pos++;
+			expression();
+			if (peek() != ')') {
+				fail("expected )");
+			}
+			pos++;
+		} else if (c == '{') {
+			size_t close = text.find('}', pos);
+			if (close == std::string::npos || close == pos + 1) {
+				fail("expected a measure code and }");
+			}
+			input(text.substr(pos + 1, close - pos - 1));
+			pos = close + 1;
+		} else if (std::isdigit((unsigned char) c) || c == '.') {
+			const char *start = text.c_str() + pos;
+			char *end;
+			double value = std::strtod(start, &end);
+			if (end == start) {
+				fail("expected a number");
+			}
+			pos += end - start;
+			emit(DerivedMeasure::Constant, value);
+		} else if (std::isalpha((unsigned char) c) || c == '_') {
+			size_t start = pos;
+			while (pos < text.size() && (std::isalnum((unsigned char) text[pos]) || text[pos] == '_')) {
+				pos++;
+			}
+			input(text.substr(start, pos - start));
+		} else if (c == '\0') {
+			fail("unexpected end of expression");
+		} else {
+			fail(std::string("unexpected '") + c + "'");
+		}
+	}
+
+ public:
+	ExpressionParser(const std::string &text, DerivedMeasure &measure)
+		: text(text), pos(0), measure(measure) {}
+
+	void parse() {
+		expression();
+		if (peek() != '\0') {
+			fail(std::string("unexpected '") + text[pos] + "'");
+		}
+		if (measure.inputs.empty()) {
+			throw std::invalid_argument("Invalid expression for derived measure " + measure.code
+										+ ": the expression must use at least one measure");
+		}
+	}
+};
+
+/**
+  Constructor for a derived measure, which compiles its expression.
+
+  @param code
+    The codename of the derived measure, which is converted to lowercase
+
+  @param expression
+    The expression to calculate the measure with, which is also its label
+
+  @throws
+    std::invalid_argument if the expression cannot be parsed
+
+  @example
+    DerivedMeasure railpp("railpp", "rail / pop");
+*/
+DerivedMeasure::DerivedMeasure(const std::string &code, const std::string &expression)
+	: code(code), label(expression) {
+	std::transform(this->code.begin(), this->code.end(), this->code.begin(), ::tolower);
+
+	//the label is the expression, without the spaces around it.
+	label.erase(0, label.find_first_not_of(" \t"));
+	label.erase(label.find_last_not_of(" \t") + 1);
+
+	ExpressionParser(expression, *this).parse();
+}
+
+/**
+  @return
+    The codename of the derived measure
+*/
+std::string DerivedMeasure::getCodename() const noexcept {
+	return code;
+}
+
+/**
+  @return
+    The label of the derived measure, its expression
+*/
+std::string DerivedMeasure::getLabel() const noexcept {
+	return label;
+}
+
+/**
+  @return
+    The codes of the measures the expression uses, in the order it first uses
+    them
+*/
+const std::vector<std::string>& DerivedMeasure::getInputs() const noexcept {
+	return inputs;
+}
+
+/**
+  Evaluate the derived measure for an Area, for every year that all the
+  measures it uses have a value for. Years for which the result is not a
+  finite number (e.g. because of a division by zero) are left out.
+
+  @param area
+    The Area to evaluate the derived measure for
+
+  @param years
+    Set to the years the derived measure has a value for, in order
+
+  @param values
+    Set to the values of the derived measure for each of those years
+
+  @return
+    False if the derived measure has no value for any year
+
+  @example
+    std::vector<unsigned int> years;
+    std::vector<double> values;
+    if (railpp.evaluate(areas.getArea("W06000011"), years, values)) {
+      ...
+    }
+*/
+bool DerivedMeasure::evaluate(const Area &area, std::vector<unsigned int> &years, std::vector<double> &values) const {
+	years.clear();
+	values.clear();
+
+	const AreaMeasures &measures = area.getMeasures();
+	std::vector<const MeasureValues *> columns;
+	for (const auto &input : inputs) {
+		auto it = measures.find(input);
+		if (it == measures.end()) {
+			return false;
+		}
+		columns.push_back(&it->second.getValues());
+	}
+
+	//the years axis: the years every measure has a value for.
+	for (const auto &value : *columns[0]) {
+		years.push_back(value.first);
+	}
+	for (size_t i = 1; i < columns.size() && !years.empty(); i++) {
+		std::vector<unsigned int> common;
+		auto it = columns[i]->begin();
+		for (unsigned int year : years) {
+			while (it != columns[i]->end() && it->first < year) {
+				it++;
+			}
+			if (it != columns[i]->end() && it->first == year) {
+				common.push_back(year);
+			}
+		}
+		years.swap(common);
+	}
+
+	const size_t n = years.size();
+	if (n == 0) {
+		return false;
+	}
+
+	//line each measure's values up with the years axis.
+	std::vector<std::vector<double>> data(columns.size());
+	for (size_t i = 0; i < columns.size(); i++) {
+		data[i].reserve(n);
+		auto it = columns[i]->begin();
+		for (unsigned int year : years) {
+			while (it->first < year) {
+				it++;
+			}
+			data[i].push_back(it->second);
+		}
+	}
+
+	//run the program with a stack of arrays, each operation looping over every year.
+	std::vector<std::vector<double>> stack;
+	stack.reserve(program.size());
+	for (const auto &op : program) {
+		if (op.code == Constant) {
+			stack.emplace_back(n, op.constant);
+			continue;
+		}
+		if (op.code == Input) {
+			stack.push_back(data[op.input]);
+			continue;
+		}
+		if (op.code == Negate) {
+			double *a = stack.back().data();
+			for (size_t i = 0; i < n; i++) {
+				a[i] = -a[i];
+			}
+			continue;
+		}
+
+		std::vector<double> rhs = std::move(stack.back());
+		stack.pop_back();
+		double *a = stack.back().data();
+		const double *b = rhs.data();
+		switch (op.code) {
+			case Add:
+				for (size_t i = 0; i < n; i++) a[i] += b[i];
+				break;
+			case Subtract:
+				for (size_t i = 0; i < n; i++) a[i] -= b[i];
+				break;
+			case Multiply:
+				for (size_t i = 0; i < n; i++) a[i] *= b[i];
+				break;
+			case Divide:
+				for (size_t i = 0; i < n; i++) a[i] /= b[i];
+				break;
+			default:
+				break;
+		}
+	}
+
+	values = std::move(stack.back());
+
+	//drop the years that could not be calculated.
+	size_t kept = 0;
+	for (size_t i = 0; i < n; i++) {
+		if (std::isfinite(values[i])) {
+			years[kept] = years[i];
+			values[kept] = values[i];
+			kept++;
+		}
+	}
+	years.resize(kept);
+	values.resize(kept);
+
+	return kept > 0;
+}
+
+/**
+  Constructor for an empty set of derived measures.
+*/
+DerivedMeasures::DerivedMeasures() : evaluations(0) {}
+
+/**
+  Define a derived measure.
+
+  @param definition
+    The definition, as <code>=<expression>
+
+  @throws
+    std::invalid_argument if the definition is not valid, the code is already
+    defined, or an earlier derived measure uses the code as a measure
+
+  @example
+    DerivedMeasures derived;
+    derived.add("railpp=rail / pop");
+*/
+void DerivedMeasures::add(const std::string &definition) {
+	size_t equals = definition.find('=');
+	if (equals == std::string::npos) {
+		throw std::invalid_argument("Invalid derived measure " + definition + ": expected <code>=<expression>");
+	}
+
+	std::string code = definition.substr(0, equals);
+	code.erase(0, code.find_first_not_of(" \t"));
+	code.erase(code.find_last_not_of(" \t") + 1);
+	if (code.empty()) {
+		throw std::invalid_argument("Invalid derived measure " + definition + ": expected <code>=<expression>");
+	}
+
+	DerivedMeasure measure(code, definition.substr(equals + 1));
+
+	//measures can only use derived measures defined before them.
+	for (const auto &other : measures) {
+		if (other.getCodename() == measure.getCodename()) {
+			throw std::invalid_argument("Derived measure " + measure.getCodename() + " is defined twice");
+		}
+		const auto &inputs = other.getInputs();
+		if (std::find(inputs.begin(), inputs.end(), measure.getCodename()) != inputs.end()) {
+			throw std::invalid_argument("Derived measure " + measure.getCodename()
+										+ " must be defined before " + other.getCodename() + ", which uses it");
+		}
+	}
+
+	measures.push_back(std::move(measure));
+	cache.clear();
+}
+
+/**
+  @return
+    The number of derived measures defined
+*/
+size_t DerivedMeasures::size() const noexcept {
+	return measures.size();
+}
+
+/**
+  Decide which derived measures to evaluate for a measures filter: those in
+  the filter, and the derived measures they use.
+
+  @param filter
+    The measures filter, or an empty set for all measures
+
+  @return
+    Whether each derived measure is to be evaluated
+*/
+std::vector<bool> DerivedMeasures::selected(const std::unordered_set<std::string> &filter) const {
+	std::vector<bool> wanted(measures.size(), filter.empty());
+	if (filter.empty()) {
+		return wanted;
+	}
+
+	//a measure can only use the ones before it, so walking backwards finds them all.
+	for (size_t i = measures.size(); i-- > 0;) {
+		wanted[i] = wanted[i] || filter.count(measures[i].getCodename()) > 0;
+		if (!wanted[i]) {
+			continue;
+		}
+		for (const auto &input : measures[i].getInputs()) {
+			for (size_t j = 0; j < i; j++) {
+				if (measures[j].getCodename() == input) {
+					wanted[j] = true;
+				}
+			}
+		}
+	}
+
+	return wanted;
+}
+
+/**
+  Find the measures that need to be imported to evaluate the derived
+  measures in a measures filter.
+
+  @param filter
+    The measures filter, or an empty set for all measures
+
+  @return
+    The codes of the imported measures the derived measures in the filter
+    use, or an empty set if the filter is empty (since everything will be
+    imported anyway)
+
+  @example
+    auto measuresFilter = BethYw::parseMeasuresArg(args);
+    for (const auto &code : derived.dependencies(measuresFilter)) {
+      measuresFilter.insert(code);
+    }
+*/
+std::unordered_set<std::string> DerivedMeasures::dependencies(const std::unordered_set<std::string> &filter) const {
+	std::unordered_set<std::string> needed;
+	if (filter.empty()) {
+		return needed;
+	}
+
+	std::unordered_set<std::string> derived;
+	for (const auto &measure : measures) {
+		derived.insert(measure.getCodename());
+	}
+
+	auto wanted = selected(filter);
+	for (size_t i = 0; i < measures.size(); i++) {
+		if (!wanted[i]) {
+			continue;
+		}
+		for (const auto &input : measures[i].getInputs()) {
+			if (derived.count(input) == 0) {
+				needed.insert(input);
+			}
+		}
+	}
+
+	return needed;
+}
+
+/**
+  Add the derived measures in a measures filter to every Area in an Areas
+  instance they can be evaluated for, replacing any measure with the same
+  code. Values cached from an earlier call are used unless invalidate() has
+  been called for the area since.
+
+  @param areas
+    The Areas instance to add the derived measures to
+
+  @param filter
+    The measures filter, or an empty set for all derived measures
+
+  @param areaCodes
+    The local authority codes of the Areas to add the derived measures to,
+    or nullptr for every Area (e.g. only those whose data has changed)
+
+  @example
+    derived.apply(data, measuresFilter);
+    std::cout << data;
+*/
+void DerivedMeasures::apply(Areas &areas, const std::unordered_set<std::string> &filter,
+							const std::set<std::string> *areaCodes) {
+	if (measures.empty()) {
+		return;
+	}
+
+	auto wanted = selected(filter);
+
+	for (const auto &entry : areas) {
+		if (areaCodes != nullptr && areaCodes->count(entry.first) == 0) {
+			continue;
+		}
+
+		const Area &area = entry.second;
+		auto &cached = cache[entry.first];
+		if (cached.empty()) {
+			cached.resize(measures.size(), CachedValues {false, false, {}, {}});
+		}
+
+		//in order, so that a derived measure sees the ones it uses.
+		for (size_t i = 0; i < measures.size(); i++) {
+			if (!wanted[i]) {
+				continue;
+			}
+
+			CachedValues &values = cached[i];
+			if (!values.computed) {
+				values.present = measures[i].evaluate(area, values.years, values.values);
+				values.computed = true;
+				evaluations++;
+			}
+
+			//setMeasure merges values, so the old measure is replaced instead.
+			const std::string code = measures[i].getCodename();
+			if (values.present) {
+				Measure measure(code, measures[i].getLabel());
+				for (size_t j = 0; j < values.years.size(); j++) {
+					measure.setValue(values.years[j], values.values[j]);
+				}
+				areas.replaceMeasure(entry.first, code, &measure);
+			} else {
+				areas.replaceMeasure(entry.first, code, nullptr);
+			}
+		}
+	}
+}
+
+/**
+  Forget all the cached values of the derived measures.
+*/
+void DerivedMeasures::invalidate() noexcept {
+	cache.clear();
+}
+
+/**
+  Forget the cached values of the derived measures for one area, after its
+  data has changed.
+
+  @param auth_code
+    The local authority code of the Area
+*/
+void DerivedMeasures::invalidate(const std::string &auth_code) noexcept {
+	cache.erase(auth_code);
+}
+
+/**
+  @return
+    The number of times a derived measure has been evaluated for an Area
+*/
+size_t DerivedMeasures::evaluationCount() const noexcept {
+	return evaluations;
+}
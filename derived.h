@@ -0,0 +1,105 @@
+#ifndef DERIVED_H_
+#define DERIVED_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains declarations for derived measures: measures that are not
+  imported from a dataset, but calculated from the other measures of an area
+  with an arithmetic expression, e.g. rail journeys per person:
+
+    railpp=rail / pop
+
+  An expression uses + - * /, brackets, numbers, and the codes of measures.
+  Codes are letters, digits and underscores starting with a letter or an
+  underscore; any other code (such as pm2-5) is written in braces: {pm2-5}.
+  An expression can use derived measures defined before it.
+
+  Nothing is calculated when a derived measure is defined. Derived measures
+  are evaluated once the data has been imported, for the areas and years that
+  were imported, and only if they are going to be printed. Each one is
+  evaluated for a whole area at once: the years every measure it uses has a
+  value for are lined up in arrays, and each operation in the expression runs
+  over the whole array. The result is added to the area as an ordinary
+  Measure, and cached, so it only needs evaluating again when the data of the
+  area changes.
+ */
+
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "areas.h"
+
+/*
+  A derived measure: its code and label, and its expression compiled into a
+  postfix program.
+*/
+class DerivedMeasure {
+ public:
+	enum OpCode {Constant, Input, Add, Subtract, Multiply, Divide, Negate};
+
+	struct Op {
+		OpCode code;
+
+		//the value of a Constant, or the index into inputs of an Input.
+		double constant;
+		size_t input;
+	};
+
+ private:
+	std::string code;
+	std::string label;
+	std::vector<std::string> inputs;
+	std::vector<Op> program;
+
+ public:
+	DerivedMeasure(const std::string &code, const std::string &expression);
+	std::string getCodename() const noexcept;
+	std::string getLabel() const noexcept;
+	const std::vector<std::string>& getInputs() const noexcept;
+	bool evaluate(const Area &area, std::vector<unsigned int> &years, std::vector<double> &values) const;
+
+	friend class ExpressionParser;
+};
+
+/*
+  The derived measures defined for a run, in the order they were defined, and
+  a cache of their values for each area.
+*/
+class DerivedMeasures {
+ private:
+	struct CachedValues {
+		bool computed;
+		bool present;
+		std::vector<unsigned int> years;
+		std::vector<double> values;
+	};
+
+	std::vector<DerivedMeasure> measures;
+
+	//by area code, the values of each measure, in the order of measures.
+	std::unordered_map<std::string, std::vector<CachedValues>> cache;
+	size_t evaluations;
+
+	std::vector<bool> selected(const std::unordered_set<std::string> &filter) const;
+
+ public:
+	DerivedMeasures();
+	void add(const std::string &definition);
+	size_t size() const noexcept;
+	std::unordered_set<std::string> dependencies(const std::unordered_set<std::string> &filter) const;
+	void apply(Areas &areas, const std::unordered_set<std::string> &filter,
+			   const std::set<std::string> *areaCodes = nullptr);
+	void invalidate() noexcept;
+	void invalidate(const std::string &auth_code) noexcept;
+	size_t evaluationCount() const noexcept;
+};
+
+#endif // DERIVED_H_
@@ -0,0 +1,429 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the implementation of the Hierarchy class. See the
+  header file for additional comments.
+ */
+
+#include <limits>
+#include <stdexcept>
+
+#include "hierarchy.h"
+
+/**
+  @return
+    The mean of the values, or NaN if there are none
+*/
+double RollUp::mean() const noexcept {
+	return count > 0 ? sum / count : std::numeric_limits<double>::quiet_NaN();
+}
+
+/**
+  @return
+    The mean of the values weighted by their areas' weights, or NaN if no
+    area with a value has a weight
+*/
+double RollUp::weightedMean() const noexcept {
+	return weight != 0.0 ? weighted / weight : std::numeric_limits<double>::quiet_NaN();
+}
+
+/**
+  @param statistic
+    The statistic
+
+  @return
+    The statistic of the values, or NaN if it has none
+*/
+double RollUp::get(RollUpStatistic statistic) const noexcept {
+	switch (statistic) {
+		case RollUpSum:
+			return sum;
+		case RollUpMean:
+			return mean();
+		case RollUpWeightedMean:
+			return weightedMean();
+		case RollUpNone:
+		default:
+			return std::numeric_limits<double>::quiet_NaN();
+	}
+}
+
+/**
+  @param query
+    The roll-up
+
+  @return
+    A description of the roll-up's statistic, which is added to the labels of
+    the Measures output for it, e.g. "mean weighted by pop"
+*/
+std::string rollUpStatisticName(const RollUpQuery &query) {
+	switch (query.statistic) {
+		case RollUpSum:
+			return "sum";
+		case RollUpMean:
+			return "mean";
+		case RollUpWeightedMean:
+			return "mean weighted by " + query.weight;
+		case RollUpNone:
+		default:
+			return "none";
+	}
+}
+
+/**
+  @return
+    true if no area has a parent
+*/
+bool Hierarchy::empty() const noexcept {
+	return parents.empty();
+}
+
+/**
+  Set the measure the weighted means are weighted by, e.g. "pop" for a mean
+  per person. This must be done before any values are added.
+
+  @param measure
+    The code of the measure, or an empty string for no weighted means
+
+  @throws
+    std::logic_error if any area already has a parent
+*/
+void Hierarchy::setWeightMeasure(const std::string &measure) {
+	if (!parents.empty()) {
+		throw std::logic_error("Hierarchy::setWeightMeasure: the weight must be set before the hierarchy is built");
+	}
+	weight_measure = measure;
+}
+
+/**
+  @return
+    The code of the measure the weighted means are weighted by
+*/
+std::string Hierarchy::getWeightMeasure() const noexcept {
+	return weight_measure;
+}
+
+/**
+  @param code
+    The local authority code of an area
+
+  @return
+    The codes of the area's parent, its parent's parent, and so on
+*/
+std::vector<std::string> Hierarchy::chain(const std::string &code) const {
+	std::vector<std::string> ancestors;
+	for (auto it = parents.find(code); it != parents.end(); it = parents.find(it->second)) {
+		ancestors.push_back(it->second);
+	}
+	return ancestors;
+}
+
+/**
+  Add to the roll-ups of a measure for a year in each of a list of areas.
+  Roll-ups that no longer have any values are removed.
+*/
+void Hierarchy::addValue(const std::vector<std::string> &ancestors, const std::string &measure, unsigned int year,
+						 double value, double count, double weighted, double weight) {
+	for (const auto &code : ancestors) {
+		auto &measures = rollups[code];
+		auto &years = measures[measure];
+		RollUp &rollup = years[year];
+
+		rollup.sum += value;
+		rollup.count += (long) count;
+		rollup.weighted += weighted;
+		rollup.weight += weight;
+
+		if (rollup.count <= 0) {
+			years.erase(year);
+			if (years.empty()) {
+				measures.erase(measure);
+				if (measures.empty()) {
+					rollups.erase(code);
+				}
+			}
+		}
+	}
+}
+
+/**
+  Add (sign 1) or remove (sign -1) everything an area contributes to the
+  roll-ups of its ancestors: its values if it is a leaf (and loaded), or
+  otherwise its own roll-ups.
+*/
+void Hierarchy::contribute(const std::string &code, const Area *area, double sign) {
+	const auto ancestors = chain(code);
+	if (ancestors.empty()) {
+		return;
+	}
+
+	if (!isLeaf(code)) {
+		auto it = rollups.find(code);
+		if (it == rollups.end()) {
+			return;
+		}
+		//copied, since the ancestors' roll-ups are changed as we go.
+		const auto own = it->second;
+		for (const auto &measure : own) {
+			for (const auto &year : measure.second) {
+				const RollUp &r = year.second;
+				addValue(ancestors, measure.first, year.first,
+						 sign * r.sum, sign * r.count, sign * r.weighted, sign * r.weight);
+			}
+		}
+		return;
+	}
+	if (area == nullptr) {
+		return;
+	}
+
+	const MeasureValues *weights = nullptr;
+	auto weight = area->getMeasures().find(weight_measure);
+	if (!weight_measure.empty() && weight != area->getMeasures().end()) {
+		weights = &weight->second.getValues();
+	}
+
+	for (const auto &measure : area->getMeasures()) {
+		for (const auto &value : measure.second.getValues()) {
+			double w = 0.0;
+			bool weighted = false;
+			if (weights != nullptr) {
+				auto it = weights->find(value.first);
+				if (it != weights->end()) {
+					w = it->second;
+					weighted = true;
+				}
+			}
+			addValue(ancestors, measure.first, value.first,
+					 sign * value.second, sign, weighted ? sign * value.second * w : 0.0, weighted ? sign * w : 0.0);
+		}
+	}
+}
+
+/**
+  Record the parent of an area, moving everything the area contributes from
+  the roll-ups of its old ancestors (if any) to those of its new ones. If the
+  parent had no children before, its own values stop counting towards its
+  ancestors' roll-ups; if the old parent has no children left, its own
+  values start counting again.
+
+  @param child
+    The local authority code of the area
+
+  @param parent
+    The local authority code of its parent
+
+  @param lookup
+    Finds the loaded Area with a code, if there is one
+
+  @return
+    false if the parent is empty or the link would make a loop, in which case
+    nothing is changed
+
+  @example
+    areas.getHierarchy().setParent("W06000011", "W92000004", lookup);
+*/
+bool Hierarchy::setParent(const std::string &child, const std::string &parent, const AreaLookup &lookup) {
+	auto current = parents.find(child);
+	if (current != parents.end() && current->second == parent) {
+		return true;
+	}
+	if (parent.empty() || parent == child) {
+		return false;
+	}
+	for (auto it = parents.find(parent); it != parents.end(); it = parents.find(it->second)) {
+		if (it->second == child) {
+			return false;
+		}
+	}
+	const std::string old_parent = current != parents.end() ? current->second : "";
+
+	const Area *child_area = lookup(child);
+	const Area *parent_area = lookup(parent);
+	const bool parent_was_leaf = isLeaf(parent);
+
+	//take the child's contribution out, with the links as they were.
+	contribute(child, child_area, -1.0);
+	if (parent_was_leaf) {
+		contribute(parent, parent_area, -1.0);
+	}
+
+	if (!old_parent.empty()) {
+		children[old_parent].erase(child);
+		if (children[old_parent].empty()) {
+			children.erase(old_parent);
+		}
+	}
+	parents[child] = parent;
+	children[parent].insert(child);
+
+	//and put it back in with the new links.
+	if (!old_parent.empty() && isLeaf(old_parent)) {
+		contribute(old_parent, lookup(old_parent), 1.0);
+	}
+	contribute(child, child_area, 1.0);
+
+	return true;
+}
+
+/**
+  @param code
+    The local authority code of an area
+
+  @return
+    The code of the area's parent, or an empty string if it has none
+*/
+std::string Hierarchy::getParent(const std::string &code) const {
+	auto it = parents.find(code);
+	return it != parents.end() ? it->second : "";
+}
+
+/**
+  @return
+    The parent of every area that has one, keyed by the area's code
+*/
+const std::map<std::string, std::string>& Hierarchy::getParents() const noexcept {
+	return parents;
+}
+
+/**
+  @param code
+    The local authority code of an area
+
+  @return
+    true if no area has this area as its parent
+*/
+bool Hierarchy::isLeaf(const std::string &code) const {
+	return children.find(code) == children.end();
+}
+
+/**
+  @return
+    The codes of the areas that have roll-ups, in order
+*/
+std::vector<std::string> Hierarchy::getRollUpCodes() const {
+	std::vector<std::string> codes;
+	for (const auto &it : rollups) {
+		codes.push_back(it.first);
+	}
+	return codes;
+}
+
+/**
+  @param code
+    The local authority code of an area
+
+  @return
+    The roll-ups of the area keyed by measure code, or nullptr if it has none
+*/
+const std::map<std::string, RollUpValues>* Hierarchy::getRollUps(const std::string &code) const {
+	auto it = rollups.find(code);
+	return it != rollups.end() ? &it->second : nullptr;
+}
+
+/**
+  Add the values of an area that has just been added to the roll-ups of its
+  ancestors.
+
+  @param area
+    The Area
+*/
+void Hierarchy::areaAdded(const Area &area) {
+	const std::string code = area.getLocalAuthorityCode();
+	if (!parents.empty() && isLeaf(code)) {
+		contribute(code, &area, 1.0);
+	}
+}
+
+/**
+  Remove the values of an area that is about to be removed from the roll-ups
+  of its ancestors.
+
+  @param area
+    The Area
+*/
+void Hierarchy::areaRemoved(const Area &area) {
+	const std::string code = area.getLocalAuthorityCode();
+	if (!parents.empty() && isLeaf(code)) {
+		contribute(code, &area, -1.0);
+	}
+}
+
+/**
+  Apply a change to one value of an area to the roll-ups of its ancestors.
+  This is called after the value has changed.
+
+  @param area
+    The Area, with the new value
+
+  @param measure
+    The code of the Measure whose value changed
+
+  @param year
+    The year of the value
+
+  @param hadOld, oldValue
+    Whether there was a value before, and what it was
+
+  @param hasNew, newValue
+    Whether there is a value now, and what it is
+
+  @example
+    areas.getHierarchy().valueChanged(area, "pop", 2019, true, 100.0, true, 110.0);
+*/
+void Hierarchy::valueChanged(const Area &area,
+							 const std::string &measure,
+							 unsigned int year,
+							 bool hadOld,
+							 double oldValue,
+							 bool hasNew,
+							 double newValue) {
+	if (parents.empty()) {
+		return;
+	}
+	const std::string code = area.getLocalAuthorityCode();
+	if (!isLeaf(code)) {
+		return;
+	}
+	const auto ancestors = chain(code);
+	if (ancestors.empty()) {
+		return;
+	}
+
+	const double before = hadOld ? oldValue : 0.0;
+	const double after = hasNew ? newValue : 0.0;
+	const double count = (hasNew ? 1.0 : 0.0) - (hadOld ? 1.0 : 0.0);
+	const auto &measures = area.getMeasures();
+
+	if (weight_measure.empty() || measure != weight_measure) {
+		double w = 0.0;
+		bool weighted = false;
+		auto weights = measures.find(weight_measure);
+		if (!weight_measure.empty() && weights != measures.end()) {
+			auto it = weights->second.getValues().find(year);
+			if (it != weights->second.getValues().end()) {
+				w = it->second;
+				weighted = true;
+			}
+		}
+		addValue(ancestors, measure, year, after - before, count,
+				 weighted ? w * (after - before) : 0.0, weighted ? w * count : 0.0);
+		return;
+	}
+
+	//the weight itself changed, which changes the weighted sums of every other measure in the year.
+	for (const auto &other : measures) {
+		if (other.first == weight_measure) {
+			continue;
+		}
+		auto it = other.second.getValues().find(year);
+		if (it != other.second.getValues().end()) {
+			addValue(ancestors, other.first, year, 0.0, 0.0, it->second * (after - before), after - before);
+		}
+	}
+	addValue(ancestors, measure, year, after - before, count, after * after - before * before, after - before);
+}
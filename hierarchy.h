@@ -0,0 +1,118 @@
+#ifndef HIERARCHY_H_
+#define HIERARCHY_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the declaration of the Hierarchy class, which records
+  the parent of each area (e.g. Wales, W92000004, for the local authorities
+  in popu1009.json, or a region for those in econ0080.json), and keeps
+  roll-ups of the measures of the areas beneath each parent: their sum,
+  count, and mean weighted by another measure.
+
+  Only leaf areas (those with no children of their own) count towards a
+  roll-up, so a region's own figures are not counted on top of its local
+  authorities'. The roll-ups are kept up to date as values are imported,
+  merged and removed: each change to a leaf area's value is applied to the
+  roll-ups of its ancestors, so reading a roll-up never needs to look at the
+  areas beneath it.
+ */
+
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "area.h"
+
+/*
+  The statistics a roll-up can give.
+*/
+enum RollUpStatistic {
+	RollUpNone,
+	RollUpSum,
+	RollUpMean,
+	RollUpWeightedMean
+};
+
+/*
+  A roll-up to output, as given to --rollup: the statistic, and the measure
+  a weighted mean is weighted by.
+*/
+struct RollUpQuery {
+	RollUpStatistic statistic = RollUpNone;
+	std::string weight;
+};
+
+std::string rollUpStatisticName(const RollUpQuery &query);
+
+/*
+  The roll-up of a measure for one year over the leaf areas beneath a parent.
+*/
+struct RollUp {
+	double sum = 0.0;
+	long count = 0;
+
+	//the sum of each value multiplied by its area's weight, and of the weights.
+	double weighted = 0.0;
+	double weight = 0.0;
+
+	double mean() const noexcept;
+	double weightedMean() const noexcept;
+	double get(RollUpStatistic statistic) const noexcept;
+};
+
+/*
+  The roll-ups of a measure, keyed by year.
+*/
+using RollUpValues = std::map<unsigned int, RollUp>;
+
+/*
+  Finds an Area by its local authority code, returning nullptr if there is
+  none.
+*/
+using AreaLookup = std::function<const Area *(const std::string &)>;
+
+class Hierarchy {
+ private:
+	std::map<std::string, std::string> parents;
+	std::map<std::string, std::set<std::string>> children;
+	std::string weight_measure;
+
+	//parent code -> measure code -> roll-ups by year
+	std::map<std::string, std::map<std::string, RollUpValues>> rollups;
+
+	std::vector<std::string> chain(const std::string &code) const;
+	void contribute(const std::string &code, const Area *area, double sign);
+	void addValue(const std::vector<std::string> &ancestors, const std::string &measure, unsigned int year,
+				  double value, double count, double weighted, double weight);
+
+ public:
+	Hierarchy() = default;
+	bool empty() const noexcept;
+	void setWeightMeasure(const std::string &measure);
+	std::string getWeightMeasure() const noexcept;
+	bool setParent(const std::string &child, const std::string &parent, const AreaLookup &lookup);
+	std::string getParent(const std::string &code) const;
+	const std::map<std::string, std::string>& getParents() const noexcept;
+	bool isLeaf(const std::string &code) const;
+	std::vector<std::string> getRollUpCodes() const;
+	const std::map<std::string, RollUpValues>* getRollUps(const std::string &code) const;
+
+	void areaAdded(const Area &area);
+	void areaRemoved(const Area &area);
+	void valueChanged(const Area &area,
+					  const std::string &measure,
+					  unsigned int year,
+					  bool hadOld,
+					  double oldValue,
+					  bool hasNew,
+					  double newValue);
+};
+
+#endif // HIERARCHY_H_
@@ -0,0 +1,549 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains a minimal HTTP/1.1 client, which is all we need to
+  download datasets from an OData API: plain GET requests over http://, one
+  request per connection. See the header file for additional comments.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#ifndef _WIN32
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#include "http.h"
+
+/**
+  Split a http:// URL into its host, port and path.
+
+  @param url
+    The URL, e.g. http://localhost:8080/dataset/popu1009?$skip=0
+
+  @return
+    The host, port (80 if not given) and path (/ if not given) of the URL
+
+  @throws
+    std::invalid_argument if the URL is not a http:// URL with a host
+
+  @example
+    URL parts = parseURL("http://localhost:8080/areas.csv");
+    // parts.host == "localhost", parts.port == "8080", parts.path == "/areas.csv"
+*/
+URL parseURL(const std::string &url) {
+	const std::string scheme = "http://";
+
+	if (!isHTTPURL(url)) {
+		throw std::invalid_argument("Not a http:// URL: " + url);
+	}
+
+	URL parts;
+	size_t host_start = scheme.size();
+	size_t path_start = url.find('/', host_start);
+	std::string authority = url.substr(host_start, path_start - host_start);
+
+	size_t colon = authority.rfind(':');
+	if (colon == std::string::npos) {
+		parts.host = authority;
+		parts.port = "80";
+	} else {
+		parts.host = authority.substr(0, colon);
+		parts.port = authority.substr(colon + 1);
+	}
+	parts.path = (path_start == std::string::npos) ? "/" : url.substr(path_start);
+
+	if (parts.host.empty() || parts.port.empty()) {
+		throw std::invalid_argument("Not a http:// URL: " + url);
+	}
+
+	return parts;
+}
+
+/**
+  Check whether a location is a http:// URL rather than a path on disk.
+
+  @param location
+    A file path or URL
+
+  @return
+    true if location starts with http:// (in any case)
+
+  @example
+    isHTTPURL("http://localhost:8080/"); // returns true
+    isHTTPURL("datasets/");              // returns false
+*/
+bool isHTTPURL(const std::string &location) noexcept {
+	const std::string scheme = "http://";
+
+	if (location.size() <= scheme.size()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < scheme.size(); i++) {
+		if (std::tolower(location[i]) != scheme[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+  The most hex digits in the size of a chunk, so the size cannot overflow.
+*/
+static const size_t MAX_CHUNK_SIZE_DIGITS = 15;
+
+/**
+  Decode a body sent with chunked transfer encoding.
+
+  @param body
+    The raw body, made up of <hex size>\r\n<data>\r\n chunks
+
+  @return
+    The decoded body
+
+  @throws
+    std::runtime_error if a chunk's size is not a hex number or the body
+    ends part way through a chunk
+*/
+static std::string decodeChunked(const std::string &body) {
+	std::string decoded;
+	size_t pos = 0;
+
+	while (pos < body.size()) {
+		size_t line_end = body.find("\r\n", pos);
+		if (line_end == std::string::npos) {
+			throw std::runtime_error("httpGet: Malformed chunked response");
+		}
+
+		//the size may be followed by extensions after a ;, which we ignore.
+		size_t chunk_size = 0;
+		size_t digits = 0;
+		for (size_t i = pos; i < line_end && body[i] != ';' && body[i] != ' ' && body[i] != '\t'; i++) {
+			const unsigned char c = (unsigned char) body[i];
+			if (!std::isxdigit(c) || ++digits > MAX_CHUNK_SIZE_DIGITS) {
+				throw std::runtime_error("httpGet: Malformed chunk size in chunked response");
+			}
+			chunk_size = chunk_size * 16 + (std::isdigit(c) ? c - '0' : std::tolower(c) - 'a' + 10);
+		}
+		if (digits == 0) {
+			throw std::runtime_error("httpGet: Malformed chunk size in chunked response");
+		}
+		if (chunk_size == 0) {
+			break;
+		}
+
+		pos = line_end + 2;
+		if (chunk_size > body.size() - pos) {
+			throw std::runtime_error("httpGet: Truncated chunked response");
+		}
+		decoded.append(body, pos, chunk_size);
+		pos += chunk_size + 2;
+	}
+
+	return decoded;
+}
+
+/**
+  Read the status code from the status line of a response, e.g. 200 from
+  "HTTP/1.1 200 OK".
+
+  @param raw
+    The response
+
+  @param header_end
+    The index of the end of the headers in raw
+
+  @return
+    The status code, or -1 if the status line is malformed
+*/
+static int parseStatus(const std::string &raw, size_t header_end) {
+	size_t start = raw.find(' ');
+	if (start == std::string::npos || start + 4 > header_end) {
+		return -1;
+	}
+
+	int status = 0;
+	for (size_t i = start + 1; i < start + 4; i++) {
+		if (!std::isdigit((unsigned char) raw[i])) {
+			return -1;
+		}
+		status = status * 10 + (raw[i] - '0');
+	}
+	if (raw[start + 4] != ' ' && raw[start + 4] != '\r') {
+		return -1;
+	}
+
+	return status;
+}
+
+/**
+  Make a GET request and wait for the whole response.
+
+  @param url
+    The http:// URL to request
+
+  @param timeoutMs
+    How long to wait for the server to accept the connection, take the
+    request, or send the next part of the response, in milliseconds
+
+  @return
+    The status code and (decoded) body of the response
+
+  @throws
+    std::runtime_error if the server cannot be reached, stops responding or
+    the response is malformed, with the message:
+    httpGet: <reason> <url>
+
+  @example
+    HTTPResponse response = httpGet("http://localhost:8080/areas.csv");
+    if (response.status == 200) {
+      std::cout << response.body;
+    }
+*/
+HTTPResponse httpGet(const std::string &url, int timeoutMs) {
+#ifdef _WIN32
+	throw std::runtime_error("httpGet: HTTP input is not supported on this platform " + url);
+#else
+	URL parts = parseURL(url);
+
+	addrinfo hints;
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	addrinfo *addresses = nullptr;
+	if (getaddrinfo(parts.host.c_str(), parts.port.c_str(), &hints, &addresses) != 0) {
+		throw std::runtime_error("httpGet: Failed to resolve host for " + url);
+	}
+
+	//a server that stops responding makes connect, send or recv fail instead of waiting for ever.
+	timeval timeout;
+	timeout.tv_sec = timeoutMs / 1000;
+	timeout.tv_usec = (timeoutMs % 1000) * 1000;
+
+	//try each address for the host until one accepts the connection.
+	int fd = -1;
+	for (addrinfo *it = addresses; it != nullptr; it = it->ai_next) {
+		fd = socket(it->ai_family, it->ai_socktype, it->ai_protocol);
+		if (fd < 0) {
+			continue;
+		}
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+		if (connect(fd, it->ai_addr, it->ai_addrlen) == 0) {
+			break;
+		}
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(addresses);
+
+	if (fd < 0) {
+		throw std::runtime_error("httpGet: Failed to connect to " + url);
+	}
+
+	std::string request = "GET " + parts.path + " HTTP/1.1\r\n"
+						  "Host: " + parts.host + "\r\n"
+						  "Accept: application/json, text/csv, */*\r\n"
+						  "Connection: close\r\n\r\n";
+
+	size_t sent = 0;
+	while (sent < request.size()) {
+		ssize_t n = send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			close(fd);
+			throw std::runtime_error("httpGet: Failed to send request to " + url);
+		}
+		sent += n;
+	}
+
+	//the server closes the connection once the response has been sent. with
+	//a timeout set, a signal makes recv fail with EINTR even under SA_RESTART,
+	//so we carry on reading.
+	std::string raw;
+	std::vector<char> buffer(64 * 1024);
+	ssize_t n;
+	while ((n = recv(fd, buffer.data(), buffer.size(), 0)) > 0 || (n < 0 && errno == EINTR)) {
+		if (n > 0) {
+			raw.append(buffer.data(), n);
+		}
+	}
+	const int error = errno;
+	close(fd);
+
+	if (n < 0 && (error == EAGAIN || error == EWOULDBLOCK)) {
+		throw std::runtime_error("httpGet: Timed out reading response from " + url);
+	}
+	if (n < 0) {
+		throw std::runtime_error("httpGet: Failed to read response from " + url);
+	}
+
+	size_t header_end = raw.find("\r\n\r\n");
+	if (raw.compare(0, 5, "HTTP/") != 0 || header_end == std::string::npos) {
+		throw std::runtime_error("httpGet: Malformed response from " + url);
+	}
+
+	HTTPResponse response;
+	response.status = parseStatus(raw, header_end);
+	if (response.status < 0) {
+		throw std::runtime_error("httpGet: Malformed status line from " + url);
+	}
+
+	std::string headers = raw.substr(0, header_end);
+	std::transform(headers.begin(), headers.end(), headers.begin(), ::tolower);
+	response.body = raw.substr(header_end + 4);
+
+	if (headers.find("transfer-encoding: chunked") != std::string::npos) {
+		response.body = decodeChunked(response.body);
+	}
+
+	return response;
+#endif
+}
+
+/**
+  Constructor for a HTTP source, which will be fetched when it is opened.
+
+  @param url
+    The http:// URL of the source
+
+  @example
+    InputHTTP input("http://localhost:8080/areas.csv");
+*/
+InputHTTP::InputHTTP(const std::string &url) : InputSource(url), status(0), fetched(false) {}
+
+/**
+  Constructor for a HTTP source that has already been fetched.
+
+  @param url
+    The http:// URL the response came from
+
+  @param response
+    The response to the request for url
+
+  @example
+    InputHTTP input(url, httpGet(url));
+*/
+InputHTTP::InputHTTP(const std::string &url, const HTTPResponse &response)
+	: InputSource(url), body_stream(response.body), status(response.status), fetched(true) {}
+
+/**
+  Fetch the URL retrievable from getSource() if it has not been fetched
+  already, and return a reference to a stream of the response body.
+
+  @return
+    A standard input stream reference
+
+  @throws
+    std::runtime_error if the URL cannot be fetched or the response is not
+    successful, with the message:
+    InputHTTP::open: Failed to fetch <url>
+
+  @example
+    InputHTTP input("http://localhost:8080/areas.csv");
+    input.open();
+*/
+std::istream& InputHTTP::open() {
+
+	if (!fetched) {
+		HTTPResponse response;
+		try {
+			response = httpGet(getSource());
+		} catch (std::runtime_error &e) {
+			throw std::runtime_error("InputHTTP::open: Failed to fetch " + getSource());
+		}
+		body_stream.str(response.body);
+		status = response.status;
+		fetched = true;
+	}
+
+	if (status != 200) {
+		throw std::runtime_error("InputHTTP::open: Failed to fetch " + getSource()
+								 + " (HTTP " + std::to_string(status) + ")");
+	}
+
+	return body_stream;
+}
+
+/**
+  Find the value of a query parameter in a URL.
+
+  @param url
+    The URL to search
+
+  @param name
+    The name of the parameter, e.g. "$skip"
+
+  @param start
+    Set to the index of the value in url
+
+  @return
+    The value of the parameter, or an empty string if it is not present
+*/
+static std::string queryValue(const std::string &url, std::string name, size_t &start) {
+	size_t query = url.find('?');
+	if (query == std::string::npos) {
+		return "";
+	}
+
+	//the $ may or may not have been URL encoded.
+	size_t pos = url.find(name + "=", query);
+	if (pos == std::string::npos && name[0] == '$') {
+		name = "%24" + name.substr(1);
+		pos = url.find(name + "=", query);
+	}
+	if (pos == std::string::npos) {
+		return "";
+	}
+
+	start = pos + name.size() + 1;
+	return url.substr(start, url.find('&', start) - start);
+}
+
+/**
+  Constructor for a resolver that fetches pages over HTTP.
+
+  @param connections
+    The maximum number of page requests in flight at once
+
+  @example
+    HTTPPageResolver resolver(8);
+*/
+HTTPPageResolver::HTTPPageResolver(size_t _connections)
+	: connections(_connections > 0 ? _connections : 1) {}
+
+/**
+  Destructor for the resolver, which waits for any requests still in flight.
+*/
+HTTPPageResolver::~HTTPPageResolver() {
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto &it : in_flight) {
+		it.second.wait();
+	}
+}
+
+/**
+  Start a request for a URL on another thread, unless one is already in
+  flight. The mutex must be held by the caller.
+
+  @param url
+    The http:// URL to request
+*/
+void HTTPPageResolver::fetch(const std::string &url) const {
+	if (in_flight.count(url) == 0) {
+		in_flight[url] = std::async(std::launch::async, httpGet, url, HTTP_TIMEOUT_MS).share();
+	}
+}
+
+/**
+  Return an InputSource for the page a nextLink points to, or nullptr if the
+  server does not have that page.
+
+  If the link gives the page by $skip and $top, the requests for the
+  following pages are started too, so that up to `connections` pages are being
+  downloaded while the caller parses this one. Once a page without a
+  nextLink (or one the server does not have) arrives, the requests for the
+  pages after it are dropped, waiting for any that have not finished.
+
+  @param nextLink
+    The odata.nextLink from the previous page
+
+  @return
+    An InputSource for the next page, or nullptr if there is no such page
+
+  @throws
+    std::runtime_error if the server cannot be reached
+
+  @example
+    HTTPPageResolver resolver(4);
+    auto page = resolver.resolve(link);
+*/
+std::unique_ptr<InputSource> HTTPPageResolver::resolve(const std::string &nextLink) const {
+	std::shared_future<HTTPResponse> response;
+
+	//work out the links of the following pages, the digits being few enough not to overflow.
+	std::vector<std::string> following;
+	size_t skip_pos = 0, top_pos = 0;
+	std::string skip = queryValue(nextLink, "$skip", skip_pos);
+	std::string top = queryValue(nextLink, "$top", top_pos);
+	if (!skip.empty() && !top.empty() && skip.size() < 10 && top.size() < 10
+		&& skip.find_first_not_of("0123456789") == std::string::npos
+		&& top.find_first_not_of("0123456789") == std::string::npos) {
+
+		unsigned long first = std::stoul(skip);
+		unsigned long page_size = std::stoul(top);
+		for (size_t i = 1; i < connections && page_size > 0; i++) {
+			std::string ahead = nextLink;
+			ahead.replace(skip_pos, skip.size(), std::to_string(first + i * page_size));
+			following.push_back(ahead);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		fetch(nextLink);
+		for (const auto &ahead : following) {
+			fetch(ahead);
+		}
+
+		response = in_flight[nextLink];
+		in_flight.erase(nextLink);
+	}
+
+	HTTPResponse result = response.get();
+
+	//the last page: every page after it was requested by an earlier call, or this one, so is one of these.
+	if (result.status == 404 || result.body.find("odata.nextLink") == std::string::npos) {
+		std::vector<std::shared_future<HTTPResponse>> dropped;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (const auto &ahead : following) {
+				auto it = in_flight.find(ahead);
+				if (it != in_flight.end()) {
+					dropped.push_back(std::move(it->second));
+					in_flight.erase(it);
+				}
+			}
+		}
+		for (const auto &request : dropped) {
+			request.wait();
+		}
+	}
+
+	if (result.status == 404) {
+		return nullptr;
+	}
+
+	return std::unique_ptr<InputSource>(new InputHTTP(nextLink, result));
+}
+
+/**
+  @return
+    The number of page requests that have been started but not yet returned
+    by resolve()
+*/
+size_t HTTPPageResolver::pending() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return in_flight.size();
+}
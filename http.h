@@ -0,0 +1,93 @@
+#ifndef HTTP_H_
+#define HTTP_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains declarations for reading datasets over HTTP, e.g. from
+  the StatsWales OData API or the local stand-in in odataserver.h.
+
+  InputHTTP is an InputSource for a single URL. HTTPPageResolver follows the
+  odata.nextLink of each page, and when the links are of the form
+  ...?$skip=<n>&$top=<m> it requests the following pages speculatively, so
+  that several requests are in flight while earlier pages are being parsed.
+ */
+
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+#include "input.h"
+
+/*
+  The parts of an http:// URL that we need to make a request.
+*/
+struct URL {
+	std::string host;
+	std::string port;
+	std::string path;
+};
+
+/*
+  The status code and body of a HTTP response.
+*/
+struct HTTPResponse {
+	int status;
+	std::string body;
+};
+
+URL parseURL(const std::string &url);
+
+bool isHTTPURL(const std::string &location) noexcept;
+
+/*
+  How long a request waits for the server to accept the connection, take the
+  request or send the next part of the response before it gives up.
+*/
+const int HTTP_TIMEOUT_MS = 30000;
+
+HTTPResponse httpGet(const std::string &url, int timeoutMs = HTTP_TIMEOUT_MS);
+
+/*
+  Source data that is fetched from a http:// URL. The response is fetched
+  when the source is opened, unless it was given to the constructor because
+  it had already been fetched.
+*/
+class InputHTTP : public InputSource {
+ private:
+	std::istringstream body_stream;
+	int status;
+	bool fetched;
+ public:
+	explicit InputHTTP(const std::string &url);
+	InputHTTP(const std::string &url, const HTTPResponse &response);
+	std::istream& open() override;
+};
+
+/*
+  Resolves pages by requesting their nextLink, keeping up to `connections`
+  requests in flight by fetching the pages after the requested one ahead of
+  time.
+*/
+class HTTPPageResolver : public PageResolver {
+ private:
+	const size_t connections;
+	mutable std::mutex mutex;
+	mutable std::map<std::string, std::shared_future<HTTPResponse>> in_flight;
+
+	void fetch(const std::string &url) const;
+ public:
+	explicit HTTPPageResolver(size_t connections = 4);
+	~HTTPPageResolver();
+	std::unique_ptr<InputSource> resolve(const std::string &nextLink) const override;
+	size_t pending() const;
+};
+
+#endif // HTTP_H_
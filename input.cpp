@@ -10,7 +10,11 @@
   by the functions in data.cpp. See the header file for additional comments.
  */
 
+#include <cctype>
+#include <stdexcept>
+
 #include "input.h"
+#include "compression.h"
 
 /**
   Constructor for an InputSource.
@@ -67,3 +71,103 @@ std::istream& InputFile::open() {
 
 	return (std::istream&) file_stream;
 }
+
+/**
+  Constructor for a resolver of pages stored as files in a directory.
+
+  @param dir
+    The directory containing the pages, including the trailing separator
+
+  @example
+    LocalPageResolver resolver("datasets/");
+*/
+LocalPageResolver::LocalPageResolver(const std::string &_dir) : dir(_dir) {}
+
+/**
+  Work out the path of the file holding the page a nextLink points to.
+
+  Links take the form .../dataset/<name>?$skiptoken=<a>|<b>|<n>|<id> (URL
+  encoded, as in the StatsWales exports), or .../dataset/<name>?$skip=<n>,
+  where <n> is the index of the first row on the page.
+
+  @param nextLink
+    The odata.nextLink from the previous page
+
+  @return
+    The path of the page file, or an empty string if the link is not understood
+
+  @example
+    LocalPageResolver resolver("datasets/");
+    resolver.pagePath("http://example/dataset/econ0080?$skip=1000");
+    // returns "datasets/econ0080-1000.json"
+*/
+std::string LocalPageResolver::pagePath(const std::string &nextLink) const {
+
+	//decode the link, we only need to worry about the characters StatsWales encodes.
+	std::string link;
+	for (size_t i = 0; i < nextLink.size(); i++) {
+		if (nextLink[i] == '%' && i + 2 < nextLink.size()
+			&& std::isxdigit((unsigned char) nextLink[i + 1]) && std::isxdigit((unsigned char) nextLink[i + 2])) {
+			link += (char) std::stoi(nextLink.substr(i + 1, 2), nullptr, 16);
+			i += 2;
+		} else {
+			link += nextLink[i];
+		}
+	}
+
+	size_t query = link.find('?');
+	size_t name_start = link.rfind('/', query);
+	if (query == std::string::npos || name_start == std::string::npos) {
+		return "";
+	}
+	std::string name = link.substr(name_start + 1, query - name_start - 1);
+
+	//the skip token is a list of '|' separated values, the row index is the second to last one.
+	std::string skip;
+	size_t pos;
+	if ((pos = link.find("$skiptoken=", query)) != std::string::npos) {
+		std::string token = link.substr(pos + 11, link.find('&', pos) - pos - 11);
+		size_t last = token.rfind('|');
+		if (last == std::string::npos || last == 0) {
+			return "";
+		}
+		size_t prev = token.rfind('|', last - 1);
+		skip = token.substr(prev == std::string::npos ? 0 : prev + 1, last - prev - 1);
+	} else if ((pos = link.find("$skip=", query)) != std::string::npos) {
+		skip = link.substr(pos + 6, link.find('&', pos) - pos - 6);
+	}
+
+	if (name.empty() || skip.empty() || skip.find_first_not_of("0123456789") != std::string::npos) {
+		return "";
+	}
+
+	return dir + name + "-" + skip + ".json";
+}
+
+/**
+  Return an InputSource for the page a nextLink points to, if it exists in the
+  directory, either as it is or gzipped (see openInputFile()).
+
+  @param nextLink
+    The odata.nextLink from the previous page
+
+  @return
+    An InputSource for the next page, or nullptr if there is no such page file
+
+  @example
+    LocalPageResolver resolver("datasets/");
+    auto page = resolver.resolve(link);
+    if (page) {
+      std::istream &is = page->open();
+    }
+*/
+std::unique_ptr<InputSource> LocalPageResolver::resolve(const std::string &nextLink) const {
+	std::string path = pagePath(nextLink);
+
+	if (path.empty()
+		|| (!std::ifstream(path).is_open() && !std::ifstream(path + ".gz").is_open())) {
+		return nullptr;
+	}
+
+	return openInputFile(path);
+}
@@ -16,8 +16,14 @@
   Although only one class derives from InputSource, we have implemented our
   code this way to support future expansion of input from different sources
   (e.g. the web).
+
+  StatsWales datasets are split into pages, each of which ends with an
+  odata.nextLink pointing at the next page. A PageResolver turns one of those
+  links into an InputSource for the next page, so that a whole dataset can be
+  read as one. LocalPageResolver finds the pages as sibling files on disk.
  */
 
+#include <memory>
 #include <string>
 #include <fstream>
 
@@ -32,7 +38,9 @@ protected:
 	const std::string source;
   	explicit InputSource(const std::string& source);
  public:
+	virtual ~InputSource() = default;
 	const std::string getSource();
+	virtual std::istream& open() = 0;
 };
 
 /*
@@ -44,7 +52,32 @@ class InputFile : public InputSource {
 	std::ifstream file_stream;
  public:
 	explicit InputFile(const std::string& filePath);
-  	std::istream& open();
+  	std::istream& open() override;
+};
+
+/*
+  A PageResolver takes the odata.nextLink of a page and returns an InputSource
+  for the page it points to, or nullptr if that page is not available (which
+  ends the dataset).
+*/
+class PageResolver {
+ public:
+	virtual ~PageResolver() = default;
+	virtual std::unique_ptr<InputSource> resolve(const std::string &nextLink) const = 0;
+};
+
+/*
+  Resolves pages to files in a local directory. A link to the page of dataset
+  <name> starting at row <n> is resolved to the file <dir><name>-<n>.json, e.g.
+  the nextLink at the end of econ0080.json resolves to econ0080-1000.json.
+*/
+class LocalPageResolver : public PageResolver {
+ private:
+	const std::string dir;
+ public:
+	explicit LocalPageResolver(const std::string &dir);
+	std::string pagePath(const std::string &nextLink) const;
+	std::unique_ptr<InputSource> resolve(const std::string &nextLink) const override;
 };
 
 #endif // INPUT_H_
\ No newline at end of file
@@ -17,8 +17,10 @@
 #include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <iterator>
 
 #include "measure.h"
+#include "memory.h"
 
 using json = nlohmann::json;
 
@@ -214,6 +216,52 @@ int Measure::size() const noexcept{
 	return values.size();
 }
 
+/**
+  Retrieve every reading in this Measure, keyed and ordered by year.
+
+  @return
+    A read-only reference to the map of years to values
+
+  @example
+    Measure measure("pop", "Population");
+    measure.setValue(1999, 12345678.9);
+    for (const auto &it : measure.getValues()) {
+      std::cout << it.first << ": " << it.second << std::endl;
+    }
+*/
+const MeasureValues& Measure::getValues() const noexcept {
+	return values;
+}
+
+/**
+  Retrieve a view of the readings in this Measure from one year to another,
+  inclusive. The bounds are found by binary search over the years, and the
+  view refers to this Measure's values rather than copying them.
+
+  @param first
+    The first year of the range
+
+  @param last
+    The last year of the range
+
+  @return
+    A view of the values from first to last, which is empty if there are none
+    or first is after last
+
+  @example
+    Measure measure("pop", "Population");
+    measure.setValue(1999, 12345678.9);
+    measure.setValue(2010, 12345679.9);
+    auto range = measure.getValues(2000, 2020); // just 2010
+    auto average = range.getAverage();          // returns 12345679.9
+*/
+MeasureRange Measure::getValues(unsigned int first, unsigned int last) const {
+	if (first > last) {
+		return MeasureRange(*this, values.end(), values.end());
+	}
+	return MeasureRange(*this, values.lower_bound(first), values.upper_bound(last));
+}
+
 /**
   Calculate the difference between the first and last year imported. This
   function should be callable from a constant context and must promise to not
@@ -230,14 +278,7 @@ int Measure::size() const noexcept{
     auto diff = measure.getDifference(); // returns 1.0
 */
 double Measure::getDifference() const noexcept{
-	if(this->size() > 1) {
-		double first = values.begin()->second;
-		double last = (--values.end())->second;
-
-		return last - first;
-	} else {
-		return 0.0;
-	}
+	return MeasureRange(*this, values.begin(), values.end()).getDifference();
 }
 
 /**
@@ -256,16 +297,7 @@ double Measure::getDifference() const noexcept{
     auto diff = measure.getDifferenceAsPercentage();
 */
 double Measure::getDifferenceAsPercentage() const noexcept{
-	if(this->size() > 1) {
-		double first = values.begin()->second;
-		double last = (--values.end())->second;
-
-		// % diff is calculated with:
-		// ((last - first) / |first|) * 100
-		return ((last - first) / std::abs(first)) * 100.0;
-	} else {
-		return 0.0;
-	}
+	return MeasureRange(*this, values.begin(), values.end()).getDifferenceAsPercentage();
 }
 
 /**
@@ -283,13 +315,7 @@ double Measure::getDifferenceAsPercentage() const noexcept{
     auto diff = measure.getDifference(); // returns 1
 */
 double Measure::getAverage() const noexcept{
-	double rolling_average = 0;
-
-	for(auto it : values) {
-		rolling_average += it.second;
-	}
-
-	return rolling_average / values.size();
+	return MeasureRange(*this, values.begin(), values.end()).getAverage();
 }
 
 /**
@@ -327,46 +353,7 @@ double Measure::getAverage() const noexcept{
     std::cout << measure << std::end;
 */
 std::ostream& operator<<(std::ostream &os, const Measure &obj) {
-
-	os << obj.getLabel() << " (" << obj.getCodename() << ")" << std::endl;
-
-	std::stringstream title_stream;
-	std::stringstream value_stream;
-
-	value_stream << std::fixed << std::setprecision(6);
-	unsigned int space;
-
-	for(auto it : obj.values) {
-		//leading space is the number of digits after decimal place, plus 6 decimal spaces.
-		//also must include space for decimal point.
-		space = std::to_string((int) it.second).length() + 7;
-
-		title_stream << std::setw(space) << it.first << " ";
-		value_stream << it.second << " ";
-	}
-
-	//format and add the Average title to the title stream
-	space = std::to_string((int) obj.getAverage()).length() + 7;
-	title_stream << std::setw(space) << "Average" << " ";
-
-	//format and add the difference title to the title stream.
-	space = std::to_string((int) obj.getDifference()).length() + 7;
-	title_stream << std::setw(space) << "Diff." << " ";
-
-	//format and add the percentage difference title to the title stream.
-	space = std::to_string((int) obj.getDifferenceAsPercentage()).length() + 7;
-	title_stream << std::setw(space) << "% Diff.";
-
-	//add all extra values to the value stream.
-	value_stream << obj.getAverage() << " ";
-	value_stream << obj.getDifference() << " ";
-	value_stream << obj.getDifferenceAsPercentage();
-
-	//convert our string streams into strings and push to ostream.
-	os << title_stream.str() << std::endl;
-	os << value_stream.str() << std::endl;
-
-	return os;
+	return os << MeasureRange(obj, obj.values.begin(), obj.values.end());
 }
 
 /**
@@ -418,13 +405,252 @@ bool Measure::operator==(const Measure &rhs) const {
  * @return JSON representation of the Measure.
  */
 json Measure::getValuesAsJSON() const {
+	return MeasureRange(*this, values.begin(), values.end()).getValuesAsJSON();
+}
+
+/**
+  Estimate the number of bytes this Measure occupies, including the object
+  itself, the heap buffers of its code and label, and one map node per year.
+
+  @return
+    The estimated footprint of the Measure in bytes
+
+  @example
+    Measure measure("pop", "Population");
+    measure.setValue(1999, 12345678.9);
+    auto bytes = measure.memoryUsage();
+*/
+size_t Measure::memoryUsage() const noexcept {
+	using namespace BethYw::Memory;
+
+	size_t bytes = sizeof(Measure);
+	bytes += stringHeapUsage(code);
+	bytes += stringHeapUsage(label);
+	bytes += values.size() * allocationSize(mapNodeSize<unsigned int, double>());
+
+	return bytes;
+}
+
+/**
+  Construct a view of the values of a Measure from one iterator into its
+  values to another. Use Measure::getValues(first, last) to find a range of
+  years.
+
+  @param measure
+    The Measure whose values are viewed
+
+  @param first
+    The first value in the view
+
+  @param last
+    The value after the last value in the view
+
+  @example
+    Measure measure("pop", "Population");
+    MeasureRange all(measure, measure.getValues().begin(), measure.getValues().end());
+*/
+MeasureRange::MeasureRange(const Measure &measure,
+						   MeasureValues::const_iterator first,
+						   MeasureValues::const_iterator last) noexcept
+	: measure(&measure), first(first), last(last) {}
+
+/**
+  @return
+    The Measure whose values are viewed
+*/
+const Measure& MeasureRange::getMeasure() const noexcept {
+	return *measure;
+}
+
+/**
+  @return
+    An iterator to the first value in the view, in year order
+*/
+MeasureValues::const_iterator MeasureRange::begin() const noexcept {
+	return first;
+}
+
+/**
+  @return
+    An iterator past the last value in the view
+*/
+MeasureValues::const_iterator MeasureRange::end() const noexcept {
+	return last;
+}
+
+/**
+  @return
+    True if there are no values in the view
+*/
+bool MeasureRange::empty() const noexcept {
+	return first == last;
+}
+
+/**
+  @return
+    The number of values in the view, which takes time linear in it
+*/
+size_t MeasureRange::size() const noexcept {
+	return (size_t) std::distance(first, last);
+}
+
+/**
+  Narrow the view to the values from one year to another, inclusive.
+
+  @param first_year
+    The first year of the range
+
+  @param last_year
+    The last year of the range
+
+  @return
+    A view of the values in both this view and the range
+
+  @example
+    auto decade = measure.getValues(2000, 2019);
+    auto value = decade.getValues(2010, 2010); // just 2010, if it is there
+*/
+MeasureRange MeasureRange::getValues(unsigned int first_year, unsigned int last_year) const {
+	if (first == last) {
+		return *this;
+	}
+	return measure->getValues(std::max(first_year, first->first), std::min(last_year, std::prev(last)->first));
+}
+
+/**
+  Calculate the difference between the first and last year in the view.
+
+  @return
+    The difference/change in value from the first to the last year, or 0 if
+    there are fewer than two years
+
+  @example
+    auto diff = measure.getValues(1999, 2010).getDifference();
+*/
+double MeasureRange::getDifference() const noexcept {
+	if (first == last || std::next(first) == last) {
+		return 0.0;
+	}
+	return std::prev(last)->second - first->second;
+}
+
+/**
+  Calculate the difference between the first and last year in the view as a
+  percentage.
+
+  @return
+    The difference/change in value from the first to the last year as a
+    percentage of the first, or 0 if there are fewer than two years
+
+  @example
+    auto diff = measure.getValues(1999, 2010).getDifferenceAsPercentage();
+*/
+double MeasureRange::getDifferenceAsPercentage() const noexcept {
+	if (first == last || std::next(first) == last) {
+		return 0.0;
+	}
+
+	// % diff is calculated with:
+	// ((last - first) / |first|) * 100
+	const double from = first->second;
+	const double to = std::prev(last)->second;
+	return ((to - from) / std::abs(from)) * 100.0;
+}
+
+/**
+  Calculate the average/mean of the values in the view.
+
+  @return
+    The average value, or NaN if the view is empty
+
+  @example
+    auto average = measure.getValues(1999, 2010).getAverage();
+*/
+double MeasureRange::getAverage() const noexcept {
+	double rolling_average = 0;
+	size_t count = 0;
+
+	for (auto it = first; it != last; it++) {
+		rolling_average += it->second;
+		count++;
+	}
+
+	return rolling_average / count;
+}
+
+/**
+  Convert the values in the view into a JSON object of years to values.
+
+  @return
+    JSON representation of the values, e.g. {"2010": 1.0}
+*/
+json MeasureRange::getValuesAsJSON() const {
 	json json_values;
 
 	std::string y;
-	for(auto &it : values) {
-		y = std::to_string(it.first);
-		json_values.emplace(y, it.second);
+	for (auto it = first; it != last; it++) {
+		y = std::to_string(it->first);
+		json_values.emplace(y, it->second);
 	}
 
 	return json_values;
 }
+
+/**
+  Overload the << operator to print the values in a view the way a Measure is
+  printed, with the average and differences over the years in the view.
+
+  @param os
+    The output stream to write to
+
+  @param obj
+    The view to write to the output stream
+
+  @return
+    Reference to the output stream
+
+  @example
+    std::cout << measure.getValues(1991, 1993) << std::endl;
+*/
+std::ostream& operator<<(std::ostream &os, const MeasureRange &obj) {
+
+	os << obj.measure->getLabel() << " (" << obj.measure->getCodename() << ")" << std::endl;
+
+	std::stringstream title_stream;
+	std::stringstream value_stream;
+
+	value_stream << std::fixed << std::setprecision(6);
+	unsigned int space;
+
+	for(auto it : obj) {
+		//leading space is the number of digits after decimal place, plus 6 decimal spaces.
+		//also must include space for decimal point.
+		space = std::to_string((int) it.second).length() + 7;
+
+		title_stream << std::setw(space) << it.first << " ";
+		value_stream << it.second << " ";
+	}
+
+	//format and add the Average title to the title stream
+	space = std::to_string((int) obj.getAverage()).length() + 7;
+	title_stream << std::setw(space) << "Average" << " ";
+
+	//format and add the difference title to the title stream.
+	space = std::to_string((int) obj.getDifference()).length() + 7;
+	title_stream << std::setw(space) << "Diff." << " ";
+
+	//format and add the percentage difference title to the title stream.
+	space = std::to_string((int) obj.getDifferenceAsPercentage()).length() + 7;
+	title_stream << std::setw(space) << "% Diff.";
+
+	//add all extra values to the value stream.
+	value_stream << obj.getAverage() << " ";
+	value_stream << obj.getDifference() << " ";
+	value_stream << obj.getDifferenceAsPercentage();
+
+	//convert our string streams into strings and push to ostream.
+	os << title_stream.str() << std::endl;
+	os << value_stream.str() << std::endl;
+
+	return os;
+}
@@ -16,6 +16,16 @@
 #include <memory>
 
 #include "lib_json.hpp"
+#include "arena.h"
+
+/*
+  The readings of a Measure, keyed by year. Nodes come from the current Arena
+  (see arena.h) if there is one.
+*/
+using MeasureValues = std::map<unsigned int, double, std::less<unsigned int>,
+							   ArenaAllocator<std::pair<const unsigned int, double>>>;
+
+class MeasureRange;
 
 /*
   The Measure class contains a measure code, label, and a container for readings
@@ -25,10 +35,11 @@ class Measure {
  private:
 	std::string code;
 	std::string label;
-	std::map<unsigned int, double> values;
+	MeasureValues values;
 
  public:
   Measure(const std::string &code, const std::string &label) noexcept;
+  Measure(const Measure &other) = default;
   ~Measure();
   Measure& operator=(const Measure &other);
   std::string getCodename() const noexcept;
@@ -37,13 +48,46 @@ class Measure {
   double getValue(const unsigned int &key) const;
   void setValue(const unsigned int &key, const double &value);
   int size() const noexcept;
+  const MeasureValues& getValues() const noexcept;
+  MeasureRange getValues(unsigned int first, unsigned int last) const;
   double getDifference() const noexcept;
   double getDifferenceAsPercentage() const noexcept;
   double getAverage() const noexcept;
   friend std::ostream& operator<<(std::ostream &os, const Measure &obj);
   bool operator==(const Measure &rhs) const;
   nlohmann::json getValuesAsJSON() const;
+  size_t memoryUsage() const noexcept;
+
+};
 
+/*
+  A read-only view of the values of a Measure in a range of years. A view only
+  holds iterators into the Measure's own values, which are ordered by year, so
+  finding the range takes O(log n) time and nothing is copied: statistics and
+  output over the view cost only the number of values in it. A view is no
+  longer valid once the Measure's values change.
+*/
+class MeasureRange {
+ private:
+	const Measure *measure;
+	MeasureValues::const_iterator first;
+	MeasureValues::const_iterator last;
+
+ public:
+	MeasureRange(const Measure &measure,
+				 MeasureValues::const_iterator first,
+				 MeasureValues::const_iterator last) noexcept;
+	const Measure& getMeasure() const noexcept;
+	MeasureValues::const_iterator begin() const noexcept;
+	MeasureValues::const_iterator end() const noexcept;
+	bool empty() const noexcept;
+	size_t size() const noexcept;
+	MeasureRange getValues(unsigned int first_year, unsigned int last_year) const;
+	double getDifference() const noexcept;
+	double getDifferenceAsPercentage() const noexcept;
+	double getAverage() const noexcept;
+	nlohmann::json getValuesAsJSON() const;
+	friend std::ostream& operator<<(std::ostream &os, const MeasureRange &obj);
 };
 
 #endif // MEASURE_H_
\ No newline at end of file
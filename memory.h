@@ -0,0 +1,95 @@
+#ifndef MEMORY_H_
+#define MEMORY_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains small helpers for estimating how many bytes the Measure,
+  Area and Areas containers hold on the heap. The standard containers do not
+  expose their allocations, so we model them: every std::map node is a single
+  allocation of the red-black tree header plus the stored pair, and a
+  std::string only allocates once it outgrows its small-string buffer.
+  Allocation sizes are rounded the way glibc's malloc rounds them (8 bytes of
+  bookkeeping, 16 byte alignment, 32 byte minimum chunk).
+ */
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <utility>
+
+namespace BethYw {
+
+namespace Memory {
+
+/*
+  The size of the bookkeeping the allocator adds to each allocation.
+*/
+constexpr size_t MALLOC_OVERHEAD = sizeof(size_t);
+
+/*
+  The alignment of allocations returned from the allocator.
+*/
+constexpr size_t MALLOC_ALIGNMENT = 2 * sizeof(size_t);
+
+/*
+  The smallest chunk the allocator will hand out.
+*/
+constexpr size_t MALLOC_MIN_CHUNK = 4 * sizeof(size_t);
+
+/*
+  The red-black tree node header used by std::map (colour, padded to a
+  pointer, and the parent/left/right links).
+*/
+constexpr size_t MAP_NODE_HEADER = 4 * sizeof(void *);
+
+/*
+  The header std::make_shared (or std::allocate_shared) puts before the
+  object it allocates: a vtable pointer, the two reference counts, and the
+  allocator.
+*/
+constexpr size_t SHARED_BLOCK_HEADER = 3 * sizeof(void *);
+
+/*
+  The number of characters std::string can store without allocating.
+*/
+constexpr size_t STRING_SSO_CAPACITY = 15;
+
+/*
+  Return the number of bytes the allocator really reserves for a request of
+  `requested` bytes.
+*/
+inline size_t allocationSize(size_t requested) noexcept {
+	size_t chunk = (requested + MALLOC_OVERHEAD + MALLOC_ALIGNMENT - 1) & ~(MALLOC_ALIGNMENT - 1);
+	return chunk < MALLOC_MIN_CHUNK ? MALLOC_MIN_CHUNK : chunk;
+}
+
+/*
+  Return the number of heap bytes owned by a std::string (0 if the string
+  fits in its small-string buffer).
+*/
+inline size_t stringHeapUsage(const std::string &str) noexcept {
+	if (str.capacity() <= STRING_SSO_CAPACITY) {
+		return 0;
+	}
+	return allocationSize(str.capacity() + 1);
+}
+
+/*
+  Return the number of bytes allocated for a single node of a std::map with
+  key type K and mapped type V.
+*/
+template <typename K, typename V>
+constexpr size_t mapNodeSize() noexcept {
+	return MAP_NODE_HEADER + sizeof(std::pair<const K, V>);
+}
+
+} // namespace Memory
+
+} // namespace BethYw
+
+#endif // MEMORY_H_
@@ -0,0 +1,346 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the implementation of ODataServer, the local stand-in
+  for the StatsWales OData API. See the header file for the URLs it serves.
+ */
+
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#include "odataserver.h"
+
+using json = nlohmann::json;
+
+/**
+  Constructor for a server of the files in a directory. The server does not
+  accept connections until start() is called.
+
+  @param dir
+    The directory to serve, including the trailing separator
+
+  @param pageSize
+    The number of rows in each page of a dataset, unless $top is given
+
+  @param delayMs
+    A delay, in milliseconds, added before every response
+
+  @example
+    ODataServer server("datasets/", 100);
+    server.start();
+*/
+ODataServer::ODataServer(const std::string &_dir, size_t pageSize, unsigned int delayMs)
+	: dir(_dir), page_size(pageSize > 0 ? pageSize : 1000), delay_ms(delayMs),
+	  listen_fd(-1), bound_port(0), running(false), requests(0) {}
+
+/**
+  Destructor for the server, which stops it if it is running.
+*/
+ODataServer::~ODataServer() {
+	stop();
+}
+
+/**
+  Start listening on the loopback interface and accepting connections on a
+  background thread.
+
+  @param port
+    The port to listen on, or 0 to use any free port (see port())
+
+  @throws
+    std::runtime_error if the server cannot listen on the port
+
+  @example
+    ODataServer server("datasets/");
+    server.start(8080);
+*/
+void ODataServer::start(unsigned short port) {
+#ifdef _WIN32
+	throw std::runtime_error("ODataServer::start: Not supported on this platform");
+#else
+	listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (listen_fd < 0) {
+		throw std::runtime_error("ODataServer::start: Failed to create socket");
+	}
+
+	int reuse = 1;
+	setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	sockaddr_in address;
+	std::memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(port);
+
+	socklen_t length = sizeof(address);
+	if (bind(listen_fd, (sockaddr *) &address, sizeof(address)) != 0
+		|| listen(listen_fd, 64) != 0
+		|| getsockname(listen_fd, (sockaddr *) &address, &length) != 0) {
+		close(listen_fd);
+		listen_fd = -1;
+		throw std::runtime_error("ODataServer::start: Failed to listen on port " + std::to_string(port));
+	}
+
+	bound_port = ntohs(address.sin_port);
+	running = true;
+	acceptor = std::thread(&ODataServer::acceptLoop, this);
+#endif
+}
+
+/**
+  Stop accepting connections and wait for any requests being handled.
+*/
+void ODataServer::stop() {
+#ifndef _WIN32
+	if (!running.exchange(false)) {
+		return;
+	}
+
+	//shutting the socket down wakes the acceptor thread up.
+	shutdown(listen_fd, SHUT_RDWR);
+	close(listen_fd);
+	listen_fd = -1;
+	acceptor.join();
+
+	std::lock_guard<std::mutex> lock(handlers_mutex);
+	for (auto &it : handlers) {
+		it.join();
+	}
+	handlers.clear();
+#endif
+}
+
+/**
+  @return
+    The port the server is listening on
+*/
+unsigned short ODataServer::port() const noexcept {
+	return bound_port;
+}
+
+/**
+  @return
+    The URL of the root of the server, e.g. http://127.0.0.1:8080
+*/
+std::string ODataServer::baseURL() const {
+	return "http://127.0.0.1:" + std::to_string(bound_port);
+}
+
+/**
+  @return
+    The number of requests the server has received
+*/
+size_t ODataServer::requestCount() const noexcept {
+	return requests;
+}
+
+/**
+  Accept connections until the server is stopped, handling each on its own
+  thread.
+*/
+void ODataServer::acceptLoop() {
+#ifndef _WIN32
+	while (running) {
+		int fd = accept(listen_fd, nullptr, nullptr);
+		if (fd < 0) {
+			if (!running) {
+				break;
+			}
+			continue;
+		}
+
+		std::lock_guard<std::mutex> lock(handlers_mutex);
+		handlers.emplace_back(&ODataServer::handle, this, fd);
+	}
+#endif
+}
+
+/**
+  Read a request from a connection, write the response and close it.
+
+  @param fd
+    The socket of the connection
+*/
+void ODataServer::handle(int fd) {
+#ifndef _WIN32
+	std::string request;
+	char buffer[4096];
+	ssize_t n;
+	while (request.find("\r\n\r\n") == std::string::npos
+		   && (n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+		request.append(buffer, n);
+	}
+	requests++;
+
+	//the request line is: GET <target> HTTP/1.1
+	int status = 400;
+	std::string body;
+	size_t target_start = request.find(' ');
+	size_t target_end = request.find(' ', target_start + 1);
+	if (request.compare(0, 4, "GET ") == 0 && target_end != std::string::npos) {
+		try {
+			body = respond(request.substr(target_start + 1, target_end - target_start - 1), status);
+		} catch (std::exception &e) {
+			status = 500;
+			body = e.what();
+		}
+	}
+
+	if (delay_ms > 0) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+	}
+
+	std::string reason = status == 200 ? "OK" : status == 404 ? "Not Found" : "Error";
+	std::string response = "HTTP/1.1 " + std::to_string(status) + " " + reason + "\r\n"
+						   "Content-Length: " + std::to_string(body.size()) + "\r\n"
+						   "Connection: close\r\n\r\n" + body;
+
+	size_t sent = 0;
+	while (sent < response.size()
+		   && (n = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL)) > 0) {
+		sent += n;
+	}
+	close(fd);
+#endif
+}
+
+/**
+  Retrieve (loading it on first use) the parsed contents of <name>.json.
+
+  @param name
+    The name of the dataset
+
+  @return
+    The parsed dataset
+
+  @throws
+    std::out_of_range if there is no such dataset
+*/
+const json &ODataServer::dataset(const std::string &name) {
+	std::lock_guard<std::mutex> lock(datasets_mutex);
+
+	auto it = datasets.find(name);
+	if (it == datasets.end()) {
+		std::ifstream file(dir + name + ".json");
+		if (!file.is_open()) {
+			throw std::out_of_range("No dataset " + name);
+		}
+		json j;
+		file >> j;
+		it = datasets.emplace(name, std::move(j)).first;
+	}
+
+	return it->second;
+}
+
+/**
+  Build the response body for a request target.
+
+  @param target
+    The path and query of the request, e.g. /dataset/popu1009?$skip=0
+
+  @param status
+    Set to the HTTP status code of the response
+
+  @return
+    The response body
+*/
+std::string ODataServer::respond(const std::string &target, int &status) {
+	const std::string dataset_prefix = "/dataset/";
+
+	//decode the target, which may have its $ encoded.
+	std::string decoded;
+	for (size_t i = 0; i < target.size(); i++) {
+		if (target[i] == '%' && i + 2 < target.size()
+			&& std::isxdigit((unsigned char) target[i + 1]) && std::isxdigit((unsigned char) target[i + 2])) {
+			decoded += (char) std::stoi(target.substr(i + 1, 2), nullptr, 16);
+			i += 2;
+		} else {
+			decoded += target[i];
+		}
+	}
+
+	size_t query = decoded.find('?');
+	std::string path = decoded.substr(0, query);
+
+	//don't allow requests to escape the datasets directory.
+	if (path.find("..") != std::string::npos) {
+		status = 404;
+		return "";
+	}
+
+	if (path.compare(0, dataset_prefix.size(), dataset_prefix) != 0) {
+		std::ifstream file(dir + path.substr(1), std::ios::binary);
+		if (!file.is_open()) {
+			status = 404;
+			return "";
+		}
+		std::stringstream contents;
+		contents << file.rdbuf();
+		status = 200;
+		return contents.str();
+	}
+
+	auto parameter = [&](const std::string &name, size_t fallback) {
+		if (query == std::string::npos) {
+			return fallback;
+		}
+		size_t pos = decoded.find(name + "=", query);
+		if (pos == std::string::npos) {
+			return fallback;
+		}
+		return (size_t) std::stoul(decoded.substr(pos + name.size() + 1));
+	};
+
+	std::string name = path.substr(dataset_prefix.size());
+	size_t skip = parameter("$skip", 0);
+	size_t top = parameter("$top", page_size);
+
+	const json *rows;
+	try {
+		rows = &dataset(name);
+	} catch (std::out_of_range &e) {
+		status = 404;
+		return "";
+	}
+
+	if (!rows->contains("value") || !(*rows)["value"].is_array()) {
+		status = 404;
+		return "";
+	}
+	rows = &(*rows)["value"];
+
+	json page;
+	page["odata.metadata"] = baseURL() + "/dataset/$metadata#" + name;
+	page["value"] = json::array();
+	for (size_t i = skip; i < rows->size() && i < skip + top; i++) {
+		page["value"].push_back((*rows)[i]);
+	}
+	if (skip + top < rows->size()) {
+		page["odata.nextLink"] = baseURL() + "/dataset/" + name
+								 + "?$skip=" + std::to_string(skip + top)
+								 + "&$top=" + std::to_string(top);
+	}
+
+	status = 200;
+	return page.dump();
+}
@@ -0,0 +1,63 @@
+#ifndef ODATASERVER_H_
+#define ODATASERVER_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the declaration of ODataServer, a small HTTP server that
+  stands in for the StatsWales OData API so that HTTP input can be tested
+  offline. It serves the files in a datasets directory:
+
+    GET /<file>                            the file as it is on disk
+    GET /dataset/<name>?$skip=<n>&$top=<m> rows n to n+m of <name>.json,
+                                           with an odata.nextLink to the
+                                           next page if there are more rows
+
+  Each connection is handled on its own thread, and an optional delay can be
+  added to every response to simulate a slow network.
+ */
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lib_json.hpp"
+
+class ODataServer {
+ private:
+	const std::string dir;
+	const size_t page_size;
+	const unsigned int delay_ms;
+	int listen_fd;
+	unsigned short bound_port;
+	std::atomic<bool> running;
+	std::atomic<size_t> requests;
+	std::thread acceptor;
+	std::vector<std::thread> handlers;
+	std::mutex handlers_mutex;
+	std::mutex datasets_mutex;
+	std::map<std::string, nlohmann::json> datasets;
+
+	void acceptLoop();
+	void handle(int fd);
+	std::string respond(const std::string &target, int &status);
+	const nlohmann::json &dataset(const std::string &name);
+
+ public:
+	ODataServer(const std::string &dir, size_t pageSize = 1000, unsigned int delayMs = 0);
+	~ODataServer();
+	void start(unsigned short port = 0);
+	void stop();
+	unsigned short port() const noexcept;
+	std::string baseURL() const;
+	size_t requestCount() const noexcept;
+};
+
+#endif // ODATASERVER_H_
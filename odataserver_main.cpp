@@ -0,0 +1,69 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the entry point for odata-server, which serves a datasets
+  directory in the same way as the StatsWales OData API so that bethyw can be
+  run against it offline, e.g.:
+
+    odata-server --dir datasets --port 8080 --page-size 100 &
+    bethyw --dir http://127.0.0.1:8080 -d popden
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "lib_cxxopts.hpp"
+#include "odataserver.h"
+
+int main(int argc, char *argv[]) {
+
+	cxxopts::Options cxxopts("odata-server", "Serve a Beth Yw? datasets directory over HTTP.\n");
+	cxxopts.add_options()
+		("dir",
+			"Directory of datasets to serve",
+			cxxopts::value<std::string>()->default_value("datasets"))
+		("port",
+			"Port to listen on",
+			cxxopts::value<unsigned short>()->default_value("8080"))
+		("page-size",
+			"Number of rows in each page of a JSON dataset",
+			cxxopts::value<size_t>()->default_value("1000"))
+		("delay",
+			"Milliseconds to wait before sending each response",
+			cxxopts::value<unsigned int>()->default_value("0"))
+		("h,help",
+			"Print usage.");
+
+	try {
+		auto args = cxxopts.parse(argc, argv);
+		if (args.count("help")) {
+			std::cerr << cxxopts.help() << std::endl;
+			return 0;
+		}
+
+		ODataServer server(args["dir"].as<std::string>() + "/",
+						   args["page-size"].as<size_t>(),
+						   args["delay"].as<unsigned int>());
+		server.start(args["port"].as<unsigned short>());
+		std::cerr << "Serving " << args["dir"].as<std::string>() << " at " << server.baseURL() << std::endl;
+
+		//serve until the process is killed.
+		for (;;) {
+			std::this_thread::sleep_for(std::chrono::hours(1));
+		}
+	} catch (cxxopts::OptionException &e) {
+		std::cerr << e.what() << std::endl;
+		return -1;
+	} catch (std::runtime_error &e) {
+		std::cerr << e.what() << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,499 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the implementation of the import pipeline. See the
+  header file for what each stage does.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+#include "pipeline.h"
+#include "queue.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+uint64_t nanosSince(Clock::time_point start) {
+	return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+//the stats of every import so far.
+std::mutex totals_mutex;
+IngestStats totals;
+
+//the number of imports whose reader and parser are running on threads of their own.
+std::atomic<size_t> running_pipelines(0);
+
+/*
+  A place among the INGEST_MAX_PIPELINES imports that may start threads for
+  their stages, held until it is destroyed, if one was free.
+*/
+class PipelineSlot {
+ private:
+	bool held;
+
+ public:
+	PipelineSlot() : held(false) {
+		size_t running = running_pipelines.load();
+		while (running < INGEST_MAX_PIPELINES && !running_pipelines.compare_exchange_weak(running, running + 1)) {}
+		held = running < INGEST_MAX_PIPELINES;
+	}
+
+	~PipelineSlot() {
+		if (held) {
+			running_pipelines--;
+		}
+	}
+
+	PipelineSlot(const PipelineSlot &) = delete;
+	PipelineSlot &operator=(const PipelineSlot &) = delete;
+
+	bool isHeld() const noexcept {
+		return held;
+	}
+};
+
+//thrown by the parser's emit() to stop parsing once the merger has stopped.
+struct IngestStopped {};
+
+/*
+  A stream buffer over the buffers of one page from the reader, which ends
+  the page with an empty buffer.
+*/
+class IngestStreamBuf : public std::streambuf {
+ private:
+	SPSCQueue<std::string> &buffers;
+	std::string current;
+	bool page_ended;
+	bool input_ended;
+
+ protected:
+	int_type underflow() override {
+		while (!page_ended) {
+			if (!buffers.pop(current)) {
+				page_ended = true;
+				input_ended = true;
+			} else if (current.empty()) {
+				page_ended = true;
+			} else {
+				setg(&current[0], &current[0], &current[0] + current.size());
+				return traits_type::to_int_type(*gptr());
+			}
+		}
+		return traits_type::eof();
+	}
+
+ public:
+	explicit IngestStreamBuf(SPSCQueue<std::string> &buffers)
+		: buffers(buffers), page_ended(false), input_ended(false) {}
+
+	//skip what the parser left of the current page, and start on the next, if the reader found one.
+	bool nextPage() {
+		setg(nullptr, nullptr, nullptr);
+		while (!page_ended) {
+			underflow();
+			setg(nullptr, nullptr, nullptr);
+		}
+		if (input_ended) {
+			return false;
+		}
+
+		//wait for the first buffer of the next page, as the reader closes the queue if there is none.
+		page_ended = false;
+		underflow();
+		return !input_ended;
+	}
+};
+
+//read each page into buffers, opening the next once the parser has found the link to it.
+void readPages(std::istream &first,
+			   const PageResolver *resolver,
+			   SPSCQueue<std::string> &buffers,
+			   BlockingQueue<std::string> &links,
+			   IngestStageStats &stats) {
+	std::unique_ptr<InputSource> source;
+	std::istream *is = &first;
+
+	for (;;) {
+		std::streambuf *in = is->rdbuf();
+		while (in != nullptr) {
+			std::string buffer(INGEST_BUFFER_BYTES, '\0');
+			const std::streamsize read = in->sgetn(&buffer[0], (std::streamsize) buffer.size());
+			if (read <= 0) {
+				break;
+			}
+			buffer.resize((size_t) read);
+			stats.items += (uint64_t) read;
+			if (!buffers.push(std::move(buffer))) {
+				return;
+			}
+		}
+		if (!buffers.push(std::string()) || resolver == nullptr) {
+			return;
+		}
+
+		std::string link;
+		const auto start = Clock::now();
+		const bool more = links.pop(link);
+		stats.waitNanos += nanosSince(start);
+		if (!more || link.empty()) {
+			return;
+		}
+
+		source = resolver->resolve(link);
+		if (!source) {
+			return;
+		}
+		is = &source->open();
+	}
+}
+
+//parse each page into batches of rows, handing the link at the end of each page back to the reader.
+void parsePages(const IngestParser &parse,
+				bool paged,
+				SPSCQueue<std::string> &buffers,
+				BlockingQueue<std::string> &links,
+				SPSCQueue<std::vector<IngestRow>> &batches,
+				IngestStageStats &stats) {
+	IngestStreamBuf pages(buffers);
+	std::istream page(&pages);
+
+	std::vector<IngestRow> batch;
+	batch.reserve(INGEST_ROWS_PER_BATCH);
+	auto emit = [&](IngestRow &row) {
+		batch.push_back(std::move(row));
+		stats.items++;
+		if (batch.size() == INGEST_ROWS_PER_BATCH) {
+			if (!batches.push(std::move(batch))) {
+				throw IngestStopped();
+			}
+			batch.clear();
+			batch.reserve(INGEST_ROWS_PER_BATCH);
+		}
+	};
+
+	//the rows parsed before an error are still merged, as they would be without the pipeline.
+	try {
+		for (;;) {
+			const std::string link = parse(page, emit);
+			if (!paged || link.empty() || !links.push(link) || !pages.nextPage()) {
+				break;
+			}
+			page.clear();
+		}
+	} catch (IngestStopped &) {
+		throw;
+	} catch (...) {
+		if (!batch.empty()) {
+			batches.push(std::move(batch));
+		}
+		throw;
+	}
+
+	if (!batch.empty()) {
+		batches.push(std::move(batch));
+	}
+}
+
+/*
+  A stream buffer that reads the input in buffers of INGEST_BUFFER_BYTES, as
+  the reader does, for an import whose stages take turns.
+*/
+class InTurnStreamBuf : public std::streambuf {
+ private:
+	std::streambuf *in;
+	std::string buffer;
+	IngestStageStats &stats;
+
+ protected:
+	int_type underflow() override {
+		if (in == nullptr) {
+			return traits_type::eof();
+		}
+		const auto start = Clock::now();
+		buffer.resize(INGEST_BUFFER_BYTES);
+		const std::streamsize read = in->sgetn(&buffer[0], (std::streamsize) buffer.size());
+		stats.busyNanos += nanosSince(start);
+		if (read <= 0) {
+			return traits_type::eof();
+		}
+		stats.items += (uint64_t) read;
+		setg(&buffer[0], &buffer[0], &buffer[0] + read);
+		return traits_type::to_int_type(*gptr());
+	}
+
+ public:
+	InTurnStreamBuf(std::streambuf *in, IngestStageStats &stats) : in(in), stats(stats) {}
+};
+
+//read, parse and merge each page in turn on this thread, in batches of rows as the pipeline does.
+void ingestInTurn(std::istream &first,
+				  const PageResolver *resolver,
+				  const IngestParser &parse,
+				  const IngestMerger &merge,
+				  IngestStats &stats) {
+	std::unique_ptr<InputSource> source;
+	std::istream *is = &first;
+
+	std::vector<IngestRow> batch;
+	batch.reserve(INGEST_ROWS_PER_BATCH);
+	auto flush = [&]() {
+		const auto start = Clock::now();
+		for (const auto &row : batch) {
+			merge(row);
+			stats.merger.items++;
+		}
+		batch.clear();
+		stats.merger.busyNanos += nanosSince(start);
+	};
+	auto emit = [&](IngestRow &row) {
+		batch.push_back(std::move(row));
+		stats.parser.items++;
+		if (batch.size() == INGEST_ROWS_PER_BATCH) {
+			flush();
+		}
+	};
+
+	for (;;) {
+		InTurnStreamBuf buffer(is->rdbuf(), stats.reader);
+		std::istream page(&buffer);
+
+		std::string link;
+		try {
+			link = parse(page, emit);
+		} catch (...) {
+			flush();
+			throw;
+		}
+		flush();
+
+		if (resolver == nullptr || link.empty()) {
+			return;
+		}
+		source = resolver->resolve(link);
+		if (!source) {
+			return;
+		}
+		is = &source->open();
+	}
+}
+
+} // namespace
+
+/**
+  @return
+    The share of the stage's time that it spent working rather than waiting,
+    from 0 to 1
+*/
+double IngestStageStats::utilisation() const noexcept {
+	const uint64_t total = busyNanos + waitNanos;
+	return total == 0 ? 0.0 : (double) busyNanos / (double) total;
+}
+
+/**
+  Add the counts of another run of the stage to these.
+
+  @param other
+    The counts to add
+
+  @return
+    These counts
+*/
+IngestStageStats &IngestStageStats::operator+=(const IngestStageStats &other) noexcept {
+	items += other.items;
+	busyNanos += other.busyNanos;
+	waitNanos += other.waitNanos;
+	return *this;
+}
+
+/**
+  Add the counts of other imports to these.
+
+  @param other
+    The counts to add
+
+  @return
+    These counts
+*/
+IngestStats &IngestStats::operator+=(const IngestStats &other) noexcept {
+	imports += other.imports;
+	reader += other.reader;
+	parser += other.parser;
+	merger += other.merger;
+	return *this;
+}
+
+/**
+  Import a dataset through the pipeline: its input is read on one thread and
+  parsed on another, while the rows are merged on this one. If
+  INGEST_MAX_PIPELINES imports are already running, it is read, parsed and
+  merged in turn on this thread instead, with the same result. If the dataset is
+  split across pages, the link the parser returns at the end of each page is
+  handed to the resolver to find the next, until there is no link or no such
+  page.
+
+  The rows are merged in order as they are parsed, so if the input cannot be
+  read or parsed part of the way through, the rows before that point have
+  already been merged.
+
+  @param is
+    The input stream of the dataset (or its first page)
+
+  @param resolver
+    The PageResolver used to find the following pages, or nullptr if the
+    dataset has only one
+
+  @param parse
+    Parses a page into rows
+
+  @param merge
+    Adds a row to the data
+
+  @return
+    What each stage did
+
+  @throws
+    The first exception thrown by reading the input, then by parse, and then
+    by merge
+
+  @example
+    Areas data;
+    runIngestPipeline(input.open(), nullptr, parseRows, [&](const IngestRow &row) {
+      ...
+    });
+*/
+IngestStats runIngestPipeline(std::istream &is,
+							  const PageResolver *resolver,
+							  const IngestParser &parse,
+							  const IngestMerger &merge) {
+	IngestStats stats;
+	stats.imports = 1;
+
+	//beyond INGEST_MAX_PIPELINES imports at once, the stages take turns rather than starting more threads.
+	PipelineSlot slot;
+	if (!slot.isHeld()) {
+		const auto start = Clock::now();
+		try {
+			ingestInTurn(is, resolver, parse, merge, stats);
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(totals_mutex);
+			totals += stats;
+			throw;
+		}
+		const uint64_t nanos = nanosSince(start);
+		const uint64_t other = stats.reader.busyNanos + stats.merger.busyNanos;
+		stats.parser.busyNanos = nanos > other ? nanos - other : 0;
+
+		std::lock_guard<std::mutex> lock(totals_mutex);
+		totals += stats;
+		return stats;
+	}
+
+	SPSCQueue<std::string> buffers(INGEST_BUFFERS);
+	SPSCQueue<std::vector<IngestRow>> batches(INGEST_BATCHES);
+	BlockingQueue<std::string> links(1);
+
+	std::exception_ptr reader_error;
+	std::exception_ptr parser_error;
+	uint64_t reader_nanos = 0;
+	uint64_t parser_nanos = 0;
+
+	//each stage closes the queues it uses as it finishes, so the others never wait for it in vain.
+	std::thread reader([&]() {
+		const auto start = Clock::now();
+		try {
+			readPages(is, resolver, buffers, links, stats.reader);
+		} catch (...) {
+			reader_error = std::current_exception();
+		}
+		buffers.close();
+		reader_nanos = nanosSince(start);
+	});
+
+	std::thread parser([&]() {
+		const auto start = Clock::now();
+		try {
+			parsePages(parse, resolver != nullptr, buffers, links, batches, stats.parser);
+		} catch (IngestStopped &) {
+		} catch (...) {
+			parser_error = std::current_exception();
+		}
+		buffers.close();
+		links.close();
+		batches.close();
+		parser_nanos = nanosSince(start);
+	});
+
+	const auto start = Clock::now();
+	std::exception_ptr merger_error;
+	try {
+		std::vector<IngestRow> batch;
+		while (batches.pop(batch)) {
+			for (const auto &row : batch) {
+				merge(row);
+			}
+			stats.merger.items += batch.size();
+		}
+	} catch (...) {
+		merger_error = std::current_exception();
+		batches.close();
+	}
+
+	parser.join();
+	reader.join();
+	const uint64_t merger_nanos = nanosSince(start);
+
+	stats.reader.waitNanos += buffers.producerWaitNanos();
+	stats.parser.waitNanos = buffers.consumerWaitNanos() + batches.producerWaitNanos();
+	stats.merger.waitNanos = batches.consumerWaitNanos();
+	stats.reader.busyNanos = reader_nanos > stats.reader.waitNanos ? reader_nanos - stats.reader.waitNanos : 0;
+	stats.parser.busyNanos = parser_nanos > stats.parser.waitNanos ? parser_nanos - stats.parser.waitNanos : 0;
+	stats.merger.busyNanos = merger_nanos > stats.merger.waitNanos ? merger_nanos - stats.merger.waitNanos : 0;
+	{
+		std::lock_guard<std::mutex> lock(totals_mutex);
+		totals += stats;
+	}
+
+	//a parse error is usually the result of the input stopping short, so the reason it did comes first.
+	if (reader_error) {
+		std::rethrow_exception(reader_error);
+	}
+	if (parser_error) {
+		std::rethrow_exception(parser_error);
+	}
+	if (merger_error) {
+		std::rethrow_exception(merger_error);
+	}
+
+	return stats;
+}
+
+/**
+  @return
+    What each stage of the pipeline did, added up over every import so far
+*/
+IngestStats ingestTotals() {
+	std::lock_guard<std::mutex> lock(totals_mutex);
+	return totals;
+}
+
+/**
+  @return
+    The number of imports whose reader and parser are running on threads of
+    their own, which is never more than INGEST_MAX_PIPELINES
+*/
+size_t ingestPipelinesRunning() noexcept {
+	return running_pipelines.load();
+}
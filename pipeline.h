@@ -0,0 +1,133 @@
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the declarations of the import pipeline, which imports a
+  dataset in three stages running at once, so waiting for input, parsing and
+  adding values to an Areas instance overlap rather than taking turns:
+
+    reader  reads the input stream into buffers of INGEST_BUFFER_BYTES, on a
+            thread of its own
+    parser  parses the buffers into IngestRows, one row of the dataset each,
+            on a thread of its own
+    merger  adds the rows to the Areas instance, on the thread that started
+            the import (so Areas needs no locks, and an ArenaScope on that
+            thread still applies)
+
+  The stages are joined by SPSCQueues (see queue.h), so a stage only waits
+  when the one before it has nothing for it or the one after it has fallen
+  too far behind, and at most INGEST_BUFFERS buffers and INGEST_BATCHES
+  batches of rows are in flight. A dataset split across pages (see
+  populateFromWelshStatsJSONPages()) goes through the same pipeline: the
+  parser hands the link at the end of each page back to the reader, which
+  opens the next page while the rows of the last are still being merged.
+
+  The reader and parser are not tasks on the TaskScheduler (see scheduler.h),
+  as they block on their queues, and a task that blocks holds up every task
+  queued behind it. Instead, at most INGEST_MAX_PIPELINES imports at once
+  start threads for them, so however many imports are started together
+  (e.g. by tasks on the TaskScheduler), no more than twice that many stage
+  threads are running. An import started while that many are running takes
+  each stage in turn on the thread that started it instead.
+
+  Each stage counts the items it handles and the time it spends working and
+  waiting, and the counts of every import are added up, so how well the
+  stages overlap can be reported (see --ingest-report).
+ */
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <string>
+
+#include "input.h"
+
+/*
+  The size of each buffer read from the input.
+*/
+const size_t INGEST_BUFFER_BYTES = 256 * 1024;
+
+/*
+  The most buffers read but not yet parsed.
+*/
+const size_t INGEST_BUFFERS = 8;
+
+/*
+  The number of rows in each batch handed from the parser to the merger, and
+  the most batches parsed but not yet merged.
+*/
+const size_t INGEST_ROWS_PER_BATCH = 512;
+const size_t INGEST_BATCHES = 8;
+
+/*
+  The most imports whose reader and parser run on threads of their own at
+  once.
+*/
+const size_t INGEST_MAX_PIPELINES = 2;
+
+/*
+  A value of a dataset, as parsed: a measure of an area in a year, with the
+  area's English name and parent and the measure's label if the dataset has
+  them.
+*/
+struct IngestRow {
+	std::string code;
+	std::string name;
+	std::string measure;
+	std::string label;
+	std::string parent;
+	bool hasParent = false;
+	unsigned int year = 0;
+	double value = 0.0;
+};
+
+/*
+  What one stage of the pipeline did: the items it handled (bytes for the
+  reader, rows for the parser and merger), and the nanoseconds it spent
+  working and waiting for the stage before or after it.
+*/
+struct IngestStageStats {
+	uint64_t items = 0;
+	uint64_t busyNanos = 0;
+	uint64_t waitNanos = 0;
+
+	double utilisation() const noexcept;
+	IngestStageStats &operator+=(const IngestStageStats &other) noexcept;
+};
+
+struct IngestStats {
+	uint64_t imports = 0;
+	IngestStageStats reader;
+	IngestStageStats parser;
+	IngestStageStats merger;
+
+	IngestStats &operator+=(const IngestStats &other) noexcept;
+};
+
+/*
+  Parses one page of input, passing each row to emit, and returns the link to
+  the next page, or "" if there is none.
+*/
+using IngestParser = std::function<std::string(std::istream &page, const std::function<void(IngestRow &)> &emit)>;
+
+/*
+  Adds a row to the data.
+*/
+using IngestMerger = std::function<void(const IngestRow &row)>;
+
+IngestStats runIngestPipeline(std::istream &is,
+							  const PageResolver *resolver,
+							  const IngestParser &parse,
+							  const IngestMerger &merge);
+
+IngestStats ingestTotals();
+
+size_t ingestPipelinesRunning() noexcept;
+
+#endif // PIPELINE_H_
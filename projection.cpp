@@ -0,0 +1,473 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the implementation of the projected StatsWales JSON
+  reader. See the header file for additional comments.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "projection.h"
+
+namespace {
+
+/*
+  Reads a StatsWales JSON page straight from the buffer of a stream, a byte at
+  a time. The key and value buffers are reused for every key and value, so
+  once they have grown to the longest key and value, reading a key or skipping
+  a value allocates nothing.
+*/
+class ProjectedJSONReader {
+ private:
+	std::streambuf *buffer;
+	const JSONProjection &projection;
+	const std::function<void(nlohmann::json &)> *onRow;
+	size_t offset;
+	std::string key;
+	std::string value;
+
+	[[noreturn]] void fail(const std::string &expected) const {
+		throw std::runtime_error("Malformed JSON: expected " + expected + " at byte " + std::to_string(offset));
+	}
+
+	int peek() {
+		return buffer->sgetc();
+	}
+
+	int next() {
+		const int c = buffer->sbumpc();
+		if (c == std::char_traits<char>::eof()) {
+			fail("more data");
+		}
+		offset++;
+		return c;
+	}
+
+	int skipWhitespace() {
+		int c = peek();
+		while (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+			buffer->sbumpc();
+			offset++;
+			c = peek();
+		}
+		return c;
+	}
+
+	void expect(char expected) {
+		if (skipWhitespace() != expected) {
+			fail(std::string("'") + expected + "'");
+		}
+		next();
+	}
+
+	//append a code point to out as UTF-8.
+	static void appendUTF8(std::string &out, unsigned long code) {
+		if (code < 0x80) {
+			out += (char) code;
+		} else if (code < 0x800) {
+			out += (char) (0xC0 | (code >> 6));
+			out += (char) (0x80 | (code & 0x3F));
+		} else if (code < 0x10000) {
+			out += (char) (0xE0 | (code >> 12));
+			out += (char) (0x80 | ((code >> 6) & 0x3F));
+			out += (char) (0x80 | (code & 0x3F));
+		} else {
+			out += (char) (0xF0 | (code >> 18));
+			out += (char) (0x80 | ((code >> 12) & 0x3F));
+			out += (char) (0x80 | ((code >> 6) & 0x3F));
+			out += (char) (0x80 | (code & 0x3F));
+		}
+	}
+
+	unsigned long readHex4() {
+		char digits[5] = {0};
+		for (int i = 0; i < 4; i++) {
+			digits[i] = (char) next();
+			if (!std::isxdigit((unsigned char) digits[i])) {
+				fail("a hexadecimal digit");
+			}
+		}
+		return std::strtoul(digits, nullptr, 16);
+	}
+
+	//read a string into out, decoding any escapes.
+	void readString(std::string &out) {
+		expect('"');
+		out.clear();
+		for (;;) {
+			int c = next();
+			if (c == '"') {
+				return;
+			}
+			if (c != '\\') {
+				out += (char) c;
+				continue;
+			}
+
+			c = next();
+			switch (c) {
+				case '"':
+				case '\\':
+				case '/': out += (char) c;
+					break;
+				case 'b': out += '\b';
+					break;
+				case 'f': out += '\f';
+					break;
+				case 'n': out += '\n';
+					break;
+				case 'r': out += '\r';
+					break;
+				case 't': out += '\t';
+					break;
+				case 'u': {
+					unsigned long code = readHex4();
+					if (code >= 0xD800 && code <= 0xDBFF) {
+						if (next() != '\\' || next() != 'u') {
+							fail("a low surrogate");
+						}
+						const unsigned long low = readHex4();
+						if (low < 0xDC00 || low > 0xDFFF) {
+							fail("a low surrogate");
+						}
+						code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+					}
+					appendUTF8(out, code);
+					break;
+				}
+				default: fail("an escape sequence");
+			}
+		}
+	}
+
+	//step over a string without keeping it.
+	void skipString() {
+		next();
+		for (;;) {
+			const int c = next();
+			if (c == '"') {
+				return;
+			}
+			if (c == '\\') {
+				next();
+			}
+		}
+	}
+
+	//step over a number or a literal (true, false or null), copying it to out if given.
+	void readScalar(std::string *out) {
+		if (out != nullptr) {
+			out->clear();
+		}
+		int c = peek();
+		while (c != std::char_traits<char>::eof() && c != ',' && c != '}' && c != ']'
+			   && c != ' ' && c != '\n' && c != '\r' && c != '\t') {
+			if (out != nullptr) {
+				*out += (char) c;
+			}
+			next();
+			c = peek();
+		}
+	}
+
+	//step over any value, copying its text to out if given.
+	void skipValue(std::string *out) {
+		const int c = skipWhitespace();
+		if (c == '"' && out == nullptr) {
+			skipString();
+			return;
+		}
+		if (c != '{' && c != '[' && c != '"') {
+			readScalar(out);
+			return;
+		}
+
+		//an object or array (or a string to copy) ends at the matching bracket.
+		size_t depth = 0;
+		bool inString = false;
+		do {
+			const int d = next();
+			if (out != nullptr) {
+				*out += (char) d;
+			}
+			if (inString) {
+				if (d == '\\') {
+					const int escaped = next();
+					if (out != nullptr) {
+						*out += (char) escaped;
+					}
+				} else if (d == '"') {
+					inString = false;
+				}
+			} else if (d == '"') {
+				inString = true;
+			} else if (d == '{' || d == '[') {
+				depth++;
+			} else if (d == '}' || d == ']') {
+				depth--;
+			}
+		} while (depth > 0 || inString);
+	}
+
+	//read a value that is kept, with the same type nlohmann::json would give it.
+	nlohmann::json readValue() {
+		const int c = skipWhitespace();
+		if (c == '"') {
+			readString(value);
+			return nlohmann::json(value);
+		}
+		if (c == '{' || c == '[') {
+			value.clear();
+			skipValue(&value);
+			return nlohmann::json::parse(value);
+		}
+
+		readScalar(&value);
+		if (value == "true" || value == "false") {
+			return nlohmann::json(value == "true");
+		}
+		if (value == "null") {
+			return nlohmann::json();
+		}
+		if (value.empty()) {
+			fail("a value");
+		}
+
+		char *end = nullptr;
+		nlohmann::json number;
+		if (value.find_first_of(".eE") != std::string::npos) {
+			number = std::strtod(value.c_str(), &end);
+		} else if (value[0] == '-') {
+			number = (long long) std::strtoll(value.c_str(), &end, 10);
+		} else {
+			number = (unsigned long long) std::strtoull(value.c_str(), &end, 10);
+		}
+		if (end != value.c_str() + value.size()) {
+			fail("a number");
+		}
+		return number;
+	}
+
+	//read the projected keys of a row.
+	nlohmann::json readRow() {
+		nlohmann::json row = nlohmann::json::object();
+		expect('{');
+		if (skipWhitespace() == '}') {
+			next();
+			return row;
+		}
+
+		for (;;) {
+			readString(key);
+			expect(':');
+			if (projection.contains(key)) {
+				row[key] = readValue();
+			} else {
+				skipValue(nullptr);
+			}
+
+			const int c = skipWhitespace();
+			next();
+			if (c == '}') {
+				return row;
+			}
+			if (c != ',') {
+				fail("',' or '}'");
+			}
+		}
+	}
+
+	nlohmann::json readRows() {
+		nlohmann::json rows = nlohmann::json::array();
+		expect('[');
+		if (skipWhitespace() == ']') {
+			next();
+			return rows;
+		}
+
+		for (;;) {
+			if (onRow != nullptr) {
+				nlohmann::json row = readRow();
+				(*onRow)(row);
+			} else {
+				rows.push_back(readRow());
+			}
+			const int c = skipWhitespace();
+			next();
+			if (c == ']') {
+				return rows;
+			}
+			if (c != ',') {
+				fail("',' or ']'");
+			}
+		}
+	}
+
+ public:
+	ProjectedJSONReader(std::istream &is,
+						const JSONProjection &projection,
+						const std::function<void(nlohmann::json &)> *onRow = nullptr)
+		: buffer(is.rdbuf()), projection(projection), onRow(onRow), offset(0) {
+		if (buffer == nullptr) {
+			throw std::runtime_error("Malformed JSON: there is no input");
+		}
+	}
+
+	nlohmann::json readPage() {
+		nlohmann::json page = nlohmann::json::object();
+		expect('{');
+		if (skipWhitespace() == '}') {
+			next();
+			return page;
+		}
+
+		for (;;) {
+			readString(key);
+			expect(':');
+			if (key == "value") {
+				page["value"] = readRows();
+			} else if (key == "odata.nextLink") {
+				page[key] = readValue();
+			} else {
+				skipValue(nullptr);
+			}
+
+			const int c = skipWhitespace();
+			next();
+			if (c == '}') {
+				return page;
+			}
+			if (c != ',') {
+				fail("',' or '}'");
+			}
+		}
+	}
+};
+
+} // namespace
+
+/**
+  Constructor for the projection of the columns an import reads.
+
+  @param cols
+    A map of the enum BethYw::SourceColumnMapping (see datasets.h) to strings
+    that give the column header in the JSON file
+
+  @example
+    JSONProjection projection(BethYw::InputFiles::POPDEN.COLS);
+*/
+JSONProjection::JSONProjection(const BethYw::SourceColumnMapping &cols) {
+	for (const auto &it : cols) {
+		if (it.first == BethYw::SINGLE_MEASURE_CODE || it.first == BethYw::SINGLE_MEASURE_NAME) {
+			continue;
+		}
+		if (std::find(keys.begin(), keys.end(), it.second) == keys.end()) {
+			keys.push_back(it.second);
+		}
+	}
+}
+
+/**
+  @param key
+    A key of a row
+
+  @return
+    true if the key is read by the import
+*/
+bool JSONProjection::contains(const std::string &key) const noexcept {
+	for (const auto &it : keys) {
+		if (it == key) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+  @return
+    The number of keys read by the import
+*/
+size_t JSONProjection::size() const noexcept {
+	return keys.size();
+}
+
+/**
+  Read a page of a StatsWales JSON dataset, keeping only its rows (with only
+  the projected keys) and its odata.nextLink. Everything else is stepped over
+  without being stored. Values keep the types nlohmann::json gives them, e.g.
+  a year of "2015" is still a string and 95.7 is still a double.
+
+  @param is
+    The input stream of the page
+
+  @param projection
+    The keys to keep in each row
+
+  @return
+    The page, as {"value": [...], "odata.nextLink": "..."}
+
+  @throws
+    std::runtime_error if the page is not valid JSON
+
+  @example
+    InputFile input("datasets/popu1009.json");
+    JSONProjection projection(BethYw::InputFiles::POPDEN.COLS);
+    nlohmann::json page = parseProjectedWelshStatsJSON(input.open(), projection);
+*/
+nlohmann::json parseProjectedWelshStatsJSON(std::istream &is, const JSONProjection &projection) {
+	try {
+		return ProjectedJSONReader(is, projection).readPage();
+	} catch (nlohmann::json::exception &e) {
+		throw std::runtime_error(std::string("Malformed JSON: ") + e.what());
+	}
+}
+
+/**
+  Read a page of a StatsWales JSON dataset as parseProjectedWelshStatsJSON()
+  does, but pass each row to `onRow` as it is read instead of keeping it, so
+  the rows of a large page can be used while the rest is still being read.
+
+  @param is
+    The input stream of the page
+
+  @param projection
+    The keys to keep in each row
+
+  @param onRow
+    Called with each row, with only the projected keys, in order
+
+  @return
+    The page's odata.nextLink, or "" if it has none
+
+  @throws
+    std::runtime_error if the page is not valid JSON, along with anything
+    thrown by onRow
+
+  @example
+    std::string link = parseProjectedWelshStatsJSON(is, projection, [](nlohmann::json &row) {
+      std::cout << row["Data"] << std::endl;
+    });
+*/
+std::string parseProjectedWelshStatsJSON(std::istream &is,
+										 const JSONProjection &projection,
+										 const std::function<void(nlohmann::json &)> &onRow) {
+	nlohmann::json page;
+	try {
+		page = ProjectedJSONReader(is, projection, &onRow).readPage();
+	} catch (nlohmann::json::exception &e) {
+		throw std::runtime_error(std::string("Malformed JSON: ") + e.what());
+	}
+
+	auto link = page.find("odata.nextLink");
+	if (link == page.end() || !link->is_string()) {
+		return "";
+	}
+	return link->get<std::string>();
+}
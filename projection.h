@@ -0,0 +1,55 @@
+#ifndef PROJECTION_H_
+#define PROJECTION_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains declarations for reading StatsWales JSON with a column
+  projection. Each row of a StatsWales dataset has around 15 keys (e.g.
+  Localauthority_SortOrder, Measure_ItemNotes_ENG, RowKey), of which an
+  import uses only the five to seven named in the dataset's
+  SourceColumnMapping. Rather than building a DOM of every key, the reader
+  compares each key against the projection as it is read and steps over the
+  bytes of any value that is not needed, so nothing is allocated for it.
+
+  The result is a nlohmann::json page with the same shape as the file, i.e.
+  {"value": [...], "odata.nextLink": "..."}, whose rows hold only the
+  projected keys, so it can be merged in the same way as a fully parsed page.
+  Alternatively, each row can be handed on as soon as it is read, rather than
+  the whole page being kept.
+ */
+
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "lib_json.hpp"
+#include "datasets.h"
+
+/*
+  The keys of a StatsWales JSON row that an import reads: the columns of a
+  SourceColumnMapping, other than the code and name of a single measure,
+  which are not columns.
+*/
+class JSONProjection {
+ private:
+	std::vector<std::string> keys;
+
+ public:
+	explicit JSONProjection(const BethYw::SourceColumnMapping &cols);
+	bool contains(const std::string &key) const noexcept;
+	size_t size() const noexcept;
+};
+
+nlohmann::json parseProjectedWelshStatsJSON(std::istream &is, const JSONProjection &projection);
+
+std::string parseProjectedWelshStatsJSON(std::istream &is,
+										 const JSONProjection &projection,
+										 const std::function<void(nlohmann::json &)> &onRow);
+
+#endif // PROJECTION_H_
@@ -0,0 +1,586 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the implementation of the quantile sketches. See the
+  header file for additional comments.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+
+#include "lib_json.hpp"
+#include "areas.h"
+#include "quantile.h"
+
+#define REGEX_QUANTILE "^([0-9]{1,3}(\\.[0-9]+)?)$"
+
+//each compactor holds 2/3 as many values as the one above it.
+static const double COMPACTOR_RATIO = 2.0 / 3.0;
+
+/**
+  Constructor for an empty sketch.
+
+  @param k
+    The number of values the largest compactor holds, or 0 to keep every
+    value so that the quantiles are exact
+
+  @example
+    QuantileSketch sketch;
+    sketch.add(1.0);
+    ...
+    double median = sketch.quantile(0.5);
+*/
+QuantileSketch::QuantileSketch(size_t k)
+	: k(k), retained(0), max_size(0), n(0), coin(0x5eed), ranked(false) {
+	grow();
+}
+
+/**
+  @param level
+    The level of a compactor
+
+  @return
+    The number of values the compactor can hold before it is compacted
+*/
+size_t QuantileSketch::capacity(size_t level) const noexcept {
+	const size_t depth = compactors.size() - 1 - level;
+	return std::max<size_t>(2, (size_t) std::ceil(k * std::pow(COMPACTOR_RATIO, (double) depth)) + 1);
+}
+
+/**
+  Add a compactor above the others.
+*/
+void QuantileSketch::grow() {
+	compactors.emplace_back();
+	max_size = 0;
+	for (size_t level = 0; level < compactors.size(); level++) {
+		max_size += capacity(level);
+	}
+}
+
+/**
+  Compact the lowest compactors that are full until the sketch holds no more
+  than it can: each is sorted, and every other value is promoted to the
+  compactor above, leaving the odd one out (if any) behind.
+*/
+void QuantileSketch::compress() {
+	for (size_t level = 0; level < compactors.size(); level++) {
+		if (compactors[level].size() < capacity(level)) {
+			continue;
+		}
+		if (level + 1 >= compactors.size()) {
+			grow();
+		}
+
+		auto &compactor = compactors[level];
+		auto &above = compactors[level + 1];
+		std::sort(compactor.begin(), compactor.end());
+
+		const size_t pairs = compactor.size() / 2;
+		const size_t offset = coin() & 1;
+		for (size_t i = 0; i < pairs; i++) {
+			above.push_back(compactor[2 * i + offset]);
+		}
+
+		//the odd one out is the last value, which is kept at this level.
+		if (compactor.size() % 2 == 1) {
+			compactor[0] = compactor.back();
+			compactor.resize(1);
+		} else {
+			compactor.clear();
+		}
+		retained -= pairs;
+
+		if (retained < max_size) {
+			break;
+		}
+	}
+}
+
+/**
+  Add a value to the sketch. Values that are not finite are ignored.
+
+  @param value
+    The value
+*/
+void QuantileSketch::add(double value) {
+	if (!std::isfinite(value)) {
+		return;
+	}
+
+	compactors[0].push_back(value);
+	retained++;
+	n++;
+	ranked = false;
+
+	if (k > 0 && retained >= max_size) {
+		compress();
+	}
+}
+
+/**
+  Merge another sketch into this one, so that this sketch is of the values
+  added to either. If either sketch is not exact, the result is not either.
+
+  @param other
+    The other sketch
+
+  @example
+    QuantileSketch left, right;
+    ...
+    left.merge(right);
+*/
+void QuantileSketch::merge(const QuantileSketch &other) {
+	while (compactors.size() < other.compactors.size()) {
+		grow();
+	}
+	for (size_t level = 0; level < other.compactors.size(); level++) {
+		compactors[level].insert(compactors[level].end(),
+								 other.compactors[level].begin(),
+								 other.compactors[level].end());
+	}
+	retained += other.retained;
+	n += other.n;
+	ranked = false;
+
+	if (k > 0) {
+		while (retained >= max_size) {
+			const size_t before = retained;
+			compress();
+			if (retained == before) {
+				break;
+			}
+		}
+	}
+}
+
+/**
+  @return
+    The number of values added to the sketch (or the sketches merged into it)
+*/
+uint64_t QuantileSketch::count() const noexcept {
+	return n;
+}
+
+/**
+  @return
+    The number of values the sketch holds
+*/
+size_t QuantileSketch::retainedCount() const noexcept {
+	return retained;
+}
+
+/**
+  @return
+    true if the sketch still holds every value added to it, so that its
+    quantiles are exact
+*/
+bool QuantileSketch::isExact() const noexcept {
+	return retained == n;
+}
+
+/**
+  Sort the values the sketch holds, with the weight up to and including each.
+
+  @return
+    The sorted values and weights
+*/
+std::vector<std::pair<double, double>> QuantileSketch::sortRanks() const {
+	std::vector<std::pair<double, double>> sorted;
+	sorted.reserve(retained);
+	double weight = 1.0;
+	for (const auto &compactor : compactors) {
+		for (const auto &value : compactor) {
+			sorted.emplace_back(value, weight);
+		}
+		weight *= 2.0;
+	}
+	std::sort(sorted.begin(), sorted.end());
+	double total = 0.0;
+	for (auto &rank : sorted) {
+		total += rank.second;
+		rank.second = total;
+	}
+	return sorted;
+}
+
+/**
+  Sort the values the sketch holds, if they have changed since they were
+  last sorted, so that quantile() is a binary search.
+
+  @example
+    sketch.rank();
+    double p90 = sketch.quantile(0.9);
+*/
+void QuantileSketch::rank() {
+	if (!ranked) {
+		ranks = sortRanks();
+		ranked = true;
+	}
+}
+
+/**
+  @return
+    true if the values have been sorted since the sketch last changed (see
+    rank())
+*/
+bool QuantileSketch::isRanked() const noexcept {
+	return ranked;
+}
+
+/**
+  Find a quantile of the values: the smallest value that at least a
+  proportion q of the values are less than or equal to (so the median of an
+  even number of values is the lower of the middle two). This changes
+  nothing, so it can be called on several threads at once; if the sketch has
+  not been ranked since it changed (see rank()), the values are sorted for
+  this call alone.
+
+  @param q
+    The quantile, from 0 (the smallest value) to 1 (the largest)
+
+  @return
+    The value, or NaN if the sketch is empty
+
+  @throws
+    std::out_of_range if q is not between 0 and 1
+
+  @example
+    double p90 = sketch.quantile(0.9);
+*/
+double QuantileSketch::quantile(double q) const {
+	if (!(q >= 0.0 && q <= 1.0)) {
+		throw std::out_of_range("QuantileSketch::quantile: " + std::to_string(q) + " is not between 0 and 1");
+	}
+	if (n == 0) {
+		return std::numeric_limits<double>::quiet_NaN();
+	}
+
+	std::vector<std::pair<double, double>> unranked;
+	if (!ranked) {
+		unranked = sortRanks();
+	}
+	const std::vector<std::pair<double, double>> &sorted = ranked ? ranks : unranked;
+
+	const double target = std::max(1.0, std::ceil(q * sorted.back().second));
+	auto it = std::lower_bound(sorted.begin(), sorted.end(), target,
+							   [](const std::pair<double, double> &rank, double target) {
+								   return rank.second < target;
+							   });
+	return it != sorted.end() ? it->first : sorted.back().first;
+}
+
+/**
+  Constructor for an index with quantiles disabled, which ignores every value
+  it is given until enable() is called.
+*/
+QuantileIndex::QuantileIndex() : enabled(false), k(QUANTILE_SKETCH_K) {}
+
+/**
+  Start keeping sketches of the values added from now on.
+
+  @param k
+    The k of each sketch (see QuantileSketch), or 0 for exact quantiles
+*/
+void QuantileIndex::enable(size_t k) noexcept {
+	enabled = true;
+	this->k = k;
+}
+
+/**
+  @return
+    true if the index keeps sketches
+*/
+bool QuantileIndex::isEnabled() const noexcept {
+	return enabled;
+}
+
+/**
+  @return
+    The k of each sketch
+*/
+size_t QuantileIndex::getK() const noexcept {
+	return k;
+}
+
+/**
+  Add a value to the sketch of a measure and year.
+
+  @param measure
+    The code of the measure
+
+  @param year
+    The year
+
+  @param value
+    The value
+*/
+void QuantileIndex::add(const std::string &measure, unsigned int year, double value) {
+	if (!enabled) {
+		return;
+	}
+	Key key(measure, year);
+	if (stale.count(key) != 0) {
+		return;
+	}
+	sketches.emplace(key, QuantileSketch(k)).first->second.add(value);
+}
+
+/**
+  Mark the sketch of a measure and year as stale, after one of its values
+  changed or was removed.
+
+  @param measure
+    The code of the measure
+
+  @param year
+    The year
+*/
+void QuantileIndex::invalidate(const std::string &measure, unsigned int year) {
+	if (!enabled) {
+		return;
+	}
+	Key key(measure, year);
+	sketches.erase(key);
+	stale.insert(key);
+}
+
+/**
+  Mark the sketches of every year of a measure as stale.
+
+  @param measure
+    The code of the measure
+*/
+void QuantileIndex::invalidateMeasure(const std::string &measure) {
+	if (!enabled) {
+		return;
+	}
+	auto it = sketches.lower_bound(Key(measure, 0));
+	while (it != sketches.end() && it->first.first == measure) {
+		stale.insert(it->first);
+		it = sketches.erase(it);
+	}
+}
+
+/**
+  @return
+    The measures and years whose sketches need building again
+*/
+const std::set<QuantileIndex::Key>& QuantileIndex::getStale() const noexcept {
+	return stale;
+}
+
+/**
+  Rank every sketch that has changed since it was last ranked (see
+  QuantileSketch::rank()), so that asking the sketches for quantiles changes
+  nothing.
+*/
+void QuantileIndex::rank() {
+	for (auto &it : sketches) {
+		it.second.rank();
+	}
+}
+
+/**
+  Replace the (stale) sketch of a measure and year with one built again.
+
+  @param measure
+    The code of the measure
+
+  @param year
+    The year
+
+  @param sketch
+    The sketch, which is dropped if it is empty
+*/
+void QuantileIndex::replace(const std::string &measure, unsigned int year, const QuantileSketch &sketch) {
+	Key key(measure, year);
+	stale.erase(key);
+	sketches.erase(key);
+	if (sketch.count() > 0) {
+		sketches.emplace(key, sketch);
+	}
+}
+
+/**
+  @return
+    The sketches, keyed by measure code and year, not including stale ones
+*/
+const std::map<QuantileIndex::Key, QuantileSketch>& QuantileIndex::getSketches() const noexcept {
+	return sketches;
+}
+
+/**
+  @param measure
+    The code of the measure
+
+  @param year
+    The year
+
+  @return
+    The sketch of the measure and year, or nullptr if there is none (or it
+    is stale)
+*/
+const QuantileSketch* QuantileIndex::find(const std::string &measure, unsigned int year) const {
+	auto it = sketches.find(Key(measure, year));
+	return it != sketches.end() ? &it->second : nullptr;
+}
+
+/**
+  Parse a comma-separated list of percentiles, e.g. "50,90,99.9".
+
+  @param list
+    The list, as given to --quantiles
+
+  @return
+    The quantiles, as proportions from 0 to 1, in the order they were given
+
+  @throws
+    std::invalid_argument if a percentile is not a number from 0 to 100, with
+    the message: Invalid input for quantiles argument: <percentile>
+
+  @example
+    auto quantiles = parseQuantiles("50,90"); // returns {0.5, 0.9}
+*/
+std::vector<double> parseQuantiles(const std::string &list) {
+	std::vector<double> quantiles;
+	std::regex percentile (REGEX_QUANTILE);
+	std::stringstream stream(list);
+	std::string item;
+
+	while (std::getline(stream, item, ',')) {
+		if (!std::regex_match(item, percentile) || std::stod(item) > 100.0) {
+			throw std::invalid_argument("Invalid input for quantiles argument: " + item);
+		}
+		quantiles.push_back(std::stod(item) / 100.0);
+	}
+	if (quantiles.empty()) {
+		throw std::invalid_argument("Invalid input for quantiles argument: " + list);
+	}
+
+	return quantiles;
+}
+
+namespace {
+
+/*
+  The name of a quantile's column, e.g. p50 or p99.9.
+*/
+std::string quantileName(double q) {
+	std::ostringstream name;
+	name << "p" << std::setprecision(6) << q * 100.0;
+	return name.str();
+}
+
+/*
+  The label of each measure in an Areas instance.
+*/
+std::map<std::string, std::string> measureLabels(const Areas &areas) {
+	std::map<std::string, std::string> labels;
+	for (const auto &area : areas) {
+		for (const auto &measure : area.second.getMeasures()) {
+			labels.emplace(measure.first, measure.second.getLabel());
+		}
+	}
+	return labels;
+}
+
+} // namespace
+
+/**
+  Print the quantiles of each measure in each year across the areas, one
+  table per measure. Years whose quantiles come from a sketch that no longer
+  holds every value, so are approximate, are marked with a ~.
+
+  @param os
+    The output stream to print to
+
+  @param areas
+    The Areas instance, with quantiles enabled
+
+  @param quantiles
+    The quantiles to print, as proportions from 0 to 1
+
+  @example
+    printQuantiles(std::cout, data, {0.5, 0.9});
+*/
+void printQuantiles(std::ostream &os, const Areas &areas, const std::vector<double> &quantiles) {
+	const auto &sketches = areas.getQuantiles().getSketches();
+	const auto labels = measureLabels(areas);
+
+	std::string current;
+	for (const auto &it : sketches) {
+		const std::string &measure = it.first.first;
+		const QuantileSketch &sketch = it.second;
+		if (!areas.isMeasureInView(measure)) {
+			continue;
+		}
+
+		if (measure != current) {
+			if (!current.empty()) {
+				os << std::endl;
+			}
+			current = measure;
+			auto label = labels.find(measure);
+			os << (label != labels.end() ? label->second : measure) << " (" << measure << ")" << std::endl;
+			os << std::setw(5) << "Year" << " " << std::setw(7) << "Areas";
+			for (const auto &q : quantiles) {
+				os << " " << std::setw(16) << quantileName(q);
+			}
+			os << std::endl;
+		}
+
+		os << std::setw(5) << it.first.second << " " << std::setw(7) << sketch.count();
+		for (const auto &q : quantiles) {
+			os << " " << std::setw(16) << std::fixed << std::setprecision(6) << sketch.quantile(q);
+		}
+		os << (sketch.isExact() ? "" : " ~") << std::endl;
+	}
+	os << std::endl;
+}
+
+/**
+  The quantiles of each measure in each year across the areas as JSON, e.g.
+
+    {"dens":{"2019":{"areas":22,"exact":true,"p50":212.7,"p90":1001.4}}}
+
+  @param areas
+    The Areas instance, with quantiles enabled
+
+  @param quantiles
+    The quantiles, as proportions from 0 to 1
+
+  @return
+    The JSON, as a string
+
+  @example
+    std::cout << quantilesToJSON(data, {0.5, 0.9});
+*/
+std::string quantilesToJSON(const Areas &areas, const std::vector<double> &quantiles) {
+	nlohmann::json j = nlohmann::json::object();
+
+	for (const auto &it : areas.getQuantiles().getSketches()) {
+		const QuantileSketch &sketch = it.second;
+		if (!areas.isMeasureInView(it.first.first)) {
+			continue;
+		}
+		nlohmann::json year;
+		year["areas"] = sketch.count();
+		year["exact"] = sketch.isExact();
+		for (const auto &q : quantiles) {
+			year[quantileName(q)] = sketch.quantile(q);
+		}
+		j[it.first.first][std::to_string(it.first.second)] = year;
+	}
+
+	return j.dump();
+}
@@ -0,0 +1,118 @@
+#ifndef QUANTILE_H_
+#define QUANTILE_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains declarations for quantiles of a measure across areas,
+  e.g. the median population density of the local authorities in 2010.
+
+  The values of each measure in each year go into a QuantileSketch, a KLL
+  sketch (Karnin, Lang and Liberty, "Optimal Quantile Approximation in
+  Streams"): a stack of compactors, each holding values that stand for 2^h of
+  the values added. When the sketch is full, a compactor is sorted and every
+  other value (starting at random from the first or second) is promoted to the
+  compactor above, so a sketch of n values holds O(k log(n / k)) of them and a
+  quantile's rank is out by about n / k at most. Two sketches are merged by
+  merging their compactors, so sketches built over separate parts of the data
+  (e.g. on separate threads) can be combined. Until the first compaction,
+  which only happens after k values, a sketch holds every value and its
+  quantiles are exact; a sketch with k = 0 is always exact.
+
+  An Areas instance with quantiles enabled (see Areas::enableQuantiles()) adds
+  each value to the sketch of its measure and year as it is imported. A
+  sketch cannot take a value out, so one whose values are changed or removed
+  is marked stale and built again from the data the next time it is asked
+  for. When the sketches are asked for, the values in each are also sorted
+  (ranked) once, so each quantile is a binary search over at most a few
+  thousand values whatever the number of areas, and asking for a quantile
+  changes nothing, so any number of threads can do it at once.
+ */
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+class Areas;
+
+/*
+  The number of values the largest compactor holds by default, which keeps
+  the error of a rank under about 1% of the number of values.
+*/
+const size_t QUANTILE_SKETCH_K = 200;
+
+class QuantileSketch {
+ private:
+	size_t k;
+	std::vector<std::vector<double>> compactors;
+	size_t retained;
+	size_t max_size;
+	uint64_t n;
+	std::minstd_rand coin;
+
+	//the retained values, sorted, with the weight up to and including each.
+	std::vector<std::pair<double, double>> ranks;
+	bool ranked;
+
+	size_t capacity(size_t level) const noexcept;
+	void grow();
+	void compress();
+	std::vector<std::pair<double, double>> sortRanks() const;
+
+ public:
+	explicit QuantileSketch(size_t k = QUANTILE_SKETCH_K);
+	void add(double value);
+	void merge(const QuantileSketch &other);
+	uint64_t count() const noexcept;
+	size_t retainedCount() const noexcept;
+	bool isExact() const noexcept;
+	void rank();
+	bool isRanked() const noexcept;
+	double quantile(double q) const;
+};
+
+/*
+  The sketches of an Areas instance, one per measure and year.
+*/
+class QuantileIndex {
+ private:
+	using Key = std::pair<std::string, unsigned int>;
+
+	bool enabled;
+	size_t k;
+	std::map<Key, QuantileSketch> sketches;
+	std::set<Key> stale;
+
+ public:
+	QuantileIndex();
+	void enable(size_t k = QUANTILE_SKETCH_K) noexcept;
+	bool isEnabled() const noexcept;
+	size_t getK() const noexcept;
+
+	void add(const std::string &measure, unsigned int year, double value);
+	void invalidate(const std::string &measure, unsigned int year);
+	void invalidateMeasure(const std::string &measure);
+
+	const std::set<Key>& getStale() const noexcept;
+	void rank();
+	void replace(const std::string &measure, unsigned int year, const QuantileSketch &sketch);
+	const std::map<Key, QuantileSketch>& getSketches() const noexcept;
+	const QuantileSketch* find(const std::string &measure, unsigned int year) const;
+};
+
+std::vector<double> parseQuantiles(const std::string &list);
+
+void printQuantiles(std::ostream &os, const Areas &areas, const std::vector<double> &quantiles);
+
+std::string quantilesToJSON(const Areas &areas, const std::vector<double> &quantiles);
+
+#endif // QUANTILE_H_
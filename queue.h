@@ -0,0 +1,232 @@
+#ifndef QUEUE_H_
+#define QUEUE_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the queues used to hand work between threads, e.g.
+  between the reader, parser and merger stages of the import pipeline (see
+  pipeline.h).
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+  A bounded first-in first-out queue. push() blocks while the queue is full
+  and pop() blocks while it is empty, so a fast producer can only get
+  `capacity` items ahead of its consumer. Once close() has been called, push()
+  discards items and pop() returns false when nothing is left.
+*/
+template <typename T>
+class BlockingQueue {
+ private:
+	const size_t capacity;
+	std::deque<T> items;
+	bool closed = false;
+	std::mutex mutex;
+	std::condition_variable not_empty;
+	std::condition_variable not_full;
+
+ public:
+	explicit BlockingQueue(size_t capacity) : capacity(capacity > 0 ? capacity : 1) {}
+
+	/*
+	  Add an item to the back of the queue, waiting for space if necessary.
+	  Returns false (and drops the item) if the queue has been closed.
+	*/
+	bool push(T item) {
+		std::unique_lock<std::mutex> lock(mutex);
+		not_full.wait(lock, [this] { return closed || items.size() < capacity; });
+		if (closed) {
+			return false;
+		}
+		items.push_back(std::move(item));
+		not_empty.notify_one();
+		return true;
+	}
+
+	/*
+	  Take the item at the front of the queue, waiting for one if necessary.
+	  Returns false if the queue is closed and empty.
+	*/
+	bool pop(T &item) {
+		std::unique_lock<std::mutex> lock(mutex);
+		not_empty.wait(lock, [this] { return closed || !items.empty(); });
+		if (items.empty()) {
+			return false;
+		}
+		item = std::move(items.front());
+		items.pop_front();
+		not_full.notify_one();
+		return true;
+	}
+
+	/*
+	  Stop accepting items and wake every waiting thread.
+	*/
+	void close() {
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		not_empty.notify_all();
+		not_full.notify_all();
+	}
+};
+
+/*
+  A bounded first-in first-out queue between exactly one producing thread and
+  one consuming thread, e.g. two stages of an import (see pipeline.h). Items
+  are kept in a ring of `capacity` slots, and the producer and consumer each
+  advance their own index of it, so push() and pop() take no lock unless the
+  queue is full or empty. Then the thread waits (which is backpressure, for
+  the producer) until the other makes room or adds an item, and the time it
+  spends waiting is counted. Once close() has been called, push() discards
+  items and pop() returns false when nothing is left.
+*/
+template <typename T>
+class SPSCQueue {
+ private:
+	std::vector<T> slots;
+
+	//the number of items pushed and popped, each written by one thread and kept on its own cache line.
+	std::atomic<size_t> pushed;
+	char pushed_padding[64];
+	std::atomic<size_t> popped;
+	char popped_padding[64];
+
+	std::atomic<bool> closed;
+	std::atomic<int> waiting;
+	std::mutex mutex;
+	std::condition_variable changed;
+
+	uint64_t producer_wait_nanos = 0;
+	uint64_t consumer_wait_nanos = 0;
+
+	template <typename Predicate>
+	void waitUntil(Predicate ready, uint64_t &nanos) {
+		//the other thread is usually about to catch up, so give it a moment before sleeping.
+		for (int i = 0; i < 16; i++) {
+			if (ready()) {
+				return;
+			}
+			std::this_thread::yield();
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		{
+			//the other thread checks waiting after moving its index, and this one counts itself in before
+			//checking the index, so one of them sees the other.
+			std::unique_lock<std::mutex> lock(mutex);
+			waiting++;
+			changed.wait(lock, ready);
+			waiting--;
+		}
+		nanos += (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start).count();
+	}
+
+	void wake() {
+		if (waiting.load() != 0) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+			}
+			changed.notify_all();
+		}
+	}
+
+ public:
+	explicit SPSCQueue(size_t capacity)
+		: slots(capacity > 0 ? capacity : 1), pushed(0), popped(0), closed(false), waiting(0) {}
+
+	SPSCQueue(const SPSCQueue &other) = delete;
+	SPSCQueue &operator=(const SPSCQueue &other) = delete;
+
+	/*
+	  Add an item to the back of the queue, waiting for space if necessary.
+	  Returns false (and drops the item) if the queue has been closed. Only
+	  the producer may call this.
+	*/
+	bool push(T item) {
+		const size_t back = pushed.load(std::memory_order_relaxed);
+		if (back - popped.load() == slots.size()) {
+			waitUntil([this, back]() {
+				return closed.load() || back - popped.load() < slots.size();
+			}, producer_wait_nanos);
+		}
+		if (closed.load()) {
+			return false;
+		}
+
+		slots[back % slots.size()] = std::move(item);
+		pushed.store(back + 1);
+		wake();
+		return true;
+	}
+
+	/*
+	  Take the item at the front of the queue, waiting for one if necessary.
+	  Returns false if the queue is closed and empty. Only the consumer may
+	  call this.
+	*/
+	bool pop(T &item) {
+		const size_t front = popped.load(std::memory_order_relaxed);
+		if (pushed.load() == front) {
+			waitUntil([this, front]() {
+				return closed.load() || pushed.load() != front;
+			}, consumer_wait_nanos);
+			if (pushed.load() == front) {
+				return false;
+			}
+		}
+
+		item = std::move(slots[front % slots.size()]);
+		popped.store(front + 1);
+		wake();
+		return true;
+	}
+
+	/*
+	  Stop accepting items and wake both threads.
+	*/
+	void close() {
+		closed.store(true);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+		}
+		changed.notify_all();
+	}
+
+	/*
+	  The number of items pushed so far.
+	*/
+	size_t pushedCount() const noexcept {
+		return pushed.load();
+	}
+
+	/*
+	  The nanoseconds the producer has spent waiting for space, and the
+	  consumer has spent waiting for items. Each is only up to date on the
+	  thread that waits, or once that thread has been joined.
+	*/
+	uint64_t producerWaitNanos() const noexcept {
+		return producer_wait_nanos;
+	}
+
+	uint64_t consumerWaitNanos() const noexcept {
+		return consumer_wait_nanos;
+	}
+};
+
+#endif // QUEUE_H_
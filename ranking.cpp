@@ -0,0 +1,311 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the implementation of the ranking query. See the header
+  file for additional comments.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iterator>
+#include <queue>
+#include <sstream>
+
+#include "lib_json.hpp"
+#include "ranking.h"
+
+namespace {
+
+/*
+  An area while the areas are being ranked. The code is the key in the Areas
+  instance, so it does not need to be copied until the area is in the result.
+*/
+struct Candidate {
+	const std::string *code;
+	const Area *area;
+	double value;
+};
+
+/*
+  Calculate the statistic a query ranks by for the values of a measure in the
+  years that are output (see Areas::setYearView()).
+
+  @param values
+    A view of the Measure's values
+
+  @param query
+    The ranking query
+
+  @param value
+    Set to the statistic, if it can be calculated
+
+  @return
+    False if the measure has no value for the year, or too few years for a
+    difference, or the statistic is not a finite number
+*/
+bool rankValue(const MeasureRange &values, const RankingQuery &query, double &value) {
+	switch (query.statistic) {
+		case RankByValue: {
+			const MeasureRange year = values.getValues(query.year, query.year);
+			if (year.empty()) {
+				return false;
+			}
+			value = year.begin()->second;
+			break;
+		}
+		//a difference over a single year is always 0, which would only crowd out real changes.
+		case RankByDifference:
+			if (values.empty() || std::next(values.begin()) == values.end()) {
+				return false;
+			}
+			value = values.getDifference();
+			break;
+		case RankByPercentage:
+			if (values.empty() || std::next(values.begin()) == values.end()) {
+				return false;
+			}
+			value = values.getDifferenceAsPercentage();
+			break;
+		case RankByAverage:
+			if (values.empty()) {
+				return false;
+			}
+			value = values.getAverage();
+			break;
+	}
+
+	return std::isfinite(value);
+}
+
+/*
+  Print the names of an Area the way the tables do, e.g. "Swansea / Abertawe".
+*/
+void printAreaName(std::ostream &os, const Area &area) {
+	const AreaNames &names = area.getNames();
+	auto eng = names.find("eng");
+	auto cym = names.find("cym");
+
+	if (eng != names.end()) {
+		os << eng->second;
+		if (cym != names.end()) {
+			os << " / " << cym->second;
+		}
+	} else if (cym != names.end()) {
+		os << cym->second;
+	} else {
+		os << "Unnamed";
+	}
+}
+
+} // namespace
+
+/**
+  Find the k areas with the highest (or lowest) statistic for a measure.
+  Areas without the measure, or for which the statistic cannot be calculated,
+  are left out. Areas with the same value are ordered by their local authority
+  code.
+
+  @param areas
+    The Areas instance to rank
+
+  @param query
+    The ranking query
+
+  @return
+    Up to query.k areas, best first
+
+  @example
+    RankingQuery query;
+    query.k = 5;
+    query.measure = "pop";
+    query.year = 2019;
+    auto top = rankAreas(areas, query);
+*/
+std::vector<RankedArea> rankAreas(const Areas &areas, const RankingQuery &query) {
+	std::vector<RankedArea> ranking;
+	if (query.k == 0) {
+		return ranking;
+	}
+
+	const bool descending = query.descending;
+	auto better = [descending](const Candidate &a, const Candidate &b) {
+		if (a.value != b.value) {
+			return descending ? a.value > b.value : a.value < b.value;
+		}
+		return *a.code < *b.code;
+	};
+
+	//ordered by better, the top of the heap is the worst area kept so far, the one to drop next.
+	std::vector<Candidate> storage;
+	storage.reserve(std::min<size_t>(query.k, (size_t) areas.size()) + 1);
+	std::priority_queue<Candidate, std::vector<Candidate>, decltype(better)> heap(better, std::move(storage));
+
+	for (const auto &entry : areas) {
+		const AreaMeasures &measures = entry.second.getMeasures();
+		auto measure = measures.find(query.measure);
+		if (measure == measures.end()) {
+			continue;
+		}
+
+		Candidate candidate {&entry.first, &entry.second, 0.0};
+		if (!rankValue(areas.getValues(measure->second), query, candidate.value)) {
+			continue;
+		}
+
+		if (heap.size() < query.k) {
+			heap.push(candidate);
+		} else if (better(candidate, heap.top())) {
+			heap.pop();
+			heap.push(candidate);
+		}
+	}
+
+	ranking.resize(heap.size());
+	for (auto it = ranking.rbegin(); it != ranking.rend(); it++) {
+		const Candidate &worst = heap.top();
+		*it = RankedArea {*worst.code, worst.area, worst.value};
+		heap.pop();
+	}
+
+	return ranking;
+}
+
+/**
+  @param statistic
+    A RankStatistic
+
+  @return
+    The name of the statistic used by the --stat argument, e.g. "pct"
+*/
+std::string rankStatisticName(RankStatistic statistic) {
+	switch (statistic) {
+		case RankByDifference:
+			return "diff";
+		case RankByPercentage:
+			return "pct";
+		case RankByAverage:
+			return "avg";
+		case RankByValue:
+		default:
+			return "value";
+	}
+}
+
+/**
+  Print the result of a ranking query as a table, e.g.
+
+    Top 2 areas by Population (pop) in 2019, highest first
+    1  Cardiff / Caerdydd (W06000015)  366903.000000
+    2  Swansea / Abertawe (W06000011)  246993.000000
+
+  @param os
+    The output stream to print to
+
+  @param ranking
+    The result of rankAreas()
+
+  @param query
+    The query that was ranked by
+*/
+void printRanking(std::ostream &os, const std::vector<RankedArea> &ranking, const RankingQuery &query) {
+	//the label is the same in every area, so we take it from the first.
+	std::string label;
+	if (!ranking.empty()) {
+		label = ranking.front().area->getMeasures().at(query.measure).getLabel() + " ";
+	}
+
+	os << "Top " << query.k << " areas by " << label << "(" << query.measure << ")";
+	switch (query.statistic) {
+		case RankByValue:
+			os << " in " << query.year;
+			break;
+		case RankByDifference:
+			os << ", difference between the first and last year";
+			break;
+		case RankByPercentage:
+			os << ", % difference between the first and last year";
+			break;
+		case RankByAverage:
+			os << ", average";
+			break;
+	}
+	os << ", " << (query.descending ? "highest" : "lowest") << " first" << std::endl;
+
+	if (ranking.empty()) {
+		os << "No areas have a value for this measure" << std::endl;
+		return;
+	}
+
+	//pad the names and values so the columns line up.
+	std::vector<std::string> names;
+	std::vector<std::string> values;
+	size_t name_width = 0;
+	size_t value_width = 0;
+	for (const auto &ranked : ranking) {
+		std::ostringstream name_stream;
+		printAreaName(name_stream, *ranked.area);
+		name_stream << " (" << ranked.code << ")";
+		names.push_back(name_stream.str());
+		name_width = std::max(name_width, names.back().length());
+
+		std::ostringstream value_stream;
+		value_stream << std::fixed << std::setprecision(6) << ranked.value;
+		values.push_back(value_stream.str());
+		value_width = std::max(value_width, values.back().length());
+	}
+
+	const int rank_width = (int) std::to_string(ranking.size()).length();
+	for (size_t i = 0; i < ranking.size(); i++) {
+		os << std::right << std::setw(rank_width) << (i + 1) << "  "
+		   << std::left << std::setw((int) name_width) << names[i] << "  "
+		   << std::right << std::setw((int) value_width) << values[i] << std::endl;
+	}
+	os << std::endl;
+}
+
+/**
+  Convert the result of a ranking query to JSON, e.g.
+
+    {"areas":[{"code":"W06000015","names":{"cym":"Caerdydd","eng":"Cardiff"},
+      "rank":1,"value":366903.0}],"measure":"pop","order":"desc",
+      "statistic":"value","year":2019}
+
+  @param ranking
+    The result of rankAreas()
+
+  @param query
+    The query that was ranked by
+
+  @return
+    The JSON as a std::string
+*/
+std::string rankingToJSON(const std::vector<RankedArea> &ranking, const RankingQuery &query) {
+	nlohmann::json j;
+
+	j["measure"] = query.measure;
+	j["statistic"] = rankStatisticName(query.statistic);
+	if (query.statistic == RankByValue) {
+		j["year"] = query.year;
+	}
+	j["order"] = query.descending ? "desc" : "asc";
+
+	j["areas"] = nlohmann::json::array();
+	for (size_t i = 0; i < ranking.size(); i++) {
+		nlohmann::json area;
+		area["rank"] = i + 1;
+		area["code"] = ranking[i].code;
+		area["names"] = nlohmann::json::object();
+		for (const auto &name : ranking[i].area->getNames()) {
+			area["names"][name.first] = name.second;
+		}
+		area["value"] = ranking[i].value;
+		j["areas"].push_back(area);
+	}
+
+	return j.dump();
+}
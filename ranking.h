@@ -0,0 +1,72 @@
+#ifndef RANKING_H_
+#define RANKING_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains declarations for ranking the areas in an Areas instance
+  by one of their measures, e.g. the five areas with the highest population
+  in 2019.
+
+  Only the k best areas are kept while the areas are scanned, in a heap whose
+  top is the worst of them, so ranking n areas takes O(n log k) time and O(k)
+  memory, and nothing is printed for the areas that do not make the cut.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "areas.h"
+
+/*
+  What an area is ranked by: its value in one year, or the difference,
+  percentage difference or average across the years that were imported, or
+  those in the Areas' year view (the same statistics printed at the end of
+  each measure's table).
+*/
+enum RankStatistic {
+	RankByValue,
+	RankByDifference,
+	RankByPercentage,
+	RankByAverage
+};
+
+/*
+  A ranking query: the k areas with the highest (or lowest) statistic for a
+  measure.
+*/
+struct RankingQuery {
+	//the number of areas to return, or 0 for no ranking.
+	size_t k = 0;
+	std::string measure;
+	RankStatistic statistic = RankByValue;
+
+	//the year to rank by, for RankByValue.
+	unsigned int year = 0;
+	bool descending = true;
+};
+
+/*
+  An area in the result of a ranking query. area points into the Areas
+  instance that was ranked.
+*/
+struct RankedArea {
+	std::string code;
+	const Area *area;
+	double value;
+};
+
+std::vector<RankedArea> rankAreas(const Areas &areas, const RankingQuery &query);
+
+std::string rankStatisticName(RankStatistic statistic);
+
+void printRanking(std::ostream &os, const std::vector<RankedArea> &ranking, const RankingQuery &query);
+
+std::string rankingToJSON(const std::vector<RankedArea> &ranking, const RankingQuery &query);
+
+#endif // RANKING_H_
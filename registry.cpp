@@ -0,0 +1,766 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the implementation of the dataset registry and the
+  schema sniffer. See the header file for additional comments.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <regex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include "lib_json.hpp"
+#include "registry.h"
+
+//the version of the schema cache file, which is ignored if it was written by another version.
+static const int SCHEMA_CACHE_VERSION = 1;
+
+//the schema sniffer reads the file this many bytes at a time, until it has enough rows.
+static const size_t SNIFF_CHUNK_BYTES = 64 * 1024;
+
+//the most the schema sniffer reads of a file before giving up on finding enough rows.
+static const size_t SNIFF_MAX_BYTES = 1024 * 1024;
+
+//the number of rows the schema sniffer reads.
+static const size_t SNIFF_ROWS = 5;
+
+namespace {
+
+const std::vector<std::pair<BethYw::SourceDataType, std::string>> SOURCE_DATA_TYPE_NAMES = {
+	{BethYw::AuthorityCodeCSV,   "AuthorityCodeCSV"},
+	{BethYw::WelshStatsJSON,     "WelshStatsJSON"},
+	{BethYw::AuthorityByYearCSV, "AuthorityByYearCSV"}
+};
+
+const std::vector<std::pair<BethYw::SourceColumn, std::string>> SOURCE_COLUMN_NAMES = {
+	{BethYw::AUTH_CODE,           "AUTH_CODE"},
+	{BethYw::AUTH_NAME_ENG,       "AUTH_NAME_ENG"},
+	{BethYw::AUTH_NAME_CYM,       "AUTH_NAME_CYM"},
+	{BethYw::MEASURE_CODE,        "MEASURE_CODE"},
+	{BethYw::MEASURE_NAME,        "MEASURE_NAME"},
+	{BethYw::SINGLE_MEASURE_CODE, "SINGLE_MEASURE_CODE"},
+	{BethYw::SINGLE_MEASURE_NAME, "SINGLE_MEASURE_NAME"},
+	{BethYw::YEAR,                "YEAR"},
+	{BethYw::VALUE,               "VALUE"},
+	{BethYw::AUTH_HIERARCHY,      "AUTH_HIERARCHY"}
+};
+
+//the <cctype> functions are given each char as an unsigned char, as a char of UTF-8 may be negative.
+std::string toLower(std::string str) {
+	for (auto &c : str) {
+		c = (char) std::tolower((unsigned char) c);
+	}
+	return str;
+}
+
+bool isDigit(char c) {
+	return std::isdigit((unsigned char) c) != 0;
+}
+
+/*
+  Finds the rows of the "value" array of a StatsWales JSON file as more of
+  the file is read, stopping at SNIFF_ROWS rows or the end of the array.
+  Each call to scan() carries on from where the last stopped, so every byte
+  is looked at once however many chunks the file is read in.
+*/
+class JSONRowFinder {
+ private:
+	enum Stage { FindValue, FindArray, BetweenRows, InRow, Done };
+
+	Stage stage = FindValue;
+	size_t pos = 0;
+	size_t rowStart = 0;
+	size_t depth = 0;
+	bool inString = false;
+	bool escaped = false;
+	std::vector<nlohmann::json> rows;
+
+ public:
+	//scan the text read so far, of which the text given before is the start.
+	void scan(const std::string &text) {
+		const std::string key = "\"value\"";
+		if (stage == FindValue) {
+			const size_t found = text.find(key, pos);
+			if (found == std::string::npos) {
+				//the key may be cut short at the end of the text.
+				pos = std::max(pos, text.size() < key.size() ? 0 : text.size() - key.size() + 1);
+				return;
+			}
+			pos = found + key.size();
+			stage = FindArray;
+		}
+		if (stage == FindArray) {
+			pos = text.find('[', pos);
+			if (pos == std::string::npos) {
+				pos = text.size();
+				return;
+			}
+			pos++;
+			stage = BetweenRows;
+		}
+
+		for (; pos < text.size() && stage != Done; pos++) {
+			const char c = text[pos];
+			if (stage == BetweenRows) {
+				if (c == ']') {
+					stage = Done;
+				} else if (c == '{') {
+					rowStart = pos;
+					depth = 1;
+					stage = InRow;
+				}
+				continue;
+			}
+
+			//find the end of this row, skipping over any braces in strings.
+			if (escaped) {
+				escaped = false;
+			} else if (inString) {
+				if (c == '\\') {
+					escaped = true;
+				} else if (c == '"') {
+					inString = false;
+				}
+			} else if (c == '"') {
+				inString = true;
+			} else if (c == '{') {
+				depth++;
+			} else if (c == '}' && --depth == 0) {
+				rows.push_back(nlohmann::json::parse(text.begin() + rowStart, text.begin() + pos + 1));
+				stage = rows.size() < SNIFF_ROWS ? BetweenRows : Done;
+			}
+		}
+	}
+
+	//the rows found so far.
+	const std::vector<nlohmann::json>& getRows() const noexcept {
+		return rows;
+	}
+
+	//whether there are no more rows to find.
+	bool isDone() const noexcept {
+		return stage == Done;
+	}
+};
+
+/*
+  The first non-empty value of a key in the rows, as a string.
+*/
+std::string sampleValue(const std::vector<nlohmann::json> &rows, const std::string &key) {
+	for (const auto &row : rows) {
+		auto it = row.find(key);
+		if (it == row.end() || it->is_null()) {
+			continue;
+		}
+		std::string value = it->is_string() ? it->get<std::string>() : it->dump();
+		if (!value.empty()) {
+			return value;
+		}
+	}
+	return "";
+}
+
+/*
+  Infer the columns of a StatsWales JSON file from its first rows. Each
+  dimension of the data (e.g. the area, the measure and the year) has a
+  <Dimension>_Code column and usually a <Dimension>_ItemName_ENG column.
+*/
+SniffedSchema sniffJSONSchema(const std::vector<nlohmann::json> &rows, const std::string &file) {
+	SniffedSchema schema;
+	schema.parser = BethYw::WelshStatsJSON;
+
+	std::set<std::string> keys;
+	for (const auto &row : rows) {
+		for (const auto &item : row.items()) {
+			keys.insert(item.key());
+		}
+	}
+
+	const std::string suffix = "_Code";
+	std::vector<std::string> dimensions;
+	for (const auto &key : keys) {
+		if (key.size() > suffix.size() && key.compare(key.size() - suffix.size(), suffix.size(), suffix) == 0) {
+			dimensions.push_back(key.substr(0, key.size() - suffix.size()));
+		}
+	}
+
+	auto fail = [&file](const std::string &reason) {
+		return std::runtime_error("Failed to infer the columns of " + file + ": " + reason);
+	};
+
+	//the year and the value.
+	auto year = std::find_if(dimensions.begin(), dimensions.end(), [](const std::string &dimension) {
+		return toLower(dimension) == "year";
+	});
+	if (year == dimensions.end()) {
+		throw fail("there is no Year_Code column");
+	}
+	schema.cols[BethYw::YEAR] = *year + suffix;
+	dimensions.erase(year);
+
+	if (keys.count("Data")) {
+		schema.cols[BethYw::VALUE] = "Data";
+	} else if (keys.count("Value")) {
+		schema.cols[BethYw::VALUE] = "Value";
+	} else {
+		throw fail("there is no Data column");
+	}
+
+	//the area is the dimension named as one, or else the one with area codes like W06000011.
+	static const std::regex areaCode("[A-Z][0-9]{8}");
+	auto area = std::find_if(dimensions.begin(), dimensions.end(), [](const std::string &dimension) {
+		const std::string name = toLower(dimension);
+		return name.find("area") != std::string::npos || name.find("authority") != std::string::npos;
+	});
+	if (area == dimensions.end()) {
+		area = std::find_if(dimensions.begin(), dimensions.end(), [&rows](const std::string &dimension) {
+			return std::regex_match(sampleValue(rows, dimension + "_Code"), areaCode);
+		});
+	}
+	if (area == dimensions.end()) {
+		throw fail("there is no area column");
+	}
+	schema.cols[BethYw::AUTH_CODE] = *area + suffix;
+	if (keys.count(*area + "_ItemName_ENG")) {
+		schema.cols[BethYw::AUTH_NAME_ENG] = *area + "_ItemName_ENG";
+	}
+
+	//a hierarchy of numbers is the order of the areas rather than their parents.
+	const std::string hierarchy = sampleValue(rows, *area + "_Hierarchy");
+	if (!hierarchy.empty() && !std::all_of(hierarchy.begin(), hierarchy.end(), isDigit)) {
+		schema.cols[BethYw::AUTH_HIERARCHY] = *area + "_Hierarchy";
+	}
+	dimensions.erase(area);
+
+	//any other dimension is the measure, whose codes are its names if they are only numbers.
+	if (dimensions.size() > 1) {
+		throw fail("there is more than one measure column");
+	}
+	if (dimensions.empty()) {
+		schema.singleMeasure = true;
+		return schema;
+	}
+
+	const std::string &measure = dimensions.front();
+	const std::string code = sampleValue(rows, measure + "_Code");
+	const bool hasName = keys.count(measure + "_ItemName_ENG") != 0;
+	schema.cols[BethYw::MEASURE_CODE] = measure + suffix;
+	schema.cols[BethYw::MEASURE_NAME] = hasName ? measure + "_ItemName_ENG" : measure + suffix;
+	if (hasName && !code.empty() && std::all_of(code.begin(), code.end(), isDigit)) {
+		schema.cols[BethYw::MEASURE_CODE] = measure + "_ItemName_ENG";
+	}
+
+	return schema;
+}
+
+/*
+  Infer the columns of a CSV file from its header: either a column for each
+  year (e.g. complete-popu1009-pop.csv), or the names of each area (e.g.
+  areas.csv).
+*/
+SniffedSchema sniffCSVSchema(const std::string &header, const std::string &file) {
+	SniffedSchema schema;
+
+	std::vector<std::string> columns;
+	std::stringstream line(header);
+	std::string column;
+	while (std::getline(line, column, ',')) {
+		if (!column.empty() && column.back() == '\r') {
+			column.pop_back();
+		}
+		columns.push_back(column);
+	}
+	if (columns.size() < 2) {
+		throw std::runtime_error("Failed to infer the columns of " + file
+								 + ": the header has fewer than two columns");
+	}
+
+	static const std::regex year("[0-9]{4}");
+	const auto isYear = [](const std::string &c) { return std::regex_match(c, year); };
+	if (std::all_of(columns.begin() + 1, columns.end(), isYear)) {
+		schema.parser = BethYw::AuthorityByYearCSV;
+		schema.cols[BethYw::AUTH_CODE] = columns[0];
+		schema.singleMeasure = true;
+		return schema;
+	}
+
+	schema.parser = BethYw::AuthorityCodeCSV;
+	schema.cols[BethYw::AUTH_CODE] = columns[0];
+	for (const auto &c : columns) {
+		if (toLower(c).find("(eng)") != std::string::npos) {
+			schema.cols[BethYw::AUTH_NAME_ENG] = c;
+		} else if (toLower(c).find("(cym)") != std::string::npos) {
+			schema.cols[BethYw::AUTH_NAME_CYM] = c;
+		}
+	}
+	if (schema.cols.size() != 3) {
+		throw std::runtime_error("Failed to infer the columns of " + file
+								 + ": the header is neither years nor English and Welsh names");
+	}
+	return schema;
+}
+
+} // namespace
+
+/**
+  @return
+    true if the dataset's parser and columns are known
+*/
+bool RegisteredDataset::hasSchema() const noexcept {
+	return parser != BethYw::None && !cols.empty();
+}
+
+/**
+  Infer the parser and columns of a dataset from the first few rows of its
+  file. A file starting with { is read as a StatsWales JSON file, and any
+  other file as a CSV file.
+
+  @param is
+    The contents of the file
+
+  @param file
+    The name of the file, for error messages
+
+  @return
+    The schema of the file
+
+  @throws
+    std::runtime_error if the schema cannot be inferred
+
+  @example
+    auto input = openInputFile("datasets/hous0501.json");
+    SniffedSchema schema = sniffSchema(input->open(), "hous0501.json");
+*/
+SniffedSchema sniffSchema(std::istream &is, const std::string &file) {
+	std::string text;
+	std::vector<char> chunk(SNIFF_CHUNK_BYTES);
+
+	is >> std::ws;
+	if (is.peek() != '{') {
+		std::string header;
+		if (!std::getline(is, header)) {
+			throw std::runtime_error("Failed to infer the columns of " + file + ": the file is empty");
+		}
+		return sniffCSVSchema(header, file);
+	}
+
+	JSONRowFinder rows;
+	while (text.size() < SNIFF_MAX_BYTES && is && !rows.isDone()) {
+		is.read(chunk.data(), chunk.size());
+		text.append(chunk.data(), (size_t) is.gcount());
+
+		try {
+			rows.scan(text);
+		} catch (nlohmann::json::exception &e) {
+			throw std::runtime_error("Failed to infer the columns of " + file + ": " + e.what());
+		}
+	}
+
+	if (rows.getRows().empty()) {
+		throw std::runtime_error("Failed to infer the columns of " + file + ": there are no rows");
+	}
+	return sniffJSONSchema(rows.getRows(), file);
+}
+
+/**
+  Create the InputFileSource of a registered dataset, using a sniffed schema
+  for anything the dataset does not give. The single measure of a dataset
+  without a measure column is named after the dataset.
+
+  @param dataset
+    The registered dataset
+
+  @param schema
+    The schema of its file, which is ignored if the dataset has its own
+
+  @return
+    The InputFileSource to import the dataset with
+
+  @example
+    auto source = applySchema(*registry.find("hous"), schema);
+*/
+BethYw::InputFileSource applySchema(const RegisteredDataset &dataset, const SniffedSchema &schema) {
+	BethYw::SourceDataType parser = dataset.parser != BethYw::None ? dataset.parser : schema.parser;
+	BethYw::SourceColumnMapping cols = !dataset.cols.empty() ? dataset.cols : schema.cols;
+
+	if (parser != BethYw::AuthorityCodeCSV && cols.count(BethYw::MEASURE_CODE) == 0) {
+		cols.emplace(BethYw::SINGLE_MEASURE_CODE, dataset.measure.empty() ? dataset.code : dataset.measure);
+		cols.emplace(BethYw::SINGLE_MEASURE_NAME, dataset.name);
+	}
+
+	return BethYw::InputFileSource {dataset.code, dataset.name, dataset.file, parser, cols};
+}
+
+/**
+  @param type
+    A SourceDataType
+
+  @return
+    The name of the SourceDataType, as used in manifests
+*/
+std::string sourceDataTypeName(BethYw::SourceDataType type) {
+	for (const auto &it : SOURCE_DATA_TYPE_NAMES) {
+		if (it.first == type) {
+			return it.second;
+		}
+	}
+	return "None";
+}
+
+/**
+  @param name
+    The name of a SourceDataType, as used in manifests
+
+  @return
+    The SourceDataType
+
+  @throws
+    std::invalid_argument if there is no such SourceDataType
+*/
+BethYw::SourceDataType parseSourceDataType(const std::string &name) {
+	for (const auto &it : SOURCE_DATA_TYPE_NAMES) {
+		if (it.second == name) {
+			return it.first;
+		}
+	}
+	throw std::invalid_argument("No parser matches: " + name);
+}
+
+/**
+  @param column
+    A SourceColumn
+
+  @return
+    The name of the SourceColumn, as used in manifests
+*/
+std::string sourceColumnName(BethYw::SourceColumn column) {
+	for (const auto &it : SOURCE_COLUMN_NAMES) {
+		if (it.first == column) {
+			return it.second;
+		}
+	}
+	return "";
+}
+
+/**
+  @param name
+    The name of a SourceColumn, as used in manifests
+
+  @return
+    The SourceColumn
+
+  @throws
+    std::invalid_argument if there is no such SourceColumn
+*/
+BethYw::SourceColumn parseSourceColumn(const std::string &name) {
+	for (const auto &it : SOURCE_COLUMN_NAMES) {
+		if (it.second == name) {
+			return it.first;
+		}
+	}
+	throw std::invalid_argument("No column matches: " + name);
+}
+
+/**
+  Constructor for the schema cache of a directory, read from the schema cache
+  file in its cache directory (see cacheDirectory()) if there is one. A file
+  that cannot be read is ignored, and replaced when the cache is saved. The
+  cache directory is not created until then.
+
+  @param dir
+    The directory, ending in a separator
+
+  @example
+    SchemaCache cache("datasets/");
+*/
+SchemaCache::SchemaCache(const std::string &dir) : dir(dir), cache(cacheDirectory(dir)), changed(false) {
+	if (cache.empty()) {
+		return;
+	}
+	std::ifstream file(cache + SCHEMA_CACHE_FILE);
+	if (!file.is_open()) {
+		return;
+	}
+
+	try {
+		nlohmann::json j;
+		file >> j;
+		if (j.at("version").get<int>() != SCHEMA_CACHE_VERSION) {
+			return;
+		}
+
+		for (const auto &item : j.at("schemas").items()) {
+			const auto &value = item.value();
+			Entry entry;
+			entry.fingerprint = FileFingerprint {value.at("name").get<std::string>(),
+												 value.at("size").get<unsigned long long>(),
+												 value.at("modified").get<long long>()};
+			entry.schema.parser = parseSourceDataType(value.at("parser").get<std::string>());
+			entry.schema.singleMeasure = value.at("single").get<bool>();
+			for (const auto &column : value.at("columns").items()) {
+				entry.schema.cols[parseSourceColumn(column.key())] = column.value().get<std::string>();
+			}
+			entries[item.key()] = entry;
+		}
+	} catch (std::exception &e) {
+		entries.clear();
+	}
+}
+
+/**
+  Find the schema sniffed from a file, if the file has not changed since.
+
+  @param file
+    The name of the file in the directory
+
+  @param schema
+    Set to the schema of the file
+
+  @return
+    false if the file needs sniffing
+*/
+bool SchemaCache::find(const std::string &file, SniffedSchema &schema) const {
+	auto it = entries.find(file);
+	FileFingerprint current;
+	if (it == entries.end() || !datasetFingerprint(dir, file, current) || !(current == it->second.fingerprint)) {
+		return false;
+	}
+
+	schema = it->second.schema;
+	return true;
+}
+
+/**
+  Add the schema sniffed from a file to the cache.
+
+  @param file
+    The name of the file in the directory
+
+  @param schema
+    The schema of the file
+*/
+void SchemaCache::store(const std::string &file, const SniffedSchema &schema) {
+	Entry entry;
+	if (!datasetFingerprint(dir, file, entry.fingerprint)) {
+		return;
+	}
+	entry.schema = schema;
+	entries[file] = entry;
+	changed = true;
+}
+
+/**
+  @return
+    true if a schema has been added since the cache was read
+*/
+bool SchemaCache::isChanged() const noexcept {
+	return changed;
+}
+
+/**
+  Write the cache to the schema cache file in its cache directory, if
+  anything has been added, creating the cache directory if need be. As with
+  DatasetCatalog::save(), failing to write it only means the files are
+  sniffed again next time.
+*/
+void SchemaCache::save() {
+	if (!changed) {
+		return;
+	}
+
+	nlohmann::json j;
+	j["version"] = SCHEMA_CACHE_VERSION;
+	j["schemas"] = nlohmann::json::object();
+	for (const auto &it : entries) {
+		nlohmann::json columns = nlohmann::json::object();
+		for (const auto &column : it.second.schema.cols) {
+			columns[sourceColumnName(column.first)] = column.second;
+		}
+		j["schemas"][it.first] = {
+			{"name", it.second.fingerprint.name},
+			{"size", it.second.fingerprint.size},
+			{"modified", it.second.fingerprint.modified},
+			{"parser", sourceDataTypeName(it.second.schema.parser)},
+			{"single", it.second.schema.singleMeasure},
+			{"columns", columns}
+		};
+	}
+
+	if (cache.empty() || !makeCacheDirectory(cache)) {
+		return;
+	}
+	const std::string path = cache + SCHEMA_CACHE_FILE;
+	const std::string temp = path + ".tmp";
+	{
+		std::ofstream file(temp);
+		if (!file.is_open()) {
+			return;
+		}
+		file << j.dump();
+		if (!file.good()) {
+			return;
+		}
+	}
+	if (std::rename(temp.c_str(), path.c_str()) != 0) {
+		std::remove(temp.c_str());
+		return;
+	}
+	changed = false;
+}
+
+/**
+  Constructor for a registry of the datasets built into datasets.h.
+
+  @example
+    DatasetRegistry registry;
+    registry.loadManifestFile("datasets/bethyw-manifest.json");
+*/
+DatasetRegistry::DatasetRegistry() {
+	for (const auto &source : BethYw::InputFiles::DATASETS) {
+		RegisteredDataset dataset;
+		dataset.code = source.CODE;
+		dataset.name = source.NAME;
+		dataset.file = source.FILE;
+		dataset.parser = source.PARSER;
+		dataset.cols = source.COLS;
+		add(dataset);
+	}
+}
+
+/**
+  Register a dataset, replacing any dataset with the same code.
+
+  @param dataset
+    The dataset
+*/
+void DatasetRegistry::add(const RegisteredDataset &dataset) {
+	auto it = index.find(dataset.code);
+	if (it != index.end()) {
+		datasets[it->second] = dataset;
+		return;
+	}
+
+	index[dataset.code] = datasets.size();
+	datasets.push_back(dataset);
+}
+
+/**
+  Register the datasets in a manifest (see the header file). Every dataset
+  needs a code and a file. The name defaults to the code, and the parser
+  (one of AuthorityCodeCSV, WelshStatsJSON or AuthorityByYearCSV) and the
+  columns (a map of SourceColumn names, e.g. AUTH_CODE, to the names of
+  columns in the file) are sniffed if they are not given.
+
+  @param is
+    The manifest
+
+  @return
+    The number of datasets registered
+
+  @throws
+    std::runtime_error if the manifest is not valid
+
+  @example
+    std::ifstream manifest("datasets/bethyw-manifest.json");
+    registry.loadManifest(manifest);
+*/
+size_t DatasetRegistry::loadManifest(std::istream &is) {
+	std::vector<RegisteredDataset> loaded;
+
+	try {
+		nlohmann::json j;
+		is >> j;
+
+		for (const auto &entry : j.at("datasets")) {
+			RegisteredDataset dataset;
+			dataset.code = entry.at("code").get<std::string>();
+			dataset.file = entry.at("file").get<std::string>();
+			dataset.name = entry.value("name", dataset.code);
+			dataset.measure = entry.value("measure", "");
+			if (dataset.code.empty() || dataset.file.empty()) {
+				throw std::invalid_argument("a dataset has no code or file");
+			}
+
+			const std::string parser = entry.value("parser", "auto");
+			if (parser != "auto") {
+				dataset.parser = parseSourceDataType(parser);
+			}
+			if (entry.count("columns")) {
+				for (const auto &column : entry.at("columns").items()) {
+					dataset.cols[parseSourceColumn(column.key())] = column.value().get<std::string>();
+				}
+			}
+
+			loaded.push_back(dataset);
+		}
+	} catch (std::exception &e) {
+		throw std::runtime_error(std::string("Invalid dataset manifest: ") + e.what());
+	}
+
+	for (const auto &dataset : loaded) {
+		add(dataset);
+	}
+	return loaded.size();
+}
+
+/**
+  Register the datasets in a manifest file.
+
+  @param path
+    The path of the manifest
+
+  @return
+    The number of datasets registered
+
+  @throws
+    std::runtime_error if the file cannot be opened or is not a valid manifest
+*/
+size_t DatasetRegistry::loadManifestFile(const std::string &path) {
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open dataset manifest " + path);
+	}
+
+	try {
+		return loadManifest(file);
+	} catch (std::runtime_error &e) {
+		throw std::runtime_error(std::string(e.what()) + " (" + path + ")");
+	}
+}
+
+/**
+  @param code
+    The code of a dataset, as used in the program arguments
+
+  @return
+    The dataset, or nullptr if no dataset has the code
+*/
+const RegisteredDataset* DatasetRegistry::find(const std::string &code) const noexcept {
+	auto it = index.find(code);
+	return it == index.end() ? nullptr : &datasets[it->second];
+}
+
+/**
+  @return
+    Every registered dataset, in the order they were registered
+*/
+const std::vector<RegisteredDataset>& DatasetRegistry::getDatasets() const noexcept {
+	return datasets;
+}
+
+/**
+  @return
+    The number of registered datasets
+*/
+size_t DatasetRegistry::size() const noexcept {
+	return datasets.size();
+}
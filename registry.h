@@ -0,0 +1,136 @@
+#ifndef REGISTRY_H_
+#define REGISTRY_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains declarations for the dataset registry, which holds the
+  datasets that can be imported: those built into datasets.h, and any listed
+  in a manifest file read at startup, e.g.
+
+    {
+      "datasets": [
+        {"code": "hous", "name": "Housing stock", "file": "hous0501.json"},
+        {"code": "rail", "name": "Rail passenger journeys", "file": "tran0152.json",
+         "parser": "WelshStatsJSON", "measure": "rail"}
+      ]
+    }
+
+  A dataset in a manifest only needs a code and a file. If its parser or
+  columns are not given, they are inferred by the schema sniffer, which reads
+  only the first few rows of the file. What the sniffer finds is kept in the
+  cache directory of the datasets directory (see cacheDirectory() in
+  catalog.h), alongside the size and modification time of the file, so each
+  file is only sniffed again when it changes. Datasets are only sniffed once
+  they are chosen for import, so a manifest of hundreds of datasets costs no
+  more than reading it.
+ */
+
+#include <istream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "datasets.h"
+#include "catalog.h"
+
+/*
+  The name of the manifest file read from a datasets directory if no other
+  manifest is given.
+*/
+const std::string MANIFEST_FILE = "bethyw-manifest.json";
+
+/*
+  The name of the schema cache file in the cache directory of a datasets
+  directory.
+*/
+const std::string SCHEMA_CACHE_FILE = "schemas.json";
+
+/*
+  A dataset that can be imported. PARSER is None, and COLS is empty, until the
+  dataset's schema is known. MEASURE is the code of the single measure of a
+  dataset that has no measure column, if it is not the dataset's code.
+*/
+struct RegisteredDataset {
+	std::string code;
+	std::string name;
+	std::string file;
+	BethYw::SourceDataType parser = BethYw::None;
+	BethYw::SourceColumnMapping cols;
+	std::string measure;
+
+	bool hasSchema() const noexcept;
+};
+
+/*
+  What the schema sniffer found in a file. A schema with a single measure has
+  no SINGLE_MEASURE_CODE or SINGLE_MEASURE_NAME column, since those are taken
+  from the dataset it is used for.
+*/
+struct SniffedSchema {
+	BethYw::SourceDataType parser = BethYw::None;
+	BethYw::SourceColumnMapping cols;
+	bool singleMeasure = false;
+};
+
+SniffedSchema sniffSchema(std::istream &is, const std::string &file);
+
+BethYw::InputFileSource applySchema(const RegisteredDataset &dataset, const SniffedSchema &schema);
+
+std::string sourceDataTypeName(BethYw::SourceDataType type);
+
+BethYw::SourceDataType parseSourceDataType(const std::string &name);
+
+std::string sourceColumnName(BethYw::SourceColumn column);
+
+BethYw::SourceColumn parseSourceColumn(const std::string &name);
+
+/*
+  The schemas sniffed from the files in a directory, read from and written to
+  its schema cache file.
+*/
+class SchemaCache {
+ private:
+	struct Entry {
+		FileFingerprint fingerprint;
+		SniffedSchema schema;
+	};
+
+	std::string dir;
+	std::string cache;
+	std::map<std::string, Entry> entries;
+	bool changed;
+
+ public:
+	explicit SchemaCache(const std::string &dir);
+	bool find(const std::string &file, SniffedSchema &schema) const;
+	void store(const std::string &file, const SniffedSchema &schema);
+	bool isChanged() const noexcept;
+	void save();
+};
+
+/*
+  The datasets that can be imported, in the order they were registered, with
+  an index of their codes.
+*/
+class DatasetRegistry {
+ private:
+	std::vector<RegisteredDataset> datasets;
+	std::unordered_map<std::string, size_t> index;
+
+ public:
+	DatasetRegistry();
+	void add(const RegisteredDataset &dataset);
+	size_t loadManifest(std::istream &is);
+	size_t loadManifestFile(const std::string &path);
+	const RegisteredDataset* find(const std::string &code) const noexcept;
+	const std::vector<RegisteredDataset>& getDatasets() const noexcept;
+	size_t size() const noexcept;
+};
+
+#endif // REGISTRY_H_
@@ -0,0 +1,336 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the implementation of TaskScheduler and TaskGroup. See
+  the header file for how tasks are shared out.
+ */
+
+#include <algorithm>
+
+#include "scheduler.h"
+
+namespace {
+
+//the scheduler the current thread is a worker of, if any, and the deque it owns.
+thread_local const TaskScheduler *current_scheduler = nullptr;
+thread_local size_t current_deque = 0;
+
+std::mutex shared_mutex;
+unsigned int shared_threads = 0;
+std::unique_ptr<TaskScheduler> shared_scheduler;
+
+unsigned int resolveThreads(unsigned int threads) noexcept {
+	return threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+} // namespace
+
+/**
+  Constructor for TaskScheduler, which starts its worker threads.
+
+  @param threads
+    The number of threads to run tasks on at once, including the thread
+    waiting for them, or 0 for one per processor
+
+  @example
+    TaskScheduler scheduler(4);
+    parallelFor(scheduler, areas.size(), 64, [&](size_t first, size_t last) {
+      ...
+    });
+*/
+TaskScheduler::TaskScheduler(unsigned int threads)
+	: queued(0), sleepers(0), stopping(false) {
+	threads = resolveThreads(threads);
+
+	for (unsigned int i = 0; i < threads; i++) {
+		deques.emplace_back(new Deque());
+	}
+	for (unsigned int i = 0; i + 1 < threads; i++) {
+		workers.emplace_back(&TaskScheduler::work, this, i);
+	}
+}
+
+/**
+  Destructor for TaskScheduler, which stops its worker threads. Every
+  TaskGroup using the scheduler must have been waited for.
+*/
+TaskScheduler::~TaskScheduler() {
+	{
+		std::lock_guard<std::mutex> lock(idle);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (auto &worker : workers) {
+		worker.join();
+	}
+}
+
+/**
+  @return
+    The number of threads that run tasks at once, including the thread
+    waiting for them
+*/
+unsigned int TaskScheduler::size() const noexcept {
+	return (unsigned int) deques.size();
+}
+
+//the deque the current thread owns: its own if it is a worker, otherwise the shared one.
+size_t TaskScheduler::self() const noexcept {
+	return current_scheduler == this ? current_deque : deques.size() - 1;
+}
+
+//add a task to the back of the current thread's deque, and wake a sleeping thread to take it.
+void TaskScheduler::push(std::function<void()> task) {
+	Deque &deque = *deques[self()];
+	{
+		std::lock_guard<std::mutex> lock(deque.mutex);
+		deque.tasks.push_back(std::move(task));
+	}
+	queued++;
+
+	//a thread counts itself as a sleeper before checking queued, under the lock, so either it sees
+	//this task or it is counted here, and taking the lock means it is either asleep or yet to check.
+	if (sleepers.load() != 0) {
+		{
+			std::lock_guard<std::mutex> lock(idle);
+		}
+		wake.notify_one();
+	}
+}
+
+//take the newest task from the owner's deque, or else steal the oldest from another one.
+bool TaskScheduler::take(size_t owner, std::function<void()> &task) {
+	if (queued.load() == 0) {
+		return false;
+	}
+
+	for (size_t i = 0; i < deques.size(); i++) {
+		Deque &deque = *deques[(owner + i) % deques.size()];
+		std::lock_guard<std::mutex> lock(deque.mutex);
+		if (deque.tasks.empty()) {
+			continue;
+		}
+		if (i == 0) {
+			task = std::move(deque.tasks.back());
+			deque.tasks.pop_back();
+		} else {
+			task = std::move(deque.tasks.front());
+			deque.tasks.pop_front();
+		}
+		queued--;
+		return true;
+	}
+
+	return false;
+}
+
+//the loop of a worker thread, which runs tasks until the scheduler is destroyed.
+void TaskScheduler::work(size_t deque) {
+	current_scheduler = this;
+	current_deque = deque;
+
+	for (;;) {
+		std::function<void()> task;
+		if (take(deque, task)) {
+			task();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(idle);
+		sleepers++;
+		wake.wait(lock, [this]() {
+			return stopping || queued.load() != 0;
+		});
+		sleepers--;
+		if (stopping) {
+			return;
+		}
+	}
+}
+
+/**
+  The scheduler shared by the whole program, which is created the first time
+  it is asked for, with the number of threads last given to
+  setSharedThreads().
+
+  @return
+    The shared scheduler
+
+  @example
+    TaskGroup group(TaskScheduler::shared());
+*/
+TaskScheduler& TaskScheduler::shared() {
+	std::lock_guard<std::mutex> lock(shared_mutex);
+	if (!shared_scheduler) {
+		shared_scheduler.reset(new TaskScheduler(shared_threads));
+	}
+	return *shared_scheduler;
+}
+
+/**
+  Set the number of threads of the shared scheduler (e.g. from the --threads
+  program argument). If the shared scheduler already exists with a different
+  number, it is replaced, so this must not be called while any task is
+  using it.
+
+  @param threads
+    The number of threads to run tasks on at once, or 0 for one per
+    processor
+
+  @example
+    TaskScheduler::setSharedThreads(4);
+*/
+void TaskScheduler::setSharedThreads(unsigned int threads) {
+	std::lock_guard<std::mutex> lock(shared_mutex);
+	shared_threads = threads;
+	if (shared_scheduler && shared_scheduler->size() != resolveThreads(threads)) {
+		shared_scheduler.reset();
+	}
+}
+
+/**
+  Constructor for TaskGroup.
+
+  @param scheduler
+    The scheduler to run the group's tasks on
+
+  @example
+    TaskGroup group(TaskScheduler::shared());
+    group.run([]() { ... });
+    group.wait();
+*/
+TaskGroup::TaskGroup(TaskScheduler &scheduler) : scheduler(scheduler), pending(0) {}
+
+/**
+  Destructor for TaskGroup, which waits for any tasks still running (e.g.
+  when an exception has been thrown before wait() was called), ignoring any
+  exception they throw.
+*/
+TaskGroup::~TaskGroup() {
+	try {
+		wait();
+	} catch (...) {
+	}
+}
+
+/**
+  Submit a task to run as part of the group.
+
+  @param task
+    The task, which may itself submit tasks and wait for them
+
+  @example
+    group.run([&]() { results[0] = compute(0); });
+*/
+void TaskGroup::run(std::function<void()> task) {
+	pending++;
+
+	scheduler.push([this, task]() {
+		try {
+			task();
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(error_mutex);
+			if (!error) {
+				error = std::current_exception();
+			}
+		}
+
+		//once pending is 0 the group may be destroyed by wait() returning, so this is its last use.
+		TaskScheduler &owner = scheduler;
+		if (--pending == 0) {
+			{
+				std::lock_guard<std::mutex> lock(owner.idle);
+			}
+			owner.wake.notify_all();
+		}
+	});
+}
+
+/**
+  Wait for every task of the group, running tasks (of this group or any
+  other) in the meantime.
+
+  @throws
+    The first exception thrown by any of the group's tasks
+*/
+void TaskGroup::wait() {
+	const size_t owner = scheduler.self();
+
+	while (pending.load() != 0) {
+		std::function<void()> task;
+		if (scheduler.take(owner, task)) {
+			task();
+			continue;
+		}
+
+		//the group's last tasks are running on other threads, which may yet submit more to help with.
+		std::unique_lock<std::mutex> lock(scheduler.idle);
+		scheduler.sleepers++;
+		scheduler.wake.wait(lock, [this]() {
+			return pending.load() == 0 || scheduler.queued.load() != 0;
+		});
+		scheduler.sleepers--;
+	}
+
+	std::exception_ptr thrown;
+	{
+		std::lock_guard<std::mutex> lock(error_mutex);
+		std::swap(thrown, error);
+	}
+	if (thrown) {
+		std::rethrow_exception(thrown);
+	}
+}
+
+/**
+  Call body for consecutive ranges of [0, count), in tasks on a scheduler,
+  and wait for them all.
+
+  @param scheduler
+    The scheduler to run the tasks on
+
+  @param count
+    The number of items
+
+  @param grain
+    The number of items in each range (the last may have fewer)
+
+  @param body
+    Called with the first item of a range and the item after the last
+
+  @throws
+    The first exception thrown by body
+
+  @example
+    parallelFor(TaskScheduler::shared(), sources.size(), 64, [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; i++) {
+        ...
+      }
+    });
+*/
+void parallelFor(TaskScheduler &scheduler,
+				 size_t count,
+				 size_t grain,
+				 const std::function<void(size_t, size_t)> &body) {
+	grain = std::max<size_t>(1, grain);
+	if (count <= grain) {
+		if (count != 0) {
+			body(0, count);
+		}
+		return;
+	}
+
+	TaskGroup group(scheduler);
+	for (size_t first = 0; first < count; first += grain) {
+		const size_t last = std::min(count, first + grain);
+		group.run([&body, first, last]() {
+			body(first, last);
+		});
+	}
+	group.wait();
+}
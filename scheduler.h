@@ -0,0 +1,115 @@
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the declaration of TaskScheduler, the pool of threads
+  that the parallel parts of importing, analysing and outputting data (e.g.
+  building quantile sketches, window functions, the correlation matrix and
+  rendering NDJSON) share, rather than each starting threads of its own and
+  fighting the others for processors.
+
+  Work is submitted as tasks through a TaskGroup, which is then waited on.
+  Each worker thread has a deque of tasks: a task submitted from a worker
+  goes on the back of its own deque, and a worker takes the newest task from
+  the back of its own deque, which is likely to still be in its cache, or
+  steals the oldest from the front of another deque, which is likely to be
+  the largest left, when its own is empty. Tasks submitted from any other
+  thread go on a deque shared by those threads.
+
+  A thread waiting for a TaskGroup runs tasks until the group is done,
+  instead of blocking, so a task can submit tasks of its own and wait for
+  them (e.g. a task per dataset, each split into a task per chunk) without
+  starting another thread or deadlocking, however deeply it is nested, and
+  the number of threads running tasks never exceeds the size of the
+  scheduler. A scheduler of size n has n - 1 worker threads, since the
+  thread waiting for the work is the nth; a scheduler of size 1 has none,
+  and runs each task on the thread that waits for it.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class TaskGroup;
+
+class TaskScheduler {
+ private:
+	struct Deque {
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	//one deque for each worker, then one shared by every other thread.
+	std::vector<std::unique_ptr<Deque>> deques;
+	std::vector<std::thread> workers;
+
+	//the number of tasks in the deques, and of threads sleeping until there are some.
+	std::atomic<size_t> queued;
+	std::atomic<size_t> sleepers;
+
+	std::mutex idle;
+	std::condition_variable wake;
+	bool stopping;
+
+	size_t self() const noexcept;
+	void push(std::function<void()> task);
+	bool take(size_t deque, std::function<void()> &task);
+	void work(size_t deque);
+
+	friend class TaskGroup;
+
+ public:
+	explicit TaskScheduler(unsigned int threads = 0);
+	~TaskScheduler();
+
+	TaskScheduler(const TaskScheduler &other) = delete;
+	TaskScheduler &operator=(const TaskScheduler &other) = delete;
+
+	unsigned int size() const noexcept;
+
+	static TaskScheduler& shared();
+	static void setSharedThreads(unsigned int threads);
+};
+
+/*
+  A set of tasks submitted to a TaskScheduler that can be waited for. The
+  first exception thrown by any of the tasks is rethrown by wait(), once
+  every task is done.
+*/
+class TaskGroup {
+ private:
+	TaskScheduler &scheduler;
+	std::atomic<size_t> pending;
+	std::mutex error_mutex;
+	std::exception_ptr error;
+
+ public:
+	explicit TaskGroup(TaskScheduler &scheduler);
+	~TaskGroup();
+
+	TaskGroup(const TaskGroup &other) = delete;
+	TaskGroup &operator=(const TaskGroup &other) = delete;
+
+	void run(std::function<void()> task);
+	void wait();
+};
+
+void parallelFor(TaskScheduler &scheduler,
+				 size_t count,
+				 size_t grain,
+				 const std::function<void(size_t, size_t)> &body);
+
+#endif // SCHEDULER_H_
@@ -0,0 +1,290 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the implementation of area matching and AreaIndex. See
+  the header file for additional comments.
+ */
+
+#include <algorithm>
+#include <regex>
+#include <stdexcept>
+
+#include "search.h"
+
+namespace {
+
+/*
+  The unaccented lowercase letter of each letter from U+00C0 to U+00FF (whose
+  UTF-8 is 0xC3 then 0x80 to 0xBF), or '_' for one that is left as it is
+  (e.g. Æ and ß).
+*/
+const char LATIN1_LETTERS[] = "aaaaaa_ceeeeiiii_nooooo_ouuuuy__aaaaaa_ceeeeiiii_nooooo_ouuuuy_y";
+
+//the key of the three bytes of text from i.
+uint32_t trigram(const std::string &text, size_t i) noexcept {
+	return (uint32_t) (unsigned char) text[i] << 16
+		   | (uint32_t) (unsigned char) text[i + 1] << 8
+		   | (uint32_t) (unsigned char) text[i + 2];
+}
+
+} // namespace
+
+/**
+  Fold a code, name or search term to the form areas are matched in: ASCII
+  letters in lowercase, and Latin letters with accents, such as the ô of
+  "Ynys Môn" and the ŵ and ŷ of Welsh, as the unaccented lowercase letter.
+  Anything else is left as it is.
+
+  @param text
+    UTF-8 text
+
+  @return
+    The folded text
+
+  @example
+    auto folded = foldAreaText("Ynys Môn"); // "ynys mon"
+*/
+std::string foldAreaText(const std::string &text) {
+	std::string folded;
+	folded.reserve(text.size());
+
+	for (size_t i = 0; i < text.size(); i++) {
+		const unsigned char c = (unsigned char) text[i];
+		if (c < 0x80) {
+			folded.push_back((char) ::tolower(c));
+			continue;
+		}
+
+		char letter = '_';
+		size_t bytes = 1;
+		if (i + 1 < text.size()) {
+			const unsigned char d = (unsigned char) text[i + 1];
+			if (c == 0xC3 && d >= 0x80 && d <= 0xBF) {
+				letter = LATIN1_LETTERS[d - 0x80];
+				bytes = 2;
+			} else if (c == 0xC5 && d >= 0xB4 && d <= 0xB8) {
+				//Ŵ, ŵ, Ŷ, ŷ and Ÿ.
+				letter = "wwyyy"[d - 0xB4];
+				bytes = 2;
+			} else if (c == 0xE1 && i + 2 < text.size()) {
+				//Ẁ, ẁ, Ẃ, ẃ, Ẅ and ẅ, then Ỳ and ỳ.
+				const unsigned char e = (unsigned char) text[i + 2];
+				if (d == 0xBA && e >= 0x80 && e <= 0x85) {
+					letter = 'w';
+				} else if (d == 0xBB && (e == 0xB2 || e == 0xB3)) {
+					letter = 'y';
+				}
+				bytes = 3;
+			}
+		}
+
+		if (letter == '_') {
+			folded.push_back(text[i]);
+		} else {
+			folded.push_back(letter);
+			i += bytes - 1;
+		}
+	}
+
+	return folded;
+}
+
+/**
+  Check whether a term of the --areas argument is a regular expression rather
+  than text to find in an area's code or names.
+
+  @param term
+    A term of the --areas argument
+
+  @return
+    True if the term holds any of the characters ^$.|?*+()[]{}\
+
+  @example
+    isAreaPattern("W0600000[1-3]"); // true
+    isAreaPattern("ynys mon");      // false
+*/
+bool isAreaPattern(const std::string &term) noexcept {
+	return term.find_first_of("^$.|?*+()[]{}\\") != std::string::npos;
+}
+
+/**
+  Add an area to the index.
+
+  @param code
+    The area's code
+
+  @param names
+    The area's names, in any language
+
+  @return
+    The area's number in the index, which numbers areas from 0 in the order
+    they are added
+
+  @example
+    AreaIndex index;
+    index.add("W06000001", {"Isle of Anglesey", "Ynys Môn"});
+*/
+uint32_t AreaIndex::add(const std::string &code, const std::vector<std::string> &names) {
+	const uint32_t area = (uint32_t) texts.size();
+	texts.emplace_back();
+	folded.emplace_back();
+
+	texts.back().reserve(names.size() + 1);
+	texts.back().push_back(code);
+	texts.back().insert(texts.back().end(), names.begin(), names.end());
+
+	for (const auto &text : texts.back()) {
+		folded.back().push_back(foldAreaText(text));
+		const std::string &f = folded.back().back();
+		for (size_t i = 0; i + 3 <= f.size(); i++) {
+			//areas are added in order, so each list stays sorted as long as an area is only added to it once.
+			std::vector<uint32_t> &list = postings[trigram(f, i)];
+			if (list.empty() || list.back() != area) {
+				list.push_back(area);
+			}
+		}
+	}
+
+	return area;
+}
+
+/**
+  @return
+    The number of areas in the index
+*/
+size_t AreaIndex::size() const noexcept {
+	return texts.size();
+}
+
+/**
+  @param area
+    An area's number in the index
+
+  @return
+    The area's code
+
+  @throws
+    std::out_of_range if there is no such area
+*/
+const std::string& AreaIndex::getCode(uint32_t area) const {
+	return texts.at(area).front();
+}
+
+//whether a folded term is part of an area's folded code or names.
+bool AreaIndex::matches(uint32_t area, const std::string &foldedTerm) const {
+	for (const auto &text : folded[area]) {
+		if (text.find(foldedTerm) != std::string::npos) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+  Find the areas that match a term of the --areas argument (see search.h).
+
+  @param term
+    A term of the --areas argument
+
+  @return
+    The numbers of the matching areas, in order
+
+  @example
+    AreaIndex index;
+    index.add("W06000001", {"Isle of Anglesey", "Ynys Môn"});
+    auto found = index.find("ynys mon"); // {0}
+*/
+std::vector<uint32_t> AreaIndex::find(const std::string &term) const {
+	std::vector<uint32_t> found;
+	const uint32_t count = (uint32_t) texts.size();
+
+	//a regular expression is matched against every area as given, as checkIfAreaMatchesFilter() does.
+	if (isAreaPattern(term)) {
+		const std::regex regex("^.*" + term + ".*$", std::regex_constants::icase);
+		for (uint32_t area = 0; area < count; area++) {
+			for (const auto &text : texts[area]) {
+				if (std::regex_match(text, regex)) {
+					found.push_back(area);
+					break;
+				}
+			}
+		}
+		return found;
+	}
+
+	const std::string foldedTerm = foldAreaText(term);
+	if (foldedTerm.size() < 3) {
+		for (uint32_t area = 0; area < count; area++) {
+			if (matches(area, foldedTerm)) {
+				found.push_back(area);
+			}
+		}
+		return found;
+	}
+
+	std::vector<const std::vector<uint32_t> *> lists;
+	for (size_t i = 0; i + 3 <= foldedTerm.size(); i++) {
+		auto it = postings.find(trigram(foldedTerm, i));
+		if (it == postings.end()) {
+			return found;
+		}
+		lists.push_back(&it->second);
+	}
+	std::sort(lists.begin(), lists.end(), [](const std::vector<uint32_t> *a, const std::vector<uint32_t> *b) {
+		return a->size() < b->size();
+	});
+
+	//intersect the candidates from the shortest list with each longer list by binary search, so a
+	//long list costs the log of its length for each candidate left.
+	std::vector<uint32_t> candidates(*lists.front());
+	for (size_t l = 1; l < lists.size() && !candidates.empty(); l++) {
+		const std::vector<uint32_t> &list = *lists[l];
+		auto from = list.begin();
+		size_t kept = 0;
+		for (uint32_t candidate : candidates) {
+			from = std::lower_bound(from, list.end(), candidate);
+			if (from == list.end()) {
+				break;
+			}
+			if (*from == candidate) {
+				candidates[kept++] = candidate;
+			}
+		}
+		candidates.resize(kept);
+	}
+
+	//the trigrams of a candidate may be spread over its code and names, or out of order, so check it.
+	for (uint32_t area : candidates) {
+		if (matches(area, foldedTerm)) {
+			found.push_back(area);
+		}
+	}
+	return found;
+}
+
+/**
+  Find the areas that match any term of the --areas argument.
+
+  @param filter
+    The terms of the --areas argument
+
+  @return
+    The numbers of the matching areas, in order
+
+  @example
+    auto found = index.find(StringFilterSet {"swan", "W06000001"});
+*/
+std::vector<uint32_t> AreaIndex::find(const std::unordered_set<std::string> &filter) const {
+	std::vector<uint32_t> found;
+	for (const auto &term : filter) {
+		const std::vector<uint32_t> areas = find(term);
+		found.insert(found.end(), areas.begin(), areas.end());
+	}
+	std::sort(found.begin(), found.end());
+	found.erase(std::unique(found.begin(), found.end()), found.end());
+	return found;
+}
@@ -0,0 +1,57 @@
+#ifndef SEARCH_H_
+#define SEARCH_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains declarations for matching areas to the --areas argument,
+  and AreaIndex, an index for finding the areas that match without looking at
+  every one of them.
+
+  A term of the argument matches an area if it is part of the area's code or
+  one of its names, ignoring case and the accents of Welsh (and other Latin)
+  letters, so "ynys mon" matches "Ynys Môn" and "Môn" matches "Ynys Mon". A
+  term holding any of the characters ^$.|?*+()[]{}\ is a regular expression
+  instead, which matches as it always has (see checkIfAreaMatchesFilter()).
+
+  AreaIndex is a trigram inverted index: every run of three bytes of each
+  area's folded code and names has a list of the areas it appears in, in
+  order. A term's candidates are the areas in the lists of all its trigrams,
+  found by intersecting them from the shortest, and each candidate is then
+  checked, so finding a term costs about the length of its rarest trigram's
+  list rather than the number of areas. A term shorter than three bytes, or
+  a regular expression, is checked against every area.
+ */
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+std::string foldAreaText(const std::string &text);
+
+bool isAreaPattern(const std::string &term) noexcept;
+
+class AreaIndex {
+ private:
+	//the code and names of each area, as given and folded, with the code first.
+	std::vector<std::vector<std::string>> texts;
+	std::vector<std::vector<std::string>> folded;
+	std::unordered_map<uint32_t, std::vector<uint32_t>> postings;
+
+	bool matches(uint32_t area, const std::string &foldedTerm) const;
+
+ public:
+	uint32_t add(const std::string &code, const std::vector<std::string> &names);
+	size_t size() const noexcept;
+	const std::string& getCode(uint32_t area) const;
+	std::vector<uint32_t> find(const std::string &term) const;
+	std::vector<uint32_t> find(const std::unordered_set<std::string> &filter) const;
+};
+
+#endif // SEARCH_H_
@@ -0,0 +1,239 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the implementation of AreasSnapshots. See the header
+  file for how readers and writers share the current version.
+ */
+
+#include <stdexcept>
+#include <thread>
+
+#include "snapshot.h"
+
+/**
+  Constructor for AreasSnapshots, with the first version of the data.
+
+  @param initial
+    The first version
+
+  @throws
+    std::invalid_argument if initial is null
+
+  @example
+    std::shared_ptr<const Areas> data = ...;
+    AreasSnapshots snapshots(data);
+*/
+AreasSnapshots::AreasSnapshots(std::shared_ptr<const Areas> initial)
+	: current(0), published(1), closed(false) {
+	if (!initial) {
+		throw std::invalid_argument("AreasSnapshots: the first version cannot be null");
+	}
+	readers[0] = 0;
+	readers[1] = 0;
+
+	//quantile sketches are built and ranked the first time they are asked for, which readers must not do at
+	//once, and after which asking for them only reads them.
+	initial->getQuantiles();
+	slots[0] = std::move(initial);
+}
+
+/**
+  Take a snapshot of the current version of the data, which stays valid, and
+  unchanged, for as long as it is held. This never takes a lock.
+
+  @return
+    The current version
+
+  @example
+    std::shared_ptr<const Areas> data = snapshots.acquire();
+    std::cout << data->toJSON();
+*/
+std::shared_ptr<const Areas> AreasSnapshots::acquire() const noexcept {
+	for (;;) {
+		const unsigned int slot = current.load();
+		readers[slot]++;
+
+		//if a version was published between reading current and counting in, a writer may be about to
+		//replace what is in this slot, so start again.
+		if (current.load() == slot) {
+			std::shared_ptr<const Areas> snapshot = slots[slot];
+			readers[slot]--;
+			return snapshot;
+		}
+		readers[slot]--;
+	}
+}
+
+/**
+  @return
+    The number of the current version, which starts at 1 and goes up by one
+    with each version published
+*/
+uint64_t AreasSnapshots::version() const noexcept {
+	return published.load();
+}
+
+/**
+  Publish a new version of the data. Readers that already have a snapshot
+  keep the version they have, and the next snapshot taken is of this one.
+  The new version must not be changed once it is published.
+
+  @param next
+    The new version
+
+  @return
+    The number of the new version
+
+  @throws
+    std::invalid_argument if next is null
+
+  @example
+    std::shared_ptr<Areas> next = std::make_shared<Areas>(*snapshots.acquire());
+    ...
+    snapshots.publish(next);
+*/
+uint64_t AreasSnapshots::publish(std::shared_ptr<const Areas> next) {
+	if (!next) {
+		throw std::invalid_argument("AreasSnapshots: a version cannot be null");
+	}
+	//as in the constructor, so readers of this version never change it.
+	next->getQuantiles();
+
+	//the version before last, which is freed (once no reader has a snapshot of it) outside the lock.
+	std::shared_ptr<const Areas> replaced;
+	uint64_t version;
+	{
+		std::lock_guard<std::mutex> lock(publishing);
+		const unsigned int slot = 1 - current.load();
+
+		//a reader may still be copying the version before last from the other slot, which is a few
+		//instructions from being done.
+		while (readers[slot].load() != 0) {
+			std::this_thread::yield();
+		}
+
+		replaced = std::move(slots[slot]);
+		slots[slot] = std::move(next);
+		current.store(slot);
+		version = ++published;
+	}
+
+	//taking the lock means a thread in wait() is either waiting, and is woken, or has yet to check the version.
+	{
+		std::lock_guard<std::mutex> lock(waiting);
+	}
+	changed.notify_all();
+
+	return version;
+}
+
+/**
+  Build a new version of the data on another thread and publish it, while
+  readers carry on with the current one.
+
+  @param build
+    Builds the new version, e.g. by copying the current version and importing
+    a dataset again into the copy
+
+  @return
+    A future of the number of the new version, which holds any exception
+    thrown by build, in which case nothing is published
+
+  @example
+    auto reloaded = snapshots.reload([&]() {
+      std::shared_ptr<Areas> next = std::make_shared<Areas>(*snapshots.acquire());
+      ...
+      return next;
+    });
+    reloaded.get();
+*/
+std::future<uint64_t> AreasSnapshots::reload(std::function<std::shared_ptr<const Areas>()> build) {
+	return std::async(std::launch::async, [this, build]() {
+		return publish(build());
+	});
+}
+
+/**
+  Wait until a version after the one seen is published, or close() is called.
+
+  @param seen
+    The number of the last version seen, which is set to the number of the
+    current version
+
+  @return
+    True if there is a version after the one seen, or false if close() was
+    called and there is not
+
+  @example
+    uint64_t seen = snapshots.version();
+    while (snapshots.wait(seen)) {
+      std::cout << *snapshots.acquire();
+    }
+*/
+bool AreasSnapshots::wait(uint64_t &seen) const {
+	std::unique_lock<std::mutex> lock(waiting);
+	changed.wait(lock, [this, &seen]() {
+		return closed || published.load() != seen;
+	});
+
+	const uint64_t latest = published.load();
+	if (latest == seen) {
+		return false;
+	}
+	seen = latest;
+	return true;
+}
+
+/**
+  Wake every thread in wait(), and make wait() return false once every
+  version has been seen.
+*/
+void AreasSnapshots::close() {
+	{
+		std::lock_guard<std::mutex> lock(waiting);
+		closed = true;
+	}
+	changed.notify_all();
+}
+
+/**
+  Constructor for SnapshotFollower, which starts a thread that calls a
+  function with each version published after this one, until the follower
+  is destroyed. Versions published while the function is running are
+  skipped, except the latest.
+
+  @param snapshots
+    The snapshots to follow, which must outlive the follower
+
+  @param follow
+    The function to call with each version
+
+  @example
+    AreasSnapshots snapshots(std::make_shared<const Areas>(data));
+    SnapshotFollower printer(snapshots, [](const Areas &version) {
+      std::cout << version;
+    });
+*/
+SnapshotFollower::SnapshotFollower(AreasSnapshots &snapshots, std::function<void(const Areas &)> follow)
+	: snapshots(snapshots) {
+	const uint64_t first = snapshots.version();
+	thread = std::thread([&snapshots, follow, first]() {
+		uint64_t seen = first;
+		while (snapshots.wait(seen)) {
+			follow(*snapshots.acquire());
+		}
+	});
+}
+
+/**
+  Destructor for SnapshotFollower. Closes the snapshots, so no more versions
+  are followed once the latest has been, and waits for the thread to finish.
+*/
+SnapshotFollower::~SnapshotFollower() {
+	snapshots.close();
+	thread.join();
+}
@@ -0,0 +1,96 @@
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the declaration of AreasSnapshots, which publishes
+  versions of imported data to readers on other threads, read-copy-update
+  style, so data can be reloaded in a long-running process without blocking
+  the readers or letting them see a reload half done.
+
+  Each version is an immutable Areas instance held by a shared_ptr, so a
+  reader that has taken a snapshot keeps reading that version, however many
+  are published after it, until it lets go of it, and a version is freed
+  when its last reader lets go. A new version is built from a copy of the
+  data, off to the side, and published by swapping it in.
+
+  Readers never take a lock. The current version is in one of two slots, and
+  each slot counts the readers copying its shared_ptr: a reader counts itself
+  in to the current slot, checks that it is still current, copies the
+  shared_ptr (which only increments its atomic reference count), and counts
+  itself out. A writer puts the next version in the other slot once no
+  reader is still copying from it, then makes it current. A reader only
+  retries if a version is published while it is counting itself in, and a
+  writer only waits for readers that are part way through a copy, which
+  takes nanoseconds, never for a reader to finish with its snapshot.
+  (std::atomic_load() of a shared_ptr is not used, as it takes a lock from a
+  pool in libstdc++.)
+
+  Writers are serialised with a mutex, which readers never touch, and
+  waiting for a new version (see wait()) takes a lock, but that is to block
+  a thread with nothing to do, not part of reading.
+
+  The next version is usually a copy of the data with a few Areas changed.
+  Copying an Areas instance shares the names and Measures of every Area with
+  the copy until one of them changes it (see area.h), so only the Areas that
+  change are copied in full.
+
+  A SnapshotFollower hands each new version to a function on a thread of its
+  own, and closes the snapshots and waits for the thread when it goes out of
+  scope, however that happens.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "areas.h"
+
+class AreasSnapshots {
+ private:
+	std::shared_ptr<const Areas> slots[2];
+	std::atomic<unsigned int> current;
+	mutable std::atomic<size_t> readers[2];
+	std::atomic<uint64_t> published;
+
+	std::mutex publishing;
+	mutable std::mutex waiting;
+	mutable std::condition_variable changed;
+	bool closed;
+
+ public:
+	explicit AreasSnapshots(std::shared_ptr<const Areas> initial);
+	AreasSnapshots(const AreasSnapshots &other) = delete;
+	AreasSnapshots &operator=(const AreasSnapshots &other) = delete;
+
+	std::shared_ptr<const Areas> acquire() const noexcept;
+	uint64_t version() const noexcept;
+	uint64_t publish(std::shared_ptr<const Areas> next);
+	std::future<uint64_t> reload(std::function<std::shared_ptr<const Areas>()> build);
+	bool wait(uint64_t &seen) const;
+	void close();
+};
+
+class SnapshotFollower {
+ private:
+	AreasSnapshots &snapshots;
+	std::thread thread;
+
+ public:
+	SnapshotFollower(AreasSnapshots &snapshots, std::function<void(const Areas &)> follow);
+	SnapshotFollower(const SnapshotFollower &other) = delete;
+	SnapshotFollower &operator=(const SnapshotFollower &other) = delete;
+	~SnapshotFollower();
+};
+
+#endif // SNAPSHOT_H_
@@ -0,0 +1,758 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the implementation of ColumnarStore and the writing of
+  a store. See the header file for the layout of the format.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "store.h"
+
+namespace {
+
+//the size of the store header, in bytes.
+const size_t HEADER_BYTES = 56 + STORE_SECTIONS * sizeof(uint64_t);
+
+//round a size up to a multiple of 8 bytes.
+uint64_t padded(uint64_t size) noexcept {
+	return (size + 7) & ~((uint64_t) 7);
+}
+
+uint64_t stringTableBytes(const std::vector<std::string> &strings) noexcept {
+	uint64_t size = (strings.size() + 1) * sizeof(uint32_t);
+	for (const auto &str : strings) {
+		size += str.size();
+	}
+	return padded(size);
+}
+
+bool isLittleEndian() noexcept {
+	const uint32_t one = 1;
+	return *reinterpret_cast<const uint8_t *>(&one) == 1;
+}
+
+/*
+  Writes the sections of a store, keeping count of the bytes written so each
+  section can be checked to end where the header says the next one starts.
+*/
+class StoreWriter {
+ private:
+	std::ostream &os;
+	uint64_t written;
+
+ public:
+	explicit StoreWriter(std::ostream &os) : os(os), written(0) {}
+
+	uint64_t offset() const noexcept {
+		return written;
+	}
+
+	void bytes(const void *data, uint64_t size) {
+		os.write(static_cast<const char *>(data), (std::streamsize) size);
+		written += size;
+	}
+
+	template <typename T>
+	void value(const T &value) {
+		bytes(&value, sizeof(T));
+	}
+
+	template <typename T>
+	void array(const std::vector<T> &values) {
+		bytes(values.data(), values.size() * sizeof(T));
+	}
+
+	void pad() {
+		static const char zeros[8] = {0};
+		bytes(zeros, padded(written) - written);
+	}
+
+	void strings(const std::vector<std::string> &strings) {
+		std::vector<uint32_t> offsets;
+		offsets.reserve(strings.size() + 1);
+		offsets.push_back(0);
+		for (const auto &str : strings) {
+			offsets.push_back(offsets.back() + (uint32_t) str.size());
+		}
+		array(offsets);
+		for (const auto &str : strings) {
+			bytes(str.data(), str.size());
+		}
+		pad();
+	}
+};
+
+} // namespace
+
+/**
+  @param i
+    The index of a string in the table
+
+  @return
+    The string
+
+  @throws
+    std::out_of_range if there is no such string
+*/
+std::string StoreStrings::get(uint32_t i) const {
+	if (i >= count || offsets[i] > offsets[i + 1] || offsets[i + 1] > size) {
+		throw std::out_of_range("StoreStrings: no string " + std::to_string(i));
+	}
+	return std::string(bytes + offsets[i], offsets[i + 1] - offsets[i]);
+}
+
+/**
+  Compare a string in the table with another, without copying it.
+
+  @param i
+    The index of a string in the table
+
+  @param str
+    The string to compare with
+
+  @return
+    Less than, equal to or greater than 0 as the string in the table is
+    ordered before, the same as or after str
+*/
+int StoreStrings::compare(uint32_t i, const std::string &str) const {
+	if (i >= count || offsets[i] > offsets[i + 1] || offsets[i + 1] > size) {
+		throw std::out_of_range("StoreStrings: no string " + std::to_string(i));
+	}
+	const size_t length = offsets[i + 1] - offsets[i];
+	const int order = std::memcmp(bytes + offsets[i], str.data(), std::min(length, str.size()));
+	if (order != 0) {
+		return order;
+	}
+	return length < str.size() ? -1 : (length > str.size() ? 1 : 0);
+}
+
+/**
+  Find a string in a sorted table by binary search.
+
+  @param str
+    The string to find
+
+  @return
+    The index of the string, or -1 if it is not in the table
+*/
+long StoreStrings::find(const std::string &str) const {
+	uint32_t low = 0;
+	uint32_t high = count;
+	while (low < high) {
+		const uint32_t mid = low + (high - low) / 2;
+		const int order = compare(mid, str);
+		if (order == 0) {
+			return mid;
+		} else if (order < 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return -1;
+}
+
+/**
+  Constructor for a ColumnarStore, which maps the store file and checks its
+  header and the bounds of its sections. Nothing else is read until it is
+  queried, so opening a store takes the same time whatever its size.
+
+  @param path
+    The path of the store file
+
+  @throws
+    std::runtime_error if the file could not be opened or mapped, or is not a
+    store of this version
+
+  @example
+    ColumnarStore store("wales.byws");
+    Areas data = Areas();
+    store.populate(data);
+*/
+ColumnarStore::ColumnarStore(const std::string &path)
+	: path(path), data(nullptr), length(0), areaCount(0), measureCount(0), languageCount(0), seriesCount(0),
+	  valueCount(0), sections(), listedAreas(nullptr), measureSeries(nullptr), seriesAreas(nullptr), seriesLabels(nullptr),
+	  seriesValues(nullptr), years(nullptr), values(nullptr) {
+	if (!isLittleEndian()) {
+		throw std::runtime_error("ColumnarStore: stores can only be read on a little-endian machine");
+	}
+
+#ifndef _WIN32
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("ColumnarStore: Failed to open file " + path);
+	}
+	struct stat info;
+	if (::fstat(fd, &info) != 0 || info.st_size < (off_t) HEADER_BYTES) {
+		::close(fd);
+		fail("the file is too short");
+	}
+	length = (size_t) info.st_size;
+	void *mapping = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (mapping == MAP_FAILED) {
+		throw std::runtime_error("ColumnarStore: Failed to map file " + path);
+	}
+	data = static_cast<const char *>(mapping);
+#else
+	//there is no mmap here, so the store is read into memory instead.
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) {
+		throw std::runtime_error("ColumnarStore: Failed to open file " + path);
+	}
+	length = (size_t) file.tellg();
+	if (length < HEADER_BYTES) {
+		fail("the file is too short");
+	}
+	char *buffer = new char[length];
+	file.seekg(0);
+	file.read(buffer, (std::streamsize) length);
+	data = buffer;
+#endif
+
+	try {
+		if (std::memcmp(data, "BYWS", 4) != 0) {
+			fail("it is not a store");
+		}
+		uint32_t version;
+		uint32_t labelCount;
+		uint64_t parentCount;
+		uint64_t fileSize;
+		std::memcpy(&version, data + 4, sizeof(version));
+		std::memcpy(&areaCount, data + 8, sizeof(areaCount));
+		std::memcpy(&measureCount, data + 12, sizeof(measureCount));
+		std::memcpy(&languageCount, data + 16, sizeof(languageCount));
+		std::memcpy(&labelCount, data + 20, sizeof(labelCount));
+		std::memcpy(&seriesCount, data + 24, sizeof(seriesCount));
+		std::memcpy(&valueCount, data + 32, sizeof(valueCount));
+		std::memcpy(&parentCount, data + 40, sizeof(parentCount));
+		std::memcpy(&fileSize, data + 48, sizeof(fileSize));
+		std::memcpy(sections, data + 56, sizeof(sections));
+		if (version != STORE_VERSION) {
+			fail("it is version " + std::to_string(version) + ", not " + std::to_string(STORE_VERSION));
+		}
+		if (fileSize != length) {
+			fail("it is " + std::to_string(length) + " bytes, not " + std::to_string(fileSize));
+		}
+		if (seriesCount > UINT32_MAX || parentCount > UINT32_MAX) {
+			fail("it has too many series");
+		}
+
+		//the sections follow the header in order, each on an 8-byte boundary.
+		uint64_t previous = HEADER_BYTES;
+		for (const uint64_t offset : sections) {
+			if (offset < previous || offset % 8 != 0 || offset > length) {
+				fail("its sections are out of order");
+			}
+			previous = offset;
+		}
+
+		areaCodes = strings(StoreAreaCodes, areaCount);
+		languages = strings(StoreLanguages, languageCount);
+		at(sections[StoreAreaNames], languageCount * sizeof(uint64_t));
+		listedAreas = reinterpret_cast<const uint8_t *>(at(sections[StoreListedAreas], (areaCount + 7) / 8));
+		measureCodes = strings(StoreMeasureCodes, measureCount);
+		labels = strings(StoreLabels, labelCount);
+		measureSeries = reinterpret_cast<const uint32_t *>(
+			at(sections[StoreMeasureSeries], (measureCount + 1) * (uint64_t) sizeof(uint32_t)));
+		seriesAreas = reinterpret_cast<const uint32_t *>(at(sections[StoreSeriesAreas], seriesCount * sizeof(uint32_t)));
+		seriesLabels = reinterpret_cast<const uint32_t *>(
+			at(sections[StoreSeriesLabels], seriesCount * sizeof(uint32_t)));
+		seriesValues = reinterpret_cast<const uint64_t *>(
+			at(sections[StoreSeriesValues], (seriesCount + 1) * sizeof(uint64_t)));
+		years = reinterpret_cast<const uint32_t *>(at(sections[StoreYears], valueCount * sizeof(uint32_t)));
+		values = reinterpret_cast<const double *>(at(sections[StoreValues], valueCount * sizeof(double)));
+		parentChildren = strings(StoreParentChildren, (uint32_t) parentCount);
+		parentCodes = strings(StoreParentCodes, (uint32_t) parentCount);
+	} catch (...) {
+#ifndef _WIN32
+		::munmap(const_cast<char *>(data), length);
+#else
+		delete[] data;
+#endif
+		throw;
+	}
+}
+
+/**
+  Destructor, which unmaps the store.
+*/
+ColumnarStore::~ColumnarStore() {
+#ifndef _WIN32
+	::munmap(const_cast<char *>(data), length);
+#else
+	delete[] data;
+#endif
+}
+
+[[noreturn]] void ColumnarStore::fail(const std::string &problem) const {
+	throw std::runtime_error("ColumnarStore: " + path + " cannot be read: " + problem);
+}
+
+//a pointer to the bytes [offset, offset + size) of the store, which must be within it.
+const char *ColumnarStore::at(uint64_t offset, uint64_t size) const {
+	if (offset > length || size > length - offset) {
+		fail("a section runs past the end");
+	}
+	return data + offset;
+}
+
+//the end of a section is where the next one starts.
+uint64_t ColumnarStore::sectionEnd(StoreSection section) const noexcept {
+	return section + 1 < STORE_SECTIONS ? sections[section + 1] : length;
+}
+
+StoreStrings ColumnarStore::strings(StoreSection section, uint32_t count) const {
+	StoreStrings table;
+	const uint64_t tableBytes = (count + 1) * (uint64_t) sizeof(uint32_t);
+	table.offsets = reinterpret_cast<const uint32_t *>(at(sections[section], tableBytes));
+	table.bytes = data + sections[section] + tableBytes;
+	table.count = count;
+	table.size = (size_t) (std::max(sectionEnd(section), sections[section] + tableBytes) - sections[section] - tableBytes);
+	if (table.offsets[count] > table.size) {
+		fail("a string table runs past its section");
+	}
+	return table;
+}
+
+//materialise an area with its names, but none of its measures.
+Area ColumnarStore::area(uint32_t index) const {
+	std::string code = areaCodes.get(index);
+	Area area(code);
+
+	const uint64_t *blocks = reinterpret_cast<const uint64_t *>(data + sections[StoreAreaNames]);
+	const uint64_t bitmapBytes = padded((areaCount + 7) / 8);
+	for (uint32_t l = 0; l < languageCount; l++) {
+		const char *block = at(blocks[l], bitmapBytes);
+		if (((uint8_t) block[index / 8] >> (index % 8) & 1) == 0) {
+			continue;
+		}
+
+		StoreStrings names;
+		const uint64_t tableBytes = (areaCount + 1) * (uint64_t) sizeof(uint32_t);
+		names.offsets = reinterpret_cast<const uint32_t *>(at(blocks[l] + bitmapBytes, tableBytes));
+		names.bytes = data + blocks[l] + bitmapBytes + tableBytes;
+		names.count = areaCount;
+		names.size = length - (blocks[l] + bitmapBytes + tableBytes);
+		area.setName(languages.get(l), names.get(index));
+	}
+	return area;
+}
+
+//the series of an area's measure, found by binary search of the measure's series, or -1 if there is none.
+long ColumnarStore::findSeries(uint32_t measure, uint32_t area) const {
+	const uint32_t first = measureSeries[measure];
+	const uint32_t last = measureSeries[measure + 1];
+	if (first > last || last > seriesCount) {
+		fail("a measure's series are out of bounds");
+	}
+	const uint32_t *found = std::lower_bound(seriesAreas + first, seriesAreas + last, area);
+	if (found == seriesAreas + last || *found != area) {
+		return -1;
+	}
+	return found - seriesAreas;
+}
+
+//the index of the codes and names of the areas, which is built the first time it is needed.
+const AreaIndex& ColumnarStore::areaIndex() const {
+	std::call_once(indexed, [this]() {
+		std::unique_ptr<AreaIndex> built(new AreaIndex());
+		std::vector<std::string> names;
+		for (uint32_t a = 0; a < areaCount; a++) {
+			const Area area = this->area(a);
+			names.clear();
+			for (const auto &name : area.getNames()) {
+				names.push_back(name.second);
+			}
+			built->add(area.getLocalAuthorityCode(), names);
+		}
+		index = std::move(built);
+	});
+	return *index;
+}
+
+/**
+  @return
+    The number of areas in the store
+*/
+size_t ColumnarStore::areas() const noexcept {
+	return areaCount;
+}
+
+/**
+  @return
+    The number of measures in the store
+*/
+size_t ColumnarStore::measures() const noexcept {
+	return measureCount;
+}
+
+/**
+  @return
+    The number of series (measures of an area) in the store
+*/
+size_t ColumnarStore::series() const noexcept {
+	return (size_t) seriesCount;
+}
+
+/**
+  @return
+    The number of values in the store
+*/
+size_t ColumnarStore::size() const noexcept {
+	return (size_t) valueCount;
+}
+
+/**
+  Add the areas, measures and years of the store that pass the filters to an
+  Areas instance, as importing the datasets the store was written from with
+  the same filters would. Areas are matched as by the --areas argument (see
+  checkIfAreaMatchesFilter()) through an index of their codes and names,
+  measures by their code in any case, and each series' years by binary
+  search. An area with none of the selected values
+  is left out when measures or years are filtered, unless it was listed in
+  areas.csv. The parent of each area added is added to the hierarchy of data,
+  and its roll-ups are made from the areas added.
+
+  Only the pages of the store holding the selected areas and series are
+  read.
+
+  @param data
+    The Areas instance to add to
+
+  @param areasFilter
+    Area codes or names to match, or nullptr or empty for every area
+
+  @param measuresFilter
+    Measure codes to match, or nullptr or empty for every measure
+
+  @param yearsFilter
+    The range of years to add, or nullptr or <0, 0> for every year
+
+  @throws
+    std::runtime_error if the store is corrupt
+
+  @example
+    ColumnarStore store("wales.byws");
+    Areas data = Areas();
+    StringFilterSet measures = {"pop"};
+    store.populate(data, nullptr, &measures);
+*/
+void ColumnarStore::populate(
+	Areas &data,
+	const StringFilterSet *const areasFilter,
+	const StringFilterSet *const measuresFilter,
+	const YearFilterTuple *const yearsFilter) const {
+	const bool allAreas = areasFilter == nullptr || areasFilter->empty();
+	const bool allMeasures = measuresFilter == nullptr || measuresFilter->empty();
+	const bool allYears = yearsFilter == nullptr || std::get<1>(*yearsFilter) == 0;
+	const unsigned int firstYear = allYears ? 0 : std::get<0>(*yearsFilter);
+	const unsigned int lastYear = allYears ? UINT32_MAX : std::get<1>(*yearsFilter);
+
+	std::vector<uint32_t> selectedMeasures;
+	if (allMeasures) {
+		for (uint32_t m = 0; m < measureCount; m++) {
+			selectedMeasures.push_back(m);
+		}
+	} else {
+		std::set<uint32_t> found;
+		for (std::string code : *measuresFilter) {
+			std::transform(code.begin(), code.end(), code.begin(), ::tolower);
+			const long m = measureCodes.find(code);
+			if (m >= 0) {
+				found.insert((uint32_t) m);
+			}
+		}
+		selectedMeasures.assign(found.begin(), found.end());
+	}
+
+	std::vector<uint32_t> matchedAreas;
+	if (!allAreas) {
+		matchedAreas = areaIndex().find(*areasFilter);
+	}
+	const uint32_t selectedCount = allAreas ? areaCount : (uint32_t) matchedAreas.size();
+
+	std::vector<std::string> added;
+	for (uint32_t i = 0; i < selectedCount; i++) {
+		const uint32_t a = allAreas ? i : matchedAreas[i];
+		Area area = this->area(a);
+
+		bool hasSeries = false;
+		for (uint32_t m : selectedMeasures) {
+			const long s = findSeries(m, a);
+			if (s < 0) {
+				continue;
+			}
+			const uint64_t first = seriesValues[s];
+			const uint64_t last = seriesValues[s + 1];
+			if (first > last || last > valueCount) {
+				fail("a series' values are out of bounds");
+			}
+
+			//the years of a series are sorted, so the range of years is found by binary search.
+			const uint32_t *begin = std::lower_bound(years + first, years + last, firstYear);
+			const uint32_t *end = std::upper_bound(begin, years + last, lastYear);
+			if (begin == end) {
+				continue;
+			}
+
+			Measure measure(measureCodes.get(m), labels.get(seriesLabels[s]));
+			for (const uint32_t *year = begin; year != end; year++) {
+				measure.setValue(*year, values[year - years]);
+			}
+			area.setMeasure(measure.getCodename(), measure);
+			hasSeries = true;
+		}
+
+		//as in an import, an area listed in areas.csv is added even if none of its values are.
+		const bool listed = (listedAreas[a / 8] >> (a % 8)) & 1;
+		if (!hasSeries && !listed && (!allMeasures || !allYears)) {
+			continue;
+		}
+
+		data.setArea(area.getLocalAuthorityCode(), area);
+		added.push_back(area.getLocalAuthorityCode());
+	}
+
+	if (parentChildren.count == 0) {
+		return;
+	}
+	const AreaLookup lookup = [&data](const std::string &code) -> const Area * {
+		try {
+			return &data.getArea(code);
+		} catch (std::out_of_range &e) {
+			return nullptr;
+		}
+	};
+	for (const auto &code : added) {
+		const long link = parentChildren.find(code);
+		if (link >= 0) {
+			data.getHierarchy().setParent(code, parentCodes.get((uint32_t) link), lookup);
+		}
+	}
+}
+
+/**
+  Write imported data as a store (see store.h for its layout), to be opened
+  with ColumnarStore.
+
+  @param os
+    The output stream to write to, which should be opened in binary mode
+
+  @param data
+    The data to write, of which only the measures that are output are
+    written (see Areas::setMeasureView())
+
+  @param listedAreas
+    The codes of the areas listed in areas.csv (see BethYw::loadAreas()),
+    which a query adds even if none of their values pass its filters, or
+    nullptr to list every area that has no measures
+
+  @throws
+    std::runtime_error if this is not a little-endian machine, or the output
+    could not be written
+
+  @example
+    std::ofstream file("wales.byws", std::ios::binary);
+    writeColumnarStore(file, data);
+*/
+void writeColumnarStore(std::ostream &os, const Areas &data, const StringFilterSet *const listedAreas) {
+	if (!isLittleEndian()) {
+		throw std::runtime_error("writeColumnarStore: stores can only be written on a little-endian machine");
+	}
+
+	//the dictionaries, each sorted.
+	std::vector<std::string> areaCodes;
+	std::set<std::string> languageSet;
+	std::set<std::string> measureSet;
+	std::set<std::string> labelSet;
+	for (const auto &area : data) {
+		areaCodes.push_back(area.first);
+		for (const auto &name : area.second.getNames()) {
+			languageSet.insert(name.first);
+		}
+		for (const auto &measure : area.second.getMeasures()) {
+			if (!data.isMeasureInView(measure.first)) {
+				continue;
+			}
+			measureSet.insert(measure.first);
+			labelSet.insert(measure.second.getLabel());
+		}
+	}
+	const std::vector<std::string> languages(languageSet.begin(), languageSet.end());
+	const std::vector<std::string> measureCodes(measureSet.begin(), measureSet.end());
+	const std::vector<std::string> labels(labelSet.begin(), labelSet.end());
+	std::map<std::string, uint32_t> measureIndexes;
+	for (uint32_t i = 0; i < measureCodes.size(); i++) {
+		measureIndexes[measureCodes[i]] = i;
+	}
+	std::map<std::string, uint32_t> labelIndexes;
+	for (uint32_t i = 0; i < labels.size(); i++) {
+		labelIndexes[labels[i]] = i;
+	}
+
+	//the names in each language, and which areas have one.
+	const uint64_t bitmapBytes = padded((areaCodes.size() + 7) / 8);
+	std::vector<std::vector<uint8_t>> nameBitmaps(languages.size(), std::vector<uint8_t>(bitmapBytes, 0));
+	std::vector<uint8_t> listed(bitmapBytes, 0);
+	std::vector<std::vector<std::string>> names(languages.size(), std::vector<std::string>(areaCodes.size()));
+	std::vector<std::vector<const Measure *>> seriesByMeasure(measureCodes.size());
+	std::vector<std::vector<uint32_t>> areasByMeasure(measureCodes.size());
+	uint32_t a = 0;
+	for (const auto &area : data) {
+		uint32_t l = 0;
+		for (const auto &language : languages) {
+			auto name = area.second.getNames().find(language);
+			if (name != area.second.getNames().end()) {
+				nameBitmaps[l][a / 8] |= (uint8_t) (1u << (a % 8));
+				names[l][a] = name->second;
+			}
+			l++;
+		}
+		if (listedAreas != nullptr ? listedAreas->count(area.first) > 0 : area.second.getMeasures().empty()) {
+			listed[a / 8] |= (uint8_t) (1u << (a % 8));
+		}
+		for (const auto &measure : area.second.getMeasures()) {
+			if (!data.isMeasureInView(measure.first)) {
+				continue;
+			}
+			const uint32_t m = measureIndexes.at(measure.first);
+			seriesByMeasure[m].push_back(&measure.second);
+			areasByMeasure[m].push_back(a);
+		}
+		a++;
+	}
+
+	//the series of each measure are contiguous, in area order.
+	std::vector<uint32_t> measureSeries(1, 0);
+	std::vector<uint32_t> seriesAreas;
+	std::vector<uint32_t> seriesLabels;
+	std::vector<uint64_t> seriesValues(1, 0);
+	for (size_t m = 0; m < measureCodes.size(); m++) {
+		for (size_t i = 0; i < seriesByMeasure[m].size(); i++) {
+			seriesAreas.push_back(areasByMeasure[m][i]);
+			seriesLabels.push_back(labelIndexes.at(seriesByMeasure[m][i]->getLabel()));
+			seriesValues.push_back(seriesValues.back() + seriesByMeasure[m][i]->getValues().size());
+		}
+		measureSeries.push_back((uint32_t) seriesAreas.size());
+	}
+	const uint64_t valueCount = seriesValues.back();
+
+	std::vector<std::string> parentChildren;
+	std::vector<std::string> parentCodes;
+	for (const auto &link : data.getHierarchy().getParents()) {
+		parentChildren.push_back(link.first);
+		parentCodes.push_back(link.second);
+	}
+
+	//every section's size is known up front, so the header can be written first.
+	uint64_t sections[STORE_SECTIONS];
+	uint64_t offset = HEADER_BYTES;
+	uint64_t namesBytes = padded(languages.size() * sizeof(uint64_t));
+	for (const auto &language : names) {
+		namesBytes += bitmapBytes + stringTableBytes(language);
+	}
+	const uint64_t sizes[STORE_SECTIONS] = {
+		stringTableBytes(areaCodes),
+		stringTableBytes(languages),
+		namesBytes,
+		bitmapBytes,
+		stringTableBytes(measureCodes),
+		stringTableBytes(labels),
+		padded(measureSeries.size() * sizeof(uint32_t)),
+		padded(seriesAreas.size() * sizeof(uint32_t)),
+		padded(seriesLabels.size() * sizeof(uint32_t)),
+		seriesValues.size() * sizeof(uint64_t),
+		padded(valueCount * sizeof(uint32_t)),
+		valueCount * sizeof(double),
+		stringTableBytes(parentChildren),
+		stringTableBytes(parentCodes)
+	};
+	for (size_t s = 0; s < STORE_SECTIONS; s++) {
+		sections[s] = offset;
+		offset += sizes[s];
+	}
+
+	StoreWriter writer(os);
+	writer.bytes("BYWS", 4);
+	writer.value(STORE_VERSION);
+	writer.value((uint32_t) areaCodes.size());
+	writer.value((uint32_t) measureCodes.size());
+	writer.value((uint32_t) languages.size());
+	writer.value((uint32_t) labels.size());
+	writer.value((uint64_t) seriesAreas.size());
+	writer.value(valueCount);
+	writer.value((uint64_t) parentChildren.size());
+	writer.value(offset);
+	writer.bytes(sections, sizeof(sections));
+
+	writer.strings(areaCodes);
+	writer.strings(languages);
+	std::vector<uint64_t> blocks;
+	uint64_t block = sections[StoreAreaNames] + padded(languages.size() * sizeof(uint64_t));
+	for (const auto &language : names) {
+		blocks.push_back(block);
+		block += bitmapBytes + stringTableBytes(language);
+	}
+	writer.array(blocks);
+	writer.pad();
+	for (size_t l = 0; l < languages.size(); l++) {
+		writer.array(nameBitmaps[l]);
+		writer.strings(names[l]);
+	}
+	writer.array(listed);
+	writer.strings(measureCodes);
+	writer.strings(labels);
+	writer.array(measureSeries);
+	writer.pad();
+	writer.array(seriesAreas);
+	writer.pad();
+	writer.array(seriesLabels);
+	writer.pad();
+	writer.array(seriesValues);
+
+	//the years and values of each series, in the order of the series.
+	std::vector<uint32_t> yearColumn;
+	std::vector<double> valueColumn;
+	yearColumn.reserve((size_t) valueCount);
+	valueColumn.reserve((size_t) valueCount);
+	for (const auto &measure : seriesByMeasure) {
+		for (const Measure *series : measure) {
+			for (const auto &value : series->getValues()) {
+				yearColumn.push_back(value.first);
+				valueColumn.push_back(value.second);
+			}
+		}
+	}
+	writer.array(yearColumn);
+	writer.pad();
+	writer.array(valueColumn);
+	writer.strings(parentChildren);
+	writer.strings(parentCodes);
+
+	if (writer.offset() != offset) {
+		throw std::runtime_error("writeColumnarStore: the store was not written as laid out");
+	}
+	os.flush();
+	if (!os.good()) {
+		throw std::runtime_error("writeColumnarStore: failed to write the output");
+	}
+}
@@ -0,0 +1,179 @@
+#ifndef STORE_H_
+#define STORE_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the declaration of ColumnarStore, an immutable on-disk
+  store of imported data that is memory-mapped and queried in place. Opening
+  a store only maps the file and checks its header, however large it is, and
+  a query only reads the pages of the areas and series it selects, which are
+  materialised into an Areas instance so they can be output like imported
+  data. The file is mapped read-only and shared, so several processes
+  querying the same store share one copy of it in the page cache.
+
+  A store is laid out as follows, where every offset is in bytes from the
+  start of the file, every section starts on an 8-byte boundary and is
+  padded with zero bytes to the next one, and all numbers are little-endian:
+
+    header (168 bytes)
+      char[4]  magic, "BYWS"
+      uint32   version, 1
+      uint32   number of areas (A)
+      uint32   number of measures (M)
+      uint32   number of name languages (L)
+      uint32   number of distinct measure labels
+      uint64   number of series (S), i.e. measures of an area
+      uint64   number of values (V)
+      uint64   number of parent links (P), see hierarchy.h
+      uint64   size of the file
+      uint64[14]  offset of each section, in the order below
+
+    area codes           string table of A codes, sorted
+    languages            string table of L language codes, sorted
+    area names           uint64[L] offsets of a block for each language:
+                           a bitmap of (A + 7) / 8 bytes, where bit a % 8 of
+                           byte a / 8 is set if area a has a name in the
+                           language, then a string table of A names
+    listed areas         a bitmap of (A + 7) / 8 bytes, where an area's bit
+                           is set if it was listed in areas.csv, and so is
+                           added by a query even without any values
+    measure codes        string table of M codes, sorted
+    labels               string table of the measure labels
+    measure series       uint32[M + 1], the series of measure m are
+                           [series[m], series[m + 1])
+    series areas         uint32[S], the area of each series, sorted within
+                           each measure's series
+    series labels        uint32[S], the label of each series
+    series values        uint64[S + 1], the values of series s are
+                           [values[s], values[s + 1])
+    years                uint32[V], sorted within each series
+    values               double[V]
+    parent children      string table of P area codes, sorted
+    parent codes         string table of the P parents of those areas
+
+  A string table of n strings is uint32[n + 1] offsets into the bytes that
+  follow, then the bytes of the strings without terminators, so string i is
+  the bytes [offsets[i], offsets[i + 1]).
+
+  The series of each measure, and their values, are contiguous, so a query
+  for one measure reads one run of the file. The areas that match an areas
+  filter are found with an AreaIndex (see search.h) of the store's codes and
+  names, built the first time a query filters areas and then kept, so later
+  queries of the same store do not look at every area.
+ */
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+#include "areas.h"
+#include "search.h"
+
+/*
+  The version of the store format written, in the header.
+*/
+const uint32_t STORE_VERSION = 1;
+
+/*
+  The sections of a store, in the order of their offsets in the header.
+*/
+enum StoreSection {
+	StoreAreaCodes,
+	StoreLanguages,
+	StoreAreaNames,
+	StoreListedAreas,
+	StoreMeasureCodes,
+	StoreLabels,
+	StoreMeasureSeries,
+	StoreSeriesAreas,
+	StoreSeriesLabels,
+	StoreSeriesValues,
+	StoreYears,
+	StoreValues,
+	StoreParentChildren,
+	StoreParentCodes,
+	STORE_SECTIONS
+};
+
+/*
+  A string table within a mapped store.
+*/
+struct StoreStrings {
+	const uint32_t *offsets = nullptr;
+	const char *bytes = nullptr;
+	uint32_t count = 0;
+	size_t size = 0;
+
+	std::string get(uint32_t i) const;
+	int compare(uint32_t i, const std::string &str) const;
+	long find(const std::string &str) const;
+};
+
+class ColumnarStore {
+ private:
+	std::string path;
+	const char *data;
+	size_t length;
+
+	uint32_t areaCount;
+	uint32_t measureCount;
+	uint32_t languageCount;
+	uint64_t seriesCount;
+	uint64_t valueCount;
+	uint64_t sections[STORE_SECTIONS];
+
+	StoreStrings areaCodes;
+	StoreStrings languages;
+	StoreStrings measureCodes;
+	StoreStrings labels;
+	StoreStrings parentChildren;
+	StoreStrings parentCodes;
+	const uint8_t *listedAreas;
+	const uint32_t *measureSeries;
+	const uint32_t *seriesAreas;
+	const uint32_t *seriesLabels;
+	const uint64_t *seriesValues;
+	const uint32_t *years;
+	const double *values;
+
+	//built the first time areas are filtered (see areaIndex()).
+	mutable std::once_flag indexed;
+	mutable std::unique_ptr<AreaIndex> index;
+
+	[[noreturn]] void fail(const std::string &problem) const;
+	const char *at(uint64_t offset, uint64_t size) const;
+	StoreStrings strings(StoreSection section, uint32_t count) const;
+	uint64_t sectionEnd(StoreSection section) const noexcept;
+	Area area(uint32_t index) const;
+	long findSeries(uint32_t measure, uint32_t area) const;
+	const AreaIndex& areaIndex() const;
+
+ public:
+	explicit ColumnarStore(const std::string &path);
+	~ColumnarStore();
+
+	ColumnarStore(const ColumnarStore &other) = delete;
+	ColumnarStore &operator=(const ColumnarStore &other) = delete;
+
+	size_t areas() const noexcept;
+	size_t measures() const noexcept;
+	size_t series() const noexcept;
+	size_t size() const noexcept;
+
+	void populate(
+		Areas &data,
+		const StringFilterSet *const areasFilter = nullptr,
+		const StringFilterSet *const measuresFilter = nullptr,
+		const YearFilterTuple *const yearsFilter = nullptr) const;
+};
+
+void writeColumnarStore(std::ostream &os, const Areas &data, const StringFilterSet *const listedAreas = nullptr);
+
+#endif // STORE_H_
@@ -0,0 +1,291 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <fstream>
+#include <string>
+
+#include "../lib_cxxopts.hpp"
+#include "../lib_cxxopts_argv.hpp"
+
+#include "../datasets.h"
+#include "../areas.h"
+#include "../bethyw.h"
+
+SCENARIO( "the memory used by Areas can be accounted for", "[Areas][memory]" ) {
+
+  GIVEN( "a Measure instance" ) {
+
+    Measure measure("pop", "Population");
+    auto empty = measure.memoryUsage();
+
+    THEN( "an empty Measure uses at least its own size" ) {
+
+      REQUIRE( empty >= sizeof(Measure) );
+
+    } // THEN
+
+    WHEN( "values are added" ) {
+
+      measure.setValue(1999, 1.0);
+      measure.setValue(2000, 2.0);
+
+      THEN( "the memory used grows with each year" ) {
+
+        auto two = measure.memoryUsage();
+        REQUIRE( two > empty );
+
+        measure.setValue(2001, 3.0);
+        REQUIRE( measure.memoryUsage() - two == (two - empty) / 2 );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+  GIVEN( "an Areas instance populated from popu1009.json" ) {
+
+    Areas areas = Areas();
+    std::ifstream stream("datasets/popu1009.json");
+    REQUIRE( stream.is_open() );
+    areas.populateFromWelshStatsJSON(stream, BethYw::InputFiles::POPDEN.COLS);
+
+    THEN( "the usage by measure contains each measure and sums to less than the total" ) {
+
+      auto usage = areas.memoryUsageByMeasure();
+      REQUIRE( usage.size() == 3 );
+      REQUIRE( usage.count("pop") == 1 );
+      REQUIRE( usage.count("dens") == 1 );
+      REQUIRE( usage.count("area") == 1 );
+      REQUIRE( usage["pop"] + usage["dens"] + usage["area"] < areas.memoryUsage() );
+
+    } // THEN
+
+    WHEN( "a measure is removed" ) {
+
+      auto before = areas.memoryUsage();
+      auto pop    = areas.memoryUsageByMeasure()["pop"];
+      auto freed  = areas.removeMeasure("Pop");
+
+      THEN( "the bytes released match the bytes the measure was using" ) {
+
+        REQUIRE( freed == pop );
+        REQUIRE( areas.memoryUsage() == before - pop );
+        REQUIRE( areas.memoryUsageByMeasure().count("pop") == 0 );
+        REQUIRE_THROWS_AS( areas.getArea("W06000011").getMeasure("pop"), std::out_of_range );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "the memory budget is checked as a dataset is imported", "[Areas][memory]" ) {
+
+  Areas unlimited = Areas();
+  std::ifstream full("datasets/popu1009.json");
+  REQUIRE( full.is_open() );
+  unlimited.populateFromWelshStatsJSON(full, BethYw::InputFiles::POPDEN.COLS);
+  const size_t total = unlimited.memoryUsage();
+
+  std::ifstream stream("datasets/popu1009.json");
+  REQUIRE( stream.is_open() );
+  Areas areas = Areas();
+  const size_t before = areas.memoryUsage();
+
+  GIVEN( "an import budget the whole dataset fits in" ) {
+
+    ImportBudget import;
+    import.headroom = total;
+    areas.setImportBudget(&import);
+    areas.populateFromWelshStatsJSON(stream, BethYw::InputFiles::POPDEN.COLS);
+    areas.setImportBudget(nullptr);
+
+    THEN( "the bytes estimated as each value is merged match the memory used" ) {
+
+      REQUIRE_FALSE( import.exceeded );
+      REQUIRE( import.added == areas.memoryUsage() - before );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "an import budget of a quarter of the dataset that must not degrade" ) {
+
+    ImportBudget import;
+    import.headroom = (total - before) / 4;
+    import.degrade = false;
+    areas.setImportBudget(&import);
+
+    THEN( "the import stops as soon as it goes over, rather than at the end" ) {
+
+      REQUIRE_THROWS_AS( areas.populateFromWelshStatsJSON(stream, BethYw::InputFiles::POPDEN.COLS),
+                         std::runtime_error );
+      areas.setImportBudget(nullptr);
+
+      REQUIRE( import.exceeded );
+      REQUIRE( import.dropped.empty() );
+      REQUIRE( areas.memoryUsage() < before + import.headroom + 1024 );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "an import budget of two thirds of the dataset that may degrade" ) {
+
+    ImportBudget import;
+    import.headroom = (total - before) * 2 / 3;
+    areas.setImportBudget(&import);
+    areas.populateFromWelshStatsJSON(stream, BethYw::InputFiles::POPDEN.COLS);
+    areas.setImportBudget(nullptr);
+
+    THEN( "measures are dropped as the import goes, and the measures kept are complete" ) {
+
+      REQUIRE_FALSE( import.exceeded );
+      REQUIRE_FALSE( import.dropped.empty() );
+      REQUIRE( areas.memoryUsage() <= before + import.headroom );
+
+      auto kept = areas.memoryUsageByMeasure();
+      auto all = unlimited.memoryUsageByMeasure();
+      REQUIRE( kept.size() + import.dropped.size() == all.size() );
+      for (const auto &it : kept) {
+        REQUIRE( it.second == all[it.first] );
+      }
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "the memory budget program arguments can be parsed correctly", "[args][memory]" ) {
+
+  auto parse = [](std::initializer_list<const char*> values) {
+    Argv argv(values);
+    auto** actual_argv = argv.argv();
+    auto argc          = argv.argc();
+
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args    = cxxopts.parse(argc, actual_argv);
+    return BethYw::parseMemoryBudgetArgs(args);
+  };
+
+  GIVEN( "no memory budget argument" ) {
+
+    THEN( "there is no budget and the policy is to degrade" ) {
+
+      auto budget = parse({"test"});
+      REQUIRE( budget.limit == 0 );
+      REQUIRE( budget.degrade );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "a memory budget argument with a unit suffix" ) {
+
+    THEN( "the limit is scaled by the unit" ) {
+
+      REQUIRE( parse({"test", "--memory-budget", "512"}).limit == 512 );
+      REQUIRE( parse({"test", "--memory-budget", "2k"}).limit == 2048 );
+      REQUIRE( parse({"test", "--memory-budget", "64M"}).limit == 64u << 20 );
+      REQUIRE( parse({"test", "--memory-budget", "1GiB"}).limit == 1u << 30 );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "invalid memory budget arguments" ) {
+
+    THEN( "a std::invalid_argument exception is thrown" ) {
+
+      REQUIRE_THROWS_AS( parse({"test", "--memory-budget", "lots"}), std::invalid_argument );
+      REQUIRE_THROWS_AS( parse({"test", "--memory-budget", "99999999999999999999"}), std::invalid_argument );
+      REQUIRE_THROWS_AS( parse({"test", "--memory-budget", "17179869184G"}), std::invalid_argument );
+      REQUIRE_THROWS_AS( parse({"test", "--memory-policy", "panic"}), std::invalid_argument );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "the abort memory policy" ) {
+
+    THEN( "the budget does not degrade" ) {
+
+      REQUIRE_FALSE( parse({"test", "--memory-policy", "abort"}).degrade );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "datasets can be loaded within a memory budget", "[bethyw][memory]" ) {
+
+  std::string dir = "datasets/";
+  std::vector<BethYw::InputFileSource> datasets = { BethYw::InputFiles::POPDEN,
+                                                    BethYw::InputFiles::BIZ };
+  StringFilterSet areasFilter;
+  StringFilterSet measuresFilter;
+  YearFilterTuple yearsFilter(0, 0);
+
+  GIVEN( "a budget that only fits the first dataset" ) {
+
+    Areas unlimited = Areas();
+    BethYw::MemoryBudget measured;
+    BethYw::loadDatasets(unlimited, dir, {BethYw::InputFiles::POPDEN},
+                         areasFilter, measuresFilter, yearsFilter, &measured);
+
+    BethYw::MemoryBudget budget;
+    budget.limit = unlimited.memoryUsage() + 1024;
+
+    WHEN( "the policy is to degrade" ) {
+
+      Areas areas = Areas();
+      BethYw::loadDatasets(areas, dir, datasets, areasFilter, measuresFilter, yearsFilter, &budget);
+
+      THEN( "the second dataset's measures are dropped and the data fits" ) {
+
+        REQUIRE_FALSE( budget.exceeded );
+        REQUIRE_FALSE( budget.droppedMeasures.empty() );
+        REQUIRE( areas.memoryUsage() <= budget.limit );
+        REQUIRE( budget.usageByDataset.count("popden") == 1 );
+        REQUIRE( budget.usageByDataset.count("biz") == 1 );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "the policy is to abort" ) {
+
+      budget.degrade = false;
+      Areas areas = Areas();
+      BethYw::loadDatasets(areas, dir, datasets, areasFilter, measuresFilter, yearsFilter, &budget);
+
+      THEN( "the budget is marked as exceeded" ) {
+
+        REQUIRE( budget.exceeded );
+        REQUIRE( budget.droppedMeasures.empty() );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
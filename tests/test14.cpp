@@ -0,0 +1,151 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "../datasets.h"
+#include "../areas.h"
+#include "../input.h"
+
+SCENARIO( "nextLinks can be resolved to local page files", "[LocalPageResolver]" ) {
+
+  GIVEN( "a LocalPageResolver for a directory" ) {
+
+    LocalPageResolver resolver("tests/datasets/");
+
+    THEN( "StatsWales skip tokens resolve to the row index of the next page" ) {
+
+      REQUIRE( resolver.pagePath("http://open.statswales.gov.wales/en-gb/dataset/econ0080?%24skiptoken=1!24!MDAwMDAwMDAwMDAwMTAwMA--%7c1!0!%7c1000%7c2795c3f066034513a1148b25c499b15c")
+               == "tests/datasets/econ0080-1000.json" );
+
+    } // THEN
+
+    THEN( "plain skip links resolve to the row index of the next page" ) {
+
+      REQUIRE( resolver.pagePath("http://localhost/dataset/popu1009?$skip=2000&$top=1000")
+               == "tests/datasets/popu1009-2000.json" );
+
+    } // THEN
+
+    THEN( "a % followed by anything other than two hex digits, including UTF-8, is left as it is" ) {
+
+      REQUIRE( resolver.pagePath("http://localhost/dataset/popu%C3%A9?$skip=2000") == "tests/datasets/popu\xC3\xA9-2000.json" );
+      REQUIRE( resolver.pagePath("http://localhost/dataset/popu%\xC3\xA9?$skip=2000") == "tests/datasets/popu%\xC3\xA9-2000.json" );
+
+    } // THEN
+
+    THEN( "links that are not understood do not resolve" ) {
+
+      REQUIRE( resolver.pagePath("http://localhost/dataset/popu1009") == "" );
+      REQUIRE( resolver.pagePath("http://localhost/dataset/popu1009?$skip=next") == "" );
+      REQUIRE( resolver.resolve("http://localhost/dataset/popu1009") == nullptr );
+
+    } // THEN
+
+    THEN( "links to pages that do not exist do not resolve" ) {
+
+      REQUIRE( resolver.resolve("http://localhost/dataset/paged?$skip=4") == nullptr );
+
+    } // THEN
+
+    THEN( "links to pages that exist resolve to an InputSource for the page" ) {
+
+      auto page = resolver.resolve("http://localhost/dataset/paged?$skip=2");
+      REQUIRE( page != nullptr );
+      REQUIRE( page->getSource() == "tests/datasets/paged-2.json" );
+      REQUIRE_NOTHROW( page->open() );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "a JSON dataset split over several pages can be imported", "[Areas][pages]" ) {
+
+  GIVEN( "the first page of a paged dataset as an open std::istream" ) {
+
+    std::ifstream stream("tests/datasets/paged.json");
+    REQUIRE( stream.is_open() );
+
+    LocalPageResolver resolver("tests/datasets/");
+    Areas areas = Areas();
+
+    WHEN( "the dataset is imported by following the pages" ) {
+
+      REQUIRE_NOTHROW( areas.populateFromWelshStatsJSONPages(stream, resolver, BethYw::InputFiles::POPDEN.COLS) );
+
+      THEN( "the values from every page are imported" ) {
+
+        REQUIRE( areas.size() == 2 );
+        REQUIRE( areas.getArea("W06000011").getMeasure("pop").size() == 3 );
+        REQUIRE( areas.getArea("W06000011").getMeasure("pop").getValue(2012) == 242000.0 );
+        REQUIRE( areas.getArea("W06000012").getMeasure("pop").getValue(2012) == 140000.0 );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "the dataset is imported through populate() with a resolver and a years filter" ) {
+
+      StringFilterSet areasFilter;
+      StringFilterSet measuresFilter;
+      YearFilterTuple yearsFilter(2011, 2012);
+
+      REQUIRE_NOTHROW( areas.populate(stream, BethYw::WelshStatsJSON, BethYw::InputFiles::POPDEN.COLS,
+                                      &areasFilter, &measuresFilter, &yearsFilter, &resolver) );
+
+      THEN( "the filter is applied to every page" ) {
+
+        REQUIRE( areas.getArea("W06000011").getMeasure("pop").size() == 2 );
+        REQUIRE_THROWS_AS( areas.getArea("W06000011").getMeasure("pop").getValue(2010), std::out_of_range );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "the dataset is imported without following the pages" ) {
+
+      areas.populateFromWelshStatsJSON(stream, BethYw::InputFiles::POPDEN.COLS);
+
+      THEN( "only the first page is imported" ) {
+
+        REQUIRE( areas.size() == 1 );
+        REQUIRE( areas.getArea("W06000011").getMeasure("pop").size() == 2 );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+  GIVEN( "a malformed first page" ) {
+
+    std::istringstream stream("{ \"value\": [");
+    LocalPageResolver resolver("tests/datasets/");
+    Areas areas = Areas();
+
+    THEN( "the parse error is passed on to the caller" ) {
+
+      REQUIRE_THROWS( areas.populateFromWelshStatsJSONPages(stream, resolver, BethYw::InputFiles::POPDEN.COLS) );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
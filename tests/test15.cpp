@@ -0,0 +1,303 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../datasets.h"
+#include "../areas.h"
+#include "../bethyw.h"
+#include "../http.h"
+#include "../odataserver.h"
+
+/*
+  A server on the loopback interface that answers one request with a canned
+  response, which need not be valid HTTP, or with nothing at all if the
+  response is empty, in which case it waits for the client to give up.
+*/
+class CannedHTTPServer {
+ private:
+  int listener;
+  int port;
+  std::thread thread;
+
+ public:
+  explicit CannedHTTPServer(const std::string &response) : listener(-1), port(0) {
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (listener < 0 || bind(listener, (sockaddr *) &address, length) != 0 || listen(listener, 1) != 0
+        || getsockname(listener, (sockaddr *) &address, &length) != 0) {
+      throw std::runtime_error("CannedHTTPServer: Failed to listen");
+    }
+    port = ntohs(address.sin_port);
+
+    thread = std::thread([this, response]() {
+      int fd = accept(listener, nullptr, nullptr);
+      if (fd < 0) {
+        return;
+      }
+      std::string request;
+      char buffer[1024];
+      ssize_t n;
+      while (request.find("\r\n\r\n") == std::string::npos && (n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+        request.append(buffer, n);
+      }
+      if (!response.empty()) {
+        send(fd, response.data(), response.size(), MSG_NOSIGNAL);
+      } else {
+        while (recv(fd, buffer, sizeof(buffer), 0) > 0) {}
+      }
+      close(fd);
+    });
+  }
+
+  ~CannedHTTPServer() {
+    thread.join();
+    close(listener);
+  }
+
+  std::string url() const {
+    return "http://127.0.0.1:" + std::to_string(port) + "/";
+  }
+};
+
+SCENARIO( "http:// URLs can be parsed", "[http][URL]" ) {
+
+  THEN( "the host, port and path are split out" ) {
+
+    URL url = parseURL("http://127.0.0.1:8080/dataset/popu1009?$skip=0");
+    REQUIRE( url.host == "127.0.0.1" );
+    REQUIRE( url.port == "8080" );
+    REQUIRE( url.path == "/dataset/popu1009?$skip=0" );
+
+  } // THEN
+
+  THEN( "the port and path have defaults" ) {
+
+    URL url = parseURL("HTTP://open.statswales.gov.wales");
+    REQUIRE( url.host == "open.statswales.gov.wales" );
+    REQUIRE( url.port == "80" );
+    REQUIRE( url.path == "/" );
+
+  } // THEN
+
+  THEN( "locations that are not http:// URLs are rejected" ) {
+
+    REQUIRE_FALSE( isHTTPURL("datasets/") );
+    REQUIRE_FALSE( isHTTPURL("https://example.com/") );
+    REQUIRE_THROWS_AS( parseURL("datasets/areas.csv"), std::invalid_argument );
+
+  } // THEN
+
+} // SCENARIO
+
+SCENARIO( "datasets can be read over HTTP from the local OData server", "[http][InputHTTP]" ) {
+
+  GIVEN( "a running ODataServer serving the datasets directory in pages of 100 rows" ) {
+
+    ODataServer server("datasets/", 100);
+    REQUIRE_NOTHROW( server.start() );
+    REQUIRE( server.port() != 0 );
+
+    WHEN( "a file is requested" ) {
+
+      InputHTTP input(server.baseURL() + "/areas.csv");
+
+      THEN( "the stream contains the contents of the file" ) {
+
+        std::ifstream file("datasets/areas.csv");
+        std::stringstream expected;
+        expected << file.rdbuf();
+
+        std::stringstream actual;
+        actual << input.open().rdbuf();
+        REQUIRE( actual.str() == expected.str() );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a file that does not exist is requested" ) {
+
+      InputHTTP input(server.baseURL() + "/doesnotexist.csv");
+
+      THEN( "opening it throws an exception" ) {
+
+        REQUIRE_THROWS_AS( input.open(), std::runtime_error );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a paged dataset is imported with several connections" ) {
+
+      InputHTTP input(server.baseURL() + "/dataset/popu1009");
+      HTTPPageResolver resolver(4);
+
+      Areas remote = Areas();
+      REQUIRE_NOTHROW( remote.populateFromWelshStatsJSONPages(input.open(), resolver, BethYw::InputFiles::POPDEN.COLS) );
+
+      THEN( "the result is the same as importing the file from disk" ) {
+
+        std::ifstream stream("datasets/popu1009.json");
+        Areas local = Areas();
+        local.populateFromWelshStatsJSON(stream, BethYw::InputFiles::POPDEN.COLS);
+
+        REQUIRE( remote.size() == 12 );
+        REQUIRE( remote.toJSON() == local.toJSON() );
+
+      } // THEN
+
+      THEN( "every page was requested" ) {
+
+        REQUIRE( server.requestCount() >= 10 );
+
+      } // THEN
+
+      THEN( "no requests for pages after the last are left in flight" ) {
+
+        REQUIRE( resolver.pending() == 0 );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "the datasets are loaded by bethyw from the server's URL" ) {
+
+      std::string dir = server.baseURL() + "/";
+      std::vector<BethYw::InputFileSource> datasets = { BethYw::InputFiles::POPDEN,
+                                                        BethYw::InputFiles::COMPLETE_POP };
+      StringFilterSet areasFilter;
+      StringFilterSet measuresFilter;
+      YearFilterTuple yearsFilter(0, 0);
+
+      Areas remote = Areas();
+      BethYw::loadAreas(remote, dir, areasFilter);
+      BethYw::loadDatasets(remote, dir, datasets, areasFilter, measuresFilter, yearsFilter, nullptr,
+                           BethYw::makePageResolver(dir, 3).get());
+
+      THEN( "the result is the same as loading them from disk" ) {
+
+        std::string local_dir = "datasets/";
+        Areas local = Areas();
+        BethYw::loadAreas(local, local_dir, areasFilter);
+        BethYw::loadDatasets(local, local_dir, datasets, areasFilter, measuresFilter, yearsFilter);
+
+        REQUIRE( remote.size() == local.size() );
+        REQUIRE( remote.toJSON() == local.toJSON() );
+
+      } // THEN
+
+    } // WHEN
+
+    server.stop();
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "malformed or stalled HTTP responses are reported as runtime errors", "[http][httpGet]" ) {
+
+  GIVEN( "a chunked response" ) {
+
+    CannedHTTPServer server("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                            "4\r\nWiki\r\n5;name=value\r\npedia\r\n0\r\n\r\n");
+
+    THEN( "the body is decoded" ) {
+
+      HTTPResponse response = httpGet(server.url());
+      REQUIRE( response.status == 200 );
+      REQUIRE( response.body == "Wikipedia" );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "a response whose status line has no status code" ) {
+
+    CannedHTTPServer server("HTTP/1.1 OK\r\n\r\nbody");
+
+    THEN( "a std::runtime_error is thrown" ) {
+
+      REQUIRE_THROWS_AS( httpGet(server.url()), std::runtime_error );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "a response for InputHTTP whose status code is not a number" ) {
+
+    CannedHTTPServer server("HTTP/1.1 2x0 OK\r\n\r\nbody");
+
+    THEN( "opening it throws a std::runtime_error" ) {
+
+      InputHTTP input(server.url());
+      REQUIRE_THROWS_AS( input.open(), std::runtime_error );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "a chunked response with a chunk size that is not hex" ) {
+
+    CannedHTTPServer server("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\nbody\r\n0\r\n\r\n");
+
+    THEN( "a std::runtime_error is thrown" ) {
+
+      REQUIRE_THROWS_AS( httpGet(server.url()), std::runtime_error );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "a chunked response that ends part way through a chunk" ) {
+
+    CannedHTTPServer server("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n10\r\nabc");
+
+    THEN( "a std::runtime_error is thrown" ) {
+
+      REQUIRE_THROWS_AS( httpGet(server.url()), std::runtime_error );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "a server that never responds" ) {
+
+    CannedHTTPServer server("");
+
+    THEN( "the request times out with a std::runtime_error" ) {
+
+      auto start = std::chrono::steady_clock::now();
+      REQUIRE_THROWS_AS( httpGet(server.url(), 200), std::runtime_error );
+      REQUIRE( std::chrono::steady_clock::now() - start < std::chrono::seconds(10) );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
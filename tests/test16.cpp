@@ -0,0 +1,190 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "../datasets.h"
+#include "../areas.h"
+#include "../bethyw.h"
+#include "../compression.h"
+
+SCENARIO( "the compression format of a stream can be detected from its magic bytes", "[compression][detectCompression]" ) {
+
+  GIVEN( "a gzip file" ) {
+
+    std::ifstream file("tests/datasets/popu1009.json.gz", std::ios::binary);
+
+    THEN( "it is detected as gzip without consuming the magic bytes" ) {
+
+      REQUIRE( detectCompression(file) == Gzip );
+      REQUIRE( file.get() == 0x1f );
+      REQUIRE( file.get() == 0x8b );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "an uncompressed file" ) {
+
+    std::ifstream file("datasets/popu1009.json");
+
+    THEN( "it is not detected as compressed and can still be read from the start" ) {
+
+      REQUIRE( detectCompression(file) == NoCompression );
+      REQUIRE( file.get() == '{' );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "streams starting with the magic bytes of other formats" ) {
+
+    std::istringstream bzip2("BZh91AY&SY");
+    std::istringstream xz(std::string("\xfd" "7zXZ\0\0", 7));
+    std::istringstream zstd("\x28\xb5\x2f\xfd");
+    std::istringstream tiny("\x1f");
+
+    THEN( "the formats are recognised" ) {
+
+      REQUIRE( detectCompression(bzip2) == Bzip2 );
+      REQUIRE( detectCompression(xz) == Xz );
+      REQUIRE( detectCompression(zstd) == Zstd );
+      REQUIRE( detectCompression(tiny) == NoCompression );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "gzipped datasets can be imported without decompressing them first", "[compression][InputDecompressor]" ) {
+
+  GIVEN( "a gzipped copy of popu1009.json" ) {
+
+    InputDecompressor input(std::unique_ptr<InputSource>(new InputFile("tests/datasets/popu1009.json.gz")));
+
+    WHEN( "it is imported" ) {
+
+      Areas compressed = Areas();
+      REQUIRE_NOTHROW( compressed.populateFromWelshStatsJSON(input.open(), BethYw::InputFiles::POPDEN.COLS) );
+
+      THEN( "it was detected as gzip" ) {
+
+        REQUIRE( input.compression() == Gzip );
+
+      } // THEN
+
+      THEN( "the result is the same as importing the uncompressed file" ) {
+
+        std::ifstream stream("datasets/popu1009.json");
+        Areas plain = Areas();
+        plain.populateFromWelshStatsJSON(stream, BethYw::InputFiles::POPDEN.COLS);
+
+        REQUIRE( compressed.size() == 12 );
+        REQUIRE( compressed.toJSON() == plain.toJSON() );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "only the start of the stream is read" ) {
+
+      std::istream &is = input.open();
+      char start[16];
+      is.read(start, sizeof(start));
+
+      THEN( "the source can be destroyed while the decompression thread is still running" ) {
+
+        REQUIRE( is.gcount() == 16 );
+        REQUIRE( start[0] == '{' );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+  GIVEN( "a directory with only gzipped copies of areas.csv and popu1009.json" ) {
+
+    std::string dir = "tests/datasets/";
+
+    WHEN( "the datasets are loaded by bethyw" ) {
+
+      std::vector<BethYw::InputFileSource> datasets = { BethYw::InputFiles::POPDEN };
+      StringFilterSet areasFilter;
+      StringFilterSet measuresFilter;
+      YearFilterTuple yearsFilter(0, 0);
+
+      Areas compressed = Areas();
+      BethYw::loadAreas(compressed, dir, areasFilter);
+      BethYw::loadDatasets(compressed, dir, datasets, areasFilter, measuresFilter, yearsFilter);
+
+      THEN( "the .gz files are used in their place" ) {
+
+        std::string local_dir = "datasets/";
+        Areas plain = Areas();
+        BethYw::loadAreas(plain, local_dir, areasFilter);
+        BethYw::loadDatasets(plain, local_dir, datasets, areasFilter, measuresFilter, yearsFilter);
+
+        REQUIRE( compressed.size() == 22 );
+        REQUIRE( compressed.toJSON() == plain.toJSON() );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+  GIVEN( "a truncated gzip stream" ) {
+
+    std::ifstream file("tests/datasets/popu1009.json.gz", std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::istringstream truncated(bytes.substr(0, bytes.size() / 2));
+
+    GzipStreamBuf buffer(truncated, "truncated");
+    std::istream is(&buffer);
+    is.exceptions(std::ios::badbit);
+
+    THEN( "reading past the data that could be decompressed throws an exception" ) {
+
+      std::string contents;
+      REQUIRE_THROWS_AS( std::getline(is, contents, '\0'), std::runtime_error );
+      REQUIRE( contents.size() > 0 );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "a source compressed in a format we cannot decompress" ) {
+
+    std::ofstream("tests/datasets/bzip2.json") << "BZh91AY&SY";
+    InputDecompressor input(std::unique_ptr<InputSource>(new InputFile("tests/datasets/bzip2.json")));
+
+    THEN( "opening it throws an exception" ) {
+
+      REQUIRE_THROWS_AS( input.open(), std::runtime_error );
+      REQUIRE( input.compression() == Bzip2 );
+
+    } // THEN
+
+    std::remove("tests/datasets/bzip2.json");
+
+  } // GIVEN
+
+} // SCENARIO
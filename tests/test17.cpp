@@ -0,0 +1,286 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../lib_json.hpp"
+#include "../datasets.h"
+#include "../areas.h"
+#include "../bethyw.h"
+#include "../watcher.h"
+
+/*
+  Copy some of the datasets into a new temporary directory, so that the tests
+  can change them.
+*/
+static std::string copyDatasets(const std::vector<std::string> &files) {
+  char pattern[] = "/tmp/bethyw-watch-XXXXXX";
+  std::string dir = std::string(mkdtemp(pattern)) + "/";
+
+  for (const auto &file : files) {
+    std::ifstream in("datasets/" + file, std::ios::binary);
+    std::ofstream out(dir + file, std::ios::binary);
+    out << in.rdbuf();
+  }
+
+  return dir;
+}
+
+/*
+  Keep the caches written while testing (see cacheDirectory() in catalog.h)
+  in a new temporary directory, rather than in the cache of whoever runs the
+  tests.
+*/
+static const bool testCacheHome = [] {
+  char pattern[] = "/tmp/bethyw-cache-XXXXXX";
+  return setenv("XDG_CACHE_HOME", mkdtemp(pattern), 1) == 0;
+}();
+
+static void removeDatasets(const std::string &dir, const std::vector<std::string> &files) {
+  for (const auto &file : files) {
+    std::remove((dir + file).c_str());
+  }
+  rmdir(dir.c_str());
+}
+
+/*
+  Import the datasets in a directory from scratch, as bethyw does without
+  --watch.
+*/
+static std::string importFresh(std::string dir, const std::vector<BethYw::InputFileSource> &datasets) {
+  StringFilterSet areasFilter;
+  StringFilterSet measuresFilter;
+  YearFilterTuple yearsFilter(0, 0);
+
+  Areas fresh = Areas();
+  BethYw::loadAreas(fresh, dir, areasFilter);
+  BethYw::loadDatasets(fresh, dir, datasets, areasFilter, measuresFilter, yearsFilter);
+  return fresh.toJSON();
+}
+
+SCENARIO( "an IncrementalLoader knows which files it imports", "[IncrementalLoader][watches]" ) {
+
+  Areas data = Areas();
+  std::vector<BethYw::InputFileSource> datasets = { BethYw::InputFiles::POPDEN,
+                                                    BethYw::InputFiles::COMPLETE_POP };
+  IncrementalLoader loader(data, "datasets/", datasets, StringFilterSet(), StringFilterSet(), YearFilterTuple(0, 0));
+
+  THEN( "areas.csv, the dataset files, their gzipped copies and later pages are watched" ) {
+
+    REQUIRE( loader.watches("areas.csv") );
+    REQUIRE( loader.watches("popu1009.json") );
+    REQUIRE( loader.watches("popu1009.json.gz") );
+    REQUIRE( loader.watches("popu1009-1000.json") );
+    REQUIRE( loader.watches("complete-popu1009-pop.csv") );
+
+  } // THEN
+
+  THEN( "other files are not" ) {
+
+    REQUIRE_FALSE( loader.watches("econ0080.json") );
+    REQUIRE_FALSE( loader.watches("popu1009-next.json") );
+    REQUIRE_FALSE( loader.watches(".popu1009.json.swp") );
+    REQUIRE_FALSE( loader.watches("complete-popu1009-pop-1000.csv") );
+
+  } // THEN
+
+} // SCENARIO
+
+SCENARIO( "an IncrementalLoader applies changes to one dataset without importing the others", "[IncrementalLoader][reload]" ) {
+
+  const std::vector<std::string> files = { "areas.csv",
+                                           "popu1009.json",
+                                           "complete-popu1009-pop.csv",
+                                           "tran0152.json" };
+  const std::vector<BethYw::InputFileSource> datasets = { BethYw::InputFiles::POPDEN,
+                                                          BethYw::InputFiles::COMPLETE_POP,
+                                                          BethYw::InputFiles::TRAINS };
+
+  GIVEN( "a directory of datasets loaded by an IncrementalLoader" ) {
+
+    std::string dir = copyDatasets(files);
+
+    Areas data = Areas();
+    IncrementalLoader loader(data, dir, datasets, StringFilterSet(), StringFilterSet(), YearFilterTuple(0, 0));
+    loader.load();
+
+    THEN( "the data is the same as a full import" ) {
+
+      REQUIRE( data.toJSON() == importFresh(dir, datasets) );
+
+    } // THEN
+
+    WHEN( "a value in one dataset is changed" ) {
+
+      nlohmann::json j;
+      std::ifstream(dir + "popu1009.json") >> j;
+      for (auto &row : j["value"]) {
+        if (row["Localauthority_Code"] == "W06000011" && row["Measure_Code"] == "Dens"
+            && row["Year_Code"] == "2010") {
+          row["Data"] = 1234.5;
+        }
+      }
+      std::ofstream(dir + "popu1009.json") << j;
+
+      const Measure *untouched = &data.getArea("W06000001").getMeasure("dens");
+      auto result = loader.reload("popu1009.json");
+
+      THEN( "only that dataset is imported again, and only that value changes" ) {
+
+        REQUIRE( result.sources == std::vector<std::string>{"popden"} );
+        REQUIRE( result.valuesChanged == 1 );
+        REQUIRE( result.measuresRebuilt == 1 );
+        REQUIRE( result.areasRebuilt == 0 );
+        REQUIRE( data.getArea("W06000011").getMeasure("dens").getValue(2010) == Approx(1234.5) );
+
+      } // THEN
+
+      THEN( "the data in other areas is left alone" ) {
+
+        REQUIRE( &data.getArea("W06000001").getMeasure("dens") == untouched );
+
+      } // THEN
+
+      THEN( "the data is the same as a full import of the changed files" ) {
+
+        REQUIRE( data.toJSON() == importFresh(dir, datasets) );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a dataset that overlaps an earlier one is deleted" ) {
+
+      std::remove((dir + "complete-popu1009-pop.csv").c_str());
+      auto result = loader.reload("complete-popu1009-pop.csv");
+
+      THEN( "its values are removed and the earlier dataset's values show through" ) {
+
+        REQUIRE( result.valuesChanged > 0 );
+        REQUIRE( data.toJSON() == importFresh(dir, datasets) );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "an area's name is changed in areas.csv" ) {
+
+      std::ifstream in(dir + "areas.csv");
+      std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+      in.close();
+      contents.replace(contents.find("Swansea"), 7, "Swansea City");
+      std::ofstream(dir + "areas.csv") << contents;
+
+      auto result = loader.reload("areas.csv");
+
+      THEN( "every dataset is imported again, since the names decide which areas are imported" ) {
+
+        REQUIRE( result.sources.size() == 4 );
+        REQUIRE( data.getArea("W06000011").getName("eng") == "Swansea City" );
+        REQUIRE( data.toJSON() == importFresh(dir, datasets) );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a changed dataset cannot be imported" ) {
+
+      std::string before = data.toJSON();
+      std::ofstream(dir + "tran0152.json") << "{\"value\": [";
+
+      THEN( "an exception is thrown and the data is left as it was" ) {
+
+        REQUIRE_THROWS( loader.reload("tran0152.json") );
+        REQUIRE( data.toJSON() == before );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a file that is not imported changes" ) {
+
+      auto result = loader.reload("notes.txt");
+
+      THEN( "nothing is imported" ) {
+
+        REQUIRE( result.sources.empty() );
+
+      } // THEN
+
+    } // WHEN
+
+    removeDatasets(dir, files);
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "a DirectoryWatcher reports the files that change in a directory", "[DirectoryWatcher]" ) {
+
+  GIVEN( "a watched directory" ) {
+
+    std::string dir = copyDatasets({});
+    DirectoryWatcher watcher(dir);
+
+    WHEN( "nothing changes" ) {
+
+      THEN( "waiting times out with no files" ) {
+
+        REQUIRE( watcher.wait(20).empty() );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a file is written twice in quick succession" ) {
+
+      std::ofstream(dir + "areas.csv") << "a";
+      std::ofstream(dir + "areas.csv") << "b";
+
+      THEN( "it is reported once" ) {
+
+        REQUIRE( watcher.wait(1000) == std::vector<std::string>{"areas.csv"} );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a file is renamed into the directory" ) {
+
+      std::ofstream(dir + "new.tmp") << "a";
+      std::rename((dir + "new.tmp").c_str(), (dir + "popu1009.json").c_str());
+
+      THEN( "its new name is reported" ) {
+
+        auto files = watcher.wait(1000);
+        REQUIRE( std::find(files.begin(), files.end(), "popu1009.json") != files.end() );
+
+      } // THEN
+
+    } // WHEN
+
+    removeDatasets(dir, {"areas.csv", "popu1009.json", "new.tmp"});
+
+  } // GIVEN
+
+} // SCENARIO
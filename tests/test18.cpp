@@ -0,0 +1,196 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "../datasets.h"
+#include "../areas.h"
+#include "../arena.h"
+
+SCENARIO( "an Arena hands out aligned memory from large blocks", "[Arena]" ) {
+
+  GIVEN( "an Arena with 1KB blocks" ) {
+
+    Arena arena(1024);
+
+    THEN( "nothing is reserved until the first allocation" ) {
+
+      REQUIRE( arena.blockCount() == 0 );
+      REQUIRE( arena.bytesReserved() == 0 );
+
+    } // THEN
+
+    WHEN( "many small allocations are made" ) {
+
+      for (int i = 0; i < 100; i++) {
+        void *p = arena.allocate(i % 2 == 0 ? 3 : 8, i % 2 == 0 ? 1 : 8);
+        if (i % 2 == 1) {
+          REQUIRE( ((uintptr_t) p) % 8 == 0 );
+        }
+      }
+
+      THEN( "they share a few blocks" ) {
+
+        REQUIRE( arena.allocationCount() == 100 );
+        REQUIRE( arena.bytesUsed() == 50 * 3 + 50 * 8 );
+        REQUIRE( arena.blockCount() <= 2 );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "an allocation larger than a quarter of a block is made" ) {
+
+      arena.allocate(8, 8);
+      arena.allocate(600, 8);
+
+      THEN( "it gets a block of its own" ) {
+
+        REQUIRE( arena.blockCount() == 2 );
+        REQUIRE( arena.bytesReserved() >= 1024 + 600 );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "large allocations are made with a stricter alignment than new gives" ) {
+
+      THEN( "each is aligned within its block" ) {
+
+        for (int i = 0; i < 16; i++) {
+          void *p = arena.allocate(600 + i, 256);
+          REQUIRE( ((uintptr_t) p) % 256 == 0 );
+        }
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "Areas, Area and Measure containers allocate from the current Arena", "[Arena][ArenaScope]" ) {
+
+  GIVEN( "no ArenaScope" ) {
+
+    Measure measure("pop", "Population");
+    measure.setValue(2000, 1.0);
+
+    THEN( "containers allocate from the heap" ) {
+
+      REQUIRE( Arena::current() == nullptr );
+      REQUIRE( measure.getValues().get_allocator().getArena() == nullptr );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "a dataset imported inside an ArenaScope" ) {
+
+    auto arena = std::make_shared<Arena>();
+    std::unique_ptr<Areas> data;
+    {
+      ArenaScope scope(arena);
+      data.reset(new Areas());
+      std::ifstream stream("datasets/popu1009.json");
+      data->populateFromWelshStatsJSON(stream, BethYw::InputFiles::POPDEN.COLS);
+    }
+
+    THEN( "the scope is no longer current once it has ended" ) {
+
+      REQUIRE( Arena::current() == nullptr );
+
+    } // THEN
+
+    THEN( "every container in the Areas allocated from the arena" ) {
+
+      REQUIRE( arena->allocationCount() > 0 );
+      for (const auto &it : *data) {
+        REQUIRE( it.second.getMeasures().get_allocator().getArena() == arena.get() );
+        for (const auto &measure : it.second.getMeasures()) {
+          REQUIRE( measure.second.getValues().get_allocator().getArena() == arena.get() );
+        }
+      }
+
+    } // THEN
+
+    THEN( "the data is the same as when it is imported on the heap" ) {
+
+      std::ifstream stream("datasets/popu1009.json");
+      Areas heap = Areas();
+      heap.populateFromWelshStatsJSON(stream, BethYw::InputFiles::POPDEN.COLS);
+
+      REQUIRE( data->toJSON() == heap.toJSON() );
+
+    } // THEN
+
+    WHEN( "the last reference to the arena is dropped" ) {
+
+      Arena *raw = arena.get();
+      arena.reset();
+
+      THEN( "the Areas still keeps it alive" ) {
+
+        REQUIRE( data->begin()->second.getMeasures().get_allocator().getArena() == raw );
+        REQUIRE( data->getArea("W06000011").getMeasure("pop").getValue(2010) > 0 );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "an Area is copied outside the scope" ) {
+
+      Area copy = data->getArea("W06000011");
+
+      THEN( "the copy allocates from the same arena as the original" ) {
+
+        REQUIRE( copy.getMeasures().get_allocator().getArena() == arena.get() );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+  GIVEN( "nested ArenaScopes" ) {
+
+    auto outer = std::make_shared<Arena>();
+    auto inner = std::make_shared<Arena>();
+
+    THEN( "each scope restores the Arena that was current before it" ) {
+
+      ArenaScope outer_scope(outer);
+      REQUIRE( Arena::current() == outer.get() );
+      {
+        ArenaScope inner_scope(inner);
+        REQUIRE( Arena::current() == inner.get() );
+        {
+          ArenaScope heap_scope(nullptr);
+          REQUIRE( Arena::current() == nullptr );
+        }
+        REQUIRE( Arena::current() == inner.get() );
+      }
+      REQUIRE( Arena::current() == outer.get() );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
@@ -0,0 +1,280 @@
+
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../lib_cxxopts.hpp"
+#include "../lib_cxxopts_argv.hpp"
+
+#include "../lib_json.hpp"
+#include "../datasets.h"
+#include "../areas.h"
+#include "../bethyw.h"
+#include "../ranking.h"
+
+SCENARIO( "the ranking program arguments can be parsed correctly", "[args][ranking]" ) {
+
+  auto parse = [](std::initializer_list<const char*> values) {
+    Argv argv(values);
+    auto** actual_argv = argv.argv();
+    auto argc          = argv.argc();
+
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args    = cxxopts.parse(argc, actual_argv);
+    return BethYw::parseRankingArgs(args);
+  };
+
+  GIVEN( "no ranking arguments" ) {
+
+    THEN( "there is no ranking" ) {
+
+      REQUIRE( parse({"test"}).k == 0 );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "a top, measure and year" ) {
+
+    auto query = parse({"test", "--top", "5", "--by", "POP", "--year", "2019"});
+
+    THEN( "the areas are ranked by their value in that year, highest first" ) {
+
+      REQUIRE( query.k == 5 );
+      REQUIRE( query.measure == "pop" );
+      REQUIRE( query.statistic == RankByValue );
+      REQUIRE( query.year == 2019 );
+      REQUIRE( query.descending );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "a statistic over the imported years and an ascending order" ) {
+
+    auto query = parse({"test", "--top", "3", "--by", "dens", "--stat", "pct", "--order", "asc"});
+
+    THEN( "no year is needed" ) {
+
+      REQUIRE( query.statistic == RankByPercentage );
+      REQUIRE_FALSE( query.descending );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "invalid ranking arguments" ) {
+
+    THEN( "a std::invalid_argument exception is thrown" ) {
+
+      REQUIRE_THROWS_AS( parse({"test", "--top", "0", "--by", "pop", "--year", "2019"}), std::invalid_argument );
+      REQUIRE_THROWS_AS( parse({"test", "--top", "five", "--by", "pop", "--year", "2019"}), std::invalid_argument );
+      REQUIRE_THROWS_AS( parse({"test", "--top", "5", "--year", "2019"}), std::invalid_argument );
+      REQUIRE_THROWS_AS( parse({"test", "--top", "5", "--by", "pop"}), std::invalid_argument );
+      REQUIRE_THROWS_AS( parse({"test", "--top", "5", "--by", "pop", "--year", "19"}), std::invalid_argument );
+      REQUIRE_THROWS_AS( parse({"test", "--top", "5", "--by", "pop", "--stat", "avg", "--year", "2019"}),
+                         std::invalid_argument );
+      REQUIRE_THROWS_AS( parse({"test", "--top", "5", "--by", "pop", "--stat", "median"}), std::invalid_argument );
+      REQUIRE_THROWS_AS( parse({"test", "--top", "5", "--by", "pop", "--year", "2019", "--order", "up"}),
+                         std::invalid_argument );
+      REQUIRE_THROWS_AS( parse({"test", "--by", "pop"}), std::invalid_argument );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "the areas in an Areas instance can be ranked by a measure", "[Areas][ranking]" ) {
+
+  GIVEN( "an Areas instance populated from popu1009.json" ) {
+
+    Areas areas = Areas();
+    std::ifstream stream("datasets/popu1009.json");
+    REQUIRE( stream.is_open() );
+    areas.populateFromWelshStatsJSON(stream, BethYw::InputFiles::POPDEN.COLS);
+
+    RankingQuery query;
+    query.k = 5;
+    query.measure = "pop";
+    query.year = 2019;
+
+    WHEN( "the top 5 areas by population in 2019 are ranked" ) {
+
+      auto top = rankAreas(areas, query);
+
+      THEN( "they are the same as the first 5 of all the areas sorted by value" ) {
+
+        std::vector<std::pair<double, std::string>> all;
+        for (const auto &entry : areas) {
+          all.emplace_back(entry.second.getMeasure("pop").getValue(2019), entry.first);
+        }
+        std::sort(all.rbegin(), all.rend());
+
+        REQUIRE( top.size() == 5 );
+        for (size_t i = 0; i < top.size(); i++) {
+          REQUIRE( top[i].value == all[i].first );
+          REQUIRE( top[i].code == all[i].second );
+          REQUIRE( top[i].area == &areas.getArea(all[i].second) );
+        }
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "more areas are asked for than have the measure" ) {
+
+      query.k = 1000;
+      query.descending = false;
+      auto all = rankAreas(areas, query);
+
+      THEN( "every area is returned, lowest first" ) {
+
+        REQUIRE( (int) all.size() == areas.size() );
+        for (size_t i = 1; i < all.size(); i++) {
+          REQUIRE( all[i - 1].value <= all[i].value );
+        }
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "the areas are ranked by a year or measure that was not imported" ) {
+
+      THEN( "no areas are returned" ) {
+
+        query.year = 1066;
+        REQUIRE( rankAreas(areas, query).empty() );
+
+        query.year = 2019;
+        query.measure = "nosuch";
+        REQUIRE( rankAreas(areas, query).empty() );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "the areas are ranked by the percentage difference" ) {
+
+      query.statistic = RankByPercentage;
+      auto top = rankAreas(areas, query);
+
+      THEN( "the values are the measures' percentage differences" ) {
+
+        for (const auto &ranked : top) {
+          REQUIRE( ranked.value == ranked.area->getMeasure("pop").getDifferenceAsPercentage() );
+        }
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a ranking is printed as JSON" ) {
+
+      query.k = 2;
+      auto top = rankAreas(areas, query);
+      auto j = nlohmann::json::parse(rankingToJSON(top, query));
+
+      THEN( "it has the query and each area's rank, code, names and value" ) {
+
+        REQUIRE( j["measure"] == "pop" );
+        REQUIRE( j["statistic"] == "value" );
+        REQUIRE( j["year"] == 2019 );
+        REQUIRE( j["order"] == "desc" );
+        REQUIRE( j["areas"].size() == 2 );
+        REQUIRE( j["areas"][0]["rank"] == 1 );
+        REQUIRE( j["areas"][0]["code"] == top[0].code );
+        REQUIRE( j["areas"][0]["names"].is_object() );
+        REQUIRE( j["areas"][0]["value"] == top[0].value );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a ranking is printed as a table" ) {
+
+      query.k = 2;
+      auto top = rankAreas(areas, query);
+      std::stringstream ss;
+      printRanking(ss, top, query);
+
+      THEN( "there is a title and a line per area" ) {
+
+        std::string line;
+        std::getline(ss, line);
+        REQUIRE( line == "Top 2 areas by Population (pop) in 2019, highest first" );
+        std::getline(ss, line);
+        REQUIRE( line.find("1  ") == 0 );
+        REQUIRE( line.find("(" + top[0].code + ")") != std::string::npos );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "a ranking scales to a large number of areas", "[Areas][ranking][scale]" ) {
+
+  GIVEN( "an Areas instance with 200,000 synthetic areas, many with the same value" ) {
+
+    std::mt19937 random(1009);
+    std::uniform_int_distribution<int> values(0, 5000);
+
+    Areas areas = Areas();
+    std::vector<std::pair<double, std::string>> expected;
+    for (int i = 0; i < 200000; i++) {
+      std::string code = "W" + std::to_string(10000000 + i);
+      Area area(code);
+      Measure measure("pop", "Population");
+      double value = values(random);
+      measure.setValue(2019, value);
+      area.setMeasure("pop", measure);
+      areas.setArea(code, area);
+      expected.emplace_back(-value, code);
+    }
+    std::sort(expected.begin(), expected.end());
+
+    WHEN( "the top 100 areas are ranked" ) {
+
+      RankingQuery query;
+      query.k = 100;
+      query.measure = "pop";
+      query.year = 2019;
+      auto top = rankAreas(areas, query);
+
+      THEN( "they are the highest values, with ties in order of their code" ) {
+
+        REQUIRE( top.size() == 100 );
+        for (size_t i = 0; i < top.size(); i++) {
+          REQUIRE( top[i].value == -expected[i].first );
+          REQUIRE( top[i].code == expected[i].second );
+        }
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
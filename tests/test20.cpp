@@ -0,0 +1,337 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../lib_cxxopts.hpp"
+#include "../lib_cxxopts_argv.hpp"
+
+#include "../datasets.h"
+#include "../areas.h"
+#include "../bethyw.h"
+#include "../derived.h"
+
+/*
+  What the program writes to the standard output when run with the given
+  arguments.
+*/
+static std::string runOutput(std::initializer_list<const char*> values) {
+  Argv argv(values);
+  std::ostringstream out;
+  std::streambuf *original = std::cout.rdbuf(out.rdbuf());
+  BethYw::run(argv.argc(), argv.argv());
+  std::cout.rdbuf(original);
+  return out.str();
+}
+
+SCENARIO( "a derived measure can be defined with an expression", "[DerivedMeasure][construct]" ) {
+
+  GIVEN( "a valid expression" ) {
+
+    DerivedMeasure measure("RailPP", " rail / (pop * 2) - {pm2-5} + -1.5e1 * rail ");
+
+    THEN( "the code is lowercase and the label is the expression" ) {
+
+      REQUIRE( measure.getCodename() == "railpp" );
+      REQUIRE( measure.getLabel() == "rail / (pop * 2) - {pm2-5} + -1.5e1 * rail" );
+
+    } // THEN
+
+    THEN( "each measure it uses is listed once, in order" ) {
+
+      REQUIRE( measure.getInputs() == std::vector<std::string>{"rail", "pop", "pm2-5"} );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "an invalid expression" ) {
+
+    THEN( "a std::invalid_argument exception is thrown" ) {
+
+      REQUIRE_THROWS_AS( DerivedMeasure("x", "pop +"), std::invalid_argument );
+      REQUIRE_THROWS_AS( DerivedMeasure("x", "(pop"), std::invalid_argument );
+      REQUIRE_THROWS_AS( DerivedMeasure("x", "pop area"), std::invalid_argument );
+      REQUIRE_THROWS_AS( DerivedMeasure("x", "pop % 2"), std::invalid_argument );
+      REQUIRE_THROWS_AS( DerivedMeasure("x", "{pop"), std::invalid_argument );
+      REQUIRE_THROWS_AS( DerivedMeasure("x", "2 * 3"), std::invalid_argument );
+      REQUIRE_THROWS_AS( DerivedMeasure("x", "x + 1"), std::invalid_argument );
+      REQUIRE_THROWS_AS( DerivedMeasure("x", ""), std::invalid_argument );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "a derived measure is evaluated over the years its measures share", "[DerivedMeasure][evaluate]" ) {
+
+  GIVEN( "an Area with two measures over overlapping years" ) {
+
+    std::string code = "W06999999";
+    Area area(code);
+
+    Measure pop("pop", "Population");
+    pop.setValue(2000, 100);
+    pop.setValue(2001, 200);
+    pop.setValue(2002, 0);
+    pop.setValue(2003, 400);
+    area.setMeasure("pop", pop);
+
+    Measure rail("rail", "Rail");
+    rail.setValue(2001, 50);
+    rail.setValue(2002, 60);
+    rail.setValue(2003, 100);
+    rail.setValue(2004, 10);
+    area.setMeasure("rail", rail);
+
+    std::vector<unsigned int> years;
+    std::vector<double> values;
+
+    WHEN( "a ratio is evaluated" ) {
+
+      DerivedMeasure ratio("railpp", "rail / pop");
+
+      THEN( "there is a value for the shared years that can be calculated" ) {
+
+        REQUIRE( ratio.evaluate(area, years, values) );
+        REQUIRE( years == std::vector<unsigned int>{2001, 2003} );
+        REQUIRE( values[0] == Approx(0.25) );
+        REQUIRE( values[1] == Approx(0.25) );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "an expression with precedence, brackets and negation is evaluated" ) {
+
+      DerivedMeasure expression("x", "-(rail - pop) * 2 + pop / 4");
+
+      THEN( "the operators are applied in the usual order" ) {
+
+        REQUIRE( expression.evaluate(area, years, values) );
+        REQUIRE( years == std::vector<unsigned int>{2001, 2002, 2003} );
+        REQUIRE( values[0] == Approx(350) );
+        REQUIRE( values[1] == Approx(-120) );
+        REQUIRE( values[2] == Approx(700) );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "an expression uses a measure the area does not have" ) {
+
+      DerivedMeasure missing("x", "rail / dens");
+
+      THEN( "it cannot be evaluated" ) {
+
+        REQUIRE_FALSE( missing.evaluate(area, years, values) );
+        REQUIRE( years.empty() );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "derived measures are added to the imported data and cached", "[DerivedMeasures]" ) {
+
+  GIVEN( "an Areas instance populated from popu1009.json and tran0152.json" ) {
+
+    Areas areas = Areas();
+    std::ifstream popden("datasets/popu1009.json");
+    areas.populateFromWelshStatsJSON(popden, BethYw::InputFiles::POPDEN.COLS);
+    std::ifstream trains("datasets/tran0152.json");
+    areas.populateFromWelshStatsJSON(trains, BethYw::InputFiles::TRAINS.COLS);
+
+    DerivedMeasures derived;
+    derived.add("railpp=rail / pop");
+    derived.add("railkpp = railpp * 1000");
+    derived.add("denscheck=pop / area");
+
+    THEN( "definitions that are invalid, repeated or out of order are rejected" ) {
+
+      REQUIRE_THROWS_AS( derived.add("railpp=rail"), std::invalid_argument );
+      REQUIRE_THROWS_AS( derived.add("rail / pop"), std::invalid_argument );
+      REQUIRE_THROWS_AS( derived.add("=rail"), std::invalid_argument );
+
+      DerivedMeasures reordered;
+      reordered.add("a=b * 2");
+      REQUIRE_THROWS_AS( reordered.add("b=pop"), std::invalid_argument );
+
+    } // THEN
+
+    THEN( "the measures a filter needs imported include those of the derived measures it uses" ) {
+
+      REQUIRE( derived.dependencies({}).empty() );
+      REQUIRE( derived.dependencies({"railkpp"}) == StringFilterSet{"rail", "pop"} );
+      REQUIRE( derived.dependencies({"denscheck", "dens"}) == StringFilterSet{"pop", "area"} );
+
+    } // THEN
+
+    WHEN( "they are applied with no filter" ) {
+
+      derived.apply(areas, {});
+      const Area &swansea = areas.getArea("W06000011");
+
+      THEN( "they appear as ordinary measures" ) {
+
+        const Measure &railpp = swansea.getMeasure("railpp");
+        REQUIRE( railpp.getLabel() == "rail / pop" );
+        REQUIRE( railpp.getValue(2016) ==
+                 Approx(swansea.getMeasure("rail").getValue(2016) / swansea.getMeasure("pop").getValue(2016)) );
+        REQUIRE( swansea.getMeasure("railkpp").getValue(2016) == Approx(railpp.getValue(2016) * 1000) );
+        REQUIRE( swansea.getMeasure("denscheck").getValue(2010) == Approx(swansea.getMeasure("dens").getValue(2010)) );
+
+      } // THEN
+
+      THEN( "applying them again uses the cached values" ) {
+
+        auto evaluations = derived.evaluationCount();
+        REQUIRE( evaluations == 3 * (size_t) areas.size() );
+        derived.apply(areas, {});
+        REQUIRE( derived.evaluationCount() == evaluations );
+
+      } // THEN
+
+      THEN( "invalidating an area evaluates only that area again, with its new data" ) {
+
+        auto evaluations = derived.evaluationCount();
+        areas.getArea("W06000011").getMeasure("rail").setValue(2016, 0);
+        derived.invalidate("W06000011");
+        derived.apply(areas, {});
+
+        REQUIRE( derived.evaluationCount() == evaluations + 3 );
+        REQUIRE( areas.getArea("W06000011").getMeasure("railpp").getValue(2016) == 0 );
+
+      } // THEN
+
+      THEN( "they can be applied again to only the areas whose data changed" ) {
+
+        auto evaluations = derived.evaluationCount();
+        double before = areas.getArea("W06000023").getMeasure("railpp").getValue(2016);
+        areas.getArea("W06000011").editMeasure("rail").setValue(2016, 0);
+        areas.getArea("W06000023").editMeasure("rail").setValue(2016, 0);
+        derived.invalidate();
+
+        const std::set<std::string> changed = {"W06000011", "W99999999"};
+        derived.apply(areas, {}, &changed);
+
+        REQUIRE( derived.evaluationCount() == evaluations + 3 );
+        REQUIRE( areas.getArea("W06000011").getMeasure("railpp").getValue(2016) == 0 );
+        REQUIRE( areas.getArea("W06000023").getMeasure("railpp").getValue(2016) == before );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "they are applied with a filter" ) {
+
+      derived.apply(areas, {"railkpp"});
+
+      THEN( "only the derived measures in it, and those they use, are evaluated" ) {
+
+        const Area &swansea = areas.getArea("W06000011");
+        REQUIRE_NOTHROW( swansea.getMeasure("railkpp") );
+        REQUIRE_NOTHROW( swansea.getMeasure("railpp") );
+        REQUIRE_THROWS_AS( swansea.getMeasure("denscheck"), std::out_of_range );
+        REQUIRE( derived.evaluationCount() == 2 * (size_t) areas.size() );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "the derive program argument can be parsed correctly", "[args][DerivedMeasures]" ) {
+
+  auto parse = [](std::initializer_list<const char*> values) {
+    Argv argv(values);
+    auto** actual_argv = argv.argv();
+    auto argc          = argv.argc();
+
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args    = cxxopts.parse(argc, actual_argv);
+    return BethYw::parseDeriveArg(args);
+  };
+
+  THEN( "each definition is added, in order" ) {
+
+    REQUIRE( parse({"test"}).size() == 0 );
+    REQUIRE( parse({"test", "--derive", "a=pop/area,b=a*2"}).size() == 2 );
+    REQUIRE( parse({"test", "--derive", "a=pop/area", "--derive", "b=a*2"}).size() == 2 );
+
+  } // THEN
+
+  THEN( "an invalid definition throws a std::invalid_argument exception" ) {
+
+    REQUIRE_THROWS_AS( parse({"test", "--derive", "a=pop+"}), std::invalid_argument );
+
+  } // THEN
+
+} // SCENARIO
+
+SCENARIO( "the measures a derived measure uses are not output unless they are asked for", "[DerivedMeasures][run]" ) {
+
+  GIVEN( "a derived measure that is the only measure asked for" ) {
+
+    auto args = {"test", "-d", "popden", "--derive", "dpp=dens/pop", "-m", "dpp", "-a", "W06000011", "-y", "2010-2011"};
+
+    THEN( "the tables output are of it alone" ) {
+
+      std::string output = runOutput(args);
+      REQUIRE( output.find("(dpp)") != std::string::npos );
+      REQUIRE( output.find("(dens)") == std::string::npos );
+      REQUIRE( output.find("(pop)") == std::string::npos );
+
+    } // THEN
+
+    THEN( "the JSON output is of it alone" ) {
+
+      std::string output = runOutput({"test", "-d", "popden", "--derive", "dpp=dens/pop", "-m", "dpp",
+                                      "-a", "W06000011", "-y", "2010-2011", "-j"});
+      auto measures = nlohmann::json::parse(output)["W06000011"]["measures"];
+      REQUIRE( measures.size() == 1 );
+      REQUIRE( measures.count("dpp") == 1 );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "a derived measure and one of the measures it uses, both asked for" ) {
+
+    THEN( "both are output" ) {
+
+      std::string output = runOutput({"test", "-d", "popden", "--derive", "dpp=dens/pop", "-m", "dpp,pop",
+                                      "-a", "W06000011", "-y", "2010-2011"});
+      REQUIRE( output.find("(dpp)") != std::string::npos );
+      REQUIRE( output.find("(pop)") != std::string::npos );
+      REQUIRE( output.find("(dens)") == std::string::npos );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
@@ -0,0 +1,264 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../lib_cxxopts.hpp"
+#include "../lib_cxxopts_argv.hpp"
+
+#include "../datasets.h"
+#include "../areas.h"
+#include "../bethyw.h"
+#include "../window.h"
+
+SCENARIO( "window functions can be parsed", "[WindowFunction][parse]" ) {
+
+  GIVEN( "valid window functions" ) {
+
+    auto functions = parseWindowFunctions({"rolling-mean:3", "YoY", "cagr", "cumsum", "yoy"});
+
+    THEN( "each is parsed once, in order" ) {
+
+      REQUIRE( functions.size() == 4 );
+      REQUIRE( functions[0].kind == WindowFunction::RollingMean );
+      REQUIRE( functions[0].width == 3 );
+      REQUIRE( functions[0].getName() == "rolling-mean:3" );
+      REQUIRE( functions[1].getName() == "yoy" );
+      REQUIRE( functions[2].getName() == "cagr" );
+      REQUIRE( functions[3].getName() == "cumsum" );
+
+    } // THEN
+
+    THEN( "the codes of the measures they create can be traced back" ) {
+
+      REQUIRE( windowBaseMeasure("pop:rolling-mean:3", functions) == "pop" );
+      REQUIRE( windowBaseMeasure("pm2-5:yoy", functions) == "pm2-5" );
+      REQUIRE( windowBaseMeasure("pop", functions) == "" );
+      REQUIRE( windowBaseMeasure("pop:rolling-mean:4", functions) == "" );
+      REQUIRE( windowBaseMeasure(":yoy", functions) == "" );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "invalid window functions" ) {
+
+    THEN( "a std::invalid_argument exception is thrown" ) {
+
+      REQUIRE_THROWS_AS( parseWindowFunctions({"median"}), std::invalid_argument );
+      REQUIRE_THROWS_AS( parseWindowFunctions({"rolling-mean"}), std::invalid_argument );
+      REQUIRE_THROWS_AS( parseWindowFunctions({"rolling-mean:0"}), std::invalid_argument );
+      REQUIRE_THROWS_AS( parseWindowFunctions({"rolling-mean:x"}), std::invalid_argument );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "the window program argument" ) {
+
+    Argv argv({"test", "--window", "rolling-mean:2,cumsum"});
+    auto** actual_argv = argv.argv();
+    auto argc          = argv.argc();
+
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args    = cxxopts.parse(argc, actual_argv);
+
+    THEN( "it is parsed as a comma-separated list" ) {
+
+      REQUIRE( BethYw::parseWindowArg(args).size() == 2 );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "window functions are calculated over a series", "[WindowFunction][compute]" ) {
+
+  GIVEN( "a series over four years with a gap" ) {
+
+    std::vector<unsigned int> years = {2000, 2001, 2002, 2004};
+    std::vector<double> values = {100, 110, 99, 121};
+    std::vector<std::vector<double>> results;
+
+    computeWindowFunctions(parseWindowFunctions({"rolling-mean:2", "yoy", "cagr", "cumsum"}),
+                           years.data(), values.data(), years.size(), results);
+
+    THEN( "the rolling mean starts once the window is full, and covers years rather than values" ) {
+
+      REQUIRE( std::isnan(results[0][0]) );
+      REQUIRE( results[0][1] == Approx(105) );
+      REQUIRE( results[0][2] == Approx(104.5) );
+      REQUIRE( results[0][3] == Approx(121) );
+
+    } // THEN
+
+    THEN( "the year on year change is a percentage of the value the year before, if there is one" ) {
+
+      REQUIRE( std::isnan(results[1][0]) );
+      REQUIRE( results[1][1] == Approx(10) );
+      REQUIRE( results[1][2] == Approx(-10) );
+      REQUIRE( std::isnan(results[1][3]) );
+
+    } // THEN
+
+    THEN( "the compound annual growth counts the years between values" ) {
+
+      REQUIRE( std::isnan(results[2][0]) );
+      REQUIRE( results[2][1] == Approx(10) );
+      REQUIRE( results[2][3] == Approx(4.8808848) );
+
+    } // THEN
+
+    THEN( "the cumulative sum includes every value so far" ) {
+
+      REQUIRE( results[3] == std::vector<double>{100, 210, 309, 430} );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "window functions over a series with a missing year are bounded by years", "[WindowFunction][compute]" ) {
+
+  GIVEN( "a series with no value for 2012" ) {
+
+    std::vector<unsigned int> years = {2010, 2011, 2013, 2014, 2015};
+    std::vector<double> values = {10, 20, 40, 50, 60};
+    std::vector<std::vector<double>> results;
+
+    computeWindowFunctions(parseWindowFunctions({"rolling-mean:3", "yoy"}),
+                           years.data(), values.data(), years.size(), results);
+
+    THEN( "a 3 year rolling mean only averages the values within 3 years" ) {
+
+      REQUIRE( std::isnan(results[0][0]) );
+      REQUIRE( std::isnan(results[0][1]) );
+      REQUIRE( results[0][2] == Approx(30) );
+      REQUIRE( results[0][3] == Approx(45) );
+      REQUIRE( results[0][4] == Approx(50) );
+
+    } // THEN
+
+    THEN( "there is no year on year change for the year after the gap" ) {
+
+      REQUIRE( results[1][1] == Approx(100) );
+      REQUIRE( std::isnan(results[1][2]) );
+      REQUIRE( results[1][3] == Approx(25) );
+      REQUIRE( results[1][4] == Approx(20) );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "window functions are applied to every measure of every area", "[WindowFunction][apply]" ) {
+
+  GIVEN( "two copies of an Areas instance populated from popu1009.json" ) {
+
+    Areas one = Areas();
+    Areas many = Areas();
+    for (Areas *areas : {&one, &many}) {
+      std::ifstream stream("datasets/popu1009.json");
+      areas->populateFromWelshStatsJSON(stream, BethYw::InputFiles::POPDEN.COLS);
+    }
+    auto functions = parseWindowFunctions({"rolling-mean:3", "yoy"});
+
+    WHEN( "the window functions are applied with one thread and with several" ) {
+
+      TaskScheduler single(1);
+      TaskScheduler several(4);
+      applyWindowFunctions(one, functions, &single);
+      applyWindowFunctions(many, functions, &several);
+
+      THEN( "each measure gets a series per function, the same either way" ) {
+
+        const Area &swansea = one.getArea("W06000011");
+        REQUIRE( swansea.size() == 9 );
+        REQUIRE( swansea.getMeasure("pop:rolling-mean:3").getLabel() == "Population, rolling mean of 3 years" );
+        REQUIRE( swansea.getMeasure("dens:yoy").getValue(2011) ==
+                 Approx((swansea.getMeasure("dens").getValue(2011) / swansea.getMeasure("dens").getValue(2010) - 1) * 100) );
+        REQUIRE( one.toJSON() == many.toJSON() );
+
+      } // THEN
+
+      THEN( "applying them again replaces the series without windowing them" ) {
+
+        std::string before = one.toJSON();
+        TaskScheduler two(2);
+        applyWindowFunctions(one, functions, &two);
+        REQUIRE( one.getArea("W06000011").size() == 9 );
+        REQUIRE( one.toJSON() == before );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "the window functions are applied to only some of the areas" ) {
+
+      const std::set<std::string> codes = {"W06000011", "W99999999"};
+      applyWindowFunctions(one, functions, nullptr, &codes);
+
+      THEN( "only those areas get the series" ) {
+
+        REQUIRE( one.getArea("W06000011").size() == 9 );
+        REQUIRE( one.getArea("W06000023").size() == 3 );
+        REQUIRE_THROWS_AS( one.getArea("W99999999"), std::out_of_range );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "the measure a window function is applied to is not output unless it is asked for", "[WindowFunction][run]" ) {
+
+  GIVEN( "a window function's series that is the only measure asked for" ) {
+
+    THEN( "the table output is of it alone" ) {
+
+      //runOutput() is in test20.cpp.
+      std::string output = runOutput({"test", "-d", "popden", "--window", "yoy", "-m", "pop:yoy",
+                                      "-a", "W06000011", "-y", "2010-2012"});
+      REQUIRE( output.find("(pop:yoy)") != std::string::npos );
+      REQUIRE( output.find("(pop)") == std::string::npos );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "a window function's series and the measure it is applied to, both asked for" ) {
+
+    THEN( "both are output" ) {
+
+      std::string output = runOutput({"test", "-d", "popden", "--window", "yoy", "-m", "pop:yoy,pop",
+                                      "-a", "W06000011", "-y", "2010-2012"});
+      REQUIRE( output.find("(pop:yoy)") != std::string::npos );
+      REQUIRE( output.find("(pop)") != std::string::npos );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
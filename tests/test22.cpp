@@ -0,0 +1,197 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../lib_cxxopts.hpp"
+#include "../lib_cxxopts_argv.hpp"
+
+#include "../lib_json.hpp"
+#include "../areas.h"
+#include "../bethyw.h"
+#include "../correlation.h"
+
+/*
+  Add a measure to an Area from a list of (year, value) pairs.
+*/
+static void addMeasure(Area &area, const std::string &code, const std::vector<std::pair<unsigned int, double>> &values) {
+  Measure measure(code, code);
+  for (const auto &value : values) {
+    measure.setValue(value.first, value.second);
+  }
+  area.setMeasure(code, measure);
+}
+
+SCENARIO( "measures are correlated over the area-years they share", "[MeasureCorrelation][pair]" ) {
+
+  GIVEN( "two areas with measures that are missing some years" ) {
+
+    std::string code1 = "W06000001";
+    std::string code2 = "W06000002";
+    Area area1(code1);
+    Area area2(code2);
+
+    addMeasure(area1, "x", {{2000, 1}, {2001, 2}, {2002, 3}});
+    addMeasure(area1, "y", {{2000, 2}, {2001, 4}, {2003, 100}});
+    addMeasure(area1, "z", {{2000, 5}, {2001, 5}, {2002, 5}});
+    addMeasure(area2, "x", {{2000, 4}, {2001, 5}});
+    addMeasure(area2, "y", {{2000, 8}, {2001, 11}});
+
+    Areas areas = Areas();
+    areas.setArea(code1, area1);
+    areas.setArea(code2, area2);
+
+    MeasureCorrelation correlation(areas);
+
+    THEN( "every measure is a column, and every year of every area an observation" ) {
+
+      REQUIRE( correlation.getMeasures() == std::vector<std::string>{"x", "y", "z"} );
+      REQUIRE( correlation.observationCount() == 6 );
+
+    } // THEN
+
+    THEN( "a pair is compared over the observations both measures have" ) {
+
+      // x = 1, 2, 4, 5 and y = 2, 4, 8, 11
+      auto xy = correlation.pair(0, 1);
+      REQUIRE( xy.observations == 4 );
+      REQUIRE( xy.covariance == Approx(22.0 / 3) );
+      REQUIRE( xy.correlation == Approx(22.0 / std::sqrt(10.0 * 48.75)) );
+      REQUIRE( correlation.pair(1, 0).correlation == Approx(xy.correlation) );
+      REQUIRE( correlation.pair(0, 0).correlation == Approx(1.0) );
+
+    } // THEN
+
+    THEN( "a measure that does not vary has a covariance but no correlation" ) {
+
+      auto xz = correlation.pair(0, 2);
+      REQUIRE( xz.observations == 3 );
+      REQUIRE( xz.covariance == Approx(0.0) );
+      REQUIRE( std::isnan(xz.correlation) );
+
+    } // THEN
+
+    THEN( "asking for a measure that does not exist throws a std::out_of_range exception" ) {
+
+      REQUIRE_THROWS_AS( correlation.pair(0, 3), std::out_of_range );
+
+    } // THEN
+
+    THEN( "the matrix can be printed as a table or JSON" ) {
+
+      std::stringstream table;
+      printCorrelation(table, correlation, false);
+      std::string line;
+      std::getline(table, line);
+      REQUIRE( line == "Correlation of 3 measures over 6 area-years" );
+
+      std::stringstream json;
+      printCorrelationJSON(json, correlation);
+      auto j = nlohmann::json::parse(json.str());
+      REQUIRE( j["pairs"].size() == 6 );
+      REQUIRE( j["pairs"][1]["x"] == "x" );
+      REQUIRE( j["pairs"][1]["y"] == "y" );
+      REQUIRE( j["pairs"][2]["correlation"].is_null() );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "the correlation matrix is the same however it is divided up", "[MeasureCorrelation][compute]" ) {
+
+  GIVEN( "many areas with many measures, some missing values" ) {
+
+    std::mt19937 random(35);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    std::bernoulli_distribution missing(0.1);
+
+    Areas areas = Areas();
+    for (int a = 0; a < 40; a++) {
+      std::string code = "W" + std::to_string(10000000 + a);
+      Area area(code);
+      for (int m = 0; m < 150; m++) {
+        std::vector<std::pair<unsigned int, double>> values;
+        for (unsigned int year = 2000; year < 2010; year++) {
+          if (!missing(random)) {
+            values.emplace_back(year, 1e6 + m * year + noise(random) * (m + 1));
+          }
+        }
+        addMeasure(area, "m" + std::to_string(1000 + m), values);
+      }
+      areas.setArea(code, area);
+    }
+
+    MeasureCorrelation correlation(areas);
+
+    WHEN( "it is computed in small blocks on several threads" ) {
+
+      TaskScheduler scheduler(4);
+      size_t rows = 0;
+      size_t pairs = 0;
+      bool matches = true;
+      correlation.compute([&](size_t i, const std::vector<PairStatistics> &row) {
+        matches &= i == rows;
+        rows++;
+        for (size_t offset = 0; offset < row.size(); offset++) {
+          auto expected = correlation.pair(i, i + offset);
+          matches &= row[offset].observations == expected.observations;
+          matches &= row[offset].correlation == expected.correlation;
+          pairs++;
+        }
+      }, &scheduler, 16);
+
+      THEN( "every row of the upper triangle is passed on once, in order, with the same values as each pair alone" ) {
+
+        REQUIRE( matches );
+        REQUIRE( rows == 150 );
+        REQUIRE( pairs == 150 * 151 / 2 );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "the correlate program argument can be parsed correctly", "[args][MeasureCorrelation]" ) {
+
+  auto parse = [](std::initializer_list<const char*> values) {
+    Argv argv(values);
+    auto** actual_argv = argv.argv();
+    auto argc          = argv.argc();
+
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args    = cxxopts.parse(argc, actual_argv);
+    return BethYw::parseCorrelateArg(args);
+  };
+
+  THEN( "it defaults to the correlation, and can ask for the covariance" ) {
+
+    REQUIRE( parse({"test"}) == "" );
+    REQUIRE( parse({"test", "--correlate"}) == "corr" );
+    REQUIRE( parse({"test", "--correlate=COV"}) == "cov" );
+    REQUIRE_THROWS_AS( parse({"test", "--correlate=spearman"}), std::invalid_argument );
+
+  } // THEN
+
+} // SCENARIO
@@ -0,0 +1,352 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../lib_cxxopts.hpp"
+#include "../lib_cxxopts_argv.hpp"
+
+#include "../datasets.h"
+#include "../areas.h"
+#include "../bethyw.h"
+#include "../hierarchy.h"
+
+/*
+  Set one value of a Measure of an Area in an Areas instance, as an import
+  would.
+*/
+static void setRollUpValue(Areas &areas, const std::string &code, const std::string &measure,
+                           unsigned int year, double value) {
+  std::string tmp = code;
+  Area area(tmp);
+  Measure m(measure, measure);
+  m.setValue(year, value);
+  area.setMeasure(measure, m);
+  areas.setArea(code, area);
+}
+
+/*
+  Link an area to its parent in an Areas instance's hierarchy.
+*/
+static bool setRollUpParent(Areas &areas, const std::string &child, const std::string &parent) {
+  return areas.getHierarchy().setParent(child, parent, [&areas](const std::string &code) -> const Area * {
+    try {
+      return &areas.getArea(code);
+    } catch (std::out_of_range &e) {
+      return nullptr;
+    }
+  });
+}
+
+/*
+  The roll-up of a measure in a year, or nullptr if there is none.
+*/
+static const RollUp *findRollUp(const Areas &areas, const std::string &code, const std::string &measure,
+                                unsigned int year) {
+  auto rollups = areas.getHierarchy().getRollUps(code);
+  if (rollups == nullptr || rollups->count(measure) == 0 || rollups->at(measure).count(year) == 0) {
+    return nullptr;
+  }
+  return &rollups->at(measure).at(year);
+}
+
+SCENARIO( "the hierarchy of a StatsWales dataset is captured as it is imported", "[Hierarchy][import]" ) {
+
+  GIVEN( "popu1009.json, whose local authorities are all in Wales" ) {
+
+    Areas areas = Areas();
+    std::ifstream stream("datasets/popu1009.json");
+    REQUIRE( stream.is_open() );
+    areas.populate(stream, BethYw::WelshStatsJSON, BethYw::InputFiles::POPDEN.COLS,
+                   nullptr, nullptr, nullptr);
+
+    THEN( "every area's parent is Wales" ) {
+
+      REQUIRE( areas.getHierarchy().getParents().size() == (size_t) areas.size() );
+      for (const auto &area : areas) {
+        REQUIRE( areas.getHierarchy().getParent(area.first) == "W92000004" );
+      }
+      REQUIRE( areas.getHierarchy().getRollUpCodes() == std::vector<std::string>{"W92000004"} );
+
+    } // THEN
+
+    THEN( "the roll-up of Wales is the sum of its local authorities" ) {
+
+      double sum = 0.0;
+      long count = 0;
+      for (const auto &area : areas) {
+        const auto &values = area.second.getMeasures().at("pop").getValues();
+        if (values.count(2019)) {
+          sum += values.at(2019);
+          count++;
+        }
+      }
+
+      const RollUp *rollup = findRollUp(areas, "W92000004", "pop", 2019);
+      REQUIRE( rollup != nullptr );
+      REQUIRE( rollup->count == count );
+      REQUIRE( rollup->sum == Approx(sum) );
+      REQUIRE( rollup->mean() == Approx(sum / count) );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "econ0080.json, which has regions between the local authorities and Wales" ) {
+
+    Areas areas = Areas();
+    std::ifstream stream("datasets/econ0080.json");
+    REQUIRE( stream.is_open() );
+    areas.populate(stream, BethYw::WelshStatsJSON, BethYw::InputFiles::BIZ.COLS,
+                   nullptr, nullptr, nullptr);
+
+    const Hierarchy &hierarchy = areas.getHierarchy();
+
+    THEN( "each area is linked to its region, and each region to its country" ) {
+
+      REQUIRE( hierarchy.getParent("W06000011") == "UKL1" );
+      REQUIRE( hierarchy.getParent("UKL2") == "W92000004" );
+      REQUIRE( hierarchy.getParent("E12000006") == "E92000001" );
+      REQUIRE( hierarchy.getParent("K02000001") == "" );
+      REQUIRE_FALSE( hierarchy.isLeaf("UKL1") );
+      REQUIRE( hierarchy.isLeaf("W06000011") );
+
+    } // THEN
+
+    THEN( "a country's roll-up counts its local authorities, not its regions' own figures" ) {
+
+      double sum = 0.0;
+      long count = 0;
+      for (const auto &area : areas) {
+        bool in_wales = false;
+        for (auto parent = hierarchy.getParent(area.first); !parent.empty(); parent = hierarchy.getParent(parent)) {
+          in_wales |= parent == "W92000004";
+        }
+        if (in_wales && hierarchy.isLeaf(area.first) && area.second.getMeasures().count("a")) {
+          const auto &values = area.second.getMeasures().at("a").getValues();
+          if (values.count(2003)) {
+            sum += values.at(2003);
+            count++;
+          }
+        }
+      }
+
+      const RollUp *rollup = findRollUp(areas, "W92000004", "a", 2003);
+      REQUIRE( rollup != nullptr );
+      REQUIRE( rollup->count == count );
+      REQUIRE( rollup->sum == Approx(sum) );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "roll-ups are kept up to date as values change", "[Hierarchy][incremental]" ) {
+
+  GIVEN( "two local authorities in a region, in a country" ) {
+
+    Areas areas = Areas();
+    setRollUpValue(areas, "A1", "x", 2000, 10);
+    setRollUpValue(areas, "A2", "x", 2000, 30);
+    REQUIRE( setRollUpParent(areas, "A1", "R") );
+    REQUIRE( setRollUpParent(areas, "A2", "R") );
+    REQUIRE( setRollUpParent(areas, "R", "C") );
+
+    THEN( "both the region and the country roll up the local authorities" ) {
+
+      REQUIRE( findRollUp(areas, "R", "x", 2000)->sum == Approx(40) );
+      REQUIRE( findRollUp(areas, "C", "x", 2000)->sum == Approx(40) );
+      REQUIRE( findRollUp(areas, "C", "x", 2000)->mean() == Approx(20) );
+
+    } // THEN
+
+    WHEN( "a value is changed, added and removed" ) {
+
+      setRollUpValue(areas, "A1", "x", 2000, 15);
+      setRollUpValue(areas, "A2", "x", 2001, 5);
+
+      THEN( "the roll-ups change with it" ) {
+
+        REQUIRE( findRollUp(areas, "C", "x", 2000)->sum == Approx(45) );
+        REQUIRE( findRollUp(areas, "C", "x", 2001)->sum == Approx(5) );
+        REQUIRE( findRollUp(areas, "C", "x", 2001)->count == 1 );
+
+        areas.removeArea("A2");
+        REQUIRE( findRollUp(areas, "C", "x", 2000)->sum == Approx(15) );
+        REQUIRE( findRollUp(areas, "C", "x", 2001) == nullptr );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "the region has its own figures" ) {
+
+      setRollUpValue(areas, "R", "x", 2000, 1000);
+
+      THEN( "they are not counted on top of its local authorities'" ) {
+
+        REQUIRE( findRollUp(areas, "C", "x", 2000)->sum == Approx(40) );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a local authority moves to another region" ) {
+
+      REQUIRE( setRollUpParent(areas, "A2", "S") );
+      REQUIRE( setRollUpParent(areas, "S", "C") );
+
+      THEN( "its values move with it" ) {
+
+        REQUIRE( findRollUp(areas, "R", "x", 2000)->sum == Approx(10) );
+        REQUIRE( findRollUp(areas, "S", "x", 2000)->sum == Approx(30) );
+        REQUIRE( findRollUp(areas, "C", "x", 2000)->sum == Approx(40) );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a link would make a loop" ) {
+
+      THEN( "it is refused" ) {
+
+        REQUIRE_FALSE( setRollUpParent(areas, "C", "A1") );
+        REQUIRE_FALSE( setRollUpParent(areas, "R", "R") );
+        REQUIRE( areas.getHierarchy().getParent("C") == "" );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a measure is replaced" ) {
+
+      Measure replacement("x", "x");
+      replacement.setValue(2002, 7);
+      areas.replaceMeasure("A1", "x", &replacement);
+
+      THEN( "only the new values are rolled up" ) {
+
+        REQUIRE( findRollUp(areas, "C", "x", 2000)->sum == Approx(30) );
+        REQUIRE( findRollUp(areas, "C", "x", 2002)->sum == Approx(7) );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "a weighted mean is kept up to date as the weights change", "[Hierarchy][weighted]" ) {
+
+  GIVEN( "two areas with a rate and a population" ) {
+
+    Areas areas = Areas();
+    areas.getHierarchy().setWeightMeasure("pop");
+    setRollUpValue(areas, "A1", "rate", 2000, 10);
+    setRollUpValue(areas, "A1", "pop", 2000, 100);
+    setRollUpValue(areas, "A2", "rate", 2000, 20);
+    REQUIRE( setRollUpParent(areas, "A1", "C") );
+    REQUIRE( setRollUpParent(areas, "A2", "C") );
+
+    THEN( "an area with no weight is left out of the weighted mean" ) {
+
+      REQUIRE( findRollUp(areas, "C", "rate", 2000)->weightedMean() == Approx(10) );
+      REQUIRE( findRollUp(areas, "C", "rate", 2000)->mean() == Approx(15) );
+
+    } // THEN
+
+    WHEN( "the other area's weight is imported" ) {
+
+      setRollUpValue(areas, "A2", "pop", 2000, 300);
+
+      THEN( "the weighted mean includes it" ) {
+
+        REQUIRE( findRollUp(areas, "C", "rate", 2000)->weightedMean() == Approx(17.5) );
+        REQUIRE( findRollUp(areas, "C", "pop", 2000)->weightedMean() == Approx(250) );
+
+      } // THEN
+
+    } // WHEN
+
+    THEN( "the weight cannot be changed once there is a hierarchy" ) {
+
+      REQUIRE_THROWS_AS( areas.getHierarchy().setWeightMeasure("area"), std::logic_error );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "the rollup program argument can be parsed correctly", "[args][Hierarchy]" ) {
+
+  auto parse = [](std::initializer_list<const char*> values) {
+    Argv argv(values);
+    auto** actual_argv = argv.argv();
+    auto argc          = argv.argc();
+
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args    = cxxopts.parse(argc, actual_argv);
+    return BethYw::parseRollUpArg(args);
+  };
+
+  THEN( "it can be a sum, a mean, or a mean weighted by a measure" ) {
+
+    REQUIRE( parse({"test"}).statistic == RollUpNone );
+    REQUIRE( parse({"test", "--rollup", "SUM"}).statistic == RollUpSum );
+    REQUIRE( parse({"test", "--rollup", "mean"}).statistic == RollUpMean );
+
+    auto weighted = parse({"test", "--rollup", "wmean:Pop"});
+    REQUIRE( weighted.statistic == RollUpWeightedMean );
+    REQUIRE( weighted.weight == "pop" );
+
+    REQUIRE_THROWS_AS( parse({"test", "--rollup", "wmean:"}), std::invalid_argument );
+    REQUIRE_THROWS_AS( parse({"test", "--rollup", "median"}), std::invalid_argument );
+
+  } // THEN
+
+} // SCENARIO
+
+SCENARIO( "the weights of a weighted mean roll-up are not output unless they are asked for", "[Hierarchy][run]" ) {
+
+  GIVEN( "a weighted mean roll-up of one measure" ) {
+
+    THEN( "only the roll-up of that measure is output" ) {
+
+      //runOutput() is in test20.cpp.
+      std::string output = runOutput({"test", "-d", "popden", "--rollup", "wmean:pop", "-m", "dens", "-y", "2010-2011"});
+      REQUIRE( output.find("(dens)") != std::string::npos );
+      REQUIRE( output.find("(pop)") == std::string::npos );
+
+    } // THEN
+
+    THEN( "the weights are output too if they are asked for" ) {
+
+      std::string output = runOutput({"test", "-d", "popden", "--rollup", "wmean:pop", "-m", "dens,pop",
+                                      "-y", "2010-2011"});
+      REQUIRE( output.find("(dens)") != std::string::npos );
+      REQUIRE( output.find("(pop)") != std::string::npos );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
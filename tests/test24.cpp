@@ -0,0 +1,275 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../lib_cxxopts.hpp"
+#include "../lib_cxxopts_argv.hpp"
+
+#include "../lib_json.hpp"
+#include "../areas.h"
+#include "../bethyw.h"
+#include "../quantile.h"
+
+/*
+  The proportion of the (sorted) values that are less than or equal to x.
+*/
+static double quantileRank(const std::vector<double> &sorted, double x) {
+  return (double) (std::upper_bound(sorted.begin(), sorted.end(), x) - sorted.begin()) / sorted.size();
+}
+
+SCENARIO( "a quantile sketch is exact for a small set of values", "[QuantileSketch][exact]" ) {
+
+  GIVEN( "a sketch of ten values" ) {
+
+    QuantileSketch sketch;
+    for (double value : {7.0, 3.0, 9.0, 1.0, 5.0, 10.0, 2.0, 8.0, 4.0, 6.0}) {
+      sketch.add(value);
+    }
+
+    THEN( "it holds every value, and each quantile is one of them" ) {
+
+      REQUIRE( sketch.isExact() );
+      REQUIRE( sketch.count() == 10 );
+      REQUIRE( sketch.quantile(0.0) == 1.0 );
+      REQUIRE( sketch.quantile(0.5) == 5.0 );
+      REQUIRE( sketch.quantile(0.9) == 9.0 );
+      REQUIRE( sketch.quantile(1.0) == 10.0 );
+
+    } // THEN
+
+    THEN( "a quantile outside 0 to 1 cannot be asked for" ) {
+
+      REQUIRE_THROWS_AS( sketch.quantile(1.5), std::out_of_range );
+
+    } // THEN
+
+    THEN( "asking for a quantile does not rank it, and ranking it gives the same quantiles" ) {
+
+      REQUIRE_FALSE( sketch.isRanked() );
+      REQUIRE( sketch.quantile(0.5) == 5.0 );
+      REQUIRE_FALSE( sketch.isRanked() );
+
+      sketch.rank();
+      REQUIRE( sketch.isRanked() );
+      REQUIRE( sketch.quantile(0.5) == 5.0 );
+      REQUIRE( sketch.quantile(0.9) == 9.0 );
+
+      sketch.add(0.0);
+      REQUIRE_FALSE( sketch.isRanked() );
+      REQUIRE( sketch.quantile(0.0) == 0.0 );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "an empty sketch" ) {
+
+    QuantileSketch sketch;
+    sketch.add(std::numeric_limits<double>::quiet_NaN());
+
+    THEN( "it has no quantiles" ) {
+
+      REQUIRE( sketch.count() == 0 );
+      REQUIRE( std::isnan(sketch.quantile(0.5)) );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "a quantile sketch of many values stays small and close", "[QuantileSketch][approximate]" ) {
+
+  GIVEN( "100,000 random values, split between two sketches that are merged" ) {
+
+    std::mt19937 random(42);
+    std::lognormal_distribution<double> distribution(5.0, 1.5);
+
+    std::vector<double> values;
+    QuantileSketch whole, left, right;
+    QuantileSketch exact(0);
+    for (size_t i = 0; i < 100000; i++) {
+      const double value = distribution(random);
+      values.push_back(value);
+      whole.add(value);
+      exact.add(value);
+      (i % 2 == 0 ? left : right).add(value);
+    }
+    left.merge(right);
+    std::sort(values.begin(), values.end());
+
+    THEN( "the sketches hold a small fraction of the values" ) {
+
+      REQUIRE_FALSE( whole.isExact() );
+      REQUIRE( whole.count() == 100000 );
+      REQUIRE( left.count() == 100000 );
+      REQUIRE( whole.retainedCount() < 2000 );
+      REQUIRE( left.retainedCount() < 2000 );
+
+    } // THEN
+
+    THEN( "each quantile's rank is within 2% of the true rank" ) {
+
+      for (double q : {0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99}) {
+        REQUIRE( std::abs(quantileRank(values, whole.quantile(q)) - q) < 0.02 );
+        REQUIRE( std::abs(quantileRank(values, left.quantile(q)) - q) < 0.02 );
+      }
+
+    } // THEN
+
+    THEN( "a sketch with k = 0 keeps every value" ) {
+
+      REQUIRE( exact.isExact() );
+      REQUIRE( exact.quantile(0.5) == values[49999] );
+      REQUIRE( exact.quantile(0.9) == values[89999] );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "an Areas instance keeps quantile sketches as values are imported", "[Areas][QuantileIndex]" ) {
+
+  GIVEN( "an Areas instance with quantiles enabled" ) {
+
+    Areas areas = Areas();
+    areas.enableQuantiles();
+
+    for (unsigned int i = 1; i <= 5; i++) {
+      std::string code = "A" + std::to_string(i);
+      Area area(code);
+      Measure measure("x", "x");
+      measure.setValue(2000, i * 10.0);
+      area.setMeasure("x", measure);
+      areas.setArea(code, area);
+    }
+
+    THEN( "the median is found from the sketch" ) {
+
+      const QuantileSketch *sketch = areas.getQuantiles().find("x", 2000);
+      REQUIRE( sketch != nullptr );
+      REQUIRE( sketch->count() == 5 );
+      REQUIRE( sketch->quantile(0.5) == 30.0 );
+
+    } // THEN
+
+    THEN( "every sketch is ranked once they are asked for, so reading them changes nothing" ) {
+
+      for (const auto &it : areas.getQuantiles().getSketches()) {
+        REQUIRE( it.second.isRanked() );
+      }
+
+    } // THEN
+
+    WHEN( "a value is replaced and an area removed" ) {
+
+      Measure replacement("x", "x");
+      replacement.setValue(2000, 1.0);
+      areas.replaceMeasure("A3", "x", &replacement);
+      areas.removeArea("A1");
+
+      THEN( "the sketch is built again from the data" ) {
+
+        const QuantileSketch *sketch = areas.getQuantiles().find("x", 2000);
+        REQUIRE( sketch != nullptr );
+        REQUIRE( sketch->count() == 4 );
+        REQUIRE( sketch->quantile(0.0) == 1.0 );
+        REQUIRE( sketch->quantile(0.5) == 20.0 );
+        REQUIRE( areas.getQuantiles().getStale().empty() );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "the measure is removed" ) {
+
+      areas.removeMeasure("X");
+
+      THEN( "it has no sketches" ) {
+
+        REQUIRE( areas.getQuantiles().find("x", 2000) == nullptr );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a dataset with the measure's codename in another case is imported" ) {
+
+      std::istringstream csv("AuthorityCode,2000\nA1,5\nA6,60\n");
+      areas.populate(csv, BethYw::AuthorityByYearCSV, {
+        {BethYw::AUTH_CODE, "AuthorityCode"},
+        {BethYw::SINGLE_MEASURE_CODE, "X"},
+        {BethYw::SINGLE_MEASURE_NAME, "x"}
+      }, nullptr, nullptr, nullptr, nullptr);
+
+      THEN( "its values are in the same sketch" ) {
+
+        REQUIRE( areas.getQuantiles().find("X", 2000) == nullptr );
+        const QuantileSketch *sketch = areas.getQuantiles().find("x", 2000);
+        REQUIRE( sketch != nullptr );
+        REQUIRE( sketch->quantile(0.0) == 5.0 );
+
+      } // THEN
+
+    } // WHEN
+
+    THEN( "the quantiles can be printed as JSON" ) {
+
+      auto j = nlohmann::json::parse(quantilesToJSON(areas, {0.5, 0.9}));
+      REQUIRE( j["x"]["2000"]["areas"] == 5 );
+      REQUIRE( j["x"]["2000"]["exact"] == true );
+      REQUIRE( j["x"]["2000"]["p50"] == 30.0 );
+      REQUIRE( j["x"]["2000"]["p90"] == 50.0 );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "the quantiles program argument can be parsed correctly", "[args][QuantileSketch]" ) {
+
+  auto parse = [](std::initializer_list<const char*> values) {
+    Argv argv(values);
+    auto** actual_argv = argv.argv();
+    auto argc          = argv.argc();
+
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args    = cxxopts.parse(argc, actual_argv);
+    return BethYw::parseQuantilesArg(args);
+  };
+
+  THEN( "it is a list of percentiles from 0 to 100" ) {
+
+    REQUIRE( parse({"test"}).empty() );
+    auto quantiles = parse({"test", "--quantiles", "50,90,99.9"});
+    REQUIRE( quantiles.size() == 3 );
+    REQUIRE( quantiles[0] == Approx(0.5) );
+    REQUIRE( quantiles[2] == Approx(0.999) );
+    REQUIRE_THROWS_AS( parse({"test", "--quantiles", "101"}), std::invalid_argument );
+    REQUIRE_THROWS_AS( parse({"test", "--quantiles", "median"}), std::invalid_argument );
+
+  } // THEN
+
+} // SCENARIO
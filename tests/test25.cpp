@@ -0,0 +1,313 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+
+#include <sys/stat.h>
+
+#include "../lib_json.hpp"
+#include "../datasets.h"
+#include "../areas.h"
+#include "../bethyw.h"
+#include "../catalog.h"
+
+SCENARIO( "a dataset catalog records what each dataset contains", "[DatasetCatalog][scan]" ) {
+
+  GIVEN( "a catalog of a copy of the datasets directory" ) {
+
+    std::string dir = copyDatasets({"areas.csv", "popu1009.json", "complete-popu1009-pop.csv"});
+    DatasetCatalog catalog(dir);
+
+    THEN( "nothing is known until a dataset is scanned" ) {
+
+      REQUIRE( catalog.find(BethYw::InputFiles::POPDEN) == nullptr );
+      REQUIRE_FALSE( catalog.isChanged() );
+
+    } // THEN
+
+    WHEN( "a JSON dataset is scanned" ) {
+
+      const CatalogEntry &entry = catalog.scan(BethYw::InputFiles::POPDEN);
+
+      THEN( "its measures, years and areas are recorded" ) {
+
+        REQUIRE( entry.measures == std::set<std::string>({"area", "dens", "pop"}) );
+        REQUIRE( entry.first_year == 1991 );
+        REQUIRE( entry.last_year == 2019 );
+        REQUIRE( entry.areas.at("W06000011") == "Swansea" );
+        REQUIRE( entry.files.size() == 1 );
+        REQUIRE( catalog.isChanged() );
+        REQUIRE( catalog.find(BethYw::InputFiles::POPDEN) == &entry );
+
+      } // THEN
+
+      THEN( "it is found again by a new catalog after saving" ) {
+
+        catalog.save();
+        DatasetCatalog reloaded(dir);
+        const CatalogEntry *found = reloaded.find(BethYw::InputFiles::POPDEN);
+        REQUIRE( found != nullptr );
+        REQUIRE( found->measures == entry.measures );
+        REQUIRE( found->areas == entry.areas );
+        REQUIRE( found->last_year == 2019 );
+
+      } // THEN
+
+      THEN( "it is forgotten once the file changes" ) {
+
+        catalog.save();
+        std::ofstream(dir + "popu1009.json", std::ios::app) << "\n";
+        REQUIRE( DatasetCatalog(dir).find(BethYw::InputFiles::POPDEN) == nullptr );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a CSV dataset is scanned" ) {
+
+      const CatalogEntry &entry = catalog.scan(BethYw::InputFiles::COMPLETE_POP);
+
+      THEN( "its single measure, its years and its area codes are recorded" ) {
+
+        REQUIRE( entry.measures == std::set<std::string>({"pop"}) );
+        REQUIRE( entry.first_year == 1991 );
+        REQUIRE( entry.last_year == 2019 );
+        REQUIRE( entry.areas.count("W06000011") == 1 );
+
+      } // THEN
+
+    } // WHEN
+
+    THEN( "a corrupt catalog file is ignored" ) {
+
+      REQUIRE( makeCacheDirectory(cacheDirectory(dir)) );
+      std::ofstream(cacheDirectory(dir) + CATALOG_FILE) << "{\"version\": 1, \"datasets\": ";
+      REQUIRE( DatasetCatalog(dir).find(BethYw::InputFiles::POPDEN) == nullptr );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "a catalog entry tells whether a dataset can contribute to a query", "[DatasetCatalog][CatalogEntry]" ) {
+
+  GIVEN( "the catalog entry of popu1009.json and the areas from areas.csv" ) {
+
+    std::string dir = copyDatasets({"areas.csv", "popu1009.json"});
+    DatasetCatalog catalog(dir);
+    const CatalogEntry &entry = catalog.scan(BethYw::InputFiles::POPDEN);
+
+    Areas known = Areas();
+    BethYw::loadAreas(known, dir, StringFilterSet());
+
+    const StringFilterSet none;
+    const YearFilterTuple allYears(0, 0);
+
+    THEN( "it is pruned by its measures" ) {
+
+      REQUIRE( entry.mayContribute(known, none, {"POP"}, allYears) );
+      REQUIRE( entry.mayContribute(known, none, {"rail", "dens"}, allYears) );
+      REQUIRE_FALSE( entry.mayContribute(known, none, {"rail"}, allYears) );
+
+    } // THEN
+
+    THEN( "it is pruned by its years" ) {
+
+      REQUIRE( entry.mayContribute(known, none, none, YearFilterTuple(2019, 2025)) );
+      REQUIRE_FALSE( entry.mayContribute(known, none, none, YearFilterTuple(1980, 1990)) );
+      REQUIRE_FALSE( entry.mayContribute(known, none, none, YearFilterTuple(2020, 2025)) );
+
+    } // THEN
+
+    THEN( "it is pruned by its areas, matched on codes and any known name" ) {
+
+      REQUIRE( entry.mayContribute(known, {"W06000011"}, none, allYears) );
+      REQUIRE( entry.mayContribute(known, {"swan"}, none, allYears) );
+      REQUIRE( entry.mayContribute(known, {"abertawe"}, none, allYears) );
+      REQUIRE_FALSE( entry.mayContribute(known, {"W06000015"}, none, allYears) );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "the caches of a datasets directory are kept in the user's cache directory", "[DatasetCatalog][cacheDirectory]" ) {
+
+  GIVEN( "two copies of the datasets directory" ) {
+
+    std::string dir = copyDatasets({});
+    std::string other = copyDatasets({});
+    const std::string home = std::getenv("XDG_CACHE_HOME");
+
+    THEN( "each has its own directory in bethyw/ in $XDG_CACHE_HOME, which is the same however it is named" ) {
+
+      const std::string cache = cacheDirectory(dir);
+      REQUIRE( cache.compare(0, home.size() + 8, home + "/bethyw/") == 0 );
+      REQUIRE( cache.back() == '/' );
+      REQUIRE( cacheDirectory(dir + "./") == cache );
+      REQUIRE( cacheDirectory(other) != cache );
+
+    } // THEN
+
+    THEN( "the directory is only created once a cache is saved" ) {
+
+      std::string source = copyDatasets({"popu1009.json"});
+      const std::string cache = cacheDirectory(source);
+      struct stat info;
+      DatasetCatalog catalog(source);
+      catalog.scan(BethYw::InputFiles::POPDEN);
+      REQUIRE( stat(cache.c_str(), &info) != 0 );
+
+      catalog.save();
+      REQUIRE( stat(cache.c_str(), &info) == 0 );
+      REQUIRE( std::ifstream(cache + CATALOG_FILE).is_open() );
+
+    } // THEN
+
+    THEN( "a relative $XDG_CACHE_HOME is ignored in favour of ~/.cache" ) {
+
+      const char *user = std::getenv("HOME");
+      const std::string previous = user != nullptr ? user : "";
+      setenv("XDG_CACHE_HOME", "relative", 1);
+      setenv("HOME", home.c_str(), 1);
+      const std::string cache = cacheDirectory(dir);
+      setenv("XDG_CACHE_HOME", home.c_str(), 1);
+      setenv("HOME", previous.c_str(), 1);
+      REQUIRE( cache.compare(0, home.size() + 15, home + "/.cache/bethyw/") == 0 );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "datasets that cannot contribute are skipped without changing the result", "[DatasetCatalog][loadDatasets]" ) {
+
+  GIVEN( "a copy of the datasets directory" ) {
+
+    std::string dir = copyDatasets({"areas.csv", "popu1009.json", "econ0080.json", "tran0152.json"});
+    const std::vector<BethYw::InputFileSource> datasets = {
+      BethYw::InputFiles::POPDEN, BethYw::InputFiles::BIZ, BethYw::InputFiles::TRAINS};
+
+    auto load = [&](const StringFilterSet &areasFilter, const StringFilterSet &measuresFilter) {
+      Areas areas = Areas();
+      BethYw::loadAreas(areas, dir, areasFilter);
+      BethYw::loadDatasets(areas, dir, datasets, areasFilter, measuresFilter, YearFilterTuple(2010, 2015));
+      return nlohmann::json::parse(areas.toJSON());
+    };
+
+    //every dataset imported, as without a catalog.
+    auto loadAll = [&](const StringFilterSet &areasFilter, const StringFilterSet &measuresFilter) {
+      Areas areas = Areas();
+      const YearFilterTuple years(2010, 2015);
+      BethYw::loadAreas(areas, dir, areasFilter);
+      for (const auto &dataset : datasets) {
+        areas.populate(BethYw::openDatasetSource(dir, dataset)->open(), dataset.PARSER, dataset.COLS,
+                       &areasFilter, &measuresFilter, &years, nullptr);
+      }
+      return nlohmann::json::parse(areas.toJSON());
+    };
+
+    WHEN( "the same queries are run twice" ) {
+
+      auto first = load({"swan"}, {"pop"});
+      auto firstAll = load({"neath"}, StringFilterSet());
+      auto second = load({"swan"}, {"pop"});
+      auto secondAll = load({"neath"}, StringFilterSet());
+
+      THEN( "the catalog is written and the results are those of importing every dataset" ) {
+
+        REQUIRE( DatasetCatalog(dir).find(BethYw::InputFiles::BIZ) != nullptr );
+        REQUIRE( std::ifstream(cacheDirectory(dir) + CATALOG_FILE).is_open() );
+        REQUIRE_FALSE( std::ifstream(dir + CATALOG_FILE).is_open() );
+        REQUIRE( first == loadAll({"swan"}, {"pop"}) );
+        REQUIRE( second == first );
+        REQUIRE( firstAll == loadAll({"neath"}, StringFilterSet()) );
+        REQUIRE( secondAll == firstAll );
+        REQUIRE( first["W06000011"]["measures"].size() == 1 );
+        REQUIRE( secondAll["W06000012"]["measures"].count("rail") == 1 );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "a dataset the catalog does not know is recorded from its import", "[DatasetCatalog][loadDatasets]" ) {
+
+  GIVEN( "two copies of the datasets directory, one of which has its datasets scanned" ) {
+
+    const std::vector<std::string> files = {"areas.csv", "popu1009.json", "complete-popu1009-pop.csv"};
+    const std::vector<BethYw::InputFileSource> datasets = {BethYw::InputFiles::POPDEN, BethYw::InputFiles::COMPLETE_POP};
+    std::string dir = copyDatasets(files);
+    DatasetCatalog scanned(copyDatasets(files));
+
+    auto load = [&](const StringFilterSet &measuresFilter) {
+      Areas areas = Areas();
+      BethYw::loadAreas(areas, dir, {"swan"});
+      BethYw::loadDatasets(areas, dir, datasets, {"swan"}, measuresFilter, YearFilterTuple(2010, 2015));
+    };
+
+    auto requireWholeDatasets = [&]() {
+      DatasetCatalog catalog(dir);
+      for (const auto &dataset : datasets) {
+        INFO( dataset.FILE );
+        const CatalogEntry *entry = catalog.find(dataset);
+        REQUIRE( entry != nullptr );
+        const CatalogEntry &expected = scanned.scan(dataset);
+        REQUIRE( entry->measures == expected.measures );
+        REQUIRE( entry->first_year == expected.first_year );
+        REQUIRE( entry->last_year == expected.last_year );
+        REQUIRE( entry->areas == expected.areas );
+        REQUIRE( entry->files.size() == expected.files.size() );
+      }
+    };
+
+    WHEN( "they are imported with filters that both datasets pass" ) {
+
+      load({"pop"});
+
+      THEN( "their entries are of the whole datasets, as if they were scanned" ) {
+
+        requireWholeDatasets();
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "they are imported with a filter that rules out the measure of the CSV dataset" ) {
+
+      load({"area"});
+
+      THEN( "the CSV dataset, which is not parsed, is scanned instead" ) {
+
+        requireWholeDatasets();
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
@@ -0,0 +1,278 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../lib_cxxopts.hpp"
+#include "../lib_cxxopts_argv.hpp"
+
+#include "../datasets.h"
+#include "../areas.h"
+#include "../bethyw.h"
+#include "../registry.h"
+
+SCENARIO( "the schema sniffer infers the columns of the datasets in datasets.h", "[SchemaSniffer]" ) {
+
+  GIVEN( "each dataset in datasets.h" ) {
+
+    for (const auto &dataset : BethYw::InputFiles::DATASETS) {
+
+      auto input = openInputFile("datasets/" + dataset.FILE);
+      SniffedSchema schema = sniffSchema(input->open(), dataset.FILE);
+
+      THEN( "the parser and the columns used to import " + dataset.FILE + " are found" ) {
+
+        REQUIRE( schema.parser == dataset.PARSER );
+        for (auto column : {BethYw::AUTH_CODE, BethYw::YEAR, BethYw::VALUE, BethYw::MEASURE_CODE, BethYw::AUTH_HIERARCHY}) {
+          REQUIRE( schema.cols.count(column) == dataset.COLS.count(column) );
+          if (dataset.COLS.count(column)) {
+            REQUIRE( schema.cols.at(column) == dataset.COLS.at(column) );
+          }
+        }
+        REQUIRE( schema.singleMeasure == (dataset.COLS.count(BethYw::SINGLE_MEASURE_CODE) == 1) );
+
+      } // THEN
+
+    }
+
+  } // GIVEN
+
+  GIVEN( "areas.csv" ) {
+
+    auto input = openInputFile("datasets/areas.csv");
+    SniffedSchema schema = sniffSchema(input->open(), "areas.csv");
+
+    THEN( "its names are found" ) {
+
+      REQUIRE( schema.parser == BethYw::AuthorityCodeCSV );
+      REQUIRE( schema.cols == BethYw::InputFiles::AREAS.COLS );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "a JSON file whose first row is longer than a chunk that is read at once" ) {
+
+    std::stringstream json;
+    json << "{\"value\": [";
+    for (int i = 0; i < 3; i++) {
+      json << (i > 0 ? "," : "") << "{\"Data\": 1, \"Area_Code\": \"W06000011\", \"Year_Code\": \"2020\", "
+           << "\"Notes\": \"" << std::string(100000, '}') << "\"}";
+    }
+    json << "]}";
+
+    THEN( "the rows are still found" ) {
+
+      SniffedSchema schema = sniffSchema(json, "long.json");
+      REQUIRE( schema.parser == BethYw::WelshStatsJSON );
+      REQUIRE( schema.cols.at(BethYw::AUTH_CODE) == "Area_Code" );
+      REQUIRE( schema.singleMeasure );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "a JSON file whose \"value\" key is split between the chunks that are read at once" ) {
+
+    std::stringstream json;
+    json << "{\"Notes\": \"" << std::string(64 * 1024 - 17, ' ') << "\", \"value\": [";
+    for (int i = 0; i < 10; i++) {
+      json << (i > 0 ? "," : "") << "{\"Data\": " << i << ", \"Area_Code\": \"W06000011\", \"Year_Code\": \"2020\"}";
+    }
+    json << "]}";
+
+    THEN( "the rows are still found" ) {
+
+      REQUIRE( json.str().substr(64 * 1024 - 3, 7) == "\"value\"" );
+      SniffedSchema schema = sniffSchema(json, "split.json");
+      REQUIRE( schema.parser == BethYw::WelshStatsJSON );
+      REQUIRE( schema.cols.at(BethYw::AUTH_CODE) == "Area_Code" );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "files whose columns cannot be inferred" ) {
+
+    std::stringstream noYear("{\"value\": [{\"Data\": 1, \"Area_Code\": \"W06000011\"}]}");
+    std::stringstream twoMeasures("{\"value\": [{\"Data\": 1, \"Area_Code\": \"W06000011\", \"Year_Code\": \"2020\", "
+                                  "\"Sex_Code\": \"F\", \"Age_Code\": \"16\"}]}");
+    std::stringstream csv("Code,Name,Notes\nW06000011,Swansea,\n");
+
+    THEN( "a std::runtime_error is thrown" ) {
+
+      REQUIRE_THROWS_AS( sniffSchema(noYear, "a.json"), std::runtime_error );
+      REQUIRE_THROWS_AS( sniffSchema(twoMeasures, "b.json"), std::runtime_error );
+      REQUIRE_THROWS_AS( sniffSchema(csv, "c.csv"), std::runtime_error );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "a dataset registry is extended by a manifest", "[DatasetRegistry][manifest]" ) {
+
+  GIVEN( "the registry of the datasets in datasets.h" ) {
+
+    DatasetRegistry registry;
+
+    THEN( "it holds each of them in order" ) {
+
+      REQUIRE( registry.size() == BethYw::InputFiles::NUM_DATASETS );
+      REQUIRE( registry.getDatasets()[0].code == "popden" );
+      REQUIRE( registry.find("trains") != nullptr );
+      REQUIRE( registry.find("trains")->hasSchema() );
+      REQUIRE( registry.find("hous") == nullptr );
+
+    } // THEN
+
+    WHEN( "a manifest adds a dataset and replaces another" ) {
+
+      std::stringstream manifest(R"({"datasets": [
+        {"code": "hous", "name": "Housing stock", "file": "hous0501.json"},
+        {"code": "trains", "file": "tran0152.json", "parser": "WelshStatsJSON", "measure": "journeys",
+         "columns": {"AUTH_CODE": "LocalAuthority_Code", "YEAR": "Year_Code", "VALUE": "Data"}}
+      ]})");
+      REQUIRE( registry.loadManifest(manifest) == 2 );
+
+      THEN( "the new dataset is added at the end, with no schema" ) {
+
+        REQUIRE( registry.size() == BethYw::InputFiles::NUM_DATASETS + 1 );
+        REQUIRE( registry.getDatasets().back().code == "hous" );
+        REQUIRE( registry.find("hous")->name == "Housing stock" );
+        REQUIRE_FALSE( registry.find("hous")->hasSchema() );
+
+      } // THEN
+
+      THEN( "the replaced dataset takes its single measure from the manifest" ) {
+
+        auto source = applySchema(*registry.find("trains"), SniffedSchema());
+        REQUIRE( source.PARSER == BethYw::WelshStatsJSON );
+        REQUIRE( source.COLS.at(BethYw::SINGLE_MEASURE_CODE) == "journeys" );
+        REQUIRE( source.COLS.at(BethYw::SINGLE_MEASURE_NAME) == "trains" );
+
+      } // THEN
+
+    } // WHEN
+
+    THEN( "a manifest that is not valid is rejected and nothing is added" ) {
+
+      std::stringstream noFile(R"({"datasets": [{"code": "a", "file": "a.json"}, {"code": "b"}]})");
+      std::stringstream badParser(R"({"datasets": [{"code": "a", "file": "a.json", "parser": "XML"}]})");
+      std::stringstream badColumn(R"({"datasets": [{"code": "a", "file": "a.json", "columns": {"AREA": "x"}}]})");
+      std::stringstream notJSON("datasets");
+
+      REQUIRE_THROWS_AS( registry.loadManifest(noFile), std::runtime_error );
+      REQUIRE_THROWS_AS( registry.loadManifest(badParser), std::runtime_error );
+      REQUIRE_THROWS_AS( registry.loadManifest(badColumn), std::runtime_error );
+      REQUIRE_THROWS_AS( registry.loadManifest(notJSON), std::runtime_error );
+      REQUIRE( registry.find("a") == nullptr );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "datasets from a manifest are sniffed, cached and imported", "[DatasetRegistry][SchemaCache][args]" ) {
+
+  GIVEN( "a directory with a manifest of a renamed copy of popu1009.json" ) {
+
+    std::string dir = copyDatasets({"areas.csv", "popu1009.json", "tran0152.json"});
+    std::rename((dir + "popu1009.json").c_str(), (dir + "people.json").c_str());
+    std::ofstream(dir + MANIFEST_FILE) << R"({"datasets": [{"code": "people", "file": "people.json"}]})";
+
+    auto parse = [&dir](std::initializer_list<const char*> values) {
+      Argv argv(values);
+      auto** actual_argv = argv.argv();
+      auto argc          = argv.argc();
+
+      auto cxxopts = BethYw::cxxoptsSetup();
+      auto args    = cxxopts.parse(argc, actual_argv);
+      return BethYw::parseDatasetsArg(args);
+    };
+    std::string dirArg = dir.substr(0, dir.size() - 1);
+
+    WHEN( "the dataset is chosen by its code" ) {
+
+      auto datasets = parse({"test", "--dir", dirArg.c_str(), "-d", "people"});
+
+      THEN( "its columns are sniffed and kept in the schema cache" ) {
+
+        REQUIRE( datasets.size() == 1 );
+        REQUIRE( datasets[0].FILE == "people.json" );
+        REQUIRE( datasets[0].COLS.at(BethYw::MEASURE_CODE) == "Measure_Code" );
+
+        SchemaCache cache(dir);
+        SniffedSchema schema;
+        REQUIRE( cache.find("people.json", schema) );
+        REQUIRE( schema.cols == datasets[0].COLS );
+
+      } // THEN
+
+      THEN( "it is imported in the same way as popden" ) {
+
+        Areas areas = Areas();
+        BethYw::loadDatasets(areas, dir, datasets, StringFilterSet(), {"pop"}, YearFilterTuple(2019, 2019));
+        REQUIRE( areas.getArea("W06000011").getMeasure("pop").getValue(2019) == 246993 );
+
+      } // THEN
+
+      THEN( "the cached schema is forgotten once the file changes" ) {
+
+        std::ofstream(dir + "people.json", std::ios::app) << "\n";
+        SniffedSchema schema;
+        REQUIRE_FALSE( SchemaCache(dir).find("people.json", schema) );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "all datasets are chosen" ) {
+
+      auto datasets = parse({"test", "--dir", dirArg.c_str()});
+
+      THEN( "the datasets in datasets.h come first, then those in the manifest" ) {
+
+        REQUIRE( datasets.size() == BethYw::InputFiles::NUM_DATASETS + 1 );
+        REQUIRE( datasets.back().CODE == "people" );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a file is chosen by its name" ) {
+
+      auto datasets = parse({"test", "--dir", dirArg.c_str(), "-d", "tran0152.json"});
+
+      THEN( "its single measure is named after the file" ) {
+
+        REQUIRE( datasets.size() == 1 );
+        REQUIRE( datasets[0].PARSER == BethYw::WelshStatsJSON );
+        REQUIRE( datasets[0].COLS.at(BethYw::SINGLE_MEASURE_CODE) == "tran0152" );
+        REQUIRE_THROWS_AS( parse({"test", "--dir", dirArg.c_str(), "-d", "missing.json"}), std::invalid_argument );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
@@ -0,0 +1,132 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "../lib_json.hpp"
+#include "../datasets.h"
+#include "../input.h"
+#include "../projection.h"
+
+SCENARIO( "a JSON projection holds the columns an import reads", "[JSONProjection]" ) {
+
+  GIVEN( "the projection of popden and of trains" ) {
+
+    JSONProjection popden(BethYw::InputFiles::POPDEN.COLS);
+    JSONProjection trains(BethYw::InputFiles::TRAINS.COLS);
+
+    THEN( "they hold the mapped columns, but not the name of a single measure" ) {
+
+      REQUIRE( popden.size() == 7 );
+      REQUIRE( popden.contains("Localauthority_Code") );
+      REQUIRE( popden.contains("Data") );
+      REQUIRE_FALSE( popden.contains("RowKey") );
+      REQUIRE( trains.size() == 4 );
+      REQUIRE_FALSE( trains.contains("rail") );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "a projected StatsWales JSON page keeps only the projected keys", "[JSONProjection][parse]" ) {
+
+  GIVEN( "popu1009.json, parsed in full and with the popden projection" ) {
+
+    JSONProjection projection(BethYw::InputFiles::POPDEN.COLS);
+
+    InputFile full_input("datasets/popu1009.json");
+    nlohmann::json full;
+    full_input.open() >> full;
+
+    InputFile projected_input("datasets/popu1009.json");
+    nlohmann::json projected = parseProjectedWelshStatsJSON(projected_input.open(), projection);
+
+    THEN( "each row holds the same values for the projected keys, with the same types" ) {
+
+      REQUIRE( projected["value"].size() == full["value"].size() );
+      for (size_t i = 0; i < full["value"].size(); i++) {
+        nlohmann::json expected = nlohmann::json::object();
+        for (const auto &item : full["value"][i].items()) {
+          if (projection.contains(item.key())) {
+            expected[item.key()] = item.value();
+          }
+        }
+        REQUIRE( projected["value"][i] == expected );
+      }
+
+    } // THEN
+
+    THEN( "the next link is kept and the metadata is not" ) {
+
+      REQUIRE( projected["odata.nextLink"] == full["odata.nextLink"] );
+      REQUIRE( projected.count("odata.metadata") == 0 );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "rows with escapes, nested values and brackets in skipped strings" ) {
+
+    std::stringstream json(R"({"odata.metadata": {"a": [1, {"b": "}]"}]},
+      "value": [
+        {"Notes": "a \"quoted\" } and ] \\", "Area_Code": "W06000011", "Nested": {"x": [1, 2, {"y": "{"}]},
+         "Area_ItemName_ENG": "Ynys Môn 😀\n", "Year_Code": "2020", "Data": -12},
+        {"Area_Code": "W06000012", "Data": 1.5e2, "Year_Code": "2021", "Extra": [true, false, null],
+         "Area_ItemName_ENG": "Neath"},
+        {}
+      ]})");
+
+    JSONProjection projection(BethYw::InputFiles::AQI.COLS);
+    nlohmann::json page = parseProjectedWelshStatsJSON(json, projection);
+
+    THEN( "the projected values are decoded and the rest are stepped over" ) {
+
+      REQUIRE( page["value"].size() == 3 );
+      REQUIRE( page["value"][0].size() == 4 );
+      REQUIRE( page["value"][0]["Area_ItemName_ENG"] == "Ynys M\xc3\xb4n \xf0\x9f\x98\x80\n" );
+      REQUIRE( page["value"][0]["Data"].is_number_integer() );
+      REQUIRE( page["value"][0]["Data"] == -12 );
+      REQUIRE( page["value"][1]["Data"].is_number_float() );
+      REQUIRE( page["value"][1]["Data"] == 150.0 );
+      REQUIRE( page["value"][1]["Year_Code"] == "2021" );
+      REQUIRE( page["value"][2].empty() );
+      REQUIRE( page.count("odata.nextLink") == 0 );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "malformed JSON" ) {
+
+    JSONProjection projection(BethYw::InputFiles::AQI.COLS);
+
+    THEN( "a std::runtime_error is thrown" ) {
+
+      for (const std::string text : {"", "[]", R"({"value": [{"Data": 1)", R"({"value": [{"Data": 1x}]})",
+                                     R"({"value": [{"Area_Code": "\q"}]})", R"({"value": [{"Notes": "abc}]})"}) {
+        std::stringstream json(text);
+        REQUIRE_THROWS_AS( parseProjectedWelshStatsJSON(json, projection), std::runtime_error );
+      }
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
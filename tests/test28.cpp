@@ -0,0 +1,171 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "../lib_cxxopts.hpp"
+#include "../lib_cxxopts_argv.hpp"
+
+#include "../lib_json.hpp"
+#include "../datasets.h"
+#include "../areas.h"
+#include "../bethyw.h"
+
+/*
+  A stream buffer that records the size of what has been written to it at
+  each flush.
+*/
+class FlushRecordingBuffer : public std::stringbuf {
+ public:
+  std::vector<size_t> flushes;
+
+ protected:
+  int sync() override {
+    flushes.push_back(str().size());
+    return 0;
+  }
+};
+
+/*
+  Split NDJSON output into its parsed records.
+*/
+static std::vector<nlohmann::json> readNDJSON(const std::string &output) {
+  std::vector<nlohmann::json> records;
+  std::stringstream lines(output);
+  std::string line;
+  while (std::getline(lines, line)) {
+    records.push_back(nlohmann::json::parse(line));
+  }
+  return records;
+}
+
+SCENARIO( "an Areas instance can be written as NDJSON", "[Areas][NDJSON]" ) {
+
+  GIVEN( "the areas imported from popu1009.json" ) {
+
+    Areas areas = Areas();
+    InputFile input("datasets/popu1009.json");
+    areas.populate(input.open(), BethYw::WelshStatsJSON, BethYw::InputFiles::POPDEN.COLS, nullptr, nullptr, nullptr, nullptr);
+    const auto whole = nlohmann::json::parse(areas.toJSON());
+
+    WHEN( "it is written with a record per area" ) {
+
+      std::stringstream output;
+      areas.toNDJSON(output, NDJSONByArea);
+      auto records = readNDJSON(output.str());
+
+      THEN( "each record is an area as it is in the JSON output, in order" ) {
+
+        REQUIRE( records.size() == whole.size() );
+        auto it = whole.begin();
+        for (const auto &record : records) {
+          REQUIRE( record["code"] == it.key() );
+          REQUIRE( record["names"] == it.value()["names"] );
+          REQUIRE( record["measures"] == it.value()["measures"] );
+          it++;
+        }
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "it is written with a record per measure" ) {
+
+      std::stringstream output;
+      areas.toNDJSON(output, NDJSONByMeasure);
+      auto records = readNDJSON(output.str());
+
+      THEN( "each record is one measure of an area" ) {
+
+        REQUIRE( records.size() == whole.size() * 3 );
+        for (const auto &record : records) {
+          const auto &area = whole[record["code"].get<std::string>()];
+          REQUIRE( record["values"] == area["measures"][record["measure"].get<std::string>()] );
+          REQUIRE( record["names"] == area["names"] );
+        }
+        REQUIRE( records[0]["measure"] == "area" );
+        REQUIRE( records[0]["label"] == "Land area" );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+  GIVEN( "an Areas instance too large to write in one block" ) {
+
+    Areas areas = Areas();
+    for (unsigned int i = 0; i < 3000; i++) {
+      std::string code = "A" + std::to_string(100000 + i);
+      Area area(code);
+      area.setName("eng", "Area number " + std::to_string(i));
+      Measure measure("pop", "Population");
+      for (unsigned int year = 2000; year < 2010; year++) {
+        measure.setValue(year, i * 1.5 + year);
+      }
+      area.setMeasure("pop", measure);
+      areas.setArea(code, area);
+    }
+
+    FlushRecordingBuffer buffer;
+    std::ostream output(&buffer);
+    areas.toNDJSON(output, NDJSONByArea);
+
+    THEN( "it is flushed after each block of whole records" ) {
+
+      REQUIRE( buffer.flushes.size() > 2 );
+      REQUIRE( buffer.flushes.back() == buffer.str().size() );
+      size_t previous = 0;
+      for (size_t flushed : buffer.flushes) {
+        REQUIRE( buffer.str()[flushed - 1] == '\n' );
+        if (flushed != buffer.flushes.back()) {
+          REQUIRE( flushed - previous >= 64 * 1024 );
+        }
+        previous = flushed;
+      }
+      REQUIRE( readNDJSON(buffer.str()).size() == 3000 );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "the ndjson program argument can be parsed correctly", "[args][NDJSON]" ) {
+
+  auto parse = [](std::initializer_list<const char*> values) {
+    Argv argv(values);
+    auto** actual_argv = argv.argv();
+    auto argc          = argv.argc();
+
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args    = cxxopts.parse(argc, actual_argv);
+    return BethYw::parseNDJSONArg(args);
+  };
+
+  THEN( "it is a record per area by default, or per measure" ) {
+
+    REQUIRE( parse({"test"}) == NDJSONNone );
+    REQUIRE( parse({"test", "--ndjson"}) == NDJSONByArea );
+    REQUIRE( parse({"test", "--ndjson=Measure"}) == NDJSONByMeasure );
+    REQUIRE_THROWS_AS( parse({"test", "--ndjson=year"}), std::invalid_argument );
+
+  } // THEN
+
+} // SCENARIO
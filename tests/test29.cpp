@@ -0,0 +1,234 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../lib_cxxopts.hpp"
+#include "../lib_cxxopts_argv.hpp"
+
+#include "../lib_json.hpp"
+#include "../datasets.h"
+#include "../areas.h"
+#include "../bethyw.h"
+#include "../writer.h"
+
+/*
+  Format a number with a BufferedWriter.
+*/
+static std::string formatDouble(double value) {
+  std::stringstream output;
+  {
+    BufferedWriter writer(output);
+    writer.writeDouble(value);
+  }
+  return output.str();
+}
+
+/*
+  Split a line of CSV (without quoted fields) into its cells.
+*/
+static std::vector<std::string> splitCSVLine(const std::string &line) {
+  std::vector<std::string> cells;
+  std::stringstream stream(line);
+  std::string cell;
+  while (std::getline(stream, cell, ',')) {
+    cells.push_back(cell);
+  }
+  if (!line.empty() && line.back() == ',') {
+    cells.push_back("");
+  }
+  return cells;
+}
+
+SCENARIO( "a BufferedWriter formats numbers and CSV fields", "[BufferedWriter][CSV]" ) {
+
+  THEN( "numbers are written in their shortest form that reads back exactly" ) {
+
+    REQUIRE( formatDouble(246993.0) == "246993" );
+    REQUIRE( formatDouble(0.0) == "0" );
+    REQUIRE( formatDouble(95.7) == "95.7" );
+    REQUIRE( formatDouble(-12.25) == "-12.25" );
+    REQUIRE( formatDouble(0.1) == "0.1" );
+    REQUIRE( formatDouble(std::numeric_limits<double>::quiet_NaN()) == "" );
+
+    for (double value : {1.0 / 3.0, 3.1415926535897931, 1e-7, 6.02214076e23, 123456.789012, -0.000123}) {
+      REQUIRE( std::stod(formatDouble(value)) == value );
+    }
+
+  } // THEN
+
+  THEN( "whole numbers are written as digits" ) {
+
+    std::stringstream output;
+    {
+      BufferedWriter writer(output);
+      writer.writeUnsigned(0);
+      writer.write(',');
+      writer.writeUnsigned(18446744073709551615ULL);
+    }
+    REQUIRE( output.str() == "0,18446744073709551615" );
+
+  } // THEN
+
+  THEN( "a field is quoted only when it needs to be" ) {
+
+    std::stringstream output;
+    {
+      BufferedWriter writer(output);
+      writer.writeCSVField("W06000011");
+      writer.write(',');
+      writer.writeCSVField("Swansea, Abertawe");
+      writer.write(',');
+      writer.writeCSVField("a \"quote\"");
+    }
+    REQUIRE( output.str() == "W06000011,\"Swansea, Abertawe\",\"a \"\"quote\"\"\"" );
+
+  } // THEN
+
+} // SCENARIO
+
+SCENARIO( "an Areas instance can be written as CSV", "[Areas][CSV]" ) {
+
+  GIVEN( "the areas imported from popu1009.json" ) {
+
+    Areas areas = Areas();
+    InputFile input("datasets/popu1009.json");
+    areas.populate(input.open(), BethYw::WelshStatsJSON, BethYw::InputFiles::POPDEN.COLS, nullptr, nullptr, nullptr, nullptr);
+    const auto whole = nlohmann::json::parse(areas.toJSON());
+
+    WHEN( "it is written in the long layout" ) {
+
+      std::stringstream output;
+      areas.toCSV(output, CSVLong);
+
+      THEN( "there is a row for each value, as in the JSON output" ) {
+
+        std::string line;
+        REQUIRE( std::getline(output, line) );
+        REQUIRE( line == "AuthorityCode,Measure,Year,Value" );
+
+        size_t rows = 0;
+        while (std::getline(output, line)) {
+          auto cells = splitCSVLine(line);
+          REQUIRE( cells.size() == 4 );
+          REQUIRE( std::stod(cells[3]) == whole[cells[0]]["measures"][cells[1]][cells[2]].get<double>() );
+          rows++;
+        }
+
+        size_t values = 0;
+        for (const auto &area : whole) {
+          for (const auto &measure : area["measures"]) {
+            values += measure.size();
+          }
+        }
+        REQUIRE( rows == values );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "it is written in the wide layout" ) {
+
+      std::stringstream output;
+      areas.toCSV(output, CSVWide);
+
+      THEN( "there is a row for each measure of each area, with a column for each year" ) {
+
+        std::string line;
+        REQUIRE( std::getline(output, line) );
+        auto header = splitCSVLine(line);
+        REQUIRE( header.size() == 2 + 29 );
+        REQUIRE( header[0] == "AuthorityCode" );
+        REQUIRE( header[1] == "Measure" );
+        REQUIRE( header[2] == "1991" );
+
+        size_t rows = 0;
+        while (std::getline(output, line)) {
+          auto cells = splitCSVLine(line);
+          REQUIRE( cells.size() == header.size() );
+          const auto &values = whole[cells[0]]["measures"][cells[1]];
+          for (size_t i = 2; i < cells.size(); i++) {
+            if (cells[i].empty()) {
+              REQUIRE( values.count(header[i]) == 0 );
+            } else {
+              REQUIRE( std::stod(cells[i]) == values[header[i]].get<double>() );
+            }
+          }
+          rows++;
+        }
+        REQUIRE( rows == whole.size() * 3 );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+  GIVEN( "areas whose measures have values for different years" ) {
+
+    Areas areas = Areas();
+    std::string code = "W06000011";
+    Area area(code);
+    std::string popCode = "pop";
+    Measure pop(popCode, "Population");
+    pop.setValue(2019, 246993);
+    std::string densCode = "dens";
+    Measure dens(densCode, "Population density");
+    dens.setValue(2018, 645.25);
+    area.setMeasure(popCode, pop);
+    area.setMeasure(densCode, dens);
+    areas.setArea(code, area);
+
+    std::stringstream output;
+    areas.toCSV(output, CSVWide);
+
+    THEN( "the missing years are empty cells" ) {
+
+      REQUIRE( output.str() == "AuthorityCode,Measure,2018,2019\n"
+                               "W06000011,dens,645.25,\n"
+                               "W06000011,pop,,246993\n" );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "the csv program argument can be parsed correctly", "[args][CSV]" ) {
+
+  auto parse = [](std::initializer_list<const char*> values) {
+    Argv argv(values);
+    auto** actual_argv = argv.argv();
+    auto argc          = argv.argc();
+
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args    = cxxopts.parse(argc, actual_argv);
+    return BethYw::parseCSVArg(args);
+  };
+
+  THEN( "it is the wide layout by default, or the long layout" ) {
+
+    REQUIRE( parse({"test"}) == CSVNone );
+    REQUIRE( parse({"test", "--csv"}) == CSVWide );
+    REQUIRE( parse({"test", "--csv=Long"}) == CSVLong );
+    REQUIRE_THROWS_AS( parse({"test", "--csv=tall"}), std::invalid_argument );
+
+  } // THEN
+
+} // SCENARIO
@@ -0,0 +1,278 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../lib_cxxopts.hpp"
+#include "../lib_cxxopts_argv.hpp"
+
+#include "../lib_json.hpp"
+#include "../datasets.h"
+#include "../areas.h"
+#include "../bethyw.h"
+#include "../columnar.h"
+
+/*
+  A BYWC file read back by following its layout, as a program that
+  memory-maps it would.
+*/
+struct ColumnarFile {
+  uint32_t version;
+  uint64_t rowCount;
+  uint32_t rowGroupRows;
+  std::vector<std::string> areas;
+  std::vector<std::string> measures;
+  std::vector<uint64_t> groupOffsets;
+  std::vector<uint32_t> groupRows;
+  std::vector<uint32_t> groupInvalid;
+  std::vector<std::string> rowArea;
+  std::vector<std::string> rowMeasure;
+  std::vector<uint32_t> rowYear;
+  std::vector<double> rowValue;
+  std::vector<bool> rowValid;
+};
+
+template <typename T>
+static T readColumnarField(const std::string &bytes, size_t offset) {
+  REQUIRE( offset + sizeof(T) <= bytes.size() );
+  T value;
+  std::memcpy(&value, bytes.data() + offset, sizeof(T));
+  return value;
+}
+
+static size_t readColumnarDictionary(const std::string &bytes, size_t offset, uint32_t count,
+                                     std::vector<std::string> &codes) {
+  const size_t base = offset + (count + 1) * sizeof(uint32_t);
+  for (uint32_t i = 0; i < count; i++) {
+    const uint32_t start = readColumnarField<uint32_t>(bytes, offset + i * sizeof(uint32_t));
+    const uint32_t end = readColumnarField<uint32_t>(bytes, offset + (i + 1) * sizeof(uint32_t));
+    codes.push_back(bytes.substr(base + start, end - start));
+  }
+  const size_t end = base + readColumnarField<uint32_t>(bytes, offset + count * sizeof(uint32_t));
+  return (end + 7) / 8 * 8;
+}
+
+static ColumnarFile readColumnar(const std::string &bytes) {
+  ColumnarFile file;
+  REQUIRE( bytes.substr(0, 4) == "BYWC" );
+  file.version = readColumnarField<uint32_t>(bytes, 4);
+  const uint32_t areaCount = readColumnarField<uint32_t>(bytes, 8);
+  const uint32_t measureCount = readColumnarField<uint32_t>(bytes, 12);
+  file.rowCount = readColumnarField<uint64_t>(bytes, 16);
+  file.rowGroupRows = readColumnarField<uint32_t>(bytes, 24);
+  const uint32_t groupCount = readColumnarField<uint32_t>(bytes, 28);
+  const uint64_t tableOffset = readColumnarField<uint64_t>(bytes, 32);
+
+  size_t offset = readColumnarDictionary(bytes, 40, areaCount, file.areas);
+  offset = readColumnarDictionary(bytes, offset, measureCount, file.measures);
+  REQUIRE( offset == tableOffset );
+
+  for (uint32_t g = 0; g < groupCount; g++) {
+    const uint64_t group = readColumnarField<uint64_t>(bytes, tableOffset + g * sizeof(uint64_t));
+    REQUIRE( group % 8 == 0 );
+    file.groupOffsets.push_back(group);
+
+    const uint32_t rows = readColumnarField<uint32_t>(bytes, group);
+    file.groupRows.push_back(rows);
+    file.groupInvalid.push_back(readColumnarField<uint32_t>(bytes, group + 4));
+
+    const size_t values = group + 8;
+    const size_t areas = values + rows * sizeof(double);
+    const size_t columnBytes = (rows * sizeof(uint32_t) + 7) / 8 * 8;
+    const size_t measures = areas + columnBytes;
+    const size_t years = measures + columnBytes;
+    const size_t validity = years + columnBytes;
+    for (uint32_t i = 0; i < rows; i++) {
+      file.rowValue.push_back(readColumnarField<double>(bytes, values + i * sizeof(double)));
+      file.rowArea.push_back(file.areas.at(readColumnarField<uint32_t>(bytes, areas + i * sizeof(uint32_t))));
+      file.rowMeasure.push_back(file.measures.at(readColumnarField<uint32_t>(bytes, measures + i * sizeof(uint32_t))));
+      file.rowYear.push_back(readColumnarField<uint32_t>(bytes, years + i * sizeof(uint32_t)));
+      file.rowValid.push_back((readColumnarField<uint8_t>(bytes, validity + i / 8) >> (i % 8)) & 1);
+    }
+
+    const size_t end = validity + ((rows + 7) / 8 + 7) / 8 * 8;
+    REQUIRE( end - group == ColumnarWriter::rowGroupBytes(rows) );
+    if (g + 1 == groupCount) {
+      REQUIRE( end == bytes.size() );
+    }
+  }
+
+  return file;
+}
+
+SCENARIO( "an Areas instance can be written in the columnar format", "[Areas][Columnar]" ) {
+
+  GIVEN( "the areas imported from popu1009.json" ) {
+
+    Areas areas = Areas();
+    InputFile input("datasets/popu1009.json");
+    areas.populate(input.open(), BethYw::WelshStatsJSON, BethYw::InputFiles::POPDEN.COLS, nullptr, nullptr, nullptr, nullptr);
+    const auto whole = nlohmann::json::parse(areas.toJSON());
+
+    std::stringstream output;
+    areas.toColumnar(output);
+    auto file = readColumnar(output.str());
+
+    THEN( "the dictionaries hold the sorted area and measure codes" ) {
+
+      REQUIRE( file.version == COLUMNAR_VERSION );
+      REQUIRE( file.areas.size() == whole.size() );
+      REQUIRE( file.areas.front() == whole.begin().key() );
+      REQUIRE( std::is_sorted(file.areas.begin(), file.areas.end()) );
+      REQUIRE( file.measures == std::vector<std::string>({"area", "dens", "pop"}) );
+
+    } // THEN
+
+    THEN( "there is a valid row for each value, as in the JSON output" ) {
+
+      size_t values = 0;
+      for (const auto &area : whole) {
+        for (const auto &measure : area["measures"]) {
+          values += measure.size();
+        }
+      }
+      REQUIRE( file.rowCount == values );
+      REQUIRE( file.rowValue.size() == values );
+      REQUIRE( file.groupOffsets.size() == 1 );
+      REQUIRE( file.groupInvalid[0] == 0 );
+
+      for (size_t i = 0; i < file.rowValue.size(); i++) {
+        REQUIRE( file.rowValid[i] );
+        REQUIRE( file.rowValue[i] ==
+                 whole[file.rowArea[i]]["measures"][file.rowMeasure[i]][std::to_string(file.rowYear[i])].get<double>() );
+      }
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "areas with a value that is not finite, written in row groups of two rows" ) {
+
+    Areas areas = Areas();
+    for (std::string code : {"W06000011", "W06000001"}) {
+      Area area(code);
+      std::string popCode = "pop";
+      Measure pop(popCode, "Population");
+      pop.setValue(2018, 100);
+      pop.setValue(2019, code == "W06000011" ? std::numeric_limits<double>::quiet_NaN() : 200);
+      area.setMeasure(popCode, pop);
+      areas.setArea(code, area);
+    }
+
+    std::stringstream output;
+    areas.toColumnar(output, 2);
+    auto file = readColumnar(output.str());
+
+    THEN( "the rows are split over the row groups in order" ) {
+
+      REQUIRE( file.rowGroupRows == 2 );
+      REQUIRE( file.groupRows == std::vector<uint32_t>({2, 2}) );
+      REQUIRE( file.rowArea == std::vector<std::string>({"W06000001", "W06000001", "W06000011", "W06000011"}) );
+      REQUIRE( file.rowYear == std::vector<uint32_t>({2018, 2019, 2018, 2019}) );
+
+    } // THEN
+
+    THEN( "the value that is not finite is marked as not valid" ) {
+
+      REQUIRE( file.groupInvalid == std::vector<uint32_t>({0, 1}) );
+      REQUIRE( file.rowValid == std::vector<bool>({true, true, true, false}) );
+      REQUIRE( file.rowValue == std::vector<double>({100, 200, 100, 0}) );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "a ColumnarWriter" ) {
+
+    std::stringstream output;
+    ColumnarWriter writer(output, {"W06000011"}, {"pop"}, 1);
+
+    THEN( "it must be given exactly the rows it was constructed for" ) {
+
+      REQUIRE_THROWS_AS( writer.finish(), std::out_of_range );
+      writer.append(0, 0, 2019, 246993);
+      REQUIRE_THROWS_AS( writer.append(0, 0, 2020, 247000), std::out_of_range );
+      REQUIRE_NOTHROW( writer.finish() );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "the columnar program argument can be parsed correctly", "[args][Columnar]" ) {
+
+  auto parse = [](std::initializer_list<const char*> values) {
+    Argv argv(values);
+    auto** actual_argv = argv.argv();
+    auto argc          = argv.argc();
+
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args    = cxxopts.parse(argc, actual_argv);
+    return BethYw::parseColumnarArg(args);
+  };
+
+  THEN( "it is the path of the file to write" ) {
+
+    REQUIRE( parse({"test"}) == "" );
+    REQUIRE( parse({"test", "--columnar", "popden.bywc"}) == "popden.bywc" );
+    REQUIRE_THROWS_AS( parse({"test", "--columnar="}), std::invalid_argument );
+
+  } // THEN
+
+  GIVEN( "a directory to write the file to" ) {
+
+    std::string dir = copyDatasets({});
+    Areas areas = Areas();
+    std::string code = "W06000011";
+    Area area(code);
+    std::string popCode = "pop";
+    Measure pop(popCode, "Population");
+    pop.setValue(2019, 246993);
+    area.setMeasure(popCode, pop);
+    areas.setArea(code, area);
+
+    BethYw::writeColumnarFile(areas, dir + "out.bywc");
+
+    THEN( "the file is written in full, with no temporary file left" ) {
+
+      std::ifstream written(dir + "out.bywc", std::ios::binary);
+      std::stringstream bytes;
+      bytes << written.rdbuf();
+      std::stringstream expected;
+      areas.toColumnar(expected);
+      REQUIRE( bytes.str() == expected.str() );
+      REQUIRE_FALSE( std::ifstream(dir + "out.bywc.tmp").good() );
+
+    } // THEN
+
+    THEN( "a file that cannot be opened is an error" ) {
+
+      REQUIRE_THROWS_AS( BethYw::writeColumnarFile(areas, dir + "missing/out.bywc"), std::runtime_error );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
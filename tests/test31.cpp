@@ -0,0 +1,184 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../lib_cxxopts.hpp"
+#include "../lib_cxxopts_argv.hpp"
+
+#include "../lib_json.hpp"
+#include "../datasets.h"
+#include "../areas.h"
+#include "../bethyw.h"
+#include "../store.h"
+
+/*
+  Import the areas and every dataset in a copy of the datasets directory, as
+  bethyw does, and write them as a store in the same directory.
+*/
+static std::string writeTestStore(Areas &data) {
+  std::string source = copyDatasets({"areas.csv", "popu1009.json", "econ0080.json", "envi0201.json",
+                                     "tran0152.json", "complete-popu1009-area.csv",
+                                     "complete-popu1009-pop.csv", "complete-popu1009-popden.csv"});
+  StringFilterSet none;
+  BethYw::loadAreas(data, source, none);
+  const StringFilterSet listed = data.getAreaCodes();
+  std::vector<BethYw::InputFileSource> datasets(std::begin(BethYw::InputFiles::DATASETS),
+                                                std::end(BethYw::InputFiles::DATASETS));
+  BethYw::loadDatasets(data, source, datasets, none, none, YearFilterTuple(0, 0));
+
+  std::string path = source + "wales.byws";
+  BethYw::writeStoreFile(data, path, &listed);
+  return path;
+}
+
+SCENARIO( "imported data can be queried from a store", "[ColumnarStore]" ) {
+
+  GIVEN( "a store of every dataset" ) {
+
+    Areas imported = Areas();
+    const std::string path = writeTestStore(imported);
+    ColumnarStore store(path);
+
+    THEN( "it holds every area, series and value" ) {
+
+      size_t series = 0;
+      size_t values = 0;
+      for (const auto &area : imported) {
+        series += area.second.getMeasures().size();
+        for (const auto &measure : area.second.getMeasures()) {
+          values += measure.second.getValues().size();
+        }
+      }
+      REQUIRE( store.areas() == (size_t) imported.size() );
+      REQUIRE( store.series() == series );
+      REQUIRE( store.size() == values );
+
+    } // THEN
+
+    WHEN( "it is queried without filters" ) {
+
+      Areas queried = Areas();
+      store.populate(queried);
+
+      THEN( "the data is the same as was imported" ) {
+
+        REQUIRE( queried.toJSON() == imported.toJSON() );
+        REQUIRE( queried.getHierarchy().getParents() == imported.getHierarchy().getParents() );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "it is queried with filters" ) {
+
+      const StringFilterSet areasFilter = {"abertawe", "W06000001"};
+      const StringFilterSet measuresFilter = {"POP", "dens"};
+      const YearFilterTuple yearsFilter(2010, 2012);
+
+      Areas queried = Areas();
+      store.populate(queried, &areasFilter, &measuresFilter, &yearsFilter);
+
+      Areas filtered = Areas();
+      std::string source = "datasets/";
+      BethYw::loadAreas(filtered, source, areasFilter);
+      std::vector<BethYw::InputFileSource> datasets(std::begin(BethYw::InputFiles::DATASETS),
+                                                    std::end(BethYw::InputFiles::DATASETS));
+      BethYw::loadDatasets(filtered, source, datasets, areasFilter, measuresFilter, yearsFilter);
+
+      THEN( "the data is the same as importing with the filters" ) {
+
+        REQUIRE( queried.size() == 2 );
+        REQUIRE( queried.toJSON() == filtered.toJSON() );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "it is queried for years with no values" ) {
+
+      const YearFilterTuple yearsFilter(1800, 1801);
+      Areas queried = Areas();
+      store.populate(queried, nullptr, nullptr, &yearsFilter);
+
+      THEN( "only the areas listed in areas.csv are added, with no measures" ) {
+
+        REQUIRE( queried.size() == 22 );
+        for (const auto &area : queried) {
+          REQUIRE( area.second.getMeasures().empty() );
+          REQUIRE( area.second.getNames().size() == 2 );
+        }
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+  GIVEN( "a file that is not a whole store" ) {
+
+    Areas imported = Areas();
+    const std::string path = writeTestStore(imported);
+
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream bytes;
+    bytes << file.rdbuf();
+    const std::string whole = bytes.str();
+
+    const std::string truncated = path + ".truncated";
+    std::ofstream(truncated, std::ios::binary) << whole.substr(0, whole.size() - 8);
+    const std::string other = path + ".other";
+    std::ofstream(other, std::ios::binary) << "BYWC" << whole.substr(4);
+
+    THEN( "it cannot be opened" ) {
+
+      REQUIRE_THROWS_AS( ColumnarStore(truncated), std::runtime_error );
+      REQUIRE_THROWS_AS( ColumnarStore(other), std::runtime_error );
+      REQUIRE_THROWS_AS( ColumnarStore(path + ".missing"), std::runtime_error );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "the store program arguments can be parsed correctly", "[args][ColumnarStore]" ) {
+
+  auto parse = [](std::initializer_list<const char*> values) {
+    Argv argv(values);
+    auto** actual_argv = argv.argv();
+    auto argc          = argv.argc();
+
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args    = cxxopts.parse(argc, actual_argv);
+    return BethYw::parseStoreArgs(args);
+  };
+
+  THEN( "they are the paths of the stores to write and read" ) {
+
+    REQUIRE( parse({"test"}).write == "" );
+    REQUIRE( parse({"test"}).read == "" );
+    REQUIRE( parse({"test", "--store", "wales.byws"}).write == "wales.byws" );
+    REQUIRE( parse({"test", "--from-store", "wales.byws"}).read == "wales.byws" );
+    REQUIRE_THROWS_AS( parse({"test", "--store="}), std::invalid_argument );
+    REQUIRE_THROWS_AS( parse({"test", "--from-store="}), std::invalid_argument );
+
+  } // THEN
+
+} // SCENARIO
@@ -0,0 +1,201 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "../lib_json.hpp"
+#include "../datasets.h"
+#include "../areas.h"
+#include "../ranking.h"
+
+/*
+  Import popu1009.json, optionally only the given years.
+*/
+static void importPopden(Areas &areas, const YearFilterTuple *const yearsFilter = nullptr) {
+  std::ifstream stream("datasets/popu1009.json");
+  areas.populate(stream, BethYw::WelshStatsJSON, BethYw::InputFiles::POPDEN.COLS,
+                 nullptr, nullptr, yearsFilter, nullptr);
+}
+
+SCENARIO( "a range of years of a Measure can be viewed without copying", "[MeasureRange]" ) {
+
+  GIVEN( "a Measure with values for 1991, 2001 and 2011" ) {
+
+    Measure measure("pop", "Population");
+    measure.setValue(2011, 300.0);
+    measure.setValue(1991, 100.0);
+    measure.setValue(2001, 150.0);
+
+    THEN( "a range holds the values in its years, in year order" ) {
+
+      const MeasureRange range = measure.getValues(1995, 2020);
+      REQUIRE( range.size() == 2 );
+      REQUIRE( range.begin()->first == 2001 );
+      REQUIRE( std::prev(range.end())->first == 2011 );
+      REQUIRE( &range.begin()->second == &measure.getValues().at(2001) );
+      REQUIRE( &range.getMeasure() == &measure );
+
+    } // THEN
+
+    THEN( "the bounds of a range are inclusive" ) {
+
+      REQUIRE( measure.getValues(1991, 2011).size() == 3 );
+      REQUIRE( measure.getValues(2001, 2001).size() == 1 );
+      REQUIRE( measure.getValues(1992, 2000).empty() );
+      REQUIRE( measure.getValues(2012, 2020).empty() );
+      REQUIRE( measure.getValues(2011, 1991).empty() );
+
+    } // THEN
+
+    THEN( "the statistics are of the values in the range" ) {
+
+      const MeasureRange range = measure.getValues(1991, 2001);
+      REQUIRE( range.getAverage() == 125.0 );
+      REQUIRE( range.getDifference() == 50.0 );
+      REQUIRE( range.getDifferenceAsPercentage() == 50.0 );
+      REQUIRE( measure.getValues(2011, 2011).getDifference() == 0.0 );
+      REQUIRE( std::isnan(measure.getValues(1800, 1801).getAverage()) );
+
+    } // THEN
+
+    THEN( "the statistics of every year are those of the Measure" ) {
+
+      const MeasureRange range = measure.getValues(0, 3000);
+      REQUIRE( range.getAverage() == measure.getAverage() );
+      REQUIRE( range.getDifference() == measure.getDifference() );
+      REQUIRE( range.getDifferenceAsPercentage() == measure.getDifferenceAsPercentage() );
+      REQUIRE( range.getValuesAsJSON() == measure.getValuesAsJSON() );
+
+      std::stringstream all, viewed;
+      all << measure;
+      viewed << range;
+      REQUIRE( viewed.str() == all.str() );
+
+    } // THEN
+
+    THEN( "a range can be narrowed" ) {
+
+      const MeasureRange range = measure.getValues(1995, 2020);
+      REQUIRE( range.getValues(0, 2005).size() == 1 );
+      REQUIRE( range.getValues(0, 2005).begin()->first == 2001 );
+      REQUIRE( range.getValues(1991, 1991).empty() );
+      REQUIRE( measure.getValues(1992, 2000).getValues(0, 3000).empty() );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "imported data can be output for a range of years", "[Areas][MeasureRange]" ) {
+
+  GIVEN( "popu1009.json imported for every year" ) {
+
+    Areas areas = Areas();
+    importPopden(areas);
+    const std::string everything = areas.toJSON();
+
+    WHEN( "the year view is set" ) {
+
+      const YearFilterTuple years(2010, 2012);
+      areas.setYearView(years);
+
+      Areas filtered = Areas();
+      importPopden(filtered, &years);
+
+      THEN( "the output is the same as importing only those years" ) {
+
+        REQUIRE( areas.getYearView() == years );
+        REQUIRE( areas.toJSON() == filtered.toJSON() );
+
+        std::stringstream viewed, imported;
+        viewed << areas;
+        imported << filtered;
+        REQUIRE( viewed.str() == imported.str() );
+
+        for (auto layout : {CSVWide, CSVLong}) {
+          std::stringstream viewedCSV, importedCSV;
+          areas.toCSV(viewedCSV, layout);
+          filtered.toCSV(importedCSV, layout);
+          REQUIRE( viewedCSV.str() == importedCSV.str() );
+        }
+
+        for (auto record : {NDJSONByArea, NDJSONByMeasure}) {
+          std::stringstream viewedNDJSON, importedNDJSON;
+          areas.toNDJSON(viewedNDJSON, record);
+          filtered.toNDJSON(importedNDJSON, record);
+          REQUIRE( viewedNDJSON.str() == importedNDJSON.str() );
+        }
+
+        std::stringstream viewedColumnar, importedColumnar;
+        areas.toColumnar(viewedColumnar);
+        filtered.toColumnar(importedColumnar);
+        REQUIRE( viewedColumnar.str() == importedColumnar.str() );
+
+      } // THEN
+
+      THEN( "areas are ranked by the statistics of those years" ) {
+
+        RankingQuery query;
+        query.k = 5;
+        query.measure = "pop";
+        query.statistic = RankByPercentage;
+
+        const auto viewed = rankAreas(areas, query);
+        const auto imported = rankAreas(filtered, query);
+        REQUIRE( viewed.size() == imported.size() );
+        for (size_t i = 0; i < viewed.size(); i++) {
+          REQUIRE( viewed[i].code == imported[i].code );
+          REQUIRE( viewed[i].value == imported[i].value );
+        }
+
+        query.statistic = RankByValue;
+        query.year = 2015;
+        REQUIRE( rankAreas(areas, query).empty() );
+
+      } // THEN
+
+      THEN( "the data is unchanged, and every year is output again once the view is cleared" ) {
+
+        areas.setYearView(YearFilterTuple(0, 0));
+        REQUIRE( areas.toJSON() == everything );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "the year view holds no years with values" ) {
+
+      areas.setYearView(YearFilterTuple(1800, 1801));
+
+      THEN( "every area is output without measures" ) {
+
+        const auto j = nlohmann::json::parse(areas.toJSON());
+        REQUIRE( j.size() == (size_t) areas.size() );
+        for (const auto &area : j) {
+          REQUIRE( area.count("measures") == 0 );
+        }
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
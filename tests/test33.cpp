@@ -0,0 +1,229 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <string>
+#include <vector>
+
+#include "../datasets.h"
+#include "../areas.h"
+#include "../bethyw.h"
+#include "../input.h"
+#include "../search.h"
+
+/*
+  Index every area in a copy of areas.csv, in order of their codes.
+*/
+static AreaIndex indexAreasCSV(Areas &areas) {
+  std::string source = copyDatasets({"areas.csv"});
+  StringFilterSet none;
+  BethYw::loadAreas(areas, source, none);
+
+  AreaIndex index;
+  for (const auto &area : areas) {
+    std::vector<std::string> names;
+    for (const auto &name : area.second.getNames()) {
+      names.push_back(name.second);
+    }
+    index.add(area.first, names);
+  }
+  return index;
+}
+
+SCENARIO( "area codes, names and search terms can be folded", "[AreaIndex][fold]" ) {
+
+  THEN( "letters are lowercased and Welsh accents are removed" ) {
+
+    REQUIRE( foldAreaText("Ynys Môn") == "ynys mon" );
+    REQUIRE( foldAreaText("YNYS MÔN") == "ynys mon" );
+    REQUIRE( foldAreaText("W06000011") == "w06000011" );
+    REQUIRE( foldAreaText("Ŵ ŵ Ŷ ŷ Ÿ") == "w w y y y" );
+    REQUIRE( foldAreaText("ẁ ẃ ẅ ỳ") == "w w w y" );
+    REQUIRE( foldAreaText("Éé Èè Ïï Ââ Ûû") == "ee ee ii aa uu" );
+
+  } // THEN
+
+  THEN( "other characters are left as they are" ) {
+
+    REQUIRE( foldAreaText("Æß–") == "Æß–" );
+    REQUIRE( foldAreaText("Rhondda Cynon Taf / Rhondda Cynon Taf") == "rhondda cynon taf / rhondda cynon taf" );
+    REQUIRE( foldAreaText("") == "" );
+
+  } // THEN
+
+  THEN( "a term with regular expression characters is a pattern" ) {
+
+    REQUIRE( isAreaPattern("W0600000[1-3]") );
+    REQUIRE( isAreaPattern("^swan") );
+    REQUIRE( isAreaPattern("st. asaph") );
+    REQUIRE_FALSE( isAreaPattern("ynys môn") );
+    REQUIRE_FALSE( isAreaPattern("W06000011") );
+
+  } // THEN
+
+} // SCENARIO
+
+SCENARIO( "areas can be found by part of their code or names with an AreaIndex", "[AreaIndex]" ) {
+
+  GIVEN( "an index of three areas" ) {
+
+    AreaIndex index;
+    REQUIRE( index.add("W06000001", {"Isle of Anglesey", "Ynys Môn"}) == 0 );
+    REQUIRE( index.add("W06000011", {"Swansea", "Abertawe"}) == 1 );
+    REQUIRE( index.add("W06000012", {"Neath Port Talbot", "Castell-nedd Port Talbot"}) == 2 );
+
+    THEN( "it holds them in the order they were added" ) {
+
+      REQUIRE( index.size() == 3 );
+      REQUIRE( index.getCode(1) == "W06000011" );
+      REQUIRE_THROWS_AS( index.getCode(3), std::out_of_range );
+
+    } // THEN
+
+    THEN( "a term finds the areas it is part of, in any case and with or without accents" ) {
+
+      REQUIRE( index.find("abertawe") == std::vector<uint32_t> {1} );
+      REQUIRE( index.find("SWAN") == std::vector<uint32_t> {1} );
+      REQUIRE( index.find("ynys mon") == std::vector<uint32_t> {0} );
+      REQUIRE( index.find("MÔN") == std::vector<uint32_t> {0} );
+      REQUIRE( index.find("port talbot") == std::vector<uint32_t> {2} );
+      REQUIRE( index.find("w0600001") == (std::vector<uint32_t> {1, 2}) );
+
+    } // THEN
+
+    THEN( "a term whose trigrams are spread over the names, but not in one of them, is not found" ) {
+
+      REQUIRE( index.find("swanseaabertawe").empty() );
+      REQUIRE( index.find("anglesey ynys").empty() );
+      REQUIRE( index.find("zzz").empty() );
+
+    } // THEN
+
+    THEN( "a short term is checked against every area" ) {
+
+      REQUIRE( index.find("").size() == 3 );
+      REQUIRE( index.find("ô") == (std::vector<uint32_t> {0, 2}) );
+      REQUIRE( index.find("wa") == std::vector<uint32_t> {1} );
+
+    } // THEN
+
+    THEN( "a regular expression is matched as given" ) {
+
+      REQUIRE( index.find("W0600001[12]") == (std::vector<uint32_t> {1, 2}) );
+      REQUIRE( index.find("^swan") == std::vector<uint32_t> {1} );
+      REQUIRE( index.find("^ynys mon$").empty() );
+
+    } // THEN
+
+    THEN( "a filter finds the areas that any of its terms find" ) {
+
+      REQUIRE( index.find(StringFilterSet {"swan", "anglesey", "abertawe"}) == (std::vector<uint32_t> {0, 1}) );
+      REQUIRE( index.find(StringFilterSet {}).empty() );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "an index of areas.csv" ) {
+
+    Areas areas = Areas();
+    const AreaIndex index = indexAreasCSV(areas);
+
+    THEN( "it finds the same areas as checking each of them" ) {
+
+      for (const std::string term : {"swan", "abertawe", "neath", "ynys mon", "môn", "CAER", "w0600002",
+                                     "ll", "a", "port", "ff", "bro morgannwg", "W0600000[1-5]", "^car", "nowhere"}) {
+        const StringFilterSet filter = {term};
+        std::vector<uint32_t> checked;
+        uint32_t i = 0;
+        for (const auto &area : areas) {
+          if (checkIfAreaMatchesFilter(area.second, &filter)) {
+            checked.push_back(i);
+          }
+          i++;
+        }
+        INFO( term );
+        REQUIRE( index.find(term) == checked );
+      }
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "areas are imported by their names without their accents", "[AreaIndex][areas]" ) {
+
+  GIVEN( "the --areas argument \"ynys mon\"" ) {
+
+    Areas areas = Areas();
+    std::string source = "datasets/";
+    const StringFilterSet filter = {"ynys mon"};
+    BethYw::loadAreas(areas, source, filter);
+
+    THEN( "Ynys Môn is imported" ) {
+
+      REQUIRE( areas.size() == 1 );
+      REQUIRE( areas.getArea("W06000001").getName("cym") == "Ynys Môn" );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "the --areas argument is matched once for each area, not for each row of a dataset", "[AreaIndex][areas]" ) {
+
+  GIVEN( "areas.csv imported with the --areas argument \"swan,neath\"" ) {
+
+    Areas areas = Areas();
+    std::string source = "datasets/";
+    const StringFilterSet filter = {"swan", "neath"};
+    BethYw::loadAreas(areas, source, filter);
+
+    WHEN( "a dataset is imported with the same argument" ) {
+
+      InputFile input("datasets/popu1009.json");
+      areas.populate(input.open(), BethYw::WelshStatsJSON, BethYw::InputFiles::POPDEN.COLS, &filter);
+
+      THEN( "only the areas of areas.csv that match have its values" ) {
+
+        REQUIRE( areas.size() == 2 );
+        REQUIRE( areas.getArea("W06000011").size() == 3 );
+        REQUIRE( areas.getArea("W06000012").size() == 3 );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a dataset is imported with another argument" ) {
+
+      const StringFilterSet other = {"conwy"};
+      InputFile input("datasets/popu1009.json");
+      areas.populate(input.open(), BethYw::WelshStatsJSON, BethYw::InputFiles::POPDEN.COLS, &other);
+
+      THEN( "the areas the other argument matches have its values, and the areas matched before do not" ) {
+
+        REQUIRE( areas.size() == 3 );
+        REQUIRE( areas.getArea("W06000011").size() == 0 );
+        REQUIRE( areas.getArea("W06000003").size() == 3 );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
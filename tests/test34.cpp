@@ -0,0 +1,315 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../areas.h"
+#include "../snapshot.h"
+
+/*
+  A version of the data in which every value of every area is the version's
+  number, so a reader can tell if it sees parts of two versions.
+*/
+static std::shared_ptr<const Areas> snapshotVersion(double number, int areas = 20, unsigned int years = 10) {
+  std::shared_ptr<Areas> data = std::make_shared<Areas>();
+  for (int a = 0; a < areas; a++) {
+    std::string code = "W" + std::to_string(6000000 + a);
+    Area area(code);
+    Measure measure("pop", "Population");
+    for (unsigned int year = 2000; year < 2000 + years; year++) {
+      measure.setValue(year, number);
+    }
+    area.setMeasure("pop", measure);
+    data->setArea(code, area);
+  }
+  return data;
+}
+
+/*
+  The value of every value in a version, or -1 if they are not all the same.
+*/
+static double snapshotValue(const Areas &data) {
+  double found = -2;
+  for (const auto &area : data) {
+    for (const auto &value : area.second.getMeasure("pop").getValues()) {
+      if (found == -2) {
+        found = value.second;
+      } else if (value.second != found) {
+        return -1;
+      }
+    }
+  }
+  return found;
+}
+
+SCENARIO( "versions of imported data can be published to readers as snapshots", "[AreasSnapshots]" ) {
+
+  GIVEN( "snapshots of a first version" ) {
+
+    AreasSnapshots snapshots(snapshotVersion(1));
+
+    THEN( "it is version 1, and every snapshot is of it" ) {
+
+      REQUIRE( snapshots.version() == 1 );
+      REQUIRE( snapshots.acquire() == snapshots.acquire() );
+      REQUIRE( snapshotValue(*snapshots.acquire()) == 1 );
+
+    } // THEN
+
+    WHEN( "a new version is published" ) {
+
+      std::shared_ptr<const Areas> before = snapshots.acquire();
+      std::weak_ptr<const Areas> first = before;
+      REQUIRE( snapshots.publish(snapshotVersion(2)) == 2 );
+
+      THEN( "new snapshots are of it, and snapshots already taken are unchanged" ) {
+
+        REQUIRE( snapshots.version() == 2 );
+        REQUIRE( snapshotValue(*snapshots.acquire()) == 2 );
+        REQUIRE( snapshotValue(*before) == 1 );
+
+      } // THEN
+
+      THEN( "the old version is freed when its last snapshot is let go" ) {
+
+        snapshots.publish(snapshotVersion(3));
+        REQUIRE_FALSE( first.expired() );
+        before.reset();
+        REQUIRE( first.expired() );
+
+      } // THEN
+
+    } // WHEN
+
+    THEN( "a null version cannot be published" ) {
+
+      REQUIRE_THROWS_AS( snapshots.publish(nullptr), std::invalid_argument );
+      REQUIRE_THROWS_AS( AreasSnapshots(nullptr), std::invalid_argument );
+      REQUIRE( snapshots.version() == 1 );
+
+    } // THEN
+
+    WHEN( "a version is reloaded on another thread" ) {
+
+      auto reloaded = snapshots.reload([]() { return snapshotVersion(2); });
+
+      THEN( "it is published once built" ) {
+
+        REQUIRE( reloaded.get() == 2 );
+        REQUIRE( snapshotValue(*snapshots.acquire()) == 2 );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a reload fails" ) {
+
+      auto reloaded = snapshots.reload([]() -> std::shared_ptr<const Areas> {
+        throw std::runtime_error("Failed to open file");
+      });
+
+      THEN( "the error is in the future, and nothing is published" ) {
+
+        REQUIRE_THROWS_AS( reloaded.get(), std::runtime_error );
+        REQUIRE( snapshots.version() == 1 );
+
+      } // THEN
+
+    } // WHEN
+
+    THEN( "a thread can wait for each new version until the snapshots are closed" ) {
+
+      std::vector<uint64_t> versions;
+      std::thread waiter([&snapshots, &versions]() {
+        uint64_t seen = 1;
+        while (snapshots.wait(seen)) {
+          versions.push_back(seen);
+        }
+      });
+
+      snapshots.publish(snapshotVersion(2));
+      snapshots.close();
+      waiter.join();
+      REQUIRE( !versions.empty() );
+      REQUIRE( versions.back() == 2 );
+
+    } // THEN
+
+  } // GIVEN
+
+  GIVEN( "readers taking snapshots while new versions are published" ) {
+
+    const int readerCount = 4;
+    const int versionCount = 200;
+    AreasSnapshots snapshots(snapshotVersion(1));
+    std::atomic<bool> done(false);
+    std::atomic<int> torn(0);
+    std::atomic<int> backwards(0);
+    std::atomic<long> reads(0);
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < readerCount; r++) {
+      readers.emplace_back([&]() {
+        double last = 0;
+        while (!done) {
+          std::shared_ptr<const Areas> snapshot = snapshots.acquire();
+          const double value = snapshotValue(*snapshot);
+          if (value < 0) {
+            torn++;
+          } else if (value < last) {
+            backwards++;
+          }
+          last = value;
+          reads++;
+        }
+      });
+    }
+
+    for (int v = 2; v <= versionCount; v++) {
+      snapshots.publish(snapshotVersion(v));
+    }
+    done = true;
+    for (auto &reader : readers) {
+      reader.join();
+    }
+
+    THEN( "every snapshot is of one whole version, and versions only go forward" ) {
+
+      REQUIRE( reads > 0 );
+      REQUIRE( torn == 0 );
+      REQUIRE( backwards == 0 );
+      REQUIRE( snapshots.version() == (uint64_t) versionCount );
+      REQUIRE( snapshotValue(*snapshots.acquire()) == versionCount );
+
+    } // THEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "a copy of the data shares every area until it is changed", "[AreasSnapshots][Area]" ) {
+
+  GIVEN( "a snapshot taken as a copy of the data" ) {
+
+    Areas data(*snapshotVersion(1, 2));
+    const std::string changed = "W6000000";
+    const std::string unchanged = "W6000001";
+    std::shared_ptr<const Areas> snapshot = std::make_shared<const Areas>(data);
+
+    THEN( "the areas of both are the same objects" ) {
+
+      REQUIRE( &snapshot->getArea(changed).getMeasures() == &data.getArea(changed).getMeasures() );
+      REQUIRE( &snapshot->getArea(unchanged).getMeasures() == &data.getArea(unchanged).getMeasures() );
+
+    } // THEN
+
+    WHEN( "an area of the data is changed" ) {
+
+      data.getArea(changed).editMeasure("pop").setValue(2000, 2);
+      data.getArea(changed).setName("eng", "Changed");
+
+      THEN( "only that area is copied, and the snapshot is unchanged" ) {
+
+        REQUIRE( &snapshot->getArea(changed).getMeasures() != &data.getArea(changed).getMeasures() );
+        REQUIRE( &snapshot->getArea(unchanged).getMeasures() == &data.getArea(unchanged).getMeasures() );
+        REQUIRE( data.getArea(changed).getMeasure("pop").getValue(2000) == 2 );
+        REQUIRE( data.getArea(changed).getName("eng") == "Changed" );
+        REQUIRE( snapshotValue(*snapshot) == 1 );
+        REQUIRE( snapshot->getArea(changed).getNames().empty() );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "a measure of an area of the data is replaced or removed" ) {
+
+      Measure replacement("pop", "Population");
+      replacement.setValue(2000, 3);
+      data.replaceMeasure(changed, "pop", &replacement);
+      data.getArea(unchanged).removeMeasure("pop");
+
+      THEN( "the snapshot is unchanged" ) {
+
+        REQUIRE( data.getArea(changed).getMeasure("pop").getValue(2000) == 3 );
+        REQUIRE( data.getArea(unchanged).size() == 0 );
+        REQUIRE( snapshotValue(*snapshot) == 1 );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "a SnapshotFollower follows each new version until it goes out of scope", "[AreasSnapshots]" ) {
+
+  GIVEN( "snapshots of a first version" ) {
+
+    AreasSnapshots snapshots(snapshotVersion(1));
+    std::vector<double> followed;
+
+    WHEN( "a version is published while it is following them" ) {
+
+      {
+        SnapshotFollower follower(snapshots, [&followed](const Areas &version) {
+          followed.push_back(snapshotValue(version));
+        });
+        snapshots.publish(snapshotVersion(2));
+      }
+
+      THEN( "it has followed it, and closed the snapshots" ) {
+
+        REQUIRE( !followed.empty() );
+        REQUIRE( followed.back() == 2 );
+        uint64_t seen = snapshots.version();
+        REQUIRE_FALSE( snapshots.wait(seen) );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "it is left by an exception" ) {
+
+      bool caught = false;
+      try {
+        SnapshotFollower follower(snapshots, [&followed](const Areas &version) {
+          followed.push_back(snapshotValue(version));
+        });
+        throw std::runtime_error("Failed to open file");
+      } catch (std::runtime_error &e) {
+        caught = true;
+      }
+
+      THEN( "its thread has still finished" ) {
+
+        REQUIRE( caught );
+        REQUIRE( followed.empty() );
+        uint64_t seen = snapshots.version();
+        REQUIRE_FALSE( snapshots.wait(seen) );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
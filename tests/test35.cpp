@@ -0,0 +1,169 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "../lib_cxxopts.hpp"
+#include "../lib_cxxopts_argv.hpp"
+
+#include "../bethyw.h"
+#include "../scheduler.h"
+
+/*
+  Count a thread in while it runs a task, keeping the most that ever ran at
+  once.
+*/
+struct SchedulerOccupancy {
+  std::atomic<int> running{0};
+  std::atomic<int> most{0};
+
+  void enter() {
+    const int now = ++running;
+    int seen = most.load();
+    while (now > seen && !most.compare_exchange_weak(seen, now)) {
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+
+  void leave() {
+    running--;
+  }
+};
+
+SCENARIO( "a TaskScheduler runs every task of a group once", "[TaskScheduler]" ) {
+
+  for (unsigned int threads : {1u, 4u}) {
+
+    GIVEN( "a scheduler with " + std::to_string(threads) + " thread(s)" ) {
+
+      TaskScheduler scheduler(threads);
+      REQUIRE( scheduler.size() == threads );
+
+      WHEN( "a range is split into tasks" ) {
+
+        std::vector<int> seen(1000, 0);
+        parallelFor(scheduler, seen.size(), 7, [&](size_t first, size_t last) {
+          for (size_t i = first; i < last; i++) {
+            seen[i]++;
+          }
+        });
+
+        THEN( "every item is seen exactly once" ) {
+
+          for (int count : seen) {
+            REQUIRE( count == 1 );
+          }
+
+        } // THEN
+
+      } // WHEN
+
+      WHEN( "a task throws" ) {
+
+        std::atomic<int> finished(0);
+        TaskGroup group(scheduler);
+        for (int i = 0; i < 20; i++) {
+          group.run([&finished, i]() {
+            if (i == 5) {
+              throw std::runtime_error("task 5");
+            }
+            finished++;
+          });
+        }
+
+        THEN( "wait() rethrows it once the other tasks are done" ) {
+
+          REQUIRE_THROWS_WITH( group.wait(), "task 5" );
+          REQUIRE( finished == 19 );
+          REQUIRE_NOTHROW( group.wait() );
+
+        } // THEN
+
+      } // WHEN
+
+    } // GIVEN
+
+  }
+
+} // SCENARIO
+
+SCENARIO( "nested tasks share the threads of a TaskScheduler", "[TaskScheduler]" ) {
+
+  GIVEN( "a scheduler with 3 threads" ) {
+
+    TaskScheduler scheduler(3);
+    SchedulerOccupancy occupancy;
+
+    WHEN( "each of several tasks splits itself into more tasks and waits for them" ) {
+
+      std::vector<std::vector<int>> seen(8, std::vector<int>(64, 0));
+      parallelFor(scheduler, seen.size(), 1, [&](size_t first, size_t last) {
+        for (size_t outer = first; outer < last; outer++) {
+          parallelFor(scheduler, seen[outer].size(), 4, [&](size_t from, size_t to) {
+            occupancy.enter();
+            for (size_t inner = from; inner < to; inner++) {
+              seen[outer][inner]++;
+            }
+            occupancy.leave();
+          });
+        }
+      });
+
+      THEN( "every inner item is seen once, and no more tasks ran at once than there are threads" ) {
+
+        for (const auto &items : seen) {
+          for (int count : items) {
+            REQUIRE( count == 1 );
+          }
+        }
+        REQUIRE( occupancy.most <= 3 );
+        REQUIRE( occupancy.most >= 1 );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "the threads program argument can be parsed correctly", "[args][TaskScheduler]" ) {
+
+  auto parse = [](std::initializer_list<const char*> values) {
+    Argv argv(values);
+    auto** actual_argv = argv.argv();
+    auto argc          = argv.argc();
+
+    auto cxxopts = BethYw::cxxoptsSetup();
+    auto args    = cxxopts.parse(argc, actual_argv);
+    return BethYw::parseThreadsArg(args);
+  };
+
+  THEN( "it is a number of threads, or 0 for one per processor" ) {
+
+    REQUIRE( parse({"test"}) == 0 );
+    REQUIRE( parse({"test", "--threads", "3"}) == 3 );
+    REQUIRE_THROWS_AS( parse({"test", "--threads", "-1"}), std::invalid_argument );
+    REQUIRE_THROWS_AS( parse({"test", "--threads", "lots"}), std::invalid_argument );
+    REQUIRE_THROWS_AS( parse({"test", "--threads", "100000"}), std::invalid_argument );
+
+  } // THEN
+
+} // SCENARIO
@@ -0,0 +1,305 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../datasets.h"
+#include "../areas.h"
+#include "../input.h"
+#include "../pipeline.h"
+#include "../queue.h"
+
+/*
+  Parse a page of "code value" lines into rows of the measure "m" in 2020.
+*/
+static std::string parseIngestLines(std::istream &page, const std::function<void(IngestRow &)> &emit) {
+  std::string line;
+  while (std::getline(page, line)) {
+    std::istringstream fields(line);
+    IngestRow row;
+    if (!(fields >> row.code >> row.value)) {
+      throw std::runtime_error("bad line: " + line);
+    }
+    row.measure = "m";
+    row.year = 2020;
+    emit(row);
+  }
+  return "";
+}
+
+SCENARIO( "an SPSCQueue hands items from one thread to another in order", "[SPSCQueue]" ) {
+
+  GIVEN( "a queue with room for 4 items" ) {
+
+    SPSCQueue<int> queue(4);
+
+    WHEN( "a producer pushes more items than there is room for" ) {
+
+      std::thread producer([&queue]() {
+        for (int i = 0; i < 1000; i++) {
+          queue.push(i);
+        }
+        queue.close();
+      });
+
+      std::vector<int> popped;
+      int item;
+      while (queue.pop(item)) {
+        popped.push_back(item);
+      }
+      producer.join();
+
+      THEN( "the consumer gets every item in order, and then nothing" ) {
+
+        REQUIRE( popped.size() == 1000 );
+        for (int i = 0; i < 1000; i++) {
+          REQUIRE( popped[i] == i );
+        }
+        REQUIRE( queue.pushedCount() == 1000 );
+        REQUIRE_FALSE( queue.pop(item) );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "the queue is closed while items are still in it" ) {
+
+      REQUIRE( queue.push(1) );
+      REQUIRE( queue.push(2) );
+      queue.close();
+
+      THEN( "no more can be pushed, but those in it can still be popped" ) {
+
+        int item;
+        REQUIRE_FALSE( queue.push(3) );
+        REQUIRE( queue.pop(item) );
+        REQUIRE( item == 1 );
+        REQUIRE( queue.pop(item) );
+        REQUIRE( item == 2 );
+        REQUIRE_FALSE( queue.pop(item) );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "the import pipeline reads, parses and merges a dataset at once", "[pipeline]" ) {
+
+  GIVEN( "an input larger than several of the reader's buffers" ) {
+
+    std::ostringstream lines;
+    const size_t count = 100000;
+    for (size_t i = 0; i < count; i++) {
+      lines << "W" << i << " " << i << "\n";
+    }
+    const std::string text = lines.str();
+    REQUIRE( text.size() > 3 * INGEST_BUFFER_BYTES );
+
+    WHEN( "it is imported through the pipeline" ) {
+
+      std::istringstream input(text);
+      std::vector<IngestRow> merged;
+      const IngestStats before = ingestTotals();
+
+      IngestStats stats = runIngestPipeline(input, nullptr, parseIngestLines, [&merged](const IngestRow &row) {
+        merged.push_back(row);
+      });
+
+      THEN( "every row is merged in the order it was read" ) {
+
+        REQUIRE( merged.size() == count );
+        size_t inOrder = 0;
+        for (size_t i = 0; i < count; i++) {
+          if (merged[i].code == "W" + std::to_string(i) && merged[i].value == (double) i) {
+            inOrder++;
+          }
+        }
+        REQUIRE( inOrder == count );
+
+      } // THEN
+
+      THEN( "the stats count what each stage handled, and are added to the totals" ) {
+
+        REQUIRE( stats.imports == 1 );
+        REQUIRE( stats.reader.items == text.size() );
+        REQUIRE( stats.parser.items == count );
+        REQUIRE( stats.merger.items == count );
+        REQUIRE( stats.merger.utilisation() >= 0.0 );
+        REQUIRE( stats.merger.utilisation() <= 1.0 );
+
+        const IngestStats after = ingestTotals();
+        REQUIRE( after.imports == before.imports + 1 );
+        REQUIRE( after.merger.items == before.merger.items + count );
+
+      } // THEN
+
+    } // WHEN
+
+    WHEN( "the merger throws part of the way through" ) {
+
+      std::istringstream input(text);
+      size_t merged = 0;
+
+      auto import = [&]() {
+        runIngestPipeline(input, nullptr, parseIngestLines, [&merged](const IngestRow &row) {
+          if (row.code == "W5000") {
+            throw std::out_of_range("no area W5000");
+          }
+          merged++;
+        });
+      };
+
+      THEN( "its exception is rethrown, and the rows before it have been merged" ) {
+
+        REQUIRE_THROWS_WITH( import(), "no area W5000" );
+        REQUIRE( merged == 5000 );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+  GIVEN( "an input the parser cannot parse part of the way through" ) {
+
+    std::istringstream input("W1 1\nW2 2\nnot a row\nW3 3\n");
+    std::vector<std::string> merged;
+
+    WHEN( "it is imported through the pipeline" ) {
+
+      auto import = [&]() {
+        runIngestPipeline(input, nullptr, parseIngestLines, [&merged](const IngestRow &row) {
+          merged.push_back(row.code);
+        });
+      };
+
+      THEN( "the parser's exception is rethrown, once the rows before it have been merged" ) {
+
+        REQUIRE_THROWS_AS( import(), std::runtime_error );
+        REQUIRE( merged == std::vector<std::string>({"W1", "W2"}) );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "a dataset split over several pages is imported through the pipeline", "[pipeline][pages]" ) {
+
+  GIVEN( "the first page of a paged dataset" ) {
+
+    std::ifstream stream("tests/datasets/paged.json");
+    REQUIRE( stream.is_open() );
+
+    LocalPageResolver resolver("tests/datasets/");
+    Areas areas = Areas();
+
+    WHEN( "it is imported by following the pages" ) {
+
+      const IngestStats before = ingestTotals();
+      areas.populateFromWelshStatsJSONPages(stream, resolver, BethYw::InputFiles::POPDEN.COLS);
+      const IngestStats after = ingestTotals();
+
+      THEN( "it counts as one import, and the parser and merger handle the rows of every page" ) {
+
+        REQUIRE( after.imports == before.imports + 1 );
+        REQUIRE( after.parser.items - before.parser.items == 4 );
+        REQUIRE( after.merger.items - before.merger.items == 4 );
+        REQUIRE( areas.getArea("W06000011").getMeasure("pop").size() == 3 );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
+
+SCENARIO( "no more than INGEST_MAX_PIPELINES imports start threads for their stages at once", "[pipeline][threads]" ) {
+
+  GIVEN( "INGEST_MAX_PIPELINES imports held up in their mergers" ) {
+
+    std::atomic<bool> release(false);
+    std::atomic<size_t> held(0);
+    std::vector<std::thread> imports;
+    for (size_t i = 0; i < INGEST_MAX_PIPELINES; i++) {
+      imports.emplace_back([&]() {
+        std::istringstream input("W1 1\nW2 2\n");
+        bool first = true;
+        runIngestPipeline(input, nullptr, parseIngestLines, [&](const IngestRow &) {
+          if (first) {
+            first = false;
+            held++;
+            while (!release) {
+              std::this_thread::yield();
+            }
+          }
+        });
+      });
+    }
+    while (held < INGEST_MAX_PIPELINES) {
+      std::this_thread::yield();
+    }
+
+    WHEN( "another import is started" ) {
+
+      const size_t running = ingestPipelinesRunning();
+      std::istringstream input("W1 1\nW2 2\nW3 3\n");
+      std::vector<std::string> merged;
+      bool parsedHere = true;
+      const std::thread::id caller = std::this_thread::get_id();
+      IngestStats stats = runIngestPipeline(input, nullptr,
+        [&](std::istream &page, const std::function<void(IngestRow &)> &emit) {
+          parsedHere &= std::this_thread::get_id() == caller;
+          return parseIngestLines(page, emit);
+        },
+        [&merged](const IngestRow &row) {
+          merged.push_back(row.code);
+        });
+
+      release = true;
+      for (auto &thread : imports) {
+        thread.join();
+      }
+
+      THEN( "its stages take turns on the thread that started it, with the same result" ) {
+
+        REQUIRE( running == INGEST_MAX_PIPELINES );
+        REQUIRE( parsedHere );
+        REQUIRE( merged == std::vector<std::string>({"W1", "W2", "W3"}) );
+        REQUIRE( stats.reader.items == 15 );
+        REQUIRE( stats.parser.items == 3 );
+        REQUIRE( stats.merger.items == 3 );
+        REQUIRE( ingestPipelinesRunning() == 0 );
+
+      } // THEN
+
+    } // WHEN
+
+  } // GIVEN
+
+} // SCENARIO
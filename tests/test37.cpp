@@ -0,0 +1,144 @@
+
+
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  Catch2 test script — https://github.com/catchorg/Catch2
+  Catch2 is licensed under the BOOST license.
+ */
+
+#include "../lib_catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../batchread.h"
+#include "../compression.h"
+
+/*
+  Read the whole of a stream into a string.
+*/
+static std::string readWholeBatchStream(std::istream &is) {
+  return std::string(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+
+SCENARIO( "a BatchFileReader reads several files at once", "[BatchFileReader]" ) {
+
+  //a file of several chunks, whose last chunk is not a whole one.
+  std::string large;
+  for (size_t i = 0; large.size() < 3 * BATCH_READ_CHUNK_BYTES + 12345; i++) {
+    large += std::to_string(i) + ",";
+  }
+  std::ofstream("tests/datasets/batch-large.txt", std::ios::binary) << large;
+
+  std::ifstream plain("datasets/popu1009.json", std::ios::binary);
+  const std::string popu1009 = readWholeBatchStream(plain);
+
+  const std::vector<std::string> paths = {
+    "tests/datasets/batch-large.txt",
+    "datasets/popu1009.json",
+    "tests/datasets/popu1009.json.gz",
+    "tests/datasets/missing.json"
+  };
+
+  for (bool allowIOUring : {true, false}) {
+
+    GIVEN( std::string("a reader for a batch of files, ") + (allowIOUring ? "with io_uring if available" : "with pread") ) {
+
+      BatchFileReader reader(paths, allowIOUring);
+      REQUIRE( reader.size() == 4 );
+      if (!allowIOUring) {
+        REQUIRE_FALSE( reader.usesIOUring() );
+      }
+
+      WHEN( "each file is read through its InputSource" ) {
+
+        auto first = reader.open(0);
+        auto second = reader.open(1);
+        auto compressed = reader.open(2);
+
+        THEN( "the contents are those of the files, decompressed if necessary" ) {
+
+          REQUIRE( readWholeBatchStream(first->open()) == large );
+          REQUIRE( readWholeBatchStream(second->open()) == popu1009 );
+          REQUIRE( readWholeBatchStream(compressed->open()) == popu1009 );
+
+        } // THEN
+
+      } // WHEN
+
+      WHEN( "the files are read in a different order to the one they were given in" ) {
+
+        auto compressed = reader.open(2);
+        auto first = reader.open(0);
+
+        THEN( "each file is still read in full" ) {
+
+          REQUIRE( readWholeBatchStream(compressed->open()) == popu1009 );
+          REQUIRE( readWholeBatchStream(first->open()) == large );
+
+        } // THEN
+
+      } // WHEN
+
+      WHEN( "a file is discarded, or its source destroyed part of the way through" ) {
+
+        reader.discard(0);
+        {
+          auto second = reader.open(1);
+          second->open().get();
+        }
+
+        THEN( "nothing more is read from it, and the other files are unaffected" ) {
+
+          BatchFileReader::Chunk chunk;
+          REQUIRE_FALSE( reader.next(0, chunk) );
+          REQUIRE_FALSE( reader.next(1, chunk) );
+          REQUIRE( readWholeBatchStream(reader.open(2)->open()) == popu1009 );
+
+        } // THEN
+
+      } // WHEN
+
+      WHEN( "a file that does not exist is opened" ) {
+
+        auto missing = reader.open(3);
+
+        THEN( "the same exception is thrown as for an InputFile" ) {
+
+          REQUIRE_FALSE( reader.isOpen(3) );
+          REQUIRE_THROWS_WITH( missing->open(), "InputFile::open: Failed to open file tests/datasets/missing.json" );
+
+        } // THEN
+
+      } // WHEN
+
+    } // GIVEN
+
+  }
+
+  std::remove("tests/datasets/batch-large.txt");
+
+} // SCENARIO
+
+SCENARIO( "a gzipped copy of a file is found in place of a missing file", "[BatchFileReader][compression]" ) {
+
+  THEN( "resolveInputFile() returns the path of the file that exists" ) {
+
+    REQUIRE( resolveInputFile("datasets/popu1009.json") == "datasets/popu1009.json" );
+    REQUIRE( resolveInputFile("tests/datasets/popu1009.json") == "tests/datasets/popu1009.json.gz" );
+    REQUIRE( resolveInputFile("tests/datasets/missing.json") == "tests/datasets/missing.json" );
+
+  } // THEN
+
+} // SCENARIO
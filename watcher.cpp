@@ -0,0 +1,700 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the implementation of IncrementalLoader and
+  DirectoryWatcher. See the header file for additional comments.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <utility>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "bethyw.h"
+#include "watcher.h"
+
+/**
+  Add the values of a Measure to the Measure with the same codename in an
+  Area, or add a copy of the Measure if the Area does not have one. As in a
+  full import, an existing Measure keeps its label.
+
+  @param area
+    The Area to add to
+
+  @param key
+    The codename of the Measure
+
+  @param measure
+    The Measure to add
+*/
+static void mergeMeasure(Area &area, const std::string &key, const Measure &measure) {
+	try {
+		Measure &existing = area.editMeasure(key);
+		for (const auto &it : measure.getValues()) {
+			existing.setValue(it.first, it.second);
+		}
+	} catch (std::out_of_range &e) {
+		area.setMeasure(key, measure);
+	}
+}
+
+/**
+  Count the years that are only in one of two sets of values, or that have a
+  different value in each.
+
+  @param lhs
+    The first set of values
+
+  @param rhs
+    The second set of values
+
+  @return
+    The number of years that differ
+*/
+static size_t countDifferences(const MeasureValues &lhs, const MeasureValues &rhs) {
+	size_t differences = 0;
+	auto l = lhs.begin();
+	auto r = rhs.begin();
+
+	while (l != lhs.end() || r != rhs.end()) {
+		if (r == rhs.end() || (l != lhs.end() && l->first < r->first)) {
+			differences++;
+			l++;
+		} else if (l == lhs.end() || r->first < l->first) {
+			differences++;
+			r++;
+		} else {
+			differences += (l->second != r->second) ? 1 : 0;
+			l++;
+			r++;
+		}
+	}
+
+	return differences;
+}
+
+/**
+  @param area
+    An Area
+
+  @return
+    The number of values across every Measure in the Area
+*/
+static size_t countValues(const Area &area) {
+	size_t count = 0;
+	for (const auto &it : area.getMeasures()) {
+		count += it.second.size();
+	}
+	return count;
+}
+
+/**
+  Compare the old and new contributions of a source, recording which Areas
+  and Measures will have to be rebuilt.
+
+  @param before
+    What the source contributed before it changed
+
+  @param after
+    What the source contributes now
+
+  @param areas
+    Added to with the codes of Areas the source added, removed or renamed
+
+  @param measures
+    Added to with the (area code, measure code) of Measures whose label or
+    values changed
+
+  @param changed
+    Added to with the number of values added, removed or changed
+
+  @return
+    true if the source added, removed or renamed any Areas, which can change
+    what later sources import
+*/
+static bool diffContributions(const Areas &before,
+							  const Areas &after,
+							  std::set<std::string> &areas,
+							  std::set<std::pair<std::string, std::string>> &measures,
+							  size_t &changed) {
+	bool areas_changed = false;
+	auto b = before.begin();
+	auto a = after.begin();
+
+	while (b != before.end() || a != after.end()) {
+		if (a == after.end() || (b != before.end() && b->first < a->first)) {
+			areas.insert(b->first);
+			changed += countValues(b->second);
+			areas_changed = true;
+			b++;
+			continue;
+		}
+		if (b == before.end() || a->first < b->first) {
+			areas.insert(a->first);
+			changed += countValues(a->second);
+			areas_changed = true;
+			a++;
+			continue;
+		}
+
+		if (b->second.getNames() != a->second.getNames()) {
+			areas.insert(a->first);
+			areas_changed = true;
+		}
+
+		const auto &old_measures = b->second.getMeasures();
+		const auto &new_measures = a->second.getMeasures();
+		auto bm = old_measures.begin();
+		auto am = new_measures.begin();
+		while (bm != old_measures.end() || am != new_measures.end()) {
+			if (am == new_measures.end() || (bm != old_measures.end() && bm->first < am->first)) {
+				measures.emplace(a->first, bm->first);
+				changed += bm->second.size();
+				bm++;
+			} else if (bm == old_measures.end() || am->first < bm->first) {
+				measures.emplace(a->first, am->first);
+				changed += am->second.size();
+				am++;
+			} else {
+				size_t differences = countDifferences(bm->second.getValues(), am->second.getValues());
+				if (differences > 0 || bm->second.getLabel() != am->second.getLabel()) {
+					measures.emplace(a->first, am->first);
+					changed += differences;
+				}
+				bm++;
+				am++;
+			}
+		}
+
+		b++;
+		a++;
+	}
+
+	return areas_changed;
+}
+
+/**
+  Constructor for a loader of areas.csv and `datasets` from `dir` into
+  `areas`, with the same filters as BethYw::loadDatasets(). Nothing is
+  imported until load() is called.
+
+  @param areas
+    The Areas instance to keep up to date, which should be empty
+
+  @param dir
+    The directory the files are in, including the trailing separator
+
+  @param datasets
+    The datasets to import, in the order they would be imported
+
+  @param areas_filter
+    The areas to import (empty for all)
+
+  @param measures_filter
+    The measures to import (empty for all)
+
+  @param years_filter
+    The years to import ((0, 0) for all)
+
+  @param resolver
+    Finds the pages of paged JSON datasets, or nullptr to read them from
+    sibling files in `dir`
+
+  @example
+    Areas data = Areas();
+    IncrementalLoader loader(data, "datasets/", datasets, areasFilter, measuresFilter, yearsFilter);
+    loader.load();
+*/
+IncrementalLoader::IncrementalLoader(
+	Areas &_areas,
+	const std::string &_dir,
+	const std::vector<BethYw::InputFileSource> &_datasets,
+	const StringFilterSet &_areas_filter,
+	const StringFilterSet &_measures_filter,
+	const YearFilterTuple &_years_filter,
+	const PageResolver *const _resolver)
+	: areas(_areas), dir(_dir), datasets(_datasets), areas_filter(_areas_filter),
+	  measures_filter(_measures_filter), years_filter(_years_filter), resolver(_resolver) {
+
+	if (resolver == nullptr) {
+		default_resolver = BethYw::makePageResolver(dir, 1);
+		resolver = default_resolver.get();
+	}
+}
+
+/**
+  Import areas.csv and every dataset, in the same way as BethYw::loadAreas()
+  followed by BethYw::loadDatasets(): a dataset that fails to import is
+  reported on the standard error and skipped.
+
+  @throws
+    std::runtime_error if areas.csv cannot be imported
+
+  @example
+    loader.load();
+*/
+void IncrementalLoader::load() {
+	std::vector<std::unique_ptr<Areas>> contributions;
+	std::vector<const Areas *> view;
+
+	contributions.push_back(stage(view, 0));
+	view.push_back(contributions.back().get());
+
+	for (size_t i = 1; i <= datasets.size(); i++) {
+		try {
+			contributions.push_back(stage(view, i));
+		} catch (std::exception &e) {
+			std::cerr << "Error importing dataset:" << std::endl << e.what() << std::endl;
+			contributions.push_back(std::unique_ptr<Areas>(new Areas()));
+		}
+		view.push_back(contributions.back().get());
+	}
+
+	sources = std::move(contributions);
+
+	std::set<std::string> codes;
+	for (const auto &source : sources) {
+		for (const auto &it : *source) {
+			codes.insert(it.first);
+		}
+	}
+	for (const auto &source : sources) {
+		areas.mergeHierarchy(*source);
+	}
+	for (const auto &code : codes) {
+		rebuildArea(code);
+	}
+}
+
+/**
+  Check whether a file in the directory is one of the files this loader
+  imports. Gzipped copies (see openInputFile()) and the later pages of paged
+  JSON datasets (see LocalPageResolver) count as the file they stand in for.
+
+  @param file
+    The name of the file, without the directory
+
+  @return
+    true if a change to the file should be passed to reload()
+
+  @example
+    loader.watches("popu1009.json");      // returns true
+    loader.watches("popu1009-1000.json"); // returns true
+    loader.watches("notes.txt");          // returns false
+*/
+bool IncrementalLoader::watches(const std::string &file) const {
+	size_t index;
+	return findSource(file, index);
+}
+
+/**
+  Find which source a file belongs to.
+
+  @param file
+    The name of the file, without the directory
+
+  @param index
+    Set to the index of the source in `sources`
+
+  @return
+    true if the file belongs to a source
+*/
+bool IncrementalLoader::findSource(const std::string &file, size_t &index) const {
+	const std::string gzip_extension = ".gz";
+	const std::string json_extension = ".json";
+
+	std::string name = file;
+	if (name.size() > gzip_extension.size()
+		&& name.compare(name.size() - gzip_extension.size(), gzip_extension.size(), gzip_extension) == 0) {
+		name.erase(name.size() - gzip_extension.size());
+	}
+
+	if (name == BethYw::InputFiles::AREAS.FILE) {
+		index = 0;
+		return true;
+	}
+
+	for (size_t i = 0; i < datasets.size(); i++) {
+		const std::string &dataset_file = datasets[i].FILE;
+		if (name == dataset_file) {
+			index = i + 1;
+			return true;
+		}
+
+		//later pages are named <name>-<first row>.json.
+		if (datasets[i].PARSER != BethYw::WelshStatsJSON || dataset_file.size() <= json_extension.size()) {
+			continue;
+		}
+		std::string prefix = dataset_file.substr(0, dataset_file.size() - json_extension.size()) + "-";
+		if (name.size() > prefix.size() + json_extension.size()
+			&& name.compare(0, prefix.size(), prefix) == 0
+			&& name.compare(name.size() - json_extension.size(), json_extension.size(), json_extension) == 0) {
+			std::string row = name.substr(prefix.size(), name.size() - prefix.size() - json_extension.size());
+			if (row.find_first_not_of("0123456789") == std::string::npos) {
+				index = i + 1;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/**
+  @param index
+    The index of a source in `sources`
+
+  @return
+    The code of the source's dataset, e.g. "popden"
+*/
+std::string IncrementalLoader::sourceCode(size_t index) const {
+	return index == 0 ? BethYw::InputFiles::AREAS.CODE : datasets[index - 1].CODE;
+}
+
+/**
+  Build the Areas that the source at `index` would see in a full import: the
+  Areas (with their names, but no Measures) contributed by the sources
+  before it.
+
+  @param contributions
+    What each source contributes
+
+  @param index
+    The index of the source about to be imported
+
+  @return
+    A new Areas instance holding the known Areas
+*/
+std::unique_ptr<Areas> IncrementalLoader::known(const std::vector<const Areas *> &contributions,
+												size_t index) const {
+	std::unique_ptr<Areas> result(new Areas());
+
+	for (size_t i = 0; i < index; i++) {
+		for (const auto &it : *contributions[i]) {
+			try {
+				Area &existing = result->getArea(it.first);
+				for (const auto &name : it.second.getNames()) {
+					if (existing.getNames().count(name.first) == 0) {
+						existing.setName(name.first, name.second);
+					}
+				}
+			} catch (std::out_of_range &e) {
+				std::string code = it.first;
+				Area area(code);
+				for (const auto &name : it.second.getNames()) {
+					area.setName(name.first, name.second);
+				}
+				result->setArea(code, area);
+			}
+		}
+	}
+
+	return result;
+}
+
+/**
+  Import the source at `index` on its own to find out what it contributes. A
+  dataset that no longer exists contributes nothing.
+
+  @param contributions
+    What each source before `index` contributes
+
+  @param index
+    The index of the source to import
+
+  @return
+    A new Areas instance holding the source's contribution
+
+  @throws
+    std::runtime_error or std::out_of_range if the source cannot be imported
+*/
+std::unique_ptr<Areas> IncrementalLoader::stage(const std::vector<const Areas *> &contributions,
+												size_t index) const {
+	std::unique_ptr<Areas> staged = known(contributions, index);
+
+	if (index == 0) {
+		BethYw::loadAreas(*staged, dir, areas_filter);
+		return staged;
+	}
+
+	const BethYw::InputFileSource &dataset = datasets[index - 1];
+	if (!isHTTPURL(dir)
+		&& !std::ifstream(dir + dataset.FILE).is_open()
+		&& !std::ifstream(dir + dataset.FILE + ".gz").is_open()) {
+		return std::unique_ptr<Areas>(new Areas());
+	}
+
+	auto input = BethYw::openDatasetSource(dir, dataset);
+	staged->populate(input->open(), dataset.PARSER, dataset.COLS,
+					 &areas_filter, &measures_filter, &years_filter, resolver);
+
+	//the Areas the dataset didn't add to were only there for it to see.
+	for (const auto &code : staged->getAreaCodes()) {
+		if (staged->getArea(code).size() == 0) {
+			staged->removeArea(code);
+		}
+	}
+
+	return staged;
+}
+
+/**
+  Replace an Area in `areas` with one rebuilt from every source's
+  contribution, or remove it if no source contributes it any more.
+
+  @param code
+    The local authority code of the Area
+*/
+void IncrementalLoader::rebuildArea(const std::string &code) {
+	std::string tmp = code;
+	Area rebuilt(tmp);
+	bool present = false;
+
+	for (const auto &source : sources) {
+		try {
+			const Area &contribution = source->getArea(code);
+			present = true;
+
+			for (const auto &name : contribution.getNames()) {
+				if (rebuilt.getNames().count(name.first) == 0) {
+					rebuilt.setName(name.first, name.second);
+				}
+			}
+			for (const auto &measure : contribution.getMeasures()) {
+				mergeMeasure(rebuilt, measure.first, measure.second);
+			}
+		} catch (std::out_of_range &e) {}
+	}
+
+	areas.removeArea(code);
+	if (present) {
+		areas.setArea(code, rebuilt);
+	}
+}
+
+/**
+  Replace a Measure of an Area in `areas` with one rebuilt from every
+  source's contribution, or remove it if no source contributes it any more.
+  The Area itself must be in `areas`.
+
+  @param code
+    The local authority code of the Area
+
+  @param key
+    The codename of the Measure
+*/
+void IncrementalLoader::rebuildMeasure(const std::string &code, const std::string &key) {
+	std::unique_ptr<Measure> rebuilt;
+
+	for (const auto &source : sources) {
+		try {
+			const auto &measures = source->getArea(code).getMeasures();
+			auto it = measures.find(key);
+			if (it == measures.end()) {
+				continue;
+			}
+			if (!rebuilt) {
+				rebuilt.reset(new Measure(it->second));
+			} else {
+				for (const auto &value : it->second.getValues()) {
+					rebuilt->setValue(value.first, value.second);
+				}
+			}
+		} catch (std::out_of_range &e) {}
+	}
+
+	areas.replaceMeasure(code, key, rebuilt.get());
+}
+
+/**
+  Apply a change to a file to `areas`. Only the source the file belongs to is
+  imported again, unless the Areas it contributes (or their names) changed,
+  in which case the sources after it are too, since they may import
+  differently. Then only the Measures and Areas that differ are rebuilt.
+
+  If any source fails to import, `areas` is left as it was.
+
+  @param file
+    The name of the file that changed, without the directory
+
+  @return
+    What was imported again and how much changed. If the file is not one
+    that is watched, nothing is done.
+
+  @throws
+    std::runtime_error or std::out_of_range if the file cannot be imported
+
+  @example
+    auto result = loader.reload("popu1009.json");
+    std::cout << result.valuesChanged << " values changed" << std::endl;
+*/
+ReloadResult IncrementalLoader::reload(const std::string &file) {
+	ReloadResult result;
+	size_t index;
+	if (!findSource(file, index)) {
+		return result;
+	}
+
+	std::vector<const Areas *> view;
+	for (const auto &source : sources) {
+		view.push_back(source.get());
+	}
+
+	std::map<size_t, std::unique_ptr<Areas>> replacements;
+	std::set<std::string> changed_areas;
+	std::set<std::pair<std::string, std::string>> changed_measures;
+	bool cascade = false;
+
+	for (size_t i = index; i < sources.size() && (i == index || cascade); i++) {
+		std::unique_ptr<Areas> staged = stage(view, i);
+		cascade |= diffContributions(*sources[i], *staged, changed_areas, changed_measures, result.valuesChanged);
+		view[i] = staged.get();
+		replacements[i] = std::move(staged);
+		result.sources.push_back(sourceCode(i));
+	}
+
+	//everything imported, so it is safe to start changing areas.
+	for (auto &it : replacements) {
+		sources[it.first] = std::move(it.second);
+		areas.mergeHierarchy(*sources[it.first]);
+	}
+
+	for (const auto &code : changed_areas) {
+		rebuildArea(code);
+		result.areasRebuilt++;
+		result.areasChanged.insert(code);
+	}
+	for (const auto &it : changed_measures) {
+		if (changed_areas.count(it.first) == 0) {
+			rebuildMeasure(it.first, it.second);
+			result.measuresRebuilt++;
+			result.areasChanged.insert(it.first);
+		}
+	}
+
+	return result;
+}
+
+/**
+  Constructor for a watcher of a directory. Changes are recorded from this
+  point on, and collected by wait().
+
+  @param dir
+    The directory to watch
+
+  @throws
+    std::runtime_error if the directory cannot be watched, or watching is not
+    supported on this platform
+
+  @example
+    DirectoryWatcher watcher("datasets/");
+*/
+DirectoryWatcher::DirectoryWatcher(const std::string &dir) : fd(-1), watch(-1) {
+#ifdef __linux__
+	fd = inotify_init1(IN_CLOEXEC);
+	if (fd < 0) {
+		throw std::runtime_error("DirectoryWatcher: Failed to initialise inotify");
+	}
+
+	//files are either written in place or written elsewhere and renamed into the directory.
+	watch = inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE);
+	if (watch < 0) {
+		close(fd);
+		throw std::runtime_error("DirectoryWatcher: Failed to watch " + dir);
+	}
+#else
+	throw std::runtime_error("DirectoryWatcher: Watching for changes is not supported on this platform");
+#endif
+}
+
+/**
+  Destructor for the watcher, which stops watching the directory.
+*/
+DirectoryWatcher::~DirectoryWatcher() {
+#ifdef __linux__
+	if (fd >= 0) {
+		close(fd);
+	}
+#endif
+}
+
+/**
+  Wait for files in the directory to change. Once something has changed,
+  changes keep being collected until there have been none for `settleMs`, so
+  that a file written in several steps is only reported once.
+
+  @param timeoutMs
+    How long to wait for the first change, or -1 to wait forever
+
+  @param settleMs
+    How long the directory must be quiet before returning
+
+  @return
+    The names of the files that changed, in the order they first changed, or
+    an empty vector if nothing changed before the timeout
+
+  @throws
+    std::runtime_error if the changes cannot be read
+
+  @example
+    DirectoryWatcher watcher("datasets/");
+    for (const auto &file : watcher.wait()) {
+      std::cout << file << " changed" << std::endl;
+    }
+*/
+std::vector<std::string> DirectoryWatcher::wait(int timeoutMs, int settleMs) {
+	std::vector<std::string> files;
+
+#ifdef __linux__
+	alignas(inotify_event) char buffer[4096];
+	int timeout = timeoutMs;
+
+	for (;;) {
+		pollfd request = {fd, POLLIN, 0};
+		int ready = poll(&request, 1, timeout);
+		if (ready < 0 && errno == EINTR) {
+			continue;
+		}
+		if (ready < 0) {
+			throw std::runtime_error("DirectoryWatcher: Failed to wait for changes");
+		}
+		if (ready == 0) {
+			break;
+		}
+
+		ssize_t length = read(fd, buffer, sizeof(buffer));
+		if (length < 0) {
+			throw std::runtime_error("DirectoryWatcher: Failed to read changes");
+		}
+
+		for (char *pos = buffer; pos < buffer + length;) {
+			const inotify_event *event = (const inotify_event *) pos;
+			if (event->len > 0) {
+				std::string name(event->name);
+				if (std::find(files.begin(), files.end(), name) == files.end()) {
+					files.push_back(name);
+				}
+			}
+			pos += sizeof(inotify_event) + event->len;
+		}
+
+		timeout = settleMs;
+	}
+#endif
+
+	return files;
+}
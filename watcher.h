@@ -0,0 +1,115 @@
+#ifndef WATCHER_H_
+#define WATCHER_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains declarations for keeping a loaded Areas instance up to
+  date as the files in the datasets directory change, without importing
+  every dataset again.
+
+  IncrementalLoader keeps what each source (areas.csv and each dataset)
+  contributed to the Areas instance separately. When a file changes, only
+  that source is parsed again, the old and new contributions are compared,
+  and only the Measures (or, if a source's areas changed, the Areas) that
+  differ are rebuilt from the contributions, respecting the order the sources
+  were loaded in. Everything else in the Areas instance is left alone.
+
+  DirectoryWatcher reports which files in a directory have been written,
+  using inotify on Linux.
+ */
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "datasets.h"
+#include "areas.h"
+#include "input.h"
+
+/*
+  What a call to IncrementalLoader::reload() did.
+*/
+struct ReloadResult {
+	//the codes of the datasets that were parsed again (areas for areas.csv).
+	std::vector<std::string> sources;
+
+	//the number of values that were added, removed or changed.
+	size_t valuesChanged = 0;
+
+	//the number of Measures and Areas rebuilt in the Areas instance.
+	size_t measuresRebuilt = 0;
+	size_t areasRebuilt = 0;
+
+	//the codes of the areas whose data changed.
+	std::set<std::string> areasChanged;
+};
+
+/*
+  Loads areas.csv and a list of datasets into an Areas instance, and applies
+  later changes to any of those files to it.
+
+  Each dataset is imported on its own into a copy of the areas known before
+  it, so it sees the same areas (and area names, which the area filter
+  matches against) as it would in a full import. The contributions are
+  combined as a full import would: area names and measure labels from the
+  first source to have them, and values from the last.
+*/
+class IncrementalLoader {
+ private:
+	Areas &areas;
+	std::string dir;
+	const std::vector<BethYw::InputFileSource> datasets;
+	const StringFilterSet areas_filter;
+	const StringFilterSet measures_filter;
+	const YearFilterTuple years_filter;
+	std::unique_ptr<PageResolver> default_resolver;
+	const PageResolver *resolver;
+
+	//what each source contributed: index 0 is areas.csv, then each dataset in order.
+	std::vector<std::unique_ptr<Areas>> sources;
+
+	bool findSource(const std::string &file, size_t &index) const;
+	std::string sourceCode(size_t index) const;
+	std::unique_ptr<Areas> known(const std::vector<const Areas *> &contributions, size_t index) const;
+	std::unique_ptr<Areas> stage(const std::vector<const Areas *> &contributions, size_t index) const;
+	void rebuildArea(const std::string &code);
+	void rebuildMeasure(const std::string &code, const std::string &measure);
+
+ public:
+	IncrementalLoader(
+		Areas &areas,
+		const std::string &dir,
+		const std::vector<BethYw::InputFileSource> &datasets,
+		const StringFilterSet &areas_filter,
+		const StringFilterSet &measures_filter,
+		const YearFilterTuple &years_filter,
+		const PageResolver *const resolver = nullptr);
+
+	void load();
+	bool watches(const std::string &file) const;
+	ReloadResult reload(const std::string &file);
+};
+
+/*
+  Watches a directory for files being written, created, renamed into it or
+  deleted.
+*/
+class DirectoryWatcher {
+ private:
+	int fd;
+	int watch;
+ public:
+	explicit DirectoryWatcher(const std::string &dir);
+	~DirectoryWatcher();
+	DirectoryWatcher(const DirectoryWatcher &) = delete;
+	DirectoryWatcher &operator=(const DirectoryWatcher &) = delete;
+	std::vector<std::string> wait(int timeoutMs = -1, int settleMs = 50);
+};
+
+#endif // WATCHER_H_
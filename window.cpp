@@ -0,0 +1,337 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the implementation of the window functions. See the
+  header file for additional comments.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <regex>
+#include <stdexcept>
+
+#include "window.h"
+
+#define REGEX_ROLLING_MEAN "^rolling-mean:([0-9]{1,3})$"
+
+//the number of areas in each task.
+static const size_t AREAS_PER_TASK = 64;
+
+/**
+  @return
+    The name of the window function as given to --window, which is also added
+    to the codes of the Measures it creates, e.g. "rolling-mean:3"
+*/
+std::string WindowFunction::getName() const {
+	switch (kind) {
+		case RollingMean:
+			return "rolling-mean:" + std::to_string(width);
+		case YearOnYear:
+			return "yoy";
+		case CAGR:
+			return "cagr";
+		case CumulativeSum:
+		default:
+			return "cumsum";
+	}
+}
+
+/**
+  @return
+    A description of the window function, which is added to the labels of the
+    Measures it creates
+*/
+std::string WindowFunction::describe() const {
+	switch (kind) {
+		case RollingMean:
+			return "rolling mean of " + std::to_string(width) + " years";
+		case YearOnYear:
+			return "% change on the year before";
+		case CAGR:
+			return "% compound annual growth since the first year";
+		case CumulativeSum:
+		default:
+			return "cumulative sum";
+	}
+}
+
+/**
+  Parse a list of window functions: rolling-mean:<width>, yoy, cagr and
+  cumsum. Functions given more than once are only applied once.
+
+  @param specs
+    The window functions, as given to --window
+
+  @return
+    The window functions, in the order they were given
+
+  @throws
+    std::invalid_argument if a function is not valid, with the message:
+    Invalid input for window argument: <spec>
+
+  @example
+    auto functions = parseWindowFunctions({"rolling-mean:3", "yoy"});
+*/
+std::vector<WindowFunction> parseWindowFunctions(const std::vector<std::string> &specs) {
+	std::vector<WindowFunction> functions;
+	std::regex rolling_mean (REGEX_ROLLING_MEAN);
+
+	for (auto spec : specs) {
+		std::transform(spec.begin(), spec.end(), spec.begin(), ::tolower);
+
+		WindowFunction function {WindowFunction::CumulativeSum, 0};
+		std::smatch s;
+		if (std::regex_match(spec, s, rolling_mean) && std::stoul(s.str(1)) > 0) {
+			function = WindowFunction {WindowFunction::RollingMean, (unsigned int) std::stoul(s.str(1))};
+		} else if (spec == "yoy") {
+			function.kind = WindowFunction::YearOnYear;
+		} else if (spec == "cagr") {
+			function.kind = WindowFunction::CAGR;
+		} else if (spec == "cumsum") {
+			function.kind = WindowFunction::CumulativeSum;
+		} else {
+			throw std::invalid_argument("Invalid input for window argument: " + spec);
+		}
+
+		bool duplicate = false;
+		for (const auto &other : functions) {
+			duplicate |= other.getName() == function.getName();
+		}
+		if (!duplicate) {
+			functions.push_back(function);
+		}
+	}
+
+	return functions;
+}
+
+/**
+  Calculate window functions over one series of values.
+
+  @param functions
+    The window functions to calculate
+
+  @param years
+    The years of the series, in order
+
+  @param values
+    The values of the series, one for each year
+
+  @param n
+    The number of years in the series
+
+  @param results
+    Set to one series per window function, with n values each. Years a
+    function has no value for (e.g. the first year, or a year after a gap,
+    for yoy) are NaN. A rolling mean covers the years up to each value, so
+    with a gap it is the mean of fewer values, and it starts once the series
+    covers a whole window.
+
+  @example
+    std::vector<std::vector<double>> results;
+    computeWindowFunctions(functions, years.data(), values.data(), years.size(), results);
+*/
+void computeWindowFunctions(const std::vector<WindowFunction> &functions,
+							const unsigned int *years,
+							const double *values,
+							size_t n,
+							std::vector<std::vector<double>> &results) {
+	results.resize(functions.size());
+
+	//the running total, after a 0, so that the sum of any window is the difference of two totals.
+	std::vector<double> totals(n + 1);
+	totals[0] = 0.0;
+	for (size_t i = 0; i < n; i++) {
+		totals[i + 1] = totals[i] + values[i];
+	}
+
+	const double *t = totals.data();
+	const double *v = values;
+
+	for (size_t f = 0; f < functions.size(); f++) {
+		results[f].assign(n, std::numeric_limits<double>::quiet_NaN());
+		double *out = results[f].data();
+
+		switch (functions[f].kind) {
+			case WindowFunction::RollingMean: {
+				//the window is the w years up to each value, so a year missing from it is left out of the mean.
+				const unsigned int w = (unsigned int) functions[f].width;
+				size_t first = 0;
+				for (size_t i = 0; i < n; i++) {
+					while (years[i] - years[first] >= w) {
+						first++;
+					}
+					if (years[i] - years[0] + 1 >= w) {
+						out[i] = (t[i + 1] - t[first]) / (double) (i + 1 - first);
+					}
+				}
+				break;
+			}
+			case WindowFunction::YearOnYear:
+				//there is no change on the year before if that year is missing.
+				for (size_t i = 1; i < n; i++) {
+					if (years[i] - years[i - 1] == 1) {
+						out[i] = ((v[i] - v[i - 1]) / std::abs(v[i - 1])) * 100.0;
+					}
+				}
+				break;
+			case WindowFunction::CAGR:
+				for (size_t i = 1; i < n; i++) {
+					out[i] = (std::pow(v[i] / v[0], 1.0 / (double) (years[i] - years[0])) - 1.0) * 100.0;
+				}
+				break;
+			case WindowFunction::CumulativeSum:
+				for (size_t i = 0; i < n; i++) {
+					out[i] = t[i + 1];
+				}
+				break;
+		}
+	}
+}
+
+/**
+  If a Measure code is one created by a window function, return the code of
+  the Measure it was created from.
+
+  @param code
+    The code of a Measure
+
+  @param functions
+    The window functions
+
+  @return
+    The code without the name of the window function, or an empty string if
+    the code was not created by one of the functions
+
+  @example
+    windowBaseMeasure("pop:yoy", functions); // returns "pop"
+*/
+std::string windowBaseMeasure(const std::string &code, const std::vector<WindowFunction> &functions) {
+	for (const auto &function : functions) {
+		const std::string suffix = ":" + function.getName();
+		if (code.size() > suffix.size()
+			&& code.compare(code.size() - suffix.size(), suffix.size(), suffix) == 0) {
+			return code.substr(0, code.size() - suffix.size());
+		}
+	}
+	return "";
+}
+
+namespace {
+
+/*
+  A series created by a window function, before it is added to its Area.
+*/
+struct WindowSeries {
+	std::string code;
+	std::string label;
+	std::vector<unsigned int> years;
+	std::vector<double> values;
+};
+
+/*
+  Calculate the window functions for every Measure of an Area, except those
+  created by an earlier call.
+*/
+void windowArea(const Area &area, const std::vector<WindowFunction> &functions, std::vector<WindowSeries> &series) {
+	std::vector<unsigned int> years;
+	std::vector<double> values;
+	std::vector<std::vector<double>> results;
+
+	for (const auto &measure : area.getMeasures()) {
+		if (!windowBaseMeasure(measure.first, functions).empty()) {
+			continue;
+		}
+
+		years.clear();
+		values.clear();
+		for (const auto &value : measure.second.getValues()) {
+			years.push_back(value.first);
+			values.push_back(value.second);
+		}
+		computeWindowFunctions(functions, years.data(), values.data(), years.size(), results);
+
+		const std::string label = measure.second.getLabel();
+		for (size_t f = 0; f < functions.size(); f++) {
+			WindowSeries windowed;
+			windowed.code = measure.first + ":" + functions[f].getName();
+			windowed.label = label + ", " + functions[f].describe();
+			for (size_t i = 0; i < years.size(); i++) {
+				if (std::isfinite(results[f][i])) {
+					windowed.years.push_back(years[i]);
+					windowed.values.push_back(results[f][i]);
+				}
+			}
+			series.push_back(std::move(windowed));
+		}
+	}
+}
+
+} // namespace
+
+/**
+  Apply window functions to every Measure of every Area, adding (or
+  replacing) a Measure for each function. The Areas are shared out between
+  tasks on a TaskScheduler (see scheduler.h), which only read from them; the
+  new Measures are added once every task has finished.
+
+  @param areas
+    The Areas instance
+
+  @param functions
+    The window functions to apply
+
+  @param scheduler
+    The scheduler to run the tasks on, or nullptr for the shared one
+
+  @param areaCodes
+    The local authority codes of the Areas to apply the functions to, or
+    nullptr for every Area
+
+  @example
+    applyWindowFunctions(data, parseWindowFunctions({"rolling-mean:3", "yoy"}));
+*/
+void applyWindowFunctions(Areas &areas, const std::vector<WindowFunction> &functions, TaskScheduler *scheduler,
+						  const std::set<std::string> *areaCodes) {
+	if (functions.empty()) {
+		return;
+	}
+
+	std::vector<const std::string *> codes;
+	std::vector<const Area *> sources;
+	for (const auto &entry : areas) {
+		if (areaCodes != nullptr && areaCodes->count(entry.first) == 0) {
+			continue;
+		}
+		codes.push_back(&entry.first);
+		sources.push_back(&entry.second);
+	}
+
+	std::vector<std::vector<WindowSeries>> results(sources.size());
+	parallelFor(scheduler != nullptr ? *scheduler : TaskScheduler::shared(), sources.size(), AREAS_PER_TASK,
+				[&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			windowArea(*sources[i], functions, results[i]);
+		}
+	});
+
+	for (size_t i = 0; i < results.size(); i++) {
+		//setMeasure merges values, so an earlier series is replaced instead.
+		for (const auto &windowed : results[i]) {
+			if (!windowed.years.empty()) {
+				Measure measure(windowed.code, windowed.label);
+				for (size_t j = 0; j < windowed.years.size(); j++) {
+					measure.setValue(windowed.years[j], windowed.values[j]);
+				}
+				areas.replaceMeasure(*codes[i], windowed.code, &measure);
+			} else {
+				areas.replaceMeasure(*codes[i], windowed.code, nullptr);
+			}
+		}
+	}
+}
@@ -0,0 +1,60 @@
+#ifndef WINDOW_H_
+#define WINDOW_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains declarations for window functions: new series calculated
+  from each Measure's values in year order, such as a rolling mean or the
+  growth on the year before. Each window function adds a Measure alongside
+  every Measure of an area, with the function's name after the code, e.g.
+  pop:rolling-mean:3 and pop:yoy.
+
+  A Measure's values are copied into contiguous arrays, and a running total
+  is taken in a single pass. Every function is then one loop over those
+  arrays with no dependency between iterations (a rolling mean is the
+  difference of two running totals), which the compiler can vectorise. Areas
+  are shared out between tasks on a TaskScheduler, and the results are added
+  to the Areas instance once every task has finished.
+ */
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "areas.h"
+#include "scheduler.h"
+
+/*
+  A window function to apply to every Measure.
+*/
+struct WindowFunction {
+	enum Kind {RollingMean, YearOnYear, CAGR, CumulativeSum};
+
+	Kind kind;
+
+	//the number of values to average, for RollingMean.
+	unsigned int width;
+
+	std::string getName() const;
+	std::string describe() const;
+};
+
+std::vector<WindowFunction> parseWindowFunctions(const std::vector<std::string> &specs);
+
+void computeWindowFunctions(const std::vector<WindowFunction> &functions,
+							const unsigned int *years,
+							const double *values,
+							size_t n,
+							std::vector<std::vector<double>> &results);
+
+void applyWindowFunctions(Areas &areas, const std::vector<WindowFunction> &functions, TaskScheduler *scheduler = nullptr,
+						  const std::set<std::string> *areaCodes = nullptr);
+
+std::string windowBaseMeasure(const std::string &code, const std::vector<WindowFunction> &functions);
+
+#endif // WINDOW_H_
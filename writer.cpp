@@ -0,0 +1,201 @@
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the implementation of BufferedWriter. See the header
+  file for additional comments.
+ */
+
+#include <cmath>
+
+#include "lib_json.hpp"
+#include "writer.h"
+
+/**
+  Constructor for a BufferedWriter of an output stream.
+
+  @param os
+    The output stream to write to
+
+  @param blockSize
+    The number of bytes to buffer before writing them
+
+  @example
+    BufferedWriter writer(std::cout);
+    writer.write("code,value\n");
+    writer.endRecord();
+*/
+BufferedWriter::BufferedWriter(std::ostream &os, size_t blockSize) : os(os), blockSize(blockSize) {
+	buffer.reserve(blockSize * 2);
+}
+
+/**
+  Destructor, which writes anything that is still buffered.
+*/
+BufferedWriter::~BufferedWriter() {
+	try {
+		flush();
+	} catch (...) {}
+}
+
+/**
+  Append bytes to the buffer.
+
+  @param data
+    The bytes
+
+  @param size
+    The number of bytes
+*/
+void BufferedWriter::write(const char *data, size_t size) {
+	buffer.append(data, size);
+}
+
+/**
+  Append a string to the buffer.
+
+  @param str
+    The string
+*/
+void BufferedWriter::write(const std::string &str) {
+	buffer.append(str);
+}
+
+/**
+  Append a character to the buffer.
+
+  @param c
+    The character
+*/
+void BufferedWriter::write(char c) {
+	buffer.push_back(c);
+}
+
+/**
+  Append the decimal digits of a number to the buffer.
+
+  @param value
+    The number
+*/
+void BufferedWriter::writeUnsigned(unsigned long long value) {
+	char digits[20];
+	size_t n = 0;
+	do {
+		digits[n++] = (char) ('0' + value % 10);
+		value /= 10;
+	} while (value > 0);
+
+	while (n > 0) {
+		buffer.push_back(digits[--n]);
+	}
+}
+
+/**
+  Append the shortest decimal form of a number that reads back as the same
+  number, as in the JSON output (but without a ".0" on a whole number), to the
+  buffer. A number that is not finite is written as nothing, i.e. an empty
+  CSV cell.
+
+  @param value
+    The number
+
+  @example
+    writer.writeDouble(246993.0); // writes 246993
+    writer.writeDouble(0.1);      // writes 0.1
+*/
+void BufferedWriter::writeDouble(double value) {
+	if (!std::isfinite(value)) {
+		return;
+	}
+
+	//most values have only a few decimal places, which we can find and write with integer arithmetic:
+	//if n / 10^k gives back the value then the decimal n / 10^k reads back as it too.
+	static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+	const double magnitude = std::fabs(value);
+	for (size_t k = 0; k < sizeof(powers) / sizeof(powers[0]); k++) {
+		const double scaled = magnitude * powers[k];
+		if (scaled >= 9007199254740992.0) {
+			break;
+		}
+
+		const double n = std::floor(scaled + 0.5);
+		if (n / powers[k] != magnitude) {
+			continue;
+		}
+
+		//write the digits backwards from the last, putting the point in after k of them.
+		char digits[32];
+		char *start = digits + sizeof(digits);
+		unsigned long long rest = (unsigned long long) n;
+		for (size_t i = 0; i < k; i++) {
+			*--start = (char) ('0' + rest % 10);
+			rest /= 10;
+		}
+		if (k > 0) {
+			*--start = '.';
+		}
+		do {
+			*--start = (char) ('0' + rest % 10);
+			rest /= 10;
+		} while (rest > 0);
+		if (value < 0) {
+			*--start = '-';
+		}
+		buffer.append(start, (size_t) (digits + sizeof(digits) - start));
+		return;
+	}
+
+	char digits[64];
+	char *end = nlohmann::detail::to_chars(digits, digits + sizeof(digits), value);
+	if (end - digits > 2 && end[-2] == '.' && end[-1] == '0') {
+		end -= 2;
+	}
+	buffer.append(digits, (size_t) (end - digits));
+}
+
+/**
+  Append a CSV field to the buffer, quoting it if it contains a comma, a
+  quote or a line break.
+
+  @param field
+    The field
+*/
+void BufferedWriter::writeCSVField(const std::string &field) {
+	if (field.find_first_of(",\"\r\n") == std::string::npos) {
+		buffer.append(field);
+		return;
+	}
+
+	buffer.push_back('"');
+	for (char c : field) {
+		if (c == '"') {
+			buffer.push_back('"');
+		}
+		buffer.push_back(c);
+	}
+	buffer.push_back('"');
+}
+
+/**
+  Mark the end of a record, writing the buffer if it holds at least a block.
+  A block always ends with a whole record.
+*/
+void BufferedWriter::endRecord() {
+	if (buffer.size() >= blockSize) {
+		flush();
+	}
+}
+
+/**
+  Write, and flush, everything that is buffered.
+*/
+void BufferedWriter::flush() {
+	if (!buffer.empty()) {
+		os.write(buffer.data(), (std::streamsize) buffer.size());
+		buffer.clear();
+	}
+	os.flush();
+}
@@ -0,0 +1,50 @@
+#ifndef WRITER_H_
+#define WRITER_H_
+
+/*
+  +---------------------------------------+
+  | BETH YW? WELSH GOVERNMENT DATA PARSER |
+  +---------------------------------------+
+
+  AUTHOR: Oliver Morris - 979663
+
+  This file contains the declaration of BufferedWriter, which the streaming
+  output modes (NDJSON and CSV) write through. Records are appended to a
+  buffer that is written to the output stream, and flushed, once it holds at
+  least a block, so the output leaves in a few large writes that a reader can
+  start on straight away. Numbers are formatted straight into the buffer,
+  without a std::string for each one.
+ */
+
+#include <ostream>
+#include <string>
+
+/*
+  The size of the blocks a BufferedWriter writes by default.
+*/
+const size_t OUTPUT_BLOCK_BYTES = 64 * 1024;
+
+class BufferedWriter {
+ private:
+	std::ostream &os;
+	std::string buffer;
+	size_t blockSize;
+
+ public:
+	explicit BufferedWriter(std::ostream &os, size_t blockSize = OUTPUT_BLOCK_BYTES);
+	~BufferedWriter();
+
+	BufferedWriter(const BufferedWriter &other) = delete;
+	BufferedWriter &operator=(const BufferedWriter &other) = delete;
+
+	void write(const char *data, size_t size);
+	void write(const std::string &str);
+	void write(char c);
+	void writeUnsigned(unsigned long long value);
+	void writeDouble(double value);
+	void writeCSVField(const std::string &field);
+	void endRecord();
+	void flush();
+};
+
+#endif // WRITER_H_